@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <iostream>
+
+#include "base/conf.h"
+#include "base/task_pool.h"
+#include "pc/srtp_session.h"
+#include "bench_util.h"
+
+using namespace xrtc::bench;
+
+// DtlsTransport等依赖的全局变量，使用默认配置
+xrtc::GeneralConf* g_conf = new xrtc::GeneralConf();
+xrtc::TaskPool* g_dtls_handshake_pool = nullptr;
+
+static void usage(const char* prog) {
+    fprintf(stderr, "usage: %s <case> [options]\n"
+        "cases:\n"
+        "    srtp [packets] [payload_size]    per-packet SRTP/SRTCP cost of each suite (audio/video sizes)\n"
+        "    fanout [packets] [payload_size]  one packet protected for 1/10/100/1000 subscribers\n"
+        "    handshake_storm [joins] [threads]  forwarding jitter while handshakes run inline/offloaded\n"
+        "    dtls [handshakes]                in-memory DTLS handshakes between two DtlsTransport\n"
+        "    subscribers [packets] [payload_size]  forwarding CPU per viewer and join/leave cost, up to 5000 viewers\n"
+        "    ice_controller [rounds]          hundreds of candidates on one channel, incremental ranking vs full re-sort\n",
+        prog);
+}
+
+// 结果以JSON输出到stdout，方便脚本对比
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    if (!xrtc::SrtpSession::init_libsrtp()) {
+        return -1;
+    }
+
+    json result;
+    result["case"] = argv[1];
+
+    int ret = -1;
+    if (strcmp(argv[1], "srtp") == 0) {
+        ret = run_srtp_bench(argc - 2, argv + 2, result);
+    } else if (strcmp(argv[1], "fanout") == 0) {
+        ret = run_fanout_bench(argc - 2, argv + 2, result);
+    } else if (strcmp(argv[1], "handshake_storm") == 0) {
+        ret = run_handshake_storm_bench(argc - 2, argv + 2, result);
+    } else if (strcmp(argv[1], "dtls") == 0) {
+        ret = run_dtls_bench(argc - 2, argv + 2, result);
+    } else if (strcmp(argv[1], "subscribers") == 0) {
+        ret = run_subscribers_bench(argc - 2, argv + 2, result);
+    } else if (strcmp(argv[1], "ice_controller") == 0) {
+        ret = run_ice_controller_bench(argc - 2, argv + 2, result);
+    } else {
+        usage(argv[0]);
+        return -1;
+    }
+
+    std::cout << result.dump(2) << std::endl;
+    return ret;
+}
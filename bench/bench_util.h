@@ -0,0 +1,82 @@
+#ifndef __BENCH_UTIL_H_
+#define __BENCH_UTIL_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "base/json.hpp"
+
+namespace xrtc {
+namespace bench {
+
+using json = nlohmann::json;
+
+inline int64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 没有rdtsc的平台返回0，结果中只看ns
+inline uint64_t now_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// 构造一个最简单的RTP包: 12字节头 + payload
+inline void make_rtp_packet(char* buf, size_t len, uint32_t ssrc, uint16_t seq,
+        uint32_t timestamp)
+{
+    uint8_t* p = (uint8_t*)buf;
+    p[0] = 0x80;
+    p[1] = 96;
+    p[2] = seq >> 8;
+    p[3] = seq & 0xff;
+    p[4] = timestamp >> 24;
+    p[5] = (timestamp >> 16) & 0xff;
+    p[6] = (timestamp >> 8) & 0xff;
+    p[7] = timestamp & 0xff;
+    p[8] = ssrc >> 24;
+    p[9] = (ssrc >> 16) & 0xff;
+    p[10] = (ssrc >> 8) & 0xff;
+    p[11] = ssrc & 0xff;
+    for (size_t i = 12; i < len; ++i) {
+        p[i] = (uint8_t)i;
+    }
+}
+
+// 构造一个RTCP SR包，len需要是4的倍数
+inline void make_rtcp_packet(char* buf, size_t len, uint32_t ssrc) {
+    uint8_t* p = (uint8_t*)buf;
+    size_t words = len / 4 - 1;
+    p[0] = 0x80;
+    p[1] = 200;
+    p[2] = (words >> 8) & 0xff;
+    p[3] = words & 0xff;
+    p[4] = ssrc >> 24;
+    p[5] = (ssrc >> 16) & 0xff;
+    p[6] = (ssrc >> 8) & 0xff;
+    p[7] = ssrc & 0xff;
+    for (size_t i = 8; i < len; ++i) {
+        p[i] = (uint8_t)i;
+    }
+}
+
+int run_srtp_bench(int argc, char** argv, json& result);
+int run_fanout_bench(int argc, char** argv, json& result);
+int run_handshake_storm_bench(int argc, char** argv, json& result);
+int run_dtls_bench(int argc, char** argv, json& result);
+int run_subscribers_bench(int argc, char** argv, json& result);
+int run_ice_controller_bench(int argc, char** argv, json& result);
+
+} // namespace bench
+} // namespace xrtc
+
+#endif // __BENCH_UTIL_H_
@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <rtc_base/rtc_certificate_generator.h>
+#include <rtc_base/ssl_fingerprint.h>
+#include <rtc_base/ssl_stream_adapter.h>
+#include <rtc_base/time_utils.h>
+
+#include "base/event_loop.h"
+#include "ice/ice_scheduler.h"
+#include "ice/ice_transport_channel.h"
+#include "pc/dtls_transport.h"
+#include "bench_util.h"
+
+namespace xrtc {
+namespace bench {
+
+static int64_t thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+class LoopbackIceChannel;
+
+// 两个channel之间的内存链路，发送的包先入队，由pump统一投递，
+// 避免在SSL的写回调中重入对端
+struct LoopbackLink {
+    std::deque<std::pair<LoopbackIceChannel*, rtc::Buffer>> packets;
+    size_t delivered = 0;
+
+    void pump();
+};
+
+// IceTransportChannel的替身: 不收集candidate，不做连通性检查，直接把包交给对端
+class LoopbackIceChannel : public IceTransportChannel {
+public:
+    LoopbackIceChannel(EventLoop* el, IceScheduler* scheduler,
+            LoopbackLink* link) :
+        IceTransportChannel(el, nullptr, scheduler, "audio",
+                IceCandidateComponent::RTP),
+        _link(link)
+    {
+    }
+
+    void set_peer(LoopbackIceChannel* peer) { _peer = peer; }
+    void set_writable(bool writable) { _set_writable(writable); }
+
+    int send_packet(const char* data, size_t len) override {
+        _link->packets.emplace_back(_peer, rtc::Buffer(data, len));
+        return (int)len;
+    }
+
+    void deliver(const rtc::Buffer& packet) {
+        signal_read_packet(this, packet.data<char>(), packet.size(),
+                rtc::TimeMicros());
+    }
+
+private:
+    LoopbackLink* _link;
+    LoopbackIceChannel* _peer = nullptr;
+};
+
+void LoopbackLink::pump() {
+    while (!packets.empty()) {
+        auto packet = std::move(packets.front());
+        packets.pop_front();
+        ++delivered;
+        packet.first->deliver(packet.second);
+    }
+}
+
+static bool set_fingerprint(DtlsTransport* dtls, rtc::RTCCertificate* remote) {
+    std::unique_ptr<rtc::SSLFingerprint> fp =
+        rtc::SSLFingerprint::CreateFromCertificate(*remote);
+    return fp && dtls->set_remote_fingerprint(fp->algorithm,
+            fp->digest.cdata(), fp->digest.size());
+}
+
+// 完整的一次内存中DTLS握手，两端都导出SRTP密钥并比较
+static bool run_handshake(EventLoop* el, IceScheduler* scheduler,
+        rtc::RTCCertificate* server_cert, rtc::RTCCertificate* client_cert,
+        size_t* packets)
+{
+    LoopbackLink link;
+    LoopbackIceChannel server_ice(el, scheduler, &link);
+    LoopbackIceChannel client_ice(el, scheduler, &link);
+    server_ice.set_peer(&client_ice);
+    client_ice.set_peer(&server_ice);
+
+    DtlsTransport server(&server_ice);
+    DtlsTransport client(&client_ice);
+    client.set_dtls_role(rtc::SSL_CLIENT);
+
+    if (!server.set_local_certificate(server_cert) ||
+            !client.set_local_certificate(client_cert) ||
+            !set_fingerprint(&server, client_cert) ||
+            !set_fingerprint(&client, server_cert))
+    {
+        return false;
+    }
+
+    server_ice.set_writable(true);
+    client_ice.set_writable(true);
+    link.pump();
+    *packets = link.delivered;
+
+    if (server.dtls_state() != DtlsTransportState::k_connected ||
+            client.dtls_state() != DtlsTransportState::k_connected)
+    {
+        return false;
+    }
+
+    int server_cs = 0;
+    int client_cs = 0;
+    uint8_t server_keys[128];
+    uint8_t client_keys[128];
+    return server.get_srtp_crypto_suite(&server_cs) &&
+        client.get_srtp_crypto_suite(&client_cs) && server_cs == client_cs &&
+        server.export_keying_material(k_dtls_srtp_exporter_label, NULL, 0, false,
+                server_keys, sizeof(server_keys)) &&
+        client.export_keying_material(k_dtls_srtp_exporter_label, NULL, 0, false,
+                client_keys, sizeof(client_keys)) &&
+        memcmp(server_keys, client_keys, sizeof(server_keys)) == 0;
+}
+
+static void bench_key_type(const char* name, const rtc::KeyParams& params,
+        int handshakes, json& item)
+{
+    item["key_type"] = name;
+
+    rtc::scoped_refptr<rtc::RTCCertificate> server_cert =
+        rtc::RTCCertificateGenerator::GenerateCertificate(params, absl::nullopt);
+    rtc::scoped_refptr<rtc::RTCCertificate> client_cert =
+        rtc::RTCCertificateGenerator::GenerateCertificate(params, absl::nullopt);
+    if (!server_cert || !client_cert) {
+        item["error"] = "generate certificate failed";
+        return;
+    }
+
+    EventLoop el(nullptr);
+    IceScheduler scheduler(&el);
+
+    std::vector<int64_t> wall_ns;
+    int64_t total_cpu_ns = 0;
+    size_t total_packets = 0;
+    int failed = 0;
+    for (int i = 0; i < handshakes; ++i) {
+        size_t packets = 0;
+        int64_t t0 = now_ns();
+        int64_t c0 = thread_cpu_ns();
+        bool ok = run_handshake(&el, &scheduler, server_cert.get(),
+                client_cert.get(), &packets);
+        total_cpu_ns += thread_cpu_ns() - c0;
+        wall_ns.push_back(now_ns() - t0);
+        total_packets += packets;
+        failed += ok ? 0 : 1;
+    }
+
+    std::sort(wall_ns.begin(), wall_ns.end());
+    size_t n = wall_ns.size();
+
+    // 两端的计算都在本线程上，单端的开销约为一半
+    item["handshakes"] = handshakes;
+    item["failed"] = failed;
+    item["packets_per_handshake"] = (double)total_packets / handshakes;
+    item["cpu_us_per_handshake"] = total_cpu_ns / 1e3 / handshakes;
+    item["wall_p50_us"] = wall_ns[n / 2] / 1e3;
+    item["wall_p99_us"] = wall_ns[n * 99 / 100] / 1e3;
+    item["wall_max_us"] = wall_ns[n - 1] / 1e3;
+}
+
+int run_dtls_bench(int argc, char** argv, json& result) {
+    int handshakes = argc > 0 ? atoi(argv[0]) : 200;
+    if (handshakes <= 0) {
+        return -1;
+    }
+
+    result["results"] = json::array();
+
+    json ecdsa;
+    bench_key_type("ecdsa", rtc::KeyParams::ECDSA(rtc::EC_NIST_P256),
+            handshakes, ecdsa);
+    result["results"].push_back(ecdsa);
+
+    json rsa;
+    bench_key_type("rsa2048", rtc::KeyParams::RSA(2048), handshakes, rsa);
+    result["results"].push_back(rsa);
+
+    return 0;
+}
+
+} // namespace bench
+} // namespace xrtc
@@ -0,0 +1,133 @@
+#include <stdlib.h>
+
+#include <memory>
+#include <vector>
+
+#include <rtc_base/ssl_stream_adapter.h>
+
+#include "base/packet_buffer.h"
+#include "pc/srtp_session.h"
+#include "bench_util.h"
+
+namespace xrtc {
+namespace bench {
+
+static const int k_subscriber_counts[] = { 1, 10, 100, 1000 };
+
+static bool create_sessions(int cs, int count,
+        std::vector<std::unique_ptr<SrtpSession>>& sessions)
+{
+    int key_len = 0;
+    int salt_len = 0;
+    if (!rtc::GetSrtpKeyAndSaltLengths(cs, &key_len, &salt_len)) {
+        return false;
+    }
+
+    // 每个订阅者使用不同的key，模拟真实的转发场景
+    std::vector<uint8_t> key(key_len + salt_len);
+    std::vector<int> ext_ids;
+    for (int i = 0; i < count; ++i) {
+        for (auto& b : key) {
+            b = rand() & 0xff;
+        }
+
+        std::unique_ptr<SrtpSession> session(new SrtpSession());
+        if (!session->set_send(cs, key.data(), key.size(), ext_ids)) {
+            return false;
+        }
+        sessions.push_back(std::move(session));
+    }
+
+    return true;
+}
+
+static void bench_fanout(int cs, int subscribers, int packets, int payload_size,
+        bool batch, json& item)
+{
+    std::vector<std::unique_ptr<SrtpSession>> sessions;
+    if (!create_sessions(cs, subscribers, sessions)) {
+        item["error"] = "create session failed";
+        return;
+    }
+
+    int packet_len = 12 + payload_size;
+    char packet[k_packet_buffer_capacity];
+    std::vector<PacketBuffer> buffers(subscribers);
+    std::vector<SrtpProtectItem> items(subscribers);
+    int failed = 0;
+
+    int64_t start_ns = now_ns();
+    uint64_t start_cycles = now_cycles();
+
+    for (int i = 0; i < packets; ++i) {
+        make_rtp_packet(packet, packet_len, 0x12345678, (uint16_t)i, i * 3000);
+
+        if (batch) {
+            for (int j = 0; j < subscribers; ++j) {
+                buffers[j].set_data(packet, packet_len);
+                items[j].session = sessions[j].get();
+                items[j].data = buffers[j].data();
+                items[j].len = packet_len;
+                items[j].max_len = buffers[j].capacity();
+            }
+
+            SrtpSession::protect_rtp_batch(items.data(), items.size());
+            for (int j = 0; j < subscribers; ++j) {
+                failed += items[j].ok ? 0 : 1;
+            }
+        } else {
+            for (int j = 0; j < subscribers; ++j) {
+                PacketBuffer buffer;
+                buffer.set_data(packet, packet_len);
+                int len = 0;
+                if (!sessions[j]->protect_rtp(buffer.data(), packet_len,
+                            buffer.capacity(), &len))
+                {
+                    ++failed;
+                }
+            }
+        }
+    }
+
+    uint64_t cycles = now_cycles() - start_cycles;
+    int64_t ns = now_ns() - start_ns;
+    double total = (double)packets * subscribers;
+
+    item["suite"] = rtc::SrtpCryptoSuiteToName(cs);
+    item["subscribers"] = subscribers;
+    item["mode"] = batch ? "batch" : "single";
+    item["packets"] = packets;
+    item["packet_size"] = packet_len;
+    item["failed"] = failed;
+    item["ns_per_packet"] = ns / total;
+    item["cycles_per_packet"] = cycles / total;
+}
+
+int run_fanout_bench(int argc, char** argv, json& result) {
+    int packets = argc > 0 ? atoi(argv[0]) : 2000;
+    int payload_size = argc > 1 ? atoi(argv[1]) : 1200;
+    if (packets <= 0 || payload_size <= 0 ||
+            (size_t)payload_size + 12 + 64 > k_packet_buffer_capacity)
+    {
+        return -1;
+    }
+
+    int cs = rtc::kSrtpAeadAes128Gcm;
+    if (!SrtpSession::is_crypto_suite_supported(cs)) {
+        cs = rtc::kSrtpAes128CmSha1_80;
+    }
+
+    result["results"] = json::array();
+    for (int subscribers : k_subscriber_counts) {
+        for (bool batch : { false, true }) {
+            json item;
+            bench_fanout(cs, subscribers, packets, payload_size, batch, item);
+            result["results"].push_back(item);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace bench
+} // namespace xrtc
@@ -0,0 +1,198 @@
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <openssl/ec.h>
+#include <openssl/ecdh.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#include <openssl/sha.h>
+#include <rtc_base/ssl_stream_adapter.h>
+
+#include "base/event_loop.h"
+#include "base/packet_buffer.h"
+#include "base/task_pool.h"
+#include "pc/srtp_session.h"
+#include "bench_util.h"
+
+namespace xrtc {
+namespace bench {
+
+// 转发节拍：每1ms转发一批包，统计节拍的延迟作为转发抖动
+const unsigned int k_forward_tick_us = 1000;
+const int k_packets_per_tick = 20;
+const int k_ticks_after_storm = 200;
+
+// 服务端一次ECDHE_ECDSA握手的主要计算: 生成临时密钥、ECDH、签名ServerKeyExchange、
+// 验证客户端CertificateVerify
+static bool handshake_crypto(EC_KEY* identity) {
+    EC_KEY* local = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+    EC_KEY* remote = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+    bool ok = local && remote && EC_KEY_generate_key(local) &&
+        EC_KEY_generate_key(remote);
+
+    uint8_t secret[32];
+    ok = ok && ECDH_compute_key(secret, sizeof(secret),
+            EC_KEY_get0_public_key(remote), local, nullptr) > 0;
+
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(secret, sizeof(secret), digest);
+    ECDSA_SIG* sig = ok ? ECDSA_do_sign(digest, sizeof(digest), identity) : nullptr;
+    ok = sig && ECDSA_do_verify(digest, sizeof(digest), sig, identity) == 1;
+
+    ECDSA_SIG_free(sig);
+    EC_KEY_free(local);
+    EC_KEY_free(remote);
+    return ok;
+}
+
+struct StormState {
+    EventLoop* el = nullptr;
+    TimerWatcher* timer = nullptr;
+    EC_KEY* identity = nullptr;
+    SrtpSession* session = nullptr;
+    int joins = 0;
+    int handshakes_done = 0;
+    int handshakes_failed = 0;
+    int ticks_after_storm = 0;
+    int64_t storm_start_ns = 0;
+    int64_t storm_end_ns = 0;
+    int64_t last_tick_ns = 0;
+    std::vector<int64_t> jitter_ns;
+};
+
+static void on_handshake_done(StormState* state, bool ok) {
+    ++state->handshakes_done;
+    if (!ok) {
+        ++state->handshakes_failed;
+    }
+
+    if (state->handshakes_done == state->joins) {
+        state->storm_end_ns = now_ns();
+    }
+}
+
+static void forward_tick_cb(EventLoop* el, TimerWatcher* /*w*/, void* data) {
+    StormState* state = (StormState*)data;
+    int64_t now = now_ns();
+    if (state->last_tick_ns) {
+        int64_t late = now - state->last_tick_ns - k_forward_tick_us * 1000;
+        state->jitter_ns.push_back(std::max<int64_t>(late, 0));
+    }
+    state->last_tick_ns = now;
+
+    static uint16_t seq = 0;
+    for (int i = 0; i < k_packets_per_tick; ++i) {
+        PacketBuffer packet;
+        make_rtp_packet(packet.data(), 1212, 0x12345678, seq, seq * 3000);
+        ++seq;
+        int len = 0;
+        state->session->protect_rtp(packet.data(), 1212, packet.capacity(), &len);
+    }
+
+    if (state->handshakes_done == state->joins &&
+            ++state->ticks_after_storm >= k_ticks_after_storm)
+    {
+        el->stop();
+    }
+}
+
+static void bench_storm(int joins, int handshake_threads, SrtpSession* session,
+        EC_KEY* identity, json& item)
+{
+    EventLoop el(nullptr);
+    StormState state;
+    state.el = &el;
+    state.identity = identity;
+    state.session = session;
+    state.joins = joins;
+
+    std::unique_ptr<TaskPool> pool;
+    if (handshake_threads > 0) {
+        pool.reset(new TaskPool("bench_handshake", handshake_threads));
+        pool->start();
+    }
+
+    state.timer = el.create_timer(forward_tick_cb, &state, true);
+    el.start_timer(state.timer, k_forward_tick_us);
+
+    // 所有用户在同一时刻加入，握手和转发在同一个worker上
+    state.storm_start_ns = now_ns();
+    StormState* s = &state;
+    for (int i = 0; i < joins; ++i) {
+        if (pool) {
+            pool->post(i, [s]() {
+                bool ok = handshake_crypto(s->identity);
+                s->el->post_task([s, ok]() {
+                    on_handshake_done(s, ok);
+                });
+            });
+        } else {
+            el.post_task([s]() {
+                on_handshake_done(s, handshake_crypto(s->identity));
+            });
+        }
+    }
+
+    el.start();
+    el.delete_timer(state.timer);
+    if (pool) {
+        pool->stop();
+        pool->join();
+    }
+
+    std::vector<int64_t>& jitter = state.jitter_ns;
+    std::sort(jitter.begin(), jitter.end());
+    size_t n = jitter.size();
+
+    item["mode"] = pool ? "offload" : "inline";
+    item["handshake_threads"] = handshake_threads;
+    item["joins"] = joins;
+    item["failed"] = state.handshakes_failed;
+    item["storm_ms"] = (state.storm_end_ns - state.storm_start_ns) / 1e6;
+    item["ticks"] = n;
+    item["jitter_p50_us"] = n ? jitter[n / 2] / 1e3 : 0;
+    item["jitter_p99_us"] = n ? jitter[n * 99 / 100] / 1e3 : 0;
+    item["jitter_max_us"] = n ? jitter[n - 1] / 1e3 : 0;
+}
+
+int run_handshake_storm_bench(int argc, char** argv, json& result) {
+    int joins = argc > 0 ? atoi(argv[0]) : 500;
+    int handshake_threads = argc > 1 ? atoi(argv[1]) : 2;
+    if (joins <= 0 || handshake_threads <= 0) {
+        return -1;
+    }
+
+    int key_len = 0;
+    int salt_len = 0;
+    rtc::GetSrtpKeyAndSaltLengths(rtc::kSrtpAes128CmSha1_80, &key_len, &salt_len);
+    std::vector<uint8_t> key(key_len + salt_len, 0x5a);
+    std::vector<int> ext_ids;
+    SrtpSession session;
+    if (!session.set_send(rtc::kSrtpAes128CmSha1_80, key.data(), key.size(), ext_ids)) {
+        return -1;
+    }
+
+    EC_KEY* identity = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+    if (!identity || !EC_KEY_generate_key(identity)) {
+        EC_KEY_free(identity);
+        return -1;
+    }
+
+    result["forward_tick_us"] = k_forward_tick_us;
+    result["packets_per_tick"] = k_packets_per_tick;
+    result["results"] = json::array();
+    for (int threads : { 0, handshake_threads }) {
+        json item;
+        bench_storm(joins, threads, &session, identity, item);
+        result["results"].push_back(item);
+    }
+
+    EC_KEY_free(identity);
+    return 0;
+}
+
+} // namespace bench
+} // namespace xrtc
@@ -0,0 +1,365 @@
+#include <netinet/in.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <rtc_base/logging.h>
+#include <rtc_base/time_utils.h>
+
+#include "base/event_loop.h"
+#include "base/network.h"
+#include "ice/ice_connection.h"
+#include "ice/ice_controller.h"
+#include "ice/udp_port.h"
+#include "bench_util.h"
+
+namespace xrtc {
+namespace bench {
+
+// 每一轮模拟经过的时间
+static const int64_t k_round_ms = 20;
+// 和IceController一致，单位ms
+static const int k_min_improvement = 10;
+
+static const uint32_t k_type_preferences[] = {
+    ICE_TYPE_PREFERENCE_HOST,
+    ICE_TYPE_PREFERENCE_SRFLX,
+    ICE_TYPE_PREFERENCE_PRFLX,
+    ICE_TYPE_PREFERENCE_RELAY_UDP,
+};
+
+// 全量排序的参照实现: 和IceController使用同样的排序键，每次对所有connection
+// 重新排序，按改造之前的方式查找要ping的connection
+class FullController {
+public:
+    explicit FullController(const std::vector<IceConnection*>& connections) :
+        _connections(connections), _pinged(connections.size(), false) {}
+
+    void set_selected_connection(IceConnection* conn) { _selected = conn; }
+
+    IceConnection* sort_and_switch_connection() {
+        std::vector<IceConnection*> sorted(_connections);
+        std::stable_sort(sorted.begin(), sorted.end(),
+                [](IceConnection* a, IceConnection* b) {
+            if (a->write_state() != b->write_state()) {
+                return a->write_state() < b->write_state();
+            }
+
+            if (a->receiving() != b->receiving()) {
+                return a->receiving();
+            }
+
+            if (a->priority() != b->priority()) {
+                return a->priority() > b->priority();
+            }
+
+            return a->rtt() < b->rtt();
+        });
+
+        IceConnection* top = sorted.empty() ? nullptr : sorted[0];
+        if (!_ready_to_send(top) || _selected == top) {
+            return nullptr;
+        }
+
+        if (!_selected) {
+            return top;
+        }
+
+        if (top->write_state() < _selected->write_state() ||
+                (top->receiving() && !_selected->receiving()))
+        {
+            return top;
+        }
+
+        if (top->rtt() <= _selected->rtt() - k_min_improvement) {
+            return top;
+        }
+
+        return nullptr;
+    }
+
+    // consent检查的间隔是随机的，只比较是否进入consent模式
+    bool consent_mode(int64_t now) {
+        return _selected && !_weak() && !_need_more_pings() && _selected->stable(now);
+    }
+
+    PingResult select_connection_to_ping(int64_t now, int64_t last_ping_sent_ms) {
+        int ping_interval = (_weak() || _need_more_pings()) ? WEAK_PING_INTERVAL
+            : STRONG_PING_INTERVAL;
+        const IceConnection* conn = nullptr;
+        if (now >= last_ping_sent_ms + ping_interval) {
+            conn = _find_next_pingable_connection(now);
+        }
+
+        return PingResult(conn, ping_interval);
+    }
+
+    void mark_connection_pinged(IceConnection* conn) {
+        auto iter = std::find(_connections.begin(), _connections.end(), conn);
+        if (iter != _connections.end()) {
+            _pinged[iter - _connections.begin()] = true;
+        }
+    }
+
+private:
+    bool _ready_to_send(IceConnection* conn) {
+        return conn && (conn->writable() ||
+                conn->write_state() == IceConnection::STATE_WRITE_UNRELIABLE);
+    }
+
+    bool _weak() {
+        return _selected == nullptr || _selected->weak();
+    }
+
+    bool _need_more_pings() {
+        for (auto conn : _connections) {
+            if (conn->num_pings_sent() < MIN_PINGS_AT_WEAK_PING_INTERVAL) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool _is_past_ping_interval(IceConnection* conn, int64_t now) {
+        int interval = STABLE_CONNECTION_PING_INTERVAL;
+        if (conn->num_pings_sent() < MIN_PINGS_AT_WEAK_PING_INTERVAL) {
+            interval = WEAK_PING_INTERVAL;
+        } else if (_weak() || !conn->stable(now)) {
+            interval = STABLING_CONNECTION_PING_INTERVAL;
+        }
+
+        return now >= conn->last_ping_sent() + interval;
+    }
+
+    bool _is_pingable(IceConnection* conn, int64_t now) {
+        return _weak() || _is_past_ping_interval(conn, now);
+    }
+
+    // 未ping的connection中最久没有发送ping的，相同时先加入的优先
+    IceConnection* _find_pingable_in_unpinged(int64_t now) {
+        IceConnection* find_conn = nullptr;
+        for (size_t i = 0; i < _connections.size(); ++i) {
+            IceConnection* conn = _connections[i];
+            if (_pinged[i] || !_is_pingable(conn, now)) {
+                continue;
+            }
+
+            if (!find_conn || conn->last_ping_sent() < find_conn->last_ping_sent()) {
+                find_conn = conn;
+            }
+        }
+
+        return find_conn;
+    }
+
+    IceConnection* _find_next_pingable_connection(int64_t now) {
+        if (_selected && _selected->writable() && _is_past_ping_interval(_selected, now)) {
+            return _selected;
+        }
+
+        IceConnection* find_conn = _find_pingable_in_unpinged(now);
+        if (!find_conn) {
+            std::fill(_pinged.begin(), _pinged.end(), false);
+            find_conn = _find_pingable_in_unpinged(now);
+        }
+
+        return find_conn;
+    }
+
+private:
+    std::vector<IceConnection*> _connections;
+    std::vector<bool> _pinged;
+    IceConnection* _selected = nullptr;
+};
+
+// 随机改变一个connection的状态: rtt、可写、可读
+static void mutate_connection(IceConnection* conn, std::mt19937& rng, int64_t now) {
+    switch (rng() % 4) {
+        case 0:
+            // 收到ping响应: 更新rtt，变为可写、可读
+            conn->received_ping_response(5 + rng() % 300);
+            break;
+        case 1:
+            conn->set_write_state((IceConnection::WriteState)(rng() % 4));
+            break;
+        case 2:
+            // 发送ping之后长时间没有收到数据，变为不可读
+            conn->update_receiving(now + WEAK_CONNECTION_RECEIVE_TIMEOUT);
+            break;
+        default:
+            conn->received_media(now);
+            break;
+    }
+}
+
+// 一个channel上有几百个远端candidate，随机改变部分connection的状态，
+// 比较IceController增量维护的排序和全量重新排序选出的最佳connection、ping的顺序
+static void bench_candidates(EventLoop* el, int candidates, int rounds, json& item) {
+    // 失败的发送和状态变化的日志太多，只保留错误
+    rtc::LogMessage::LogToDebug(rtc::LS_ERROR);
+
+    UDPPort port(el, "video", IceCandidateComponent::RTP,
+            IceParamters("localufrag", "localpassword0123456789"));
+    Network network("lo", rtc::IPAddress(INADDR_LOOPBACK));
+    Candidate local;
+    if (port.create_ice_candidate(&network, 0, 0, local) != 0) {
+        item["error"] = "create local candidate failed";
+        return;
+    }
+
+    std::mt19937 rng(candidates);
+    std::vector<IceConnection*> connections;
+    IceController controller(nullptr);
+    for (int i = 0; i < candidates; ++i) {
+        Candidate remote;
+        remote.component = IceCandidateComponent::RTP;
+        remote.protocol = "udp";
+        remote.address = rtc::SocketAddress(rtc::IPAddress(INADDR_LOOPBACK), 20000 + i);
+        remote.port = 20000 + i;
+        // 只有几种优先级，rtt和加入顺序也会参与排序
+        remote.priority = remote.get_priority(k_type_preferences[rng() % 4], 0, 0);
+        remote.username = "remoteufrag";
+        remote.password = "remotepassword0123456789";
+        remote.type = LOCAL_PORT_TYPE;
+
+        IceConnection* conn = port.create_connection(remote);
+        connections.push_back(conn);
+        controller.add_connection(conn);
+    }
+
+    FullController full(connections);
+    int64_t now = rtc::TimeMillis();
+    int64_t last_ping_sent_ms = 0;
+    IceConnection* best_selected = nullptr;
+    int mutations = std::max(1, candidates / 20);
+    int64_t incremental_ns = 0;
+    int64_t full_ns = 0;
+    int switches = 0;
+    int pings = 0;
+    int consent_checks = 0;
+    int best_mismatches = 0;
+    int ping_mismatches = 0;
+
+    for (int round = 0; round < rounds; ++round) {
+        now += k_round_ms;
+
+        std::vector<IceConnection*> changed;
+        for (int i = 0; i < mutations; ++i) {
+            IceConnection* conn = connections[rng() % connections.size()];
+            mutate_connection(conn, rng, now);
+            changed.push_back(conn);
+        }
+
+        // 最佳connection
+        int64_t t0 = now_ns();
+        for (auto conn : changed) {
+            controller.update_connection(conn);
+        }
+        IceConnection* best = controller.sort_and_switch_connection();
+        incremental_ns += now_ns() - t0;
+
+        t0 = now_ns();
+        IceConnection* full_best = full.sort_and_switch_connection();
+        full_ns += now_ns() - t0;
+
+        if (best != full_best) {
+            ++best_mismatches;
+        }
+
+        if (best) {
+            controller.set_selected_connection(best);
+            full.set_selected_connection(best);
+            best_selected = best;
+            ++switches;
+        }
+
+        // ping的顺序
+        bool consent_mode = full.consent_mode(now);
+        t0 = now_ns();
+        PingResult result = controller.select_connection_to_ping(now, last_ping_sent_ms);
+        incremental_ns += now_ns() - t0;
+
+        if (result.consent != consent_mode) {
+            ++ping_mismatches;
+        } else if (consent_mode) {
+            // consent检查只针对选中的connection
+            if (result.conn && result.conn != best_selected) {
+                ++ping_mismatches;
+            }
+        } else {
+            t0 = now_ns();
+            PingResult full_result = full.select_connection_to_ping(now,
+                    last_ping_sent_ms);
+            full_ns += now_ns() - t0;
+
+            if (result.conn != full_result.conn ||
+                    result.ping_interval != full_result.ping_interval)
+            {
+                ++ping_mismatches;
+            }
+        }
+
+        if (!result.conn) {
+            continue;
+        }
+
+        IceConnection* conn = const_cast<IceConnection*>(result.conn);
+        last_ping_sent_ms = now;
+        if (result.consent) {
+            conn->send_consent_check(now);
+            ++consent_checks;
+        } else {
+            conn->ping(now);
+            ++pings;
+        }
+        controller.mark_connection_pinged(conn);
+        full.mark_connection_pinged(conn);
+    }
+
+    for (auto conn : connections) {
+        controller.on_connection_destroyed(conn);
+        delete conn;
+    }
+
+    item["candidates"] = candidates;
+    item["rounds"] = rounds;
+    item["mutations_per_round"] = mutations;
+    item["switches"] = switches;
+    item["pings"] = pings;
+    item["consent_checks"] = consent_checks;
+    item["incremental_ns_per_round"] = incremental_ns / rounds;
+    item["full_sort_ns_per_round"] = full_ns / rounds;
+    item["best_mismatches"] = best_mismatches;
+    item["ping_mismatches"] = ping_mismatches;
+}
+
+int run_ice_controller_bench(int argc, char** argv, json& result) {
+    int rounds = argc > 0 ? atoi(argv[0]) : 2000;
+    if (rounds <= 0) {
+        return -1;
+    }
+
+    EventLoop el(nullptr);
+
+    static const int k_candidate_counts[] = { 100, 300, 500 };
+    int ret = 0;
+    result["results"] = json::array();
+    for (int candidates : k_candidate_counts) {
+        json item;
+        bench_candidates(&el, candidates, rounds, item);
+        if (item.contains("error") || item["best_mismatches"] != 0 ||
+                item["ping_mismatches"] != 0)
+        {
+            ret = -1;
+        }
+        result["results"].push_back(item);
+    }
+
+    return ret;
+}
+
+} // namespace bench
+} // namespace xrtc
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+
+#include <iterator>
+#include <vector>
+
+#include <rtc_base/ssl_stream_adapter.h>
+
+#include "base/packet_buffer.h"
+#include "pc/srtp_session.h"
+#include "bench_util.h"
+
+namespace xrtc {
+namespace bench {
+
+// 默认测试的包大小: 音频和视频
+static const int k_default_payload_sizes[] = { 100, 1200 };
+
+static const int k_bench_suites[] = {
+    rtc::kSrtpAes128CmSha1_80,
+    rtc::kSrtpAes128CmSha1_32,
+    rtc::kSrtpAeadAes128Gcm,
+    rtc::kSrtpAeadAes256Gcm,
+};
+
+static bool bench_suite(int cs, int packets, int payload_size, json& item) {
+    int key_len = 0;
+    int salt_len = 0;
+    if (!rtc::GetSrtpKeyAndSaltLengths(cs, &key_len, &salt_len)) {
+        return false;
+    }
+
+    std::vector<uint8_t> key(key_len + salt_len);
+    for (auto& b : key) {
+        b = rand() & 0xff;
+    }
+
+    std::vector<int> ext_ids;
+    SrtpSession send_session;
+    SrtpSession recv_session;
+    if (!send_session.set_send(cs, key.data(), key.size(), ext_ids) ||
+            !recv_session.set_recv(cs, key.data(), key.size(), ext_ids))
+    {
+        return false;
+    }
+
+    int packet_len = 12 + payload_size;
+    PacketBuffer packet;
+    int64_t protect_ns = 0;
+    int64_t unprotect_ns = 0;
+    uint64_t protect_cycles = 0;
+    uint64_t unprotect_cycles = 0;
+    int failed = 0;
+
+    for (int i = 0; i < packets; ++i) {
+        make_rtp_packet(packet.data(), packet_len, 0x12345678, (uint16_t)i, i * 3000);
+
+        int len = 0;
+        int64_t t0 = now_ns();
+        uint64_t c0 = now_cycles();
+        bool ok = send_session.protect_rtp(packet.data(), packet_len,
+                packet.capacity(), &len);
+        uint64_t c1 = now_cycles();
+        int64_t t1 = now_ns();
+        ok = ok && recv_session.unprotect_rtp(packet.data(), len, &len);
+        uint64_t c2 = now_cycles();
+        int64_t t2 = now_ns();
+
+        if (!ok || len != packet_len) {
+            ++failed;
+        }
+
+        protect_ns += t1 - t0;
+        unprotect_ns += t2 - t1;
+        protect_cycles += c1 - c0;
+        unprotect_cycles += c2 - c1;
+    }
+
+    // RTCP包大小对齐到4字节
+    int rtcp_len = packet_len & ~3;
+    int64_t protect_rtcp_ns = 0;
+    int64_t unprotect_rtcp_ns = 0;
+    uint64_t protect_rtcp_cycles = 0;
+    for (int i = 0; i < packets; ++i) {
+        make_rtcp_packet(packet.data(), rtcp_len, 0x12345678);
+
+        int len = 0;
+        int64_t t0 = now_ns();
+        uint64_t c0 = now_cycles();
+        bool ok = send_session.protect_rtcp(packet.data(), rtcp_len,
+                packet.capacity(), &len);
+        uint64_t c1 = now_cycles();
+        int64_t t1 = now_ns();
+        ok = ok && recv_session.unprotect_rtcp(packet.data(), len, &len);
+        int64_t t2 = now_ns();
+
+        if (!ok || len != rtcp_len) {
+            ++failed;
+        }
+
+        protect_rtcp_ns += t1 - t0;
+        unprotect_rtcp_ns += t2 - t1;
+        protect_rtcp_cycles += c1 - c0;
+    }
+
+    item["suite"] = rtc::SrtpCryptoSuiteToName(cs);
+    item["packets"] = packets;
+    item["packet_size"] = packet_len;
+    item["failed"] = failed;
+    item["protect_rtcp_ns_per_packet"] = (double)protect_rtcp_ns / packets;
+    item["unprotect_rtcp_ns_per_packet"] = (double)unprotect_rtcp_ns / packets;
+    item["protect_rtcp_cycles_per_packet"] = (double)protect_rtcp_cycles / packets;
+    item["protect_ns_per_packet"] = (double)protect_ns / packets;
+    item["unprotect_ns_per_packet"] = (double)unprotect_ns / packets;
+    item["protect_cycles_per_packet"] = (double)protect_cycles / packets;
+    item["unprotect_cycles_per_packet"] = (double)unprotect_cycles / packets;
+    return true;
+}
+
+int run_srtp_bench(int argc, char** argv, json& result) {
+    int packets = argc > 0 ? atoi(argv[0]) : 100000;
+    std::vector<int> payload_sizes(std::begin(k_default_payload_sizes),
+            std::end(k_default_payload_sizes));
+    if (argc > 1) {
+        payload_sizes = { atoi(argv[1]) };
+    }
+
+    for (int payload_size : payload_sizes) {
+        if (packets <= 0 || payload_size <= 0 ||
+                (size_t)payload_size + 12 + 64 > k_packet_buffer_capacity)
+        {
+            return -1;
+        }
+    }
+
+    result["results"] = json::array();
+    for (int payload_size : payload_sizes) {
+        for (int cs : k_bench_suites) {
+            json item;
+            if (!SrtpSession::is_crypto_suite_supported(cs) ||
+                    !bench_suite(cs, packets, payload_size, item))
+            {
+                item["suite"] = rtc::SrtpCryptoSuiteToName(cs);
+                item["packet_size"] = 12 + payload_size;
+                item["supported"] = false;
+            } else {
+                item["supported"] = true;
+            }
+            result["results"].push_back(item);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace bench
+} // namespace xrtc
@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <rtc_base/ssl_stream_adapter.h>
+
+#include "base/event_loop.h"
+#include "ice/ice_scheduler.h"
+#include "ice/ice_transport_channel.h"
+#include "pc/dtls_srtp_transport.h"
+#include "pc/dtls_transport.h"
+#include "stream/subscriber_set.h"
+#include "bench_util.h"
+
+namespace xrtc {
+namespace bench {
+
+static const int k_viewer_counts[] = { 1, 10, 100, 1000, 2000, 5000 };
+
+static int64_t thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// IceTransportChannel的替身: 只统计发送的字节数，不真正发出
+class DropIceChannel : public IceTransportChannel {
+public:
+    DropIceChannel(EventLoop* el, IceScheduler* scheduler) :
+        IceTransportChannel(el, nullptr, scheduler, "video",
+                IceCandidateComponent::RTP)
+    {
+    }
+
+    int send_packet(const char* /*data*/, size_t len) override {
+        _sent_bytes += len;
+        return (int)len;
+    }
+
+    size_t sent_bytes() { return _sent_bytes; }
+
+private:
+    size_t _sent_bytes = 0;
+};
+
+// 一个订阅者: ICE -> DTLS -> SRTP，使用随机的key，不做DTLS握手
+struct Viewer {
+    std::unique_ptr<DropIceChannel> ice;
+    std::unique_ptr<DtlsTransport> dtls;
+    std::unique_ptr<DtlsSrtpTransport> srtp;
+};
+
+static bool create_viewer(EventLoop* el, IceScheduler* scheduler, int cs,
+        Viewer& viewer)
+{
+    int key_len = 0;
+    int salt_len = 0;
+    if (!rtc::GetSrtpKeyAndSaltLengths(cs, &key_len, &salt_len)) {
+        return false;
+    }
+
+    std::vector<uint8_t> send_key(key_len + salt_len);
+    std::vector<uint8_t> recv_key(key_len + salt_len);
+    for (size_t i = 0; i < send_key.size(); ++i) {
+        send_key[i] = rand() & 0xff;
+        recv_key[i] = rand() & 0xff;
+    }
+
+    viewer.ice.reset(new DropIceChannel(el, scheduler));
+    viewer.dtls.reset(new DtlsTransport(viewer.ice.get()));
+    viewer.srtp.reset(new DtlsSrtpTransport("video", true));
+    viewer.srtp->set_dtls_transport(viewer.dtls.get(), nullptr);
+
+    std::vector<int> ext_ids;
+    return viewer.srtp->set_rtp_params(cs, send_key.data(), send_key.size(), ext_ids,
+            cs, recv_key.data(), recv_key.size(), ext_ids);
+}
+
+static void bench_viewers(EventLoop* el, IceScheduler* scheduler, int cs,
+        int viewers, int packets, int payload_size, json& item)
+{
+    std::vector<Viewer> pool(viewers);
+    for (int i = 0; i < viewers; ++i) {
+        if (!create_viewer(el, scheduler, cs, pool[i])) {
+            item["error"] = "create viewer failed";
+            return;
+        }
+    }
+
+    // 路由表: 一路音频，一路视频(带rtx)，转发的包都是视频
+    StreamParams audio;
+    audio.ssrcs.push_back(0x11111111);
+    StreamParams video;
+    video.ssrcs.push_back(0x12345678);
+    video.ssrcs.push_back(0x12345679);
+
+    // 加入: PullStream本身不参与转发，这里只用uid占位
+    SubscriberSet subscribers;
+    subscribers.set_sources({ audio }, { video });
+    int64_t t0 = now_ns();
+    for (int i = 0; i < viewers; ++i) {
+        subscribers.add(i, nullptr, pool[i].srtp.get(), pool[i].srtp.get());
+    }
+    int64_t join_ns = now_ns() - t0;
+
+    int packet_len = 12 + payload_size;
+    char packet[k_packet_buffer_capacity];
+    int64_t sent = 0;
+
+    int64_t c0 = thread_cpu_ns();
+    t0 = now_ns();
+    for (int i = 0; i < packets; ++i) {
+        make_rtp_packet(packet, packet_len, 0x12345678, (uint16_t)i, i * 3000);
+        sent += subscribers.forward_rtp(packet, packet_len);
+    }
+    int64_t forward_ns = now_ns() - t0;
+    int64_t forward_cpu_ns = thread_cpu_ns() - c0;
+
+    // 离开: 随机顺序，覆盖从中间删除的情况
+    std::vector<int> uids(viewers);
+    for (int i = 0; i < viewers; ++i) {
+        uids[i] = i;
+    }
+    std::mt19937 rng(viewers);
+    std::shuffle(uids.begin(), uids.end(), rng);
+
+    t0 = now_ns();
+    for (int uid : uids) {
+        subscribers.remove(uid);
+    }
+    int64_t leave_ns = now_ns() - t0;
+
+    double total = (double)packets * viewers;
+    item["viewers"] = viewers;
+    item["packets"] = packets;
+    item["packet_size"] = packet_len;
+    item["sent"] = sent;
+    item["failed"] = (int64_t)total - sent;
+    item["cpu_ns_per_viewer_packet"] = forward_cpu_ns / total;
+    item["wall_ns_per_viewer_packet"] = forward_ns / total;
+    item["cpu_us_per_packet"] = forward_cpu_ns / 1e3 / packets;
+    item["join_ns"] = (double)join_ns / viewers;
+    item["leave_ns"] = (double)leave_ns / viewers;
+}
+
+int run_subscribers_bench(int argc, char** argv, json& result) {
+    int packets = argc > 0 ? atoi(argv[0]) : 200;
+    int payload_size = argc > 1 ? atoi(argv[1]) : 1200;
+    if (packets <= 0 || payload_size <= 0 ||
+            (size_t)payload_size + 12 + 64 > k_packet_buffer_capacity)
+    {
+        return -1;
+    }
+
+    int cs = rtc::kSrtpAeadAes128Gcm;
+    if (!SrtpSession::is_crypto_suite_supported(cs)) {
+        cs = rtc::kSrtpAes128CmSha1_80;
+    }
+
+    EventLoop el(nullptr);
+    IceScheduler scheduler(&el);
+
+    result["suite"] = rtc::SrtpCryptoSuiteToName(cs);
+    result["results"] = json::array();
+    for (int viewers : k_viewer_counts) {
+        json item;
+        bench_viewers(&el, &scheduler, cs, viewers, packets, payload_size, item);
+        result["results"].push_back(item);
+    }
+
+    return 0;
+}
+
+} // namespace bench
+} // namespace xrtc
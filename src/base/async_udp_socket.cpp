@@ -26,23 +26,21 @@ void AsyncUdpSocket::send_data() {
     int sent = 0;
     while (!_udp_packet_list.empty()) {
         // 发送udp packet
-        UdpPacketData* packet = _udp_packet_list.front();
+        UdpPacketData& packet = _udp_packet_list.front();
         sockaddr_storage saddr;
-        len = packet->addr().ToSockAddrStorage(&saddr);
-        sent = sock_send_to(_socket, packet->data(), packet->size(),
+        len = packet.addr().ToSockAddrStorage(&saddr);
+        sent = sock_send_to(_socket, packet.data(), packet.size(),
                 MSG_NOSIGNAL, (struct sockaddr*)&saddr, len);
         if (sent < 0) {
             RTC_LOG(LS_WARNING) << "send udp packet error, remote_addr: " <<
-                packet->addr().ToString();
-            delete packet;
+                packet.addr().ToString();
             _udp_packet_list.pop_front();
             return;
         } else if (0 == sent) {
             RTC_LOG(LS_WARNING) << "send o bytes, try again, remote_addr: " <<
-                packet->addr().ToString();
+                packet.addr().ToString();
             return;
         } else {
-            delete packet;
             _udp_packet_list.pop_front();
         }
     }
@@ -76,7 +74,7 @@ AsyncUdpSocket::~AsyncUdpSocket() {
 
 void AsyncUdpSocket::recv_data() {
     while (true) {
-        struct sockaddr_in addr;
+        struct sockaddr_storage addr;
         socklen_t addr_len = sizeof(addr);
 
         int len = sock_recv_from(_socket, _buf, _size, (struct sockaddr*)&addr, addr_len);
@@ -85,10 +83,8 @@ void AsyncUdpSocket::recv_data() {
         }
 
         int64_t ts = sock_get_recv_timestamp(_socket);
-        int port = ntohs(addr.sin_port);
-        char ip[64] = {0};
-        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
-        rtc::SocketAddress remote_addr(ip, port);
+        rtc::SocketAddress remote_addr;
+        rtc::SocketAddressFromSockAddrStorage(addr, &remote_addr);
 
         signal_read_packet(this, _buf, len, remote_addr, ts);
     }
@@ -106,23 +102,21 @@ int AsyncUdpSocket::_add_udp_packet(const char* data, size_t size,
     int sent = 0;
     while (!_udp_packet_list.empty()) {
         // 发送udp packet
-        UdpPacketData* packet = _udp_packet_list.front();
+        UdpPacketData& packet = _udp_packet_list.front();
         sockaddr_storage saddr;
-        len = packet->addr().ToSockAddrStorage(&saddr);
-        sent = sock_send_to(_socket, packet->data(), packet->size(),
+        len = packet.addr().ToSockAddrStorage(&saddr);
+        sent = sock_send_to(_socket, packet.data(), packet.size(),
                 MSG_NOSIGNAL, (struct sockaddr*)&saddr, len);
         if (sent < 0) {
             RTC_LOG(LS_WARNING) << "send udp packet error, remote_addr: " <<
-                packet->addr().ToString();
-            delete packet;
+                packet.addr().ToString();
             _udp_packet_list.pop_front();
             return -1;
         } else if (0 == sent) {
             RTC_LOG(LS_WARNING) << "send o bytes, try again, remote_addr: " <<
-                packet->addr().ToString();
+                packet.addr().ToString();
             goto SEND_AGAIN;
         } else {
-            delete packet;
             _udp_packet_list.pop_front();
         }
     }
@@ -145,8 +139,14 @@ int AsyncUdpSocket::_add_udp_packet(const char* data, size_t size,
 
 SEND_AGAIN:
     // 3、无法发送出去时，才开启写事件监控
-    UdpPacketData* packet_data = new UdpPacketData(data, size, addr);
-    _udp_packet_list.push_back(packet_data);
+    PacketBuffer buffer;
+    if (!buffer.set_data(data, size)) {
+        RTC_LOG(LS_WARNING) << "udp packet too large to queue, size: " << size
+            << ", remote_addr: " << addr.ToString();
+        return -1;
+    }
+
+    _udp_packet_list.emplace_back(std::move(buffer), addr);
     _el->start_io_event(_socket_watcher, _socket, EventLoop::WRITE);
 
     return size;
@@ -1,39 +1,33 @@
 #ifndef __ASYNC_UDP_SOCKET_H_
 #define __ASYNC_UDP_SOCKET_H_
 
-#include <list>
+#include <deque>
 #include <cstring>
 #include <rtc_base/third_party/sigslot/sigslot.h>
 #include <rtc_base/socket_address.h>
 
 #include "base/event_loop.h"
+#include "base/packet_buffer.h"
 
 namespace xrtc {
 
+// 发送积压的数据包，数据存放在线程缓冲池的slot中
 class UdpPacketData {
 public:
-    UdpPacketData(const char* data, size_t size, const rtc::SocketAddress& addr) :
-        _data(new char[size]),
-        _size(size),
+    UdpPacketData(PacketBuffer&& buffer, const rtc::SocketAddress& addr) :
+        _buffer(std::move(buffer)),
         _addr(addr)
     {
-        mempcpy(_data, data, _size);
     }
 
-    ~UdpPacketData() {
-        if (_data) {
-            delete []_data;
-            _data = nullptr;
-        }
-    }
+    UdpPacketData(UdpPacketData&& other) = default;
 
-    char* data() { return _data; }
-    size_t size() { return _size; }
+    const char* data() { return _buffer.cdata(); }
+    size_t size() { return _buffer.size(); }
     const rtc::SocketAddress& addr() { return _addr; }
 
 private:
-    char*               _data;
-    size_t              _size;
+    PacketBuffer        _buffer;
     rtc::SocketAddress  _addr;
 };
 
@@ -62,7 +56,7 @@ private:
     char* _buf;
     size_t _size;
 
-    std::list<UdpPacketData*> _udp_packet_list;
+    std::deque<UdpPacketData> _udp_packet_list;
 };
 
 }
@@ -0,0 +1,124 @@
+#include "base/broadcast_ring.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace xrtc {
+
+static size_t round_up_pow2(size_t n) {
+    size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+BroadcastRing::BroadcastRing(size_t capacity) :
+    _mask(round_up_pow2(capacity < 2 ? 2 : capacity) - 1),
+    _slots(new Slot[_mask + 1]),
+    _packet_count((_mask + 1) * 2),
+    _packets(new BroadcastPacket[_packet_count])
+{
+}
+
+BroadcastRing::~BroadcastRing() {
+}
+
+BroadcastPacket* BroadcastRing::_alloc_packet() {
+    // 只有生产者会把引用计数从0变成1，读者只在计数不为0时增加引用
+    for (size_t i = 0; i < _packet_count; ++i) {
+        BroadcastPacket* packet = &_packets[_alloc_pos];
+        _alloc_pos = (_alloc_pos + 1) % _packet_count;
+        if (packet->_ref.load() == 0) {
+            packet->_ref.store(1);
+            return packet;
+        }
+    }
+
+    return nullptr;
+}
+
+bool BroadcastRing::publish(const char* data, size_t len, int type) {
+    if (len > k_packet_buffer_capacity) {
+        ++_dropped;
+        return false;
+    }
+
+    BroadcastPacket* packet = _alloc_packet();
+    if (!packet) {
+        ++_dropped;
+        return false;
+    }
+
+    memcpy(packet->_data, data, len);
+    packet->_size = len;
+    packet->_type = type;
+
+    uint64_t seq = _head.load();
+    Slot& slot = _slots[seq & _mask];
+    slot.seq.store(0);
+    BroadcastPacket* old = slot.packet.exchange(packet);
+    slot.seq.store(seq + 1);
+    _head.store(seq + 1);
+
+    // 队列持有的引用，读者还在使用时由最后一个读者释放
+    if (old) {
+        release(old);
+    }
+
+    return true;
+}
+
+// 读的过程中slot被覆盖，跳到当前最旧的包，至少前进一个
+void BroadcastRing::_skip_overwritten(uint64_t* seq) {
+    uint64_t head = _head.load();
+    uint64_t oldest = head > _mask + 1 ? head - (_mask + 1) : 0;
+    *seq = std::max(*seq + 1, oldest);
+}
+
+int BroadcastRing::read(uint64_t* seq, BroadcastPacket** packet) {
+    uint64_t head = _head.load();
+    if (*seq >= head) {
+        return k_read_empty;
+    }
+
+    if (head - *seq > _mask + 1) {
+        *seq = head - (_mask + 1);
+        return k_read_overrun;
+    }
+
+    Slot& slot = _slots[*seq & _mask];
+    uint64_t expected = *seq + 1;
+    if (slot.seq.load() != expected) {
+        _skip_overwritten(seq);
+        return k_read_overrun;
+    }
+
+    BroadcastPacket* p = slot.packet.load();
+    int ref = p ? p->_ref.load() : 0;
+    while (ref > 0 && !p->_ref.compare_exchange_weak(ref, ref + 1)) {
+    }
+
+    if (ref == 0) {
+        _skip_overwritten(seq);
+        return k_read_overrun;
+    }
+
+    // 取得引用之后slot没有变化，包的内容就是这个序号写入的数据
+    if (slot.seq.load() != expected) {
+        release(p);
+        _skip_overwritten(seq);
+        return k_read_overrun;
+    }
+
+    *packet = p;
+    ++*seq;
+    return k_read_ok;
+}
+
+void BroadcastRing::release(BroadcastPacket* packet) {
+    --packet->_ref;
+}
+
+} // namespace xrtc
@@ -0,0 +1,85 @@
+#ifndef __BASE_BROADCAST_RING_H_
+#define __BASE_BROADCAST_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+#include "base/packet_buffer.h"
+
+namespace xrtc {
+
+// 环形队列中的包，带引用计数。读者持有引用期间包不会被复用，
+// 所以每个读者直接使用同一份数据，不需要拷贝
+class BroadcastPacket {
+public:
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+    int type() const { return _type; }
+
+private:
+    friend class BroadcastRing;
+
+    std::atomic<int> _ref{0};
+    size_t _size = 0;
+    int _type = 0;
+    char _data[k_packet_buffer_capacity];
+};
+
+// 一个生产者、多个消费者的无锁环形队列。
+// 生产者从不等待读者: 队列满时覆盖最旧的包，读得慢的读者会跳过被覆盖的部分。
+// 每个slot是一个seqlock，读者取得包的引用之后再检查slot的序号，
+// 序号变化说明包已经被覆盖，放弃这次读取。
+// 包的内存在队列销毁之前不会释放，引用计数为0的包由生产者回收
+class BroadcastRing {
+public:
+    enum {
+        k_read_ok = 0,
+        k_read_empty = 1,
+        k_read_overrun = -1
+    };
+
+    // capacity会向上取整到2的幂
+    explicit BroadcastRing(size_t capacity);
+    ~BroadcastRing();
+
+    BroadcastRing(const BroadcastRing&) = delete;
+    BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+    // 只能在生产者线程调用；没有空闲的包(读者持有太多引用)时丢弃并返回false
+    bool publish(const char* data, size_t len, int type);
+
+    // 读取序号为*seq的包，成功时*packet持有一个引用，用完后调用release。
+    // 返回k_read_overrun时*seq已被移动到当前最旧的可读位置
+    int read(uint64_t* seq, BroadcastPacket** packet);
+    static void release(BroadcastPacket* packet);
+
+    // 下一个要写入的序号，新的读者从这里开始读
+    uint64_t head() { return _head.load(); }
+    size_t capacity() { return _mask + 1; }
+    uint64_t dropped() { return _dropped.load(); }
+
+private:
+    BroadcastPacket* _alloc_packet();
+    void _skip_overwritten(uint64_t* seq);
+
+    struct Slot {
+        std::atomic<uint64_t> seq{0}; // 序号+1，0表示正在写入或者为空
+        std::atomic<BroadcastPacket*> packet{nullptr};
+    };
+
+private:
+    size_t _mask;
+    std::unique_ptr<Slot[]> _slots;
+    // 包的个数是slot的两倍，给读者持有的引用留出余量
+    size_t _packet_count;
+    std::unique_ptr<BroadcastPacket[]> _packets;
+    size_t _alloc_pos = 0;
+    std::atomic<uint64_t> _head{0};
+    std::atomic<uint64_t> _dropped{0};
+};
+
+} // namespace xrtc
+
+#endif // __BASE_BROADCAST_RING_H_
@@ -28,6 +28,107 @@ int load_general_conf(const char * filename, GeneralConf* conf) {
         // ice
         conf->ice_min_port = config["ice"]["min_port"].as<int>();
         conf->ice_max_port = config["ice"]["max_port"].as<int>();
+        YAML::Node network = config["ice"]["network"];
+        if (network) {
+            if (network["include"]) {
+                conf->ice_include_ifaces = network["include"].as<std::vector<std::string>>();
+            }
+            if (network["exclude"]) {
+                conf->ice_exclude_ifaces = network["exclude"].as<std::vector<std::string>>();
+            }
+            if (network["ipv6"]) {
+                conf->ice_enable_ipv6 = network["ipv6"].as<bool>();
+            }
+            if (network["announced_ips"]) {
+                conf->ice_announced_ips =
+                    network["announced_ips"].as<std::vector<std::string>>();
+            }
+        }
+        // dtls
+        if (config["dtls"] && config["dtls"]["srtp_crypto_suites"]) {
+            conf->srtp_crypto_suites =
+                config["dtls"]["srtp_crypto_suites"].as<std::vector<std::string>>();
+        }
+        if (config["dtls"] && config["dtls"]["srtp_context_pool_size"]) {
+            conf->srtp_context_pool_size =
+                config["dtls"]["srtp_context_pool_size"].as<int>();
+        }
+        if (config["dtls"] && config["dtls"]["handshake_threads"]) {
+            conf->dtls_handshake_threads =
+                config["dtls"]["handshake_threads"].as<int>();
+        }
+        if (config["dtls"] && config["dtls"]["key_type"]) {
+            conf->dtls_key_type = config["dtls"]["key_type"].as<std::string>();
+        }
+        if (config["dtls"] && config["dtls"]["rsa_modulus"]) {
+            conf->dtls_rsa_modulus = config["dtls"]["rsa_modulus"].as<int>();
+        }
+        if (config["dtls"] && config["dtls"]["replay_window"]) {
+            YAML::Node window = config["dtls"]["replay_window"];
+            if (window["audio"]) {
+                conf->srtp_audio_replay_window = window["audio"].as<int>();
+            }
+            if (window["video"]) {
+                conf->srtp_video_replay_window = window["video"].as<int>();
+            }
+        }
+
+        // rtp
+        if (config["rtp"] && config["rtp"]["nack_history_size"]) {
+            conf->rtp_history_size = config["rtp"]["nack_history_size"].as<int>();
+        }
+        if (config["rtp"] && config["rtp"]["keyframe_request_interval_ms"]) {
+            conf->keyframe_request_interval_ms =
+                config["rtp"]["keyframe_request_interval_ms"].as<int>();
+        }
+
+        // rtcp
+        if (config["rtcp"] && config["rtcp"]["report_interval_ms"]) {
+            conf->rtcp_report_interval_ms = config["rtcp"]["report_interval_ms"].as<int>();
+        }
+
+        // fanout
+        if (config["fanout"] && config["fanout"]["cross_worker"]) {
+            conf->fanout_cross_worker = config["fanout"]["cross_worker"].as<bool>();
+        }
+        if (config["fanout"] && config["fanout"]["ring_size"]) {
+            conf->fanout_ring_size = config["fanout"]["ring_size"].as<int>();
+        }
+
+        // gop cache
+        if (config["gop_cache"] && config["gop_cache"]["enable"]) {
+            conf->gop_cache_enable = config["gop_cache"]["enable"].as<bool>();
+        }
+        if (config["gop_cache"] && config["gop_cache"]["max_bytes"]) {
+            conf->gop_cache_max_bytes = config["gop_cache"]["max_bytes"].as<int>();
+        }
+        if (config["gop_cache"] && config["gop_cache"]["replay_kbps"]) {
+            conf->gop_cache_replay_kbps = config["gop_cache"]["replay_kbps"].as<int>();
+        }
+
+        // bwe
+        if (config["bwe"] && config["bwe"]["transport_cc"]) {
+            conf->bwe_transport_cc = config["bwe"]["transport_cc"].as<bool>();
+        }
+        if (config["bwe"] && config["bwe"]["min_bitrate_kbps"]) {
+            conf->bwe_min_bitrate_kbps = config["bwe"]["min_bitrate_kbps"].as<int>();
+        }
+        if (config["bwe"] && config["bwe"]["start_bitrate_kbps"]) {
+            conf->bwe_start_bitrate_kbps = config["bwe"]["start_bitrate_kbps"].as<int>();
+        }
+        if (config["bwe"] && config["bwe"]["max_bitrate_kbps"]) {
+            conf->bwe_max_bitrate_kbps = config["bwe"]["max_bitrate_kbps"].as<int>();
+        }
+
+        // simulcast
+        if (config["simulcast"] && config["simulcast"]["rids"]) {
+            conf->simulcast_rids = config["simulcast"]["rids"].as<std::vector<std::string>>();
+        }
+
+        // svc
+        if (config["svc"] && config["svc"]["enable"]) {
+            conf->svc_enable = config["svc"]["enable"].as<bool>();
+        }
     } catch (YAML::Exception &e) {
         fprintf(stderr, "catch a YAML::Excaption, line: %d, column: %d"
             ", error: %s\n", e.mark.line, e.mark.column, e.msg.c_str());
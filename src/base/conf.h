@@ -2,6 +2,7 @@
 #define __BASE_CONF_H_
 
 #include <string>
+#include <vector>
 
 namespace xrtc {
 
@@ -14,6 +15,48 @@ struct GeneralConf {
     // ice
     int ice_min_port = 0;
     int ice_max_port = 0;
+    std::vector<std::string> ice_include_ifaces;
+    std::vector<std::string> ice_exclude_ifaces;
+    bool ice_enable_ipv6 = false;
+    std::vector<std::string> ice_announced_ips;
+
+    // dtls
+    std::vector<std::string> srtp_crypto_suites; // 按优先级排列
+    int srtp_context_pool_size = 0; // 每个worker预分配的srtp上下文个数
+    int dtls_handshake_threads = 0; // 0表示在worker线程上握手
+    std::string dtls_key_type = "ecdsa"; // 证书密钥类型: ecdsa(P-256) 或 rsa
+    int dtls_rsa_modulus = 2048;
+    // SRTP接收方向的重放窗口(包数)，视频码率高、乱序范围大，需要更大的窗口
+    int srtp_audio_replay_window = 1024;
+    int srtp_video_replay_window = 8192;
+
+    // rtp
+    int rtp_history_size = 1024; // 每个视频ssrc保存的包数，0表示NACK全部转给推流端
+    int keyframe_request_interval_ms = 500; // 同一个推流ssrc的PLI/FIR合并窗口
+
+    // rtcp
+    int rtcp_report_interval_ms = 1000; // 服务器SR/RR的平均发送间隔
+
+    // fanout
+    bool fanout_cross_worker = false; // 拉流分散到所有worker
+    int fanout_ring_size = 1024;
+
+    // gop cache
+    bool gop_cache_enable = false;
+    int gop_cache_max_bytes = 8 * 1024 * 1024; // 每个推流的上限
+    int gop_cache_replay_kbps = 20000; // 每个订阅者的回放速率
+
+    // bwe
+    bool bwe_transport_cc = true; // 给订阅者提供transport-wide-cc扩展
+    int bwe_min_bitrate_kbps = 100;
+    int bwe_start_bitrate_kbps = 1000;
+    int bwe_max_bitrate_kbps = 10000;
+
+    // simulcast
+    std::vector<std::string> simulcast_rids; // 推流offer中请求的RID，从低到高，空表示不请求
+
+    // svc
+    bool svc_enable = false; // 协商VP9/AV1，按订阅者丢弃增强层
 };
 
 int load_general_conf(const char * filename, GeneralConf* conf);
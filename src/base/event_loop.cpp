@@ -10,15 +10,60 @@
 
 namespace xrtc {
 
+class AsyncWatcher {
+public:
+    AsyncWatcher(EventLoop* el) : el(el) {
+        async.data = this;
+    }
+
+public:
+    EventLoop* el;
+    struct ev_async async;
+};
+
+void generic_async_cb(struct ev_loop* /*loop*/, struct ev_async* async, int /*events*/) {
+    AsyncWatcher* watcher = (AsyncWatcher*)(async->data);
+    watcher->el->_run_posted_tasks();
+}
+
 EventLoop::EventLoop(void* owner) :
     _owner(owner),
-    _loop(ev_loop_new(EVFLAG_AUTO))
+    _loop(ev_loop_new(EVFLAG_AUTO)),
+    _async_watcher(new AsyncWatcher(this))
 {
-
+    ev_async_init(&_async_watcher->async, generic_async_cb);
+    ev_async_start(_loop, &_async_watcher->async);
+    // async watcher不应该阻止loop在没有其他事件时退出
+    ev_unref(_loop);
 }
 
 EventLoop::~EventLoop() {
+    // 构造时unref过，停止之前需要先ref回来
+    ev_ref(_loop);
+    ev_async_stop(_loop, &_async_watcher->async);
+    delete _async_watcher;
+    _async_watcher = nullptr;
+}
+
+void EventLoop::post_task(std::function<void()> task) {
+    {
+        std::unique_lock<std::mutex> lock(_tasks_mtx);
+        _tasks.push_back(std::move(task));
+    }
+
+    ev_async_send(_loop, &_async_watcher->async);
+}
 
+void EventLoop::_run_posted_tasks() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::unique_lock<std::mutex> lock(_tasks_mtx);
+        tasks.swap(_tasks);
+    }
+
+    for (auto& task : tasks) {
+        task();
+    }
 }
 
 void EventLoop::start() {
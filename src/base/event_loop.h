@@ -1,13 +1,19 @@
 #ifndef __BASE_EVENT_LOOP_H_
 #define __BASE_EVENT_LOOP_H_
 
+#include <functional>
+#include <mutex>
+#include <vector>
+
 struct ev_loop;
+struct ev_async;
 
 namespace xrtc {
 
 class EventLoop;
 class IOWatcher;
 class TimerWatcher;
+class AsyncWatcher;
 
 typedef void (*io_cb_t)(EventLoop* el, IOWatcher* w, int fd, int events, void* data);
 typedef void (*timer_cb_t)(EventLoop* el, TimerWatcher* w, void* data);
@@ -37,9 +43,22 @@ public:
     void stop_timer(TimerWatcher* w);
     void delete_timer(TimerWatcher* w);
 
+    // 线程安全，其他线程投递的任务在本loop线程中按顺序执行。
+    // loop析构时还没有执行的任务直接丢弃，不会再执行；任务捕获的对象可能已经释放。
+    // 投递方需要保证loop在自己之后析构，或者在析构前停止投递
+    void post_task(std::function<void()> task);
+
+private:
+    void _run_posted_tasks();
+
+    friend void generic_async_cb(struct ev_loop* loop, struct ev_async* w, int events);
+
 private:
     void* _owner;
     struct ev_loop* _loop;
+    AsyncWatcher* _async_watcher;
+    std::mutex _tasks_mtx;
+    std::vector<std::function<void()>> _tasks;
 };
 
 } // namespace xrtc
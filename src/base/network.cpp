@@ -1,4 +1,7 @@
 #include <ifaddrs.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include <rtc_base/logging.h>
 
@@ -7,6 +10,8 @@
 
 namespace xrtc {
 
+const int k_preferred_network_preference = 1;
+
 NetWorkManager::NetWorkManager() = default;
 
 NetWorkManager::~NetWorkManager() {
@@ -16,11 +21,52 @@ NetWorkManager::~NetWorkManager() {
     _network_lists.clear();
 }
 
-int NetWorkManager::create_networks() {
-//因为云服务器没有公网IP对应的网卡，所以getifaddrs无法获取公网IP，
-//目前直接强制写死，后续可以部署stun或turn服务，实现公网IP获取。
-#define CANT_GET_FROM_IFADDRS
-#ifndef CANT_GET_FROM_IFADDRS
+bool NetWorkManager::_iface_filtered(const NetworkOptions& options,
+        const std::string& name)
+{
+    if (!options.include_ifaces.empty() &&
+            std::find(options.include_ifaces.begin(), options.include_ifaces.end(),
+                name) == options.include_ifaces.end())
+    {
+        return true;
+    }
+
+    return std::find(options.exclude_ifaces.begin(), options.exclude_ifaces.end(),
+            name) != options.exclude_ifaces.end();
+}
+
+int NetWorkManager::_parse_announced_ips(const NetworkOptions& options) {
+    for (auto& item : options.announced_ips) {
+        size_t pos = item.find('=');
+        std::string public_ip_s = item.substr(0, pos);
+        rtc::IPAddress public_ip;
+        if (!rtc::IPFromString(public_ip_s, &public_ip)) {
+            RTC_LOG(LS_WARNING) << "invalid announced ip: " << item;
+            return -1;
+        }
+
+        if (pos == std::string::npos) {
+            _announced_any.push_back(public_ip);
+            continue;
+        }
+
+        rtc::IPAddress local_ip;
+        if (!rtc::IPFromString(item.substr(pos + 1), &local_ip)) {
+            RTC_LOG(LS_WARNING) << "invalid announced local ip: " << item;
+            return -1;
+        }
+
+        _announced.push_back(std::make_pair(local_ip, public_ip));
+    }
+
+    return 0;
+}
+
+int NetWorkManager::create_networks(const NetworkOptions& options) {
+    if (_parse_announced_ips(options) != 0) {
+        return -1;
+    }
+
     struct ifaddrs* interface;
     int err = getifaddrs(&interface);
     if (err != 0) {
@@ -30,34 +76,64 @@ int NetWorkManager::create_networks() {
     }
 
     for (auto cur = interface; cur != NULL; cur = cur->ifa_next) {
-        if (cur->ifa_addr->sa_family != AF_INET) continue; 
+        if (!cur->ifa_addr) {
+            continue;
+        }
 
-        struct sockaddr_in* addr = (struct sockaddr_in*)(cur->ifa_addr);
-        rtc::IPAddress ip_address(addr->sin_addr);
+        rtc::IPAddress ip_address;
+        int family = cur->ifa_addr->sa_family;
+        if (AF_INET == family) {
+            struct sockaddr_in* addr = (struct sockaddr_in*)(cur->ifa_addr);
+            ip_address = rtc::IPAddress(addr->sin_addr);
+        } else if (AF_INET6 == family && options.enable_ipv6) {
+            struct sockaddr_in6* addr = (struct sockaddr_in6*)(cur->ifa_addr);
+            ip_address = rtc::IPAddress(addr->sin6_addr);
+            // 链路本地地址需要scope_id，不适合作为candidate
+            if (rtc::IPIsLinkLocal(ip_address)) {
+                continue;
+            }
+        } else {
+            continue;
+        }
 
-        if (rtc::IPIsLoopback(ip_address)) {
+        if (rtc::IPIsLoopback(ip_address) || _iface_filtered(options, cur->ifa_name)) {
             continue;
         }
 
-        Network* network = new Network(cur->ifa_name, ip_address);
+        // 云服务器的公网IP不在网卡上，通过配置映射到本地IP
+        rtc::IPAddress public_ip = ip_address;
+        for (auto& item : _announced) {
+            if (item.first == ip_address) {
+                public_ip = item.second;
+                break;
+            }
+        }
 
-        RTC_LOG(LS_INFO) << "gathered network interface: " << network->to_string();
+        Network* network = new Network(cur->ifa_name, public_ip, ip_address);
+        if (!options.preferred_iface.empty() && options.preferred_iface == cur->ifa_name) {
+            network->set_preference(k_preferred_network_preference);
+        }
 
-        _network_lists.push_back(network);
+        RTC_LOG(LS_INFO) << "gathered network interface: " << network->to_string()
+            << ", preference: " << network->preference();
 
+        _network_lists.push_back(network);
     }
 
     freeifaddrs(interface);
-#else
-    rtc::IPAddress ip_address(htonl(inet_addr("120.76.197.143")));
-    Network* network = new Network("eth0", ip_address);
-    RTC_LOG(LS_INFO) << "gathered network interface: " << network->to_string();
-
-    _network_lists.push_back(network);
-#endif
-#undef CANT_GET_FROM_IFADDRS
+
+    for (auto& public_ip : _announced_any) {
+        rtc::IPAddress any_ip = (AF_INET6 == public_ip.family()) ?
+            rtc::IPAddress(in6addr_any) : rtc::IPAddress(INADDR_ANY);
+        Network* network = new Network("announced", public_ip, any_ip);
+
+        RTC_LOG(LS_INFO) << "gathered network interface: " << network->to_string();
+
+        _network_lists.push_back(network);
+    }
+
     return 0;
 }
 
 
-} // namespace xrtc
\ No newline at end of file
+} // namespace xrtc
@@ -1,6 +1,7 @@
 #ifndef __BASE_NETWORK_H_
 #define __BASE_NETWORK_H_
 
+#include <string>
 #include <vector>
 #include <rtc_base/ip_address.h>
 
@@ -9,20 +10,44 @@ namespace xrtc {
 class Network {
 public:
     Network(const std::string& name, const rtc::IPAddress& ip) :
-        _name(name), _ip(ip) {}
+        _name(name), _ip(ip), _bind_ip(ip) {}
+    Network(const std::string& name, const rtc::IPAddress& ip,
+            const rtc::IPAddress& bind_ip) :
+        _name(name), _ip(ip), _bind_ip(bind_ip) {}
     ~Network() = default;
 
     const std::string name() { return _name; }
+    // 对外宣告的IP，写入candidate
     const rtc::IPAddress ip() { return _ip; }
+    // socket实际绑定的本地IP，ANY表示绑定所有地址
+    const rtc::IPAddress bind_ip() { return _bind_ip; }
+
+    // 网卡偏好，越大越优先，影响candidate的local preference
+    int preference() { return _preference; }
+    void set_preference(int preference) { _preference = preference; }
 
     std::string to_string() {
-        return _name + ":" + _ip.ToString();
+        std::string str = _name + ":" + _ip.ToString();
+        if (!(_bind_ip == _ip)) {
+            str += "(" + _bind_ip.ToString() + ")";
+        }
+        return str;
     }
 
-
 private:
     std::string _name;
     rtc::IPAddress _ip;
+    rtc::IPAddress _bind_ip;
+    int _preference = 0;
+};
+
+struct NetworkOptions {
+    std::vector<std::string> include_ifaces; // 为空表示不过滤
+    std::vector<std::string> exclude_ifaces;
+    bool enable_ipv6 = false;
+    // 格式: 公网IP=本地IP；只配置公网IP时绑定ANY地址
+    std::vector<std::string> announced_ips;
+    std::string preferred_iface; // 当前worker优先使用的网卡
 };
 
 class NetWorkManager {
@@ -31,13 +56,18 @@ public:
     ~NetWorkManager();
 
     const std::vector<Network*>& get_networks() { return _network_lists; }
-    int create_networks();
+    int create_networks(const NetworkOptions& options);
 
 private:
-    std::vector<Network*> _network_lists;
+    bool _iface_filtered(const NetworkOptions& options, const std::string& name);
+    int _parse_announced_ips(const NetworkOptions& options);
 
+private:
+    std::vector<Network*> _network_lists;
+    std::vector<std::pair<rtc::IPAddress, rtc::IPAddress>> _announced; // local -> public
+    std::vector<rtc::IPAddress> _announced_any; // 绑定ANY地址的公网IP
 };
 
 } // namespace xrtc
 
-#endif // __BASE_NETWORK_H_
\ No newline at end of file
+#endif // __BASE_NETWORK_H_
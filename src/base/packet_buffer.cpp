@@ -0,0 +1,72 @@
+#include <string.h>
+
+#include "base/packet_buffer.h"
+
+namespace xrtc {
+
+// 每次扩容分配的slot个数
+const size_t k_packet_buffer_pool_grow = 256;
+
+PacketBufferPool* PacketBufferPool::current() {
+    static thread_local PacketBufferPool pool;
+    return &pool;
+}
+
+void PacketBufferPool::_grow() {
+    std::unique_ptr<char[]> chunk(
+            new char[k_packet_buffer_capacity * k_packet_buffer_pool_grow]);
+    for (size_t i = 0; i < k_packet_buffer_pool_grow; ++i) {
+        _free_slots.push_back(chunk.get() + i * k_packet_buffer_capacity);
+    }
+
+    _chunks.push_back(std::move(chunk));
+    _total_slots += k_packet_buffer_pool_grow;
+}
+
+char* PacketBufferPool::alloc() {
+    if (_free_slots.empty()) {
+        _grow();
+    }
+
+    char* slot = _free_slots.back();
+    _free_slots.pop_back();
+    return slot;
+}
+
+void PacketBufferPool::release(char* slot) {
+    _free_slots.push_back(slot);
+}
+
+PacketBuffer::PacketBuffer() :
+    _pool(PacketBufferPool::current()),
+    _data(_pool->alloc())
+{
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer&& other) :
+    _pool(other._pool),
+    _data(other._data),
+    _size(other._size)
+{
+    other._data = nullptr;
+    other._size = 0;
+}
+
+PacketBuffer::~PacketBuffer() {
+    if (_data) {
+        _pool->release(_data);
+        _data = nullptr;
+    }
+}
+
+bool PacketBuffer::set_data(const char* data, size_t len) {
+    if (len > k_packet_buffer_capacity) {
+        return false;
+    }
+
+    memcpy(_data, data, len);
+    _size = len;
+    return true;
+}
+
+} // namespace xrtc
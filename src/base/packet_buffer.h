@@ -0,0 +1,64 @@
+#ifndef __BASE_PACKET_BUFFER_H_
+#define __BASE_PACKET_BUFFER_H_
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+namespace xrtc {
+
+// MTU + SRTP/SRTCP认证tag、MKI以及SRTCP index的预留空间
+const size_t k_packet_buffer_capacity = 1500 + 64;
+
+// 每个线程一个缓冲池，预分配固定大小的slot，转发路径上不再有堆内存分配
+class PacketBufferPool {
+public:
+    PacketBufferPool() = default;
+    ~PacketBufferPool() = default;
+
+    // 当前线程的缓冲池，每个worker线程各自独立，不需要加锁
+    static PacketBufferPool* current();
+
+    char* alloc();
+    void release(char* slot);
+
+    size_t total_slots() { return _total_slots; }
+    size_t free_slots() { return _free_slots.size(); }
+
+private:
+    void _grow();
+
+private:
+    std::vector<std::unique_ptr<char[]>> _chunks;
+    std::vector<char*> _free_slots;
+    size_t _total_slots = 0;
+};
+
+// 从当前线程缓冲池中借出的包缓冲区，析构时归还
+class PacketBuffer {
+public:
+    PacketBuffer();
+    PacketBuffer(PacketBuffer&& other);
+    ~PacketBuffer();
+
+    PacketBuffer(const PacketBuffer&) = delete;
+    PacketBuffer& operator=(const PacketBuffer&) = delete;
+
+    char* data() { return _data; }
+    const char* cdata() const { return _data; }
+    size_t size() const { return _size; }
+    size_t capacity() const { return k_packet_buffer_capacity; }
+    void set_size(size_t size) { _size = size; }
+
+    // 数据超过slot大小时返回false
+    bool set_data(const char* data, size_t len);
+
+private:
+    PacketBufferPool* _pool;
+    char* _data;
+    size_t _size = 0;
+};
+
+} // namespace xrtc
+
+#endif // __BASE_PACKET_BUFFER_H_
@@ -216,9 +216,12 @@ int sock_bind(int sock, struct sockaddr* addr, socklen_t len, int min_port, int
         // 让操作系统自动选择一个port
         ret = bind(sock, addr, len);
     } else {
-        struct sockaddr_in* addr_in = (struct sockaddr_in*)addr;
         for (int port = min_port; port <= max_port && ret != 0; port++) {
-            addr_in->sin_port = htons(port);
+            if (AF_INET6 == addr->sa_family) {
+                ((struct sockaddr_in6*)addr)->sin6_port = htons(port);
+            } else {
+                ((struct sockaddr_in*)addr)->sin_port = htons(port);
+            }
             ret = bind(sock, addr, len);
         }
     }
@@ -232,21 +235,35 @@ int sock_bind(int sock, struct sockaddr* addr, socklen_t len, int min_port, int
 }
 
 int sock_get_address(int sock, char* ip, int* port) {
-    struct sockaddr_in addr_in;
-    socklen_t len = sizeof(struct sockaddr);
-    int ret = getsockname(sock, (struct sockaddr*)&addr_in, &len);
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    int ret = getsockname(sock, (struct sockaddr*)&addr, &len);
     if (ret != 0) {
         RTC_LOG(LS_WARNING) << "getsockname error: " << strerror(errno)
             << ", errno: " << errno;
         return -1;
     }
 
+    if (AF_INET6 == addr.ss_family) {
+        struct sockaddr_in6* addr_in6 = (struct sockaddr_in6*)&addr;
+        if (ip) {
+            inet_ntop(AF_INET6, &addr_in6->sin6_addr, ip, INET6_ADDRSTRLEN);
+        }
+
+        if (port) {
+            *port = ntohs(addr_in6->sin6_port);
+        }
+
+        return 0;
+    }
+
+    struct sockaddr_in* addr_in = (struct sockaddr_in*)&addr;
     if (ip) {
-        memcpy(ip, inet_ntoa(addr_in.sin_addr), sizeof(addr_in.sin_addr));
+        memcpy(ip, inet_ntoa(addr_in->sin_addr), sizeof(addr_in->sin_addr));
     }
 
     if (port) {
-        *port = ntohs(addr_in.sin_port);
+        *port = ntohs(addr_in->sin_port);
     }
 
     return 0;
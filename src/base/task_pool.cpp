@@ -0,0 +1,88 @@
+#include <rtc_base/logging.h>
+
+#include "base/task_pool.h"
+
+namespace xrtc {
+
+TaskPool::TaskPool(const std::string& name, int thread_num) :
+    _name(name)
+{
+    for (int i = 0; i < thread_num; ++i) {
+        _workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+}
+
+TaskPool::~TaskPool() {
+    stop();
+    join();
+
+    for (auto& worker : _workers) {
+        delete worker->thread;
+        worker->thread = nullptr;
+    }
+}
+
+bool TaskPool::start() {
+    for (auto& worker : _workers) {
+        if (worker->thread) {
+            RTC_LOG(LS_WARNING) << _name << " task pool already start";
+            return false;
+        }
+
+        worker->running = true;
+        Worker* w = worker.get();
+        worker->thread = new std::thread([=]() {
+            _run(w);
+        });
+    }
+
+    RTC_LOG(LS_INFO) << _name << " task pool start, thread_num: " << _workers.size();
+    return true;
+}
+
+void TaskPool::stop() {
+    for (auto& worker : _workers) {
+        std::unique_lock<std::mutex> lock(worker->mtx);
+        worker->running = false;
+        worker->cond.notify_one();
+    }
+}
+
+void TaskPool::join() {
+    for (auto& worker : _workers) {
+        if (worker->thread && worker->thread->joinable()) {
+            worker->thread->join();
+        }
+    }
+}
+
+void TaskPool::post(size_t key, std::function<void()> task) {
+    Worker* worker = _workers[key % _workers.size()].get();
+    std::unique_lock<std::mutex> lock(worker->mtx);
+    worker->tasks.push_back(std::move(task));
+    worker->cond.notify_one();
+}
+
+void TaskPool::_run(Worker* worker) {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(worker->mtx);
+            worker->cond.wait(lock, [=]() {
+                return !worker->running || !worker->tasks.empty();
+            });
+
+            // 退出前把已经投递的任务执行完
+            if (worker->tasks.empty()) {
+                return;
+            }
+
+            task = std::move(worker->tasks.front());
+            worker->tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+} // namespace xrtc
@@ -0,0 +1,48 @@
+#ifndef __BASE_TASK_POOL_H_
+#define __BASE_TASK_POOL_H_
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xrtc {
+
+// 固定数量的后台线程，每个线程一个任务队列。
+// 相同key的任务总是投递到同一个线程，保证按投递顺序串行执行
+class TaskPool {
+public:
+    TaskPool(const std::string& name, int thread_num);
+    ~TaskPool();
+
+    bool start();
+    void stop();
+    void join();
+
+    int thread_num() { return (int)_workers.size(); }
+    void post(size_t key, std::function<void()> task);
+
+private:
+    struct Worker {
+        std::thread* thread = nullptr;
+        std::mutex mtx;
+        std::condition_variable cond;
+        std::deque<std::function<void()>> tasks;
+        bool running = false;
+    };
+
+    void _run(Worker* worker);
+
+private:
+    std::string _name;
+    std::vector<std::unique_ptr<Worker>> _workers;
+};
+
+} // namespace xrtc
+
+#endif // __BASE_TASK_POOL_H_
@@ -8,8 +8,9 @@
 
 namespace xrtc {
 
-IceAgent::IceAgent(EventLoop* el, PortAllocator* allocator) : 
-    _el(el), _allocator(allocator) {}
+IceAgent::IceAgent(EventLoop* el, PortAllocator* allocator,
+        IceScheduler* scheduler) : 
+    _el(el), _allocator(allocator), _scheduler(scheduler) {}
 
 IceAgent::~IceAgent() {
     for (auto channel : _channels) {
@@ -32,7 +33,8 @@ bool IceAgent::create_channel(EventLoop* el, const std::string& transport_name,
         return true;
     }
     
-    auto channel = new IceTransportChannel(el, _allocator, transport_name, component);
+    auto channel = new IceTransportChannel(el, _allocator, _scheduler,
+            transport_name, component);
     channel->signal_candidate_allocate_done.connect(this, 
         &IceAgent::on_candidate_allocate_done);
     channel->signal_receiving_state.connect(this, 
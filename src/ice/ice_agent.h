@@ -9,13 +9,14 @@
 #include "base/event_loop.h"
 #include "ice/ice_transport_channel.h"
 #include "ice/port_allocator.h"
+#include "ice/ice_scheduler.h"
 #include "rtc_base/third_party/sigslot/sigslot.h"
 
 namespace xrtc {
 
 class IceAgent : public sigslot::has_slots<> {
 public:
-    IceAgent(EventLoop* el, PortAllocator* allocator);
+    IceAgent(EventLoop* el, PortAllocator* allocator, IceScheduler* scheduler);
     ~IceAgent();
 
     bool create_channel(EventLoop* el, const std::string& transport_name,
@@ -55,6 +56,7 @@ private:
     EventLoop* _el;
     std::vector<IceTransportChannel*> _channels;
     PortAllocator* _allocator;
+    IceScheduler* _scheduler;
     IceTransportState _ice_state = IceTransportState::k_new;
 };
 
@@ -18,18 +18,10 @@ const int RTT_RATIO = 3;
 const int MIN_RTT = 100; // 100ms
 const int MAX_RTT = 60000; // 60S
 
-ConnectionRequest::ConnectionRequest(IceConnection* conn) :
-    StunRequest(new StunMessage()), _connection(conn)
+static void prepare_binding_request(IceConnection* conn,
+        const std::string& username, StunMessage* msg)
 {
-   
-}
-
-
-void ConnectionRequest::prepare(StunMessage* msg) {
     msg->set_type(STUN_BINDING_REQUEST);
-    std::string username;
-    _connection->port()->create_stun_username(
-         _connection->remote_candidate().username, &username);
     msg->add_attribute(std::make_unique<StunByteStringAttribute>(
                     STUN_ATTR_USERNAME, username));
     msg->add_attribute(std::make_unique<StunUInt64Attribute>(
@@ -39,13 +31,27 @@ void ConnectionRequest::prepare(StunMessage* msg) {
     // priority
     int type_pref = ICE_TYPE_PREFERENCE_PRFLX;
     uint32_t prflx_priority = (type_pref << 24) |
-        (_connection->local_candidate().priority & 0x00FFFFFF);
+        (conn->local_candidate().priority & 0x00FFFFFF);
     msg->add_attribute(std::make_unique<StunUInt32Attribute>(
                         STUN_ATTR_PRIORITY, prflx_priority));
-    msg->add_message_integrity(_connection->remote_candidate().password);
+    msg->add_message_integrity(conn->remote_candidate().password);
     msg->add_fingerprint();
 }
 
+ConnectionRequest::ConnectionRequest(IceConnection* conn) :
+    StunRequest(new StunMessage()), _connection(conn)
+{
+   
+}
+
+
+void ConnectionRequest::prepare(StunMessage* msg) {
+    std::string username;
+    _connection->port()->create_stun_username(
+         _connection->remote_candidate().username, &username);
+    prepare_binding_request(_connection, username, msg);
+}
+
 void ConnectionRequest::on_request_response(StunMessage* msg) {
     _connection->on_connection_request_response(this, msg);
 }
@@ -140,6 +146,7 @@ void IceConnection::received_ping_response(int rtt) {
     // 5 10 20
     // rtt = 5
     // rtt = 5 * 0.75 + 10 * 0.25 = 3.75 + 2.5 = 6.25
+    int old_rtt = _rtt;
     if (_rtt_samples > 0) {
         _rtt = rtc::GetNextMovingAverage(_rtt, rtt, RTT_RATIO);
     } else {
@@ -152,6 +159,10 @@ void IceConnection::received_ping_response(int rtt) {
     update_receiving(_last_ping_response_received); // 只要收到任何合法数据都会调用
     set_write_state(STATE_WRITABLE);
     set_state(IceCandidatePairState::SUCCEEDED);
+
+    if (_rtt != old_rtt) {
+        signal_rtt_change(this);
+    }
 }
 
 
@@ -294,7 +305,10 @@ void IceConnection::send_stun_binding_response(StunMessage* stun_msg) {
     response.add_attribute(std::make_unique<StunXorAddressAttribute>
         (STUN_ATTR_XOR_MAPPED_ADDRESS, remote_candidate().address));
     // 4 + 20
-    response.add_message_integrity(_port->ice_pwd()); // 构建response时，使用的是服务器的本地ice_pwd(local ice pwd)?
+    // ice restart期间可能同时存在新旧两套本地凭证，使用请求中ufrag对应的pwd
+    std::string username = username_attr->get_string();
+    std::string local_ufrag = username.substr(0, username.find(':'));
+    response.add_message_integrity(_port->ice_pwd(local_ufrag)); // 构建response时，使用的是服务器的本地ice_pwd(local ice pwd)?
     // 4 + 4
     response.add_fingerprint();
 
@@ -355,8 +369,10 @@ void IceConnection::on_read_packet(const char* buf, size_t len, int64_t ts) {
             case STUN_BINDING_RESPONSE:
             case STUN_BINDING_ERROR_RESPONSE:
                 stun_msg->validate_message_integrity(_remote_candidate.password);
-                if (stun_msg->integrity_ok()) {
-                    _request_manager.check_response(stun_msg.get());
+                if (stun_msg->integrity_ok() &&
+                        !_request_manager.check_response(stun_msg.get()))
+                {
+                    _on_consent_response(stun_msg.get());
                 }
                 break;
             default:
@@ -374,6 +390,13 @@ void IceConnection::maybe_set_remote_ice_params(const IceParamters& ice_params)
     }
 }
 
+void IceConnection::on_ice_restart(const IceParamters& ice_params) {
+    // 地址不变的连接直接使用新的凭证继续检查，consent请求会在下次发送时重建
+    _remote_candidate.username = ice_params.ice_ufrag;
+    _remote_candidate.password = ice_params.ice_pwd;
+    RTC_LOG(LS_INFO) << to_string() << ": remote credentials updated by ice restart";
+}
+
 bool IceConnection::stable(int64_t now) const {
     return _rtt_samples > RTT_RATIO + 1 && !_miss_response(now);
 }
@@ -398,6 +421,90 @@ void IceConnection::ping(int64_t now) {
     _nums_pings_sent++;
 }
 
+bool IceConnection::_build_consent_request() {
+    std::string username;
+    _port->create_stun_username(_remote_candidate.username, &username);
+    if (_consent_request_len > 0 && username == _consent_username &&
+            _remote_candidate.password == _consent_password)
+    {
+        return true;
+    }
+
+    StunMessage msg;
+    msg.set_transaction_id(rtc::CreateRandomString(k_stun_transaction_id_length));
+    prepare_binding_request(this, username, &msg);
+
+    rtc::ByteBufferWriter buf;
+    if (!msg.write(&buf) || buf.Length() > sizeof(_consent_request)) {
+        _consent_request_len = 0;
+        return false;
+    }
+
+    memcpy(_consent_request, buf.Data(), buf.Length());
+    _consent_request_len = buf.Length();
+    _consent_username = username;
+    _consent_password = _remote_candidate.password;
+    return true;
+}
+
+void IceConnection::send_consent_check(int64_t now) {
+    _consent_id = rtc::CreateRandomString(k_stun_transaction_id_length);
+    if (!_build_consent_request() ||
+            !StunMessage::update_transaction_id(_consent_request,
+                _consent_request_len, _consent_id, _consent_password))
+    {
+        RTC_LOG(LS_WARNING) << to_string() << ": Failed to build consent request, "
+            << "fallback to ping";
+        _consent_id.clear();
+        ping(now);
+        return;
+    }
+
+    _last_ping_sent = now;
+    _consent_sent = now;
+    _pings_since_last_responses.push_back(SentPing(_consent_id, now));
+    _nums_pings_sent++;
+
+    int ret = _port->send_to(_consent_request, _consent_request_len,
+            _remote_candidate.address);
+    if (ret < 0) {
+        RTC_LOG(LS_WARNING) << to_string() << ": Failed to send consent request: ret="
+            << ret << ", id=" << rtc::hex_encode(_consent_id);
+    }
+}
+
+void IceConnection::_on_consent_response(StunMessage* msg) {
+    if (_consent_id.empty() || msg->transaction_id() != _consent_id) {
+        return;
+    }
+
+    _consent_id.clear();
+    int rtt = rtc::TimeMillis() - _consent_sent;
+    if (msg->type() == STUN_BINDING_RESPONSE) {
+        received_ping_response(rtt);
+        return;
+    }
+
+    int error_code = msg->get_error_code_value();
+    RTC_LOG(LS_WARNING) << to_string() << ": Received consent error response"
+        << ", id=" << rtc::hex_encode(msg->transaction_id())
+        << ", rtt=" << rtt
+        << ", code=" << error_code;
+    if (STUN_ERROR_UNAUTHORIZED != error_code &&
+            STUN_ERROR_UNKNOWN_ATTRBUTE != error_code &&
+            STUN_ERROR_SERVER_ERROR != error_code)
+    {
+        // 对端明确撤回了同意
+        fail_and_destroy();
+    }
+}
+
+void IceConnection::received_media(int64_t now) {
+    _last_data_received = now;
+    if (!_receiving) {
+        update_receiving(now);
+    }
+}
 
 int IceConnection::send_packet(const char* data, size_t len) {
     if (!_port) {
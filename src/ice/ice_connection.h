@@ -15,6 +15,8 @@ namespace xrtc {
 class UDPPort;
 class IceConnection;
 
+const size_t k_max_consent_request_size = 512;
+
 class ConnectionRequest : public StunRequest {
 public:
     ConnectionRequest(IceConnection* conn);
@@ -58,6 +60,7 @@ public:
     void on_connection_request_response(ConnectionRequest* request, StunMessage* msg);
     void on_connection_request_error_response(ConnectionRequest* request, StunMessage* msg);
     void maybe_set_remote_ice_params(const IceParamters& ice_params);
+    void on_ice_restart(const IceParamters& ice_params);
     void print_pings_since_last_response(std::string& pings, size_t max);
 
     void set_write_state(WriteState state);
@@ -69,6 +72,10 @@ public:
     bool active() { return _write_state != STATE_WRITE_TIMEOUT; }
     bool stable(int64_t now) const;
     void ping(int64_t now);
+    // rfc7675 consent检查，复用预先构造好的binding请求
+    void send_consent_check(int64_t now);
+    // 收到经过认证的数据(SRTP/SRTCP)，说明对端仍然同意接收
+    void received_media(int64_t now);
     void received_ping_response(int rtt);
     void update_receiving(int64_t now);
     int receiving_timeout();
@@ -85,11 +92,13 @@ public:
 
     int64_t last_ping_sent() const { return _last_ping_sent; }
     int64_t last_received();
+    int64_t last_data_received() const { return _last_data_received; }
     int num_pings_sent() const { return _nums_pings_sent; }
 
     std::string to_string();
 
     sigslot::signal<IceConnection*> signal_state_change;
+    sigslot::signal<IceConnection*> signal_rtt_change;
     sigslot::signal<IceConnection*> signal_connection_destroy;
     sigslot::signal<IceConnection*, const char*, size_t, int64_t> signal_read_packet;
 
@@ -98,6 +107,8 @@ private:
     bool _miss_response(int64_t now) const;
     bool _too_many_ping_fails(size_t max_pings, int rtt, int64_t now);
     bool _too_long_without_response(int min_time, int64_t now);
+    bool _build_consent_request();
+    void _on_consent_response(StunMessage* msg);
 
 private:
     EventLoop* _el;
@@ -118,6 +129,14 @@ private:
     int _rtt = 3000;
     int _rtt_samples = 0; // rtt采样数，计算rtt需要用到平滑算法
     IceCandidatePairState _state = IceCandidatePairState::WAITING;
+
+    // 预先构造的consent请求，用户名或密码变化时重新构造
+    char _consent_request[k_max_consent_request_size];
+    size_t _consent_request_len = 0;
+    std::string _consent_username;
+    std::string _consent_password;
+    std::string _consent_id;
+    int64_t _consent_sent = 0;
 };
 
 }
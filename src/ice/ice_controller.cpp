@@ -1,7 +1,8 @@
+#include <algorithm>
 #include <cstdint>
+#include <tuple>
 #include <rtc_base/logging.h>
-#include <rtc_base/time_utils.h>
-#include <absl/algorithm/container.h>
+#include <rtc_base/helpers.h>
 
 #include "ice/ice_controller.h"
 #include "ice/ice_connection.h"
@@ -11,16 +12,76 @@
 namespace xrtc {
 
 const int k_min_improvement = 10; // 单位：10ms
-const int a_is_better = 1;
-const int b_is_better = -1;
+// consent模式下两次检查之间最短的等待时间，单位：ms
+const int k_min_consent_check_delay = 50;
+
+bool ConnectionRank::operator<(const ConnectionRank& other) const {
+    return std::tie(write_state, not_receiving, inverse_priority, rtt, seq) <
+        std::tie(other.write_state, other.not_receiving, other.inverse_priority,
+                other.rtt, other.seq);
+}
+
+bool ConnectionRank::operator==(const ConnectionRank& other) const {
+    return std::tie(write_state, not_receiving, inverse_priority, rtt, seq) ==
+        std::tie(other.write_state, other.not_receiving, other.inverse_priority,
+                other.rtt, other.seq);
+}
+
+ConnectionRank IceController::_make_rank(IceConnection* conn, uint64_t seq) {
+    ConnectionRank rank;
+    rank.write_state = conn->write_state();
+    rank.not_receiving = conn->receiving() ? 0 : 1;
+    rank.inverse_priority = UINT64_MAX - conn->priority();
+    rank.rtt = conn->rtt();
+    rank.seq = seq;
+    return rank;
+}
 
 void IceController::add_connection(IceConnection* conn) {
+    ConnectionEntry& entry = _entries[conn];
+    entry.seq = _next_seq++;
+    entry.rank = _make_rank(conn, entry.seq);
+    entry.ping_key = PingKey(conn->last_ping_sent(), entry.seq);
+    entry.active = conn->active();
+    entry.receiving = conn->receiving();
+    entry.need_more_pings = conn->num_pings_sent() < MIN_PINGS_AT_WEAK_PING_INTERVAL;
+
     _connections.push_back(conn);
-    _unpinged_connections.insert(conn);
+    _ranking.emplace(entry.rank, conn);
+    _unpinged_connections.emplace(entry.ping_key, conn);
+    _num_active += entry.active ? 1 : 0;
+    _num_receiving += entry.receiving ? 1 : 0;
+    _num_need_more_pings += entry.need_more_pings ? 1 : 0;
 }
 
-bool IceController::has_pingable_connection() {
-    int64_t now = rtc::TimeMillis();
+void IceController::update_connection(IceConnection* conn) {
+    auto iter = _entries.find(conn);
+    if (iter == _entries.end()) {
+        return;
+    }
+
+    ConnectionEntry& entry = iter->second;
+    ConnectionRank rank = _make_rank(conn, entry.seq);
+    if (!(rank == entry.rank)) {
+        _ranking.erase(entry.rank);
+        entry.rank = rank;
+        _ranking.emplace(rank, conn);
+    }
+
+    bool active = conn->active();
+    if (active != entry.active) {
+        entry.active = active;
+        active ? ++_num_active : --_num_active;
+    }
+
+    bool receiving = conn->receiving();
+    if (receiving != entry.receiving) {
+        entry.receiving = receiving;
+        receiving ? ++_num_receiving : --_num_receiving;
+    }
+}
+
+bool IceController::has_pingable_connection(int64_t now) {
     for (auto conn : _connections) {
         if (_is_pingable(conn, now)) {
             return true;
@@ -47,30 +108,69 @@ bool IceController::_is_pingable(IceConnection* conn, int64_t now) {
     return _is_connection_past_ping_interval(conn, now);
 }
 
-
-PingResult IceController::select_connection_to_ping(int64_t _last_ping_sent_ms) {
-    bool need_ping_more_at_weak = false;
-    for (auto conn : _connections) {
-        if (conn->num_pings_sent() < MIN_PINGS_AT_WEAK_PING_INTERVAL) {
-            need_ping_more_at_weak =  true;
-            break;
-        }
+PingResult IceController::select_connection_to_ping(int64_t now,
+        int64_t last_ping_sent_ms)
+{
+    // 选中的连接已经稳定，只需要对它做consent检查(rfc7675)
+    // 下一次检查之前不需要再唤醒
+    if (consent_mode(now)) {
+        const IceConnection* conn = _find_consent_check_connection(now);
+        return PingResult(conn, _consent_check_delay(conn, now), true);
     }
 
+    bool need_ping_more_at_weak = _num_need_more_pings > 0;
+
     // 1、确定ping的间隔
     int ping_interval = (_weak() || need_ping_more_at_weak) ? WEAK_PING_INTERVAL 
         : STRONG_PING_INTERVAL;
 
     // 2、确定ping的IceConnection
-    int64_t now = rtc::TimeMillis();
     const IceConnection* conn = nullptr;
-    if (now >= _last_ping_sent_ms + ping_interval) {
+    if (now >= last_ping_sent_ms + ping_interval) {
         conn = _find_next_pingable_connection(now);
     }
 
     return PingResult(conn, ping_interval);
 }
 
+bool IceController::consent_mode(int64_t now) {
+    return _selected_connection && !_weak() && _num_need_more_pings == 0 &&
+        _selected_connection->stable(now);
+}
+
+const IceConnection* IceController::_find_consent_check_connection(int64_t now) {
+    IceConnection* conn = _selected_connection;
+    if (now < conn->last_ping_sent() + _consent_interval) {
+        return nullptr;
+    }
+
+    // 最近收到过SRTP/SRTCP，已经可以证明对端存活，跳过本次检查
+    if (now < conn->last_data_received() + _consent_interval) {
+        return nullptr;
+    }
+
+    _update_consent_interval();
+    return conn;
+}
+
+int IceController::_consent_check_delay(const IceConnection* conn, int64_t now) {
+    // 本次发送了检查，下一次在新的随机间隔之后
+    if (conn) {
+        return _consent_interval;
+    }
+
+    const IceConnection* selected = _selected_connection;
+    int64_t next_check = std::max(selected->last_ping_sent(),
+            selected->last_data_received()) + _consent_interval;
+    return std::max<int64_t>(next_check - now, k_min_consent_check_delay);
+}
+
+void IceController::_update_consent_interval() {
+    // 随机化检查间隔，避免大量连接同时发送
+    _consent_interval = CONSENT_CHECK_INTERVAL - CONSENT_CHECK_JITTER +
+        rtc::CreateRandomId() % (2 * CONSENT_CHECK_JITTER + 1);
+}
+
 const IceConnection* IceController::_find_next_pingable_connection(int64_t now) {
     if (_selected_connection && _selected_connection->writable() &&
             _is_connection_past_ping_interval(_selected_connection, now))
@@ -78,55 +178,40 @@ const IceConnection* IceController::_find_next_pingable_connection(int64_t now)
         return _selected_connection;
     }
 
-    bool has_pingable = false;
-    for (auto conn : _unpinged_connections) {
-        if (_is_pingable(conn, now)) {
-            has_pingable = true;
-            break;
-        }
+    IceConnection* find_conn = _find_pingable_in_unpinged(now);
+    if (find_conn) {
+        return find_conn;
     }
 
-    if (!has_pingable) {
+    // 未ping的connection都不可ping，重新开始新的一轮
+    if (!_pinged_connections.empty()) {
         _unpinged_connections.insert(_pinged_connections.begin(),
             _pinged_connections.end());
         _pinged_connections.clear();
-    }
-
-    IceConnection* find_conn = nullptr;
-    for (auto conn : _unpinged_connections) {
-        if (!_is_pingable(conn, now)) {
-            continue;
-        }
-        // 优先选择最久没有发送ping请求的connection
-        if (_more_pingable(conn, find_conn)) {
-            find_conn = conn;
-        }
+        find_conn = _find_pingable_in_unpinged(now);
     }
 
     return find_conn;
 }
 
-bool IceController::_more_pingable(IceConnection* conn1, IceConnection* conn2) {
-    if (!conn2) {
-        return true;
-    }
-
-    if (!conn1) {
-        return false;
-    }
+IceConnection* IceController::_find_pingable_in_unpinged(int64_t now) {
+    // 按最近一次发送ping的时间排序，第一个可ping的就是最久没有发送ping请求的connection
+    bool weak = _weak();
+    for (auto& item : _unpinged_connections) {
+        IceConnection* conn = item.second;
+        // 最小的ping间隔都没到，后面的connection更不可能到
+        if (!weak && now < conn->last_ping_sent() + WEAK_PING_INTERVAL) {
+            break;
+        }
 
-    if (conn1->last_ping_sent() < conn2->last_ping_sent()) {
-        return true;
+        if (_is_pingable(conn, now)) {
+            return conn;
+        }
     }
 
-    if (conn1->last_ping_sent() > conn2->last_ping_sent()) {
-        return false;
-    }
-    
-    return false;
+    return nullptr;
 }
 
-
 bool IceController::_is_connection_past_ping_interval(const IceConnection* conn,
         int64_t now)
 {
@@ -148,72 +233,33 @@ int IceController::_get_connection_ping_interval(const IceConnection* conn,
     return STABLE_CONNECTION_PING_INTERVAL;  // 2500ms
 }
 
-int IceController::_compare_connections(IceConnection* a, IceConnection* b) {
-    if (a->writable() && !b->writable()) {
-        return a_is_better;
-    }
-
-    if (!a->writable() && b->writable()) {
-        return b_is_better;
-    }
-
-    if (a->write_state() < b->write_state()) {
-        return a_is_better;
-    }
-
-    if (a->write_state() > b->write_state()) {
-        return b_is_better;
-    }
-
-    if (a->receiving() && !b->receiving()) {
-        return a_is_better;
-    }
-
-    if (!a->receiving() && b->receiving()) {
-        return b_is_better;
-    }
-
-    if (a->priority() > b->priority()) {
-        return a_is_better;
-    }
-
-    if (a->priority() < b->priority()) {
-        return b_is_better;
-    }
-
-    return 0;
-}
-
 bool IceController::ready_to_send(IceConnection* conn) {
     return conn && (conn->writable() || conn->write_state() 
                     == IceConnection::STATE_WRITE_UNRELIABLE);
 }
 
 IceConnection* IceController::sort_and_switch_connection() {
-    absl::c_stable_sort(_connections, [this](IceConnection* conn1, IceConnection* conn2){
-        int cmp = _compare_connections(conn1, conn2);
-        if (cmp != 0) {
-            return cmp > 0;
-        }
-
-        return conn1->rtt() < conn2->rtt();
-    });
-
-    RTC_LOG(LS_INFO) << "Sort " << _connections.size() << " available connections: ";
-    for (auto conn : _connections) {
-        RTC_LOG(LS_INFO) << conn->to_string();
-    }
-
-    IceConnection* top_connection = _connections.empty() ? nullptr : _connections[0];
+    IceConnection* top_connection = _ranking.empty() ? nullptr : _ranking.begin()->second;
     if (!ready_to_send(top_connection) || _selected_connection == top_connection) {
         return nullptr;
     }
 
+    RTC_LOG(LS_INFO) << "Top of " << _ranking.size() << " available connections: "
+        << top_connection->to_string();
+
     // 未选出selected_connection
     if (!_selected_connection)  {
         return top_connection;
     }
 
+    // 选中的连接已经不可写或者不再接收数据(比如ice restart后客户端切换了网络)，
+    // 不需要等待rtt的改善，直接切换
+    if (top_connection->write_state() < _selected_connection->write_state() ||
+            (top_connection->receiving() && !_selected_connection->receiving()))
+    {
+        return top_connection;
+    }
+
     if (top_connection->rtt() <= _selected_connection->rtt() - k_min_improvement) {
         return top_connection;
     }
@@ -222,24 +268,46 @@ IceConnection* IceController::sort_and_switch_connection() {
 }
 
 void IceController::mark_connection_pinged(IceConnection* conn) {
-    if (conn && _pinged_connections.insert(conn).second) {
-        _unpinged_connections.erase(conn);
+    auto iter = _entries.find(conn);
+    if (iter == _entries.end()) {
+        return;
+    }
+
+    ConnectionEntry& entry = iter->second;
+    _unpinged_connections.erase(entry.ping_key);
+    _pinged_connections.erase(entry.ping_key);
+    entry.ping_key = PingKey(conn->last_ping_sent(), entry.seq);
+    _pinged_connections.emplace(entry.ping_key, conn);
+
+    if (entry.need_more_pings &&
+            conn->num_pings_sent() >= MIN_PINGS_AT_WEAK_PING_INTERVAL)
+    {
+        entry.need_more_pings = false;
+        --_num_need_more_pings;
     }
 }
 
 void IceController::on_connection_destroyed(IceConnection* conn) {
-    _pinged_connections.erase(conn);
-    _unpinged_connections.erase(conn);
-
-    auto iter = _connections.begin();
-    for (; iter != _connections.end(); ++iter) {
-        if (*iter == conn) {
-            _connections.erase(iter);
-            break; // ???
-        }
+    if (_selected_connection == conn) {
+        _selected_connection = nullptr;
     }
-}
 
-} // namespace xrtc
+    auto iter = _entries.find(conn);
+    if (iter != _entries.end()) {
+        ConnectionEntry& entry = iter->second;
+        _ranking.erase(entry.rank);
+        _pinged_connections.erase(entry.ping_key);
+        _unpinged_connections.erase(entry.ping_key);
+        _num_active -= entry.active ? 1 : 0;
+        _num_receiving -= entry.receiving ? 1 : 0;
+        _num_need_more_pings -= entry.need_more_pings ? 1 : 0;
+        _entries.erase(iter);
+    }
 
+    auto conn_iter = std::find(_connections.begin(), _connections.end(), conn);
+    if (conn_iter != _connections.end()) {
+        _connections.erase(conn_iter);
+    }
+}
 
+} // namespace xrtc
@@ -1,20 +1,37 @@
 #ifndef  __ICE_CONTROLLER_H_
 #define  __ICE_CONTROLLER_H_
 
-#include <set>
+#include <map>
+#include <unordered_map>
+#include <utility>
 
 #include "ice/ice_connection.h"
+#include "ice/ice_def.h"
 
 namespace xrtc {
 
 class IceTransportChannel;
 
 struct PingResult {
-    PingResult(const IceConnection* conn, int ping_interval) :
-        conn(conn), ping_interval(ping_interval) {}
+    PingResult(const IceConnection* conn, int ping_interval, bool consent = false) :
+        conn(conn), ping_interval(ping_interval), consent(consent) {}
 
     const IceConnection* conn = nullptr;
     int ping_interval = 0;
+    bool consent = false; // 是否为consent检查
+};
+
+// connection的排序键，越小越好:
+// 可写状态 > 可读状态 > 优先级 > rtt > 加入顺序
+struct ConnectionRank {
+    int write_state = 0;
+    int not_receiving = 0;
+    uint64_t inverse_priority = 0;
+    int rtt = 0;
+    uint64_t seq = 0;
+
+    bool operator<(const ConnectionRank& other) const;
+    bool operator==(const ConnectionRank& other) const;
 };
 
 class IceController {
@@ -23,37 +40,64 @@ public:
     ~IceController() = default;
   
     void add_connection(IceConnection* conn);
-    const std::vector<IceConnection*> connections() { return _connections; }
-    bool has_pingable_connection();
-    PingResult select_connection_to_ping(int64_t _last_ping_sent_ms);
+    // connection的可写、可读状态或者rtt发生变化时调用，增量更新排序
+    void update_connection(IceConnection* conn);
+    const std::vector<IceConnection*>& connections() { return _connections; }
+    bool has_pingable_connection(int64_t now);
+    PingResult select_connection_to_ping(int64_t now, int64_t last_ping_sent_ms);
+    // 选中的连接已经稳定，只需要对它做consent检查
+    bool consent_mode(int64_t now);
     IceConnection* sort_and_switch_connection();
     void set_selected_connection(IceConnection* conn) { _selected_connection = conn; }
     void mark_connection_pinged(IceConnection* conn);
     void on_connection_destroyed(IceConnection* conn);
     bool ready_to_send(IceConnection* conn);
+    bool has_active_connection() { return _num_active > 0; }
+    bool has_receiving_connection() { return _num_receiving > 0; }
 
 private:
+    // 未ping/已ping集合的排序键: (last_ping_sent, seq)
+    typedef std::pair<int64_t, uint64_t> PingKey;
+
+    struct ConnectionEntry {
+        uint64_t seq = 0;
+        ConnectionRank rank;
+        PingKey ping_key;
+        bool active = false;
+        bool receiving = false;
+        bool need_more_pings = false; // 发送的ping还不够MIN_PINGS_AT_WEAK_PING_INTERVAL
+    };
+
     bool _is_pingable(IceConnection* conn, int64_t now);
     const IceConnection* _find_next_pingable_connection(int64_t now);
+    IceConnection* _find_pingable_in_unpinged(int64_t now);
     bool _is_connection_past_ping_interval(const IceConnection* conn, int64_t now);
     int _get_connection_ping_interval(const IceConnection* conn, int64_t now);
+    const IceConnection* _find_consent_check_connection(int64_t now);
+    int _consent_check_delay(const IceConnection* conn, int64_t now);
+    void _update_consent_interval();
+    ConnectionRank _make_rank(IceConnection* conn, uint64_t seq);
 
     bool _weak() {
         // 当channel没有选出最佳的connection或者最佳的connection处于weak状态时，channel就属于weak状态
         return _selected_connection == nullptr ||  _selected_connection->weak();
     }
- 
-    bool _more_pingable(IceConnection* conn1, IceConnection* conn2);
-    int _compare_connections(IceConnection* a, IceConnection* b);
 
 private:
     IceTransportChannel* _ice_channel;
     IceConnection* _selected_connection = nullptr;
     std::vector<IceConnection*> _connections;
-    std::set<IceConnection*> _unpinged_connections;
-    std::set<IceConnection*> _pinged_connections;
+    std::unordered_map<IceConnection*, ConnectionEntry> _entries;
+    std::map<ConnectionRank, IceConnection*> _ranking;
+    std::map<PingKey, IceConnection*> _unpinged_connections;
+    std::map<PingKey, IceConnection*> _pinged_connections;
+    int _consent_interval = CONSENT_CHECK_INTERVAL;
+    uint64_t _next_seq = 0;
+    size_t _num_active = 0;
+    size_t _num_receiving = 0;
+    size_t _num_need_more_pings = 0;
 };
 
 } // namespace xrtc
 
-#endif  //__ICE_CONTROLLER_H_
\ No newline at end of file
+#endif  //__ICE_CONTROLLER_H_
@@ -15,5 +15,8 @@ const int WEAK_CONNECTION_RECEIVE_TIMEOUT = 2500;
 const int CONNECTION_WRITE_CONNECT_FAILS = 5;
 const int CONNECTION_WRITE_CONNECT_TIMEOUT = 5000;
 const int CONNECTION_WRITE_TIMEOUT = 15000;
+// rfc7675: consent检查的间隔在[4s, 6s]之间随机
+const int CONSENT_CHECK_INTERVAL = 5000;
+const int CONSENT_CHECK_JITTER = 1000;
 
 } // namespace xrtc
\ No newline at end of file
@@ -18,6 +18,8 @@ extern const int WEAK_CONNECTION_RECEIVE_TIMEOUT;
 extern const int CONNECTION_WRITE_CONNECT_FAILS;
 extern const int CONNECTION_WRITE_CONNECT_TIMEOUT;
 extern const int CONNECTION_WRITE_TIMEOUT;
+extern const int CONSENT_CHECK_INTERVAL;               // 5s, rfc7675
+extern const int CONSENT_CHECK_JITTER;
 
 enum IceCandidateComponent {
     RTP = 1,
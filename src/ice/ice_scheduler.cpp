@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include <rtc_base/logging.h>
+#include <rtc_base/time_utils.h>
+
+#include "ice/ice_scheduler.h"
+#include "ice/ice_transport_channel.h"
+
+namespace xrtc {
+
+// 到期时间相差不超过该值的channel合并到同一次唤醒处理
+const int k_ice_scheduler_slack_ms = 5;
+
+void ice_scheduler_cb(EventLoop* /*el*/, TimerWatcher* /*w*/, void* data) {
+    IceScheduler* scheduler = (IceScheduler*)data;
+    scheduler->_on_tick();
+}
+
+IceScheduler::IceScheduler(EventLoop* el) :
+    _el(el)
+{
+    _timer_watcher = _el->create_timer(ice_scheduler_cb, this, false);
+}
+
+IceScheduler::~IceScheduler() {
+    if (_timer_watcher) {
+        _el->delete_timer(_timer_watcher);
+        _timer_watcher = nullptr;
+    }
+}
+
+void IceScheduler::schedule(IceTransportChannel* channel, int64_t due_ms) {
+    auto iter = _due_times.find(channel);
+    if (iter != _due_times.end()) {
+        if (iter->second == due_ms) {
+            return;
+        }
+        _queue.erase(std::make_pair(iter->second, channel));
+        iter->second = due_ms;
+    } else {
+        _due_times[channel] = due_ms;
+    }
+
+    _queue.insert(std::make_pair(due_ms, channel));
+
+    // 只有新的到期时间早于当前定时器时才需要重新设置定时器,
+    // 处理到期channel的过程中统一在最后设置
+    if (_in_tick) {
+        return;
+    }
+
+    if (_armed_ms < 0 || due_ms + k_ice_scheduler_slack_ms < _armed_ms) {
+        _arm_timer(rtc::TimeMillis());
+    }
+}
+
+void IceScheduler::cancel(IceTransportChannel* channel) {
+    auto iter = _due_times.find(channel);
+    if (iter != _due_times.end()) {
+        _queue.erase(std::make_pair(iter->second, channel));
+        _due_times.erase(iter);
+    }
+
+    // channel可能在本轮的回调中被删除
+    std::replace(_ready.begin(), _ready.end(), channel,
+            (IceTransportChannel*)nullptr);
+
+    if (!_in_tick && _queue.empty() && _armed_ms >= 0) {
+        _el->stop_timer(_timer_watcher);
+        _armed_ms = -1;
+    }
+}
+
+void IceScheduler::_arm_timer(int64_t now) {
+    if (_queue.empty()) {
+        _el->stop_timer(_timer_watcher);
+        _armed_ms = -1;
+        return;
+    }
+
+    int64_t due_ms = _queue.begin()->first;
+    int64_t delay_ms = std::max<int64_t>(due_ms - now, 0);
+    _armed_ms = now + delay_ms;
+    _el->start_timer(_timer_watcher, delay_ms * 1000);
+}
+
+void IceScheduler::_on_tick() {
+    _armed_ms = -1;
+
+    // 一次唤醒只取一次时间，处理所有到期的channel
+    int64_t now = rtc::TimeMillis();
+    _ready.clear();
+    auto iter = _queue.begin();
+    while (iter != _queue.end() && iter->first <= now + k_ice_scheduler_slack_ms) {
+        _ready.push_back(iter->second);
+        _due_times.erase(iter->second);
+        iter = _queue.erase(iter);
+    }
+
+    // 回调中channel会重新调用schedule
+    _in_tick = true;
+    for (size_t i = 0; i < _ready.size(); ++i) {
+        if (_ready[i]) {
+            _ready[i]->_on_check_and_ping(now);
+        }
+    }
+    _ready.clear();
+    _in_tick = false;
+
+    _arm_timer(now);
+}
+
+} // namespace xrtc
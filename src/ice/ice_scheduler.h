@@ -0,0 +1,46 @@
+#ifndef __ICE_SCHEDULER_H_
+#define __ICE_SCHEDULER_H_
+
+#include <cstdint>
+#include <set>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include "base/event_loop.h"
+
+namespace xrtc {
+
+class IceTransportChannel;
+
+// 每个worker一个，统一调度该worker上所有IceTransportChannel的连通性检查，
+// 代替每个channel各自的ping定时器
+class IceScheduler {
+public:
+    IceScheduler(EventLoop* el);
+    ~IceScheduler();
+
+    // 在due_ms(rtc::TimeMillis)时刻执行channel的检查，重复调用会覆盖之前的时间
+    void schedule(IceTransportChannel* channel, int64_t due_ms);
+    void cancel(IceTransportChannel* channel);
+    size_t size() { return _due_times.size(); }
+
+private:
+    void _on_tick();
+    void _arm_timer(int64_t now);
+
+    friend void ice_scheduler_cb(EventLoop* /*el*/, TimerWatcher* /*w*/, void* data);
+
+private:
+    EventLoop* _el;
+    TimerWatcher* _timer_watcher = nullptr;
+    int64_t _armed_ms = -1; // 定时器到期的时间，-1表示未启动
+    bool _in_tick = false;
+    std::set<std::pair<int64_t, IceTransportChannel*>> _queue;
+    std::unordered_map<IceTransportChannel*, int64_t> _due_times;
+    std::vector<IceTransportChannel*> _ready; // 本轮到期的channel, 复用避免每次分配
+};
+
+} // namespace xrtc
+
+#endif // __ICE_SCHEDULER_H_
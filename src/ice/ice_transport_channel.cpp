@@ -11,32 +11,25 @@ namespace xrtc {
 
 const int PING_INTERVAL_DIFF = 5;
 
-void ice_ping_cb(EventLoop* /*el*/, TimerWatcher* /*w*/, void* data) {
-    IceTransportChannel* channel = (IceTransportChannel*)data;
-    channel->_on_check_and_ping();
-}
-
 IceTransportChannel::IceTransportChannel(EventLoop* el, 
         PortAllocator* allocator,
+        IceScheduler* scheduler,
         const std::string transport_name,
         IceCandidateComponent component) :
     _el(el),
     _transport_name(transport_name),
     _component(component),
     _allocator(allocator),
+    _scheduler(scheduler),
     _ice_controller(new IceController(this))
 {
     RTC_LOG(LS_INFO) << "ice transport channel created, transport-name: " << _transport_name
         << ", component: " << _component;
-    _ping_wather = _el->create_timer(ice_ping_cb, this, true);
 }
 
 IceTransportChannel::~IceTransportChannel()
 {
-    if (_ping_wather) {
-        _el->delete_timer(_ping_wather);
-        _ping_wather = nullptr;
-    }
+    _scheduler->cancel(this);
 
     std::vector<IceConnection*> connections = _ice_controller->connections();
     for (auto conn : connections) {
@@ -61,6 +54,16 @@ void IceTransportChannel::set_ice_params(const IceParamters& ice_params) {
         << ", ufrag: " << ice_params.ice_ufrag
         << ", pwd: " << ice_params.ice_pwd;
     _ice_params = ice_params;
+
+    // ice restart: 端口和socket保持不变，更新端口上的本地凭证
+    for (auto port : _ports) {
+        port->set_ice_params(ice_params);
+    }
+
+    for (auto& c : _local_candidates) {
+        c.username = ice_params.ice_ufrag;
+        c.password = ice_params.ice_pwd;
+    }
 }
 
 void IceTransportChannel::set_remote_ice_params(const IceParamters& ice_params) {
@@ -69,10 +72,27 @@ void IceTransportChannel::set_remote_ice_params(const IceParamters& ice_params)
         << ", component: " << _component
         << ", ufrag: " << ice_params.ice_ufrag
         << ", pwd: " << ice_params.ice_pwd;
+
+    bool ice_restart = !_remote_ice_params.ice_ufrag.empty() &&
+        _remote_ice_params.ice_ufrag != ice_params.ice_ufrag;
     _remote_ice_params = ice_params;
 
+    if (ice_restart) {
+        RTC_LOG(LS_INFO) << to_string() << ": ice restart, remote ufrag: "
+            << ice_params.ice_ufrag;
+
+        // 对端已经切换到新的凭证，不再接受旧的本地ufrag
+        for (auto port : _ports) {
+            port->clear_prev_ice_params();
+        }
+    }
+
     for (auto conn : _ice_controller->connections()) {
-        conn->maybe_set_remote_ice_params(ice_params);
+        if (ice_restart) {
+            conn->on_ice_restart(ice_params);
+        } else {
+            conn->maybe_set_remote_ice_params(ice_params);
+        }
     }
 
     _sort_connections_and_update_state();
@@ -134,7 +154,10 @@ void IceTransportChannel::_on_unknown_address(UDPPort* port,
     remote_condidate.protocol = "udp";
     remote_condidate.address = addr;
     remote_condidate.username = remote_ufrag;
-    remote_condidate.password = _remote_ice_params.ice_pwd;
+    // 新的ufrag可能先于answer到达，此时密码未知，等设置remote ICE param时再补上
+    if (remote_ufrag == _remote_ice_params.ice_ufrag) {
+        remote_condidate.password = _remote_ice_params.ice_pwd;
+    }
     remote_condidate.priority = remote_priority;
     remote_condidate.type = PRFLX_PORT_TYPE;
 
@@ -165,6 +188,8 @@ void IceTransportChannel::_on_unknown_address(UDPPort* port,
 void IceTransportChannel::_add_connection(IceConnection* conn) {
     conn->signal_state_change.connect(this, 
         &IceTransportChannel::_on_connection_state_change);
+    conn->signal_rtt_change.connect(this, 
+        &IceTransportChannel::_on_connection_state_change);
     conn->signal_connection_destroy.connect(this,
                 &IceTransportChannel::_on_connection_destroyed);
     conn->signal_read_packet.connect(this,
@@ -175,13 +200,24 @@ void IceTransportChannel::_add_connection(IceConnection* conn) {
     _ice_controller->add_connection(conn);
 }
 
-void IceTransportChannel::_on_read_packet(IceConnection* /*conn*/,
+void IceTransportChannel::_on_read_packet(IceConnection* conn,
         const char* buf, size_t len, int64_t ts)
 {
+    _last_read_connection = conn;
     signal_read_packet(this, buf, len, ts);
 }
 
+void IceTransportChannel::on_media_received() {
+    if (_last_read_connection) {
+        _last_read_connection->received_media(rtc::TimeMillis());
+    }
+}
+
 void IceTransportChannel::_on_connection_destroyed(IceConnection* conn) {
+    if (_last_read_connection == conn) {
+        _last_read_connection = nullptr;
+    }
+
     _ice_controller->on_connection_destroyed(conn);
     RTC_LOG(LS_INFO) << to_string() << ": Remove connection: " << conn
         << " with " << _ice_controller->connections().size() << " remaining";
@@ -195,7 +231,8 @@ void IceTransportChannel::_on_connection_destroyed(IceConnection* conn) {
     }
 }
 
-void IceTransportChannel::_on_connection_state_change(IceConnection* /*conn*/) {
+void IceTransportChannel::_on_connection_state_change(IceConnection* conn) {
+    _ice_controller->update_connection(conn);
     _sort_connections_and_update_state();
 }
 
@@ -235,14 +272,7 @@ void IceTransportChannel::_update_state() {
     bool writable = _selected_connection && _selected_connection->writable();
     _set_writable(writable);
 
-    bool receiving = false;
-    for (auto conn : _ice_controller->connections()) {
-        if (conn->receiving()) {
-            receiving = true;
-            break;
-        }
-    }
-    _set_receiving(receiving);
+    _set_receiving(_ice_controller->has_receiving_connection());
 
     IceTransportState state = _compute_ice_transport_state();
     if (state != _state) {
@@ -252,12 +282,8 @@ void IceTransportChannel::_update_state() {
 }
 
 IceTransportState IceTransportChannel::_compute_ice_transport_state() {
-    bool has_connection = false; // 至少有一个连接是活跃的，has_connection = true
-    for (auto conn : _ice_controller->connections()) {
-        if (conn->active()) {
-            has_connection = true;
-        }
-    }
+    // 至少有一个连接是活跃的，has_connection = true
+    bool has_connection = _ice_controller->has_active_connection();
 
     if (_had_connection && !has_connection) {
         return IceTransportState::k_failed;
@@ -310,49 +336,60 @@ void IceTransportChannel::_switch_selected_connection(IceConnection* conn) {
 }
 
 void IceTransportChannel::_maybe_state_pinging() {
+    int64_t now = rtc::TimeMillis();
     if (_start_pinging) {
+        // consent模式下要等到下一次consent检查才唤醒，加入了新的连接或者选中的连接
+        // 变为weak时立即恢复ping
+        if (_cur_ping_interval > STRONG_PING_INTERVAL &&
+                !_ice_controller->consent_mode(now))
+        {
+            _cur_ping_interval = WEAK_PING_INTERVAL;
+            _scheduler->schedule(this, now);
+        }
         return;
     }
 
-    if (_ice_controller->has_pingable_connection()) {
+    if (_ice_controller->has_pingable_connection(now)) {
         RTC_LOG(LS_INFO) << to_string() << ": Have a pingable connection "
             << "for the first time, starting to ping";
-        // 启动定时器
-        _el->start_timer(_ping_wather, _cur_ping_interval * 1000);
+        // 交给worker的调度器统一调度
+        _scheduler->schedule(this, now + _cur_ping_interval);
         _start_pinging = true;
     }
 }
 
-void IceTransportChannel::_on_check_and_ping() {
-    _update_connection_states();
+void IceTransportChannel::_on_check_and_ping(int64_t now) {
+    _update_connection_states(now);
 
-    auto result = _ice_controller->select_connection_to_ping(
+    auto result = _ice_controller->select_connection_to_ping(now,
         _last_ping_sent_ms - PING_INTERVAL_DIFF);
 
     if (result.conn) {
         IceConnection* conn = const_cast<IceConnection*>(result.conn);
-        _ping_connection(conn); // ???
+        if (result.consent) {
+            _last_ping_sent_ms = now;
+            conn->send_consent_check(now);
+        } else {
+            _ping_connection(conn, now);
+        }
         _ice_controller->mark_connection_pinged(conn);
     }
 
-    if (_cur_ping_interval != result.ping_interval) {
-        _cur_ping_interval = result.ping_interval;
-        _el->stop_timer(_ping_wather);
-        _el->start_timer(_ping_wather, _cur_ping_interval * 1000);
-    }
-
+    _cur_ping_interval = result.ping_interval;
+    _scheduler->schedule(this, now + _cur_ping_interval);
 }
 
-void IceTransportChannel::_update_connection_states() {
-    std::vector<IceConnection*> connections = _ice_controller->connections();
-    int64_t now = rtc::TimeMillis();
-    for (auto conn : connections) {
-        conn->update_state(now); // 这里可能会删除特定conn，所以先保存成一个局部变量connections，再遍历
+void IceTransportChannel::_update_connection_states(int64_t now) {
+    // 这里可能会删除特定conn或者重新排序，所以先保存一份快照再遍历
+    _update_connections.assign(_ice_controller->connections().begin(),
+            _ice_controller->connections().end());
+    for (auto conn : _update_connections) {
+        conn->update_state(now);
     }
 }
 
-void IceTransportChannel::_ping_connection(IceConnection* conn) {
-    _last_ping_sent_ms = rtc::TimeMillis();
+void IceTransportChannel::_ping_connection(IceConnection* conn, int64_t now) {
+    _last_ping_sent_ms = now;
     conn->ping(_last_ping_sent_ms);
 }
 
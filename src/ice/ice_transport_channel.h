@@ -15,6 +15,7 @@
 #include "ice/stun.h"
 #include "ice/udp_port.h"
 #include "ice/ice_controller.h"
+#include "ice/ice_scheduler.h"
 
 namespace xrtc {
 
@@ -33,10 +34,12 @@ enum class IceTransportState {
 class IceTransportChannel : public sigslot::has_slots<> {
 public:
     IceTransportChannel(EventLoop* el, PortAllocator* allocator, 
+            IceScheduler* scheduler,
             const std::string transport_name,
             IceCandidateComponent component);
     virtual ~IceTransportChannel();
 
+    EventLoop* event_loop() { return _el; }
     const std::string& transport_name() { return _transport_name; }
     IceCandidateComponent component() { return _component; }
     bool writable() { return _writable; }
@@ -46,7 +49,9 @@ public:
     void set_ice_params(const IceParamters& ice_params);
     void set_remote_ice_params(const IceParamters& ice_params);
     void gathering_candidate();
-    int send_packet(const char* data, size_t len);
+    virtual int send_packet(const char* data, size_t len);
+    // 上层认证通过的数据包(SRTP/SRTCP)，作为连接存活的证明
+    void on_media_received();
 
     std::string to_string();
 
@@ -58,6 +63,10 @@ public:
     sigslot::signal1<IceTransportChannel*> signal_ice_state_changed;
     sigslot::signal4<IceTransportChannel*, const char*, size_t, int64_t> signal_read_packet;
 
+protected:
+    void _set_receiving(bool receiving);
+    void _set_writable(bool writable);
+
 private:
     void _on_unknown_address(UDPPort* port,
         const rtc::SocketAddress& addr,
@@ -66,36 +75,36 @@ private:
     void _add_connection(IceConnection* conn);
     void _sort_connections_and_update_state();
     void _maybe_state_pinging();
-    void _on_check_and_ping();
-    void _on_connection_state_change(IceConnection* /*conn*/);
+    void _on_check_and_ping(int64_t now);
+    void _on_connection_state_change(IceConnection* conn);
     void _on_connection_destroyed(IceConnection* /*conn*/);
     void _on_read_packet(IceConnection* conn, const char*buf, size_t len, int64_t ts);
-    void _ping_connection(IceConnection* conn);
+    void _ping_connection(IceConnection* conn, int64_t now);
     void _maybe_switch_selected_connection(IceConnection* conn);
     void _switch_selected_connection(IceConnection* conn);
-    void _update_connection_states();
+    void _update_connection_states(int64_t now);
     void _update_state();
-    void _set_receiving(bool receiving);
-    void _set_writable(bool writable);
     IceTransportState _compute_ice_transport_state();
 
-    friend void ice_ping_cb(EventLoop* /*el*/, TimerWatcher* /*w*/, void* data);
+    friend class IceScheduler;
 
 private:
     EventLoop* _el;
     std::string _transport_name; // audio video
     IceCandidateComponent _component;
     PortAllocator* _allocator;
+    IceScheduler* _scheduler;
     IceParamters _ice_params;
     IceParamters _remote_ice_params;
     std::vector<Candidate> _local_candidates;
     std::vector<UDPPort*> _ports;
     std::unique_ptr<IceController> _ice_controller;
     bool _start_pinging = false;
-    TimerWatcher* _ping_wather = nullptr;
     int _cur_ping_interval = WEAK_PING_INTERVAL;
     int64_t _last_ping_sent_ms = 0;
     IceConnection* _selected_connection = nullptr;
+    IceConnection* _last_read_connection = nullptr;
+    std::vector<IceConnection*> _update_connections; // 更新状态时的连接快照, 复用避免每次分配
     bool _receiving = false;
     bool _writable = false;
     IceTransportState _state = IceTransportState::k_new;
@@ -3,10 +3,10 @@
 
 namespace xrtc {
 
-PortAllocator::PortAllocator() :
+PortAllocator::PortAllocator(const NetworkOptions& options) :
     _network_manager(new NetWorkManager())
 {
-    _network_manager->create_networks();
+    _network_manager->create_networks(options);
 }
 
 PortAllocator::~PortAllocator() = default;
@@ -74,6 +74,45 @@ bool StunMessage::validate_fingerprint(const char* data, size_t len) {
         rtc::ComputeCrc32(data, len - fingerprint_attr_size); 
 }
 
+bool StunMessage::update_transaction_id(char* data, size_t len,
+        const std::string& transaction_id, const std::string& password)
+{
+    size_t fingerprint_attr_size = k_stun_attribute_header_size +
+        StunUInt32Attribute::SIZE;
+    size_t mi_attr_size = k_stun_attribute_header_size + k_stun_message_integrity_size;
+    if (transaction_id.size() != k_stun_transaction_id_length ||
+            len < k_stun_header_size + mi_attr_size + fingerprint_attr_size)
+    {
+        return false;
+    }
+
+    char* fingerprint_attr_data = data + len - fingerprint_attr_size;
+    char* mi_attr_data = fingerprint_attr_data - mi_attr_size;
+    if (rtc::GetBE16(fingerprint_attr_data) != STUN_ATTR_FINGERPRINT ||
+            rtc::GetBE16(mi_attr_data) != STUN_ATTR_MESSAGE_INTEGRITY)
+    {
+        return false;
+    }
+
+    memcpy(data + k_stun_transaction_id_offset, transaction_id.data(),
+            k_stun_transaction_id_length);
+
+    // 计算MESSAGE-INTEGRITY时，头部的length不包含FINGERPRINT属性
+    rtc::SetBE16(data + 2, len - k_stun_header_size - fingerprint_attr_size);
+    size_t ret = rtc::ComputeHmac(rtc::DIGEST_SHA_1, password.c_str(),
+            password.length(), data, mi_attr_data - data,
+            mi_attr_data + k_stun_attribute_header_size,
+            k_stun_message_integrity_size);
+    rtc::SetBE16(data + 2, len - k_stun_header_size);
+    if (ret != k_stun_message_integrity_size) {
+        return false;
+    }
+
+    uint32_t c = rtc::ComputeCrc32(data, len - fingerprint_attr_size);
+    rtc::SetBE32(fingerprint_attr_data + k_stun_attribute_header_size,
+            c ^ STUN_FINGERPRINT_XOR_VALUE);
+    return true;
+}
 
 StunMessage::IntegrityStatus StunMessage::validate_message_integrity(
         const std::string& password)
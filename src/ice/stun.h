@@ -121,6 +121,10 @@ public:
     }
 
     static bool validate_fingerprint(const char* data, size_t len);
+    // 原地替换已序列化请求的transaction id，并重新计算MESSAGE-INTEGRITY和FINGERPRINT,
+    // 要求data以这两个属性结尾
+    static bool update_transaction_id(char* data, size_t len,
+            const std::string& transaction_id, const std::string& password);
     bool add_fingerprint();
 
     IntegrityStatus validate_message_integrity(const std::string& password);
@@ -39,6 +39,37 @@ UDPPort::~UDPPort() {
 
 }
 
+void UDPPort::set_ice_params(const IceParamters& ice_params) {
+    if (ice_params.ice_ufrag == _ice_params.ice_ufrag) {
+        return;
+    }
+
+    _prev_ice_params = _ice_params;
+    _ice_params = ice_params;
+
+    for (auto& c : _candidates) {
+        c.username = _ice_params.ice_ufrag;
+        c.password = _ice_params.ice_pwd;
+    }
+
+    RTC_LOG(LS_INFO) << to_string() << ": ice params updated, prev ufrag: "
+        << _prev_ice_params.ice_ufrag;
+}
+
+void UDPPort::clear_prev_ice_params() {
+    _prev_ice_params = IceParamters();
+}
+
+std::string UDPPort::ice_pwd(const std::string& local_ufrag) {
+    if (!_prev_ice_params.ice_ufrag.empty() &&
+            local_ufrag == _prev_ice_params.ice_ufrag)
+    {
+        return _prev_ice_params.ice_pwd;
+    }
+
+    return _ice_params.ice_pwd;
+}
+
 std::string compute_foundation(const std::string& type,
         const std::string& protocol,
         const std::string& relay_protocol,
@@ -52,7 +83,7 @@ std::string compute_foundation(const std::string& type,
 int UDPPort::create_ice_candidate(Network* network, int min_port, int max_port, 
         Candidate& c)
 {
-    _socket = create_udp_socket(network->ip().family());
+    _socket = create_udp_socket(network->bind_ip().family());
     if (_socket < 0) {
         return -1;
     }
@@ -61,15 +92,10 @@ int UDPPort::create_ice_candidate(Network* network, int min_port, int max_port,
         return -1;
     }
 
-    sockaddr_in addr_in;
-    addr_in.sin_family = network->ip().family();
-    // 因为目前network里是强制填写公网IP，当bind的IP地址不是本地的地址时，会报错（errno：99）。
-    //addr_in.sin_addr = network->ip().ipv4_address();
-    addr_in.sin_addr.s_addr = INADDR_ANY;
-
-    if (sock_bind(_socket, (struct sockaddr*)&addr_in, sizeof(sockaddr),
-            min_port, max_port))
-    {
+    // 绑定本地IP，公网IP只用于candidate（绑定非本地地址会报错，errno：99）
+    sockaddr_storage addr;
+    socklen_t addr_len = rtc::SocketAddress(network->bind_ip(), 0).ToSockAddrStorage(&addr);
+    if (sock_bind(_socket, (struct sockaddr*)&addr, addr_len, min_port, max_port)) {
         return -1;
     }
 
@@ -92,7 +118,7 @@ int UDPPort::create_ice_candidate(Network* network, int min_port, int max_port,
     c.protocol = "udp";
     c.address = _local_addr;
     c.port = port;
-    c.priority = c.get_priority(ICE_TYPE_PREFERENCE_HOST, 0, 0); // 无3G/WIFI
+    c.priority = c.get_priority(ICE_TYPE_PREFERENCE_HOST, network->preference(), 0);
     c.username = _ice_params.ice_ufrag;
     c.password = _ice_params.ice_pwd;
     c.type = LOCAL_PORT_TYPE;
@@ -191,7 +217,9 @@ bool UDPPort::get_stun_message(const char* data, size_t len,
         std::string local_ufrag;
         std::string remote_ufrag;
         if (!_parse_stun_username(stun_msg.get(), &local_ufrag, &remote_ufrag) ||
-                local_ufrag != _ice_params.ice_ufrag)
+                (local_ufrag != _ice_params.ice_ufrag &&
+                 (_prev_ice_params.ice_ufrag.empty() ||
+                  local_ufrag != _prev_ice_params.ice_ufrag)))
         {
             // todo
             RTC_LOG(LS_WARNING) << to_string() << ": received "
@@ -203,7 +231,7 @@ bool UDPPort::get_stun_message(const char* data, size_t len,
             return true;
         }
 
-        if (stun_msg->validate_message_integrity(_ice_params.ice_pwd) != 
+        if (stun_msg->validate_message_integrity(ice_pwd(local_ufrag)) != 
                 StunMessage::IntegrityStatus::k_integrity_ok)
         {
             RTC_LOG(LS_WARNING) << to_string() << ": received "
@@ -313,7 +341,12 @@ void UDPPort::create_stun_username(const std::string& remote_username,
     stun_attr_username->clear();
     *stun_attr_username = remote_username;
     stun_attr_username->append(":");
-    stun_attr_username->append(_ice_params.ice_ufrag);
+    // 对端answer到达之前，对端仍然只认识旧的本地ufrag
+    if (!_prev_ice_params.ice_ufrag.empty()) {
+        stun_attr_username->append(_prev_ice_params.ice_ufrag);
+    } else {
+        stun_attr_username->append(_ice_params.ice_ufrag);
+    }
 }
 
 
@@ -32,6 +32,11 @@ public:
 
     std::string ice_ufrag() { return _ice_params.ice_ufrag; }
     std::string ice_pwd() { return _ice_params.ice_pwd; }
+    std::string ice_pwd(const std::string& local_ufrag);
+
+    // ice restart: 新旧凭证在对端answer到达之前同时有效
+    void set_ice_params(const IceParamters& ice_params);
+    void clear_prev_ice_params();
 
     const std::string transport_name() { return _transport_name; }
     IceCandidateComponent component() { return _component; }
@@ -70,6 +75,7 @@ private:
     std::string _transport_name;
     IceCandidateComponent _component;
     IceParamters _ice_params;
+    IceParamters _prev_ice_params; // ice restart之前的本地凭证
     int _socket = -1;
     std::unique_ptr<AsyncUdpSocket> _async_socket;
     rtc::SocketAddress _local_addr;
@@ -4,13 +4,18 @@
 
 #include "base/conf.h"
 #include "base/log.h"
+#include "base/task_pool.h"
+#include "pc/srtp_session.h"
 #include "server/rtc_server.h"
 #include "server/signaling_server.h"
+#include "stream/stream_hub.h"
 
 xrtc::GeneralConf* g_conf = nullptr;
 xrtc::XrtcLog* g_log = nullptr;
 xrtc::SignalingServer* g_signaling_server = nullptr;
 xrtc::RtcServer* g_rtc_server = nullptr;
+xrtc::TaskPool* g_dtls_handshake_pool = nullptr;
+xrtc::StreamHub* g_stream_hub = nullptr;
 
 int init_general_conf(const char* filename) {
     if (!filename) {
@@ -66,6 +71,19 @@ int init_rtc_server() {
     return 0;
 }
 
+int init_dtls_handshake_pool(int thread_num) {
+    if (thread_num <= 0) {
+        return 0;
+    }
+
+    g_dtls_handshake_pool = new xrtc::TaskPool("dtls_handshake", thread_num);
+    if (!g_dtls_handshake_pool->start()) {
+        return -1;
+    }
+
+    return 0;
+}
+
 static void process_signal(int sig) {
     RTC_LOG(LS_INFO) << "receive signal: " << sig;
     switch (sig) {
@@ -96,12 +114,26 @@ int main() {
     }
     g_log->set_log_to_stderr(g_conf->log_to_stderr);
 
+    // libsrtp只在进程启动时初始化一次
+    if (!xrtc::SrtpSession::init_libsrtp()) {
+        return -1;
+    }
+
+    // 初始化DTLS握手线程池
+    ret = init_dtls_handshake_pool(g_conf->dtls_handshake_threads);
+    if (ret != 0) {
+        return -1;
+    }
+
     // 初始化signaling server
     ret = init_signaling_server();
     if (ret != 0) {
         return -1;
     }
 
+    // 跨worker转发的推流映射，在worker启动之前创建
+    g_stream_hub = new xrtc::StreamHub();
+
     // 初始化rtc server
     ret = init_rtc_server();
     if (ret != 0) {
@@ -117,5 +149,12 @@ int main() {
     g_signaling_server->join();
     g_rtc_server->join();
 
+    if (g_dtls_handshake_pool) {
+        g_dtls_handshake_pool->stop();
+        g_dtls_handshake_pool->join();
+    }
+
+    xrtc::SrtpSession::shutdown_libsrtp();
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "module/congestion_controller/delay_based_bwe.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace xrtc {
+
+// 发送时间在5ms以内的包属于同一组(一次突发)
+const int64_t k_burst_time_us = 5000;
+// trendline
+const size_t k_trendline_window = 20;
+const double k_smoothing = 0.9;
+const double k_threshold_gain = 4.0;
+const int k_max_deltas = 60;
+// 过载检测
+const double k_overuse_time_ms = 10.0;
+const double k_threshold_up = 0.0087;
+const double k_threshold_down = 0.039;
+const double k_min_threshold = 6.0;
+const double k_max_threshold = 600.0;
+const double k_max_adapt_offset = 15.0;
+// AIMD
+const double k_decrease_factor = 0.85;
+const double k_increase_per_second = 1.08;
+const int64_t k_min_decrease_interval_ms = 200;
+
+DelayBasedBwe::DelayBasedBwe(int64_t start_bitrate_bps, int64_t min_bitrate_bps,
+        int64_t max_bitrate_bps) :
+    _bitrate(start_bitrate_bps),
+    _min_bitrate_bps(min_bitrate_bps),
+    _max_bitrate_bps(max_bitrate_bps)
+{
+}
+
+void DelayBasedBwe::on_packet(int64_t send_time_us, int64_t recv_time_us) {
+    if (_current.first_send_us < 0) {
+        _current.first_send_us = send_time_us;
+        _current.last_send_us = send_time_us;
+        _current.last_recv_us = recv_time_us;
+        return;
+    }
+
+    // 乱序发送的包不参与分组
+    if (send_time_us < _current.first_send_us) {
+        return;
+    }
+
+    if (send_time_us - _current.first_send_us <= k_burst_time_us) {
+        _current.last_send_us = std::max(_current.last_send_us, send_time_us);
+        _current.last_recv_us = std::max(_current.last_recv_us, recv_time_us);
+        return;
+    }
+
+    // 新的一组开始，前两组完整了
+    if (_prev.first_send_us >= 0) {
+        _on_group_delta((_current.last_send_us - _prev.last_send_us) / 1000.0,
+                (_current.last_recv_us - _prev.last_recv_us) / 1000.0,
+                _current.last_recv_us / 1000);
+    }
+
+    _prev = _current;
+    _current.first_send_us = send_time_us;
+    _current.last_send_us = send_time_us;
+    _current.last_recv_us = recv_time_us;
+}
+
+void DelayBasedBwe::_on_group_delta(double send_delta_ms, double recv_delta_ms,
+        int64_t recv_time_ms)
+{
+    if (_first_recv_ms < 0) {
+        _first_recv_ms = recv_time_ms;
+    }
+
+    _num_deltas = std::min(_num_deltas + 1, 1000);
+    _accumulated_delay += recv_delta_ms - send_delta_ms;
+    _smoothed_delay = k_smoothing * _smoothed_delay + (1 - k_smoothing) * _accumulated_delay;
+
+    _samples.emplace_back((double)(recv_time_ms - _first_recv_ms), _smoothed_delay);
+    if (_samples.size() > k_trendline_window) {
+        _samples.pop_front();
+    }
+
+    double trend = _prev_trend;
+    if (_samples.size() == k_trendline_window) {
+        trend = _linear_fit_slope();
+    }
+
+    _detect(trend, send_delta_ms, recv_time_ms);
+}
+
+double DelayBasedBwe::_linear_fit_slope() {
+    double sum_x = 0;
+    double sum_y = 0;
+    for (auto& sample : _samples) {
+        sum_x += sample.first;
+        sum_y += sample.second;
+    }
+
+    double avg_x = sum_x / _samples.size();
+    double avg_y = sum_y / _samples.size();
+    double numerator = 0;
+    double denominator = 0;
+    for (auto& sample : _samples) {
+        numerator += (sample.first - avg_x) * (sample.second - avg_y);
+        denominator += (sample.first - avg_x) * (sample.first - avg_x);
+    }
+
+    return denominator != 0 ? numerator / denominator : _prev_trend;
+}
+
+void DelayBasedBwe::_detect(double trend, double send_delta_ms, int64_t now_ms) {
+    double modified_trend = std::min(_num_deltas, k_max_deltas) * trend * k_threshold_gain;
+    if (modified_trend > _threshold) {
+        if (_overuse_time_ms < 0) {
+            _overuse_time_ms = send_delta_ms / 2;
+        } else {
+            _overuse_time_ms += send_delta_ms;
+        }
+        ++_overuse_count;
+
+        // 持续一段时间并且还在增长才认为过载
+        if (_overuse_time_ms > k_overuse_time_ms && _overuse_count > 1 &&
+                trend >= _prev_trend)
+        {
+            _overuse_time_ms = 0;
+            _overuse_count = 0;
+            _state = BandwidthUsage::k_overusing;
+        }
+    } else if (modified_trend < -_threshold) {
+        _overuse_time_ms = -1;
+        _overuse_count = 0;
+        _state = BandwidthUsage::k_underusing;
+    } else {
+        _overuse_time_ms = -1;
+        _overuse_count = 0;
+        _state = BandwidthUsage::k_normal;
+    }
+
+    _prev_trend = trend;
+    _update_threshold(modified_trend, now_ms);
+}
+
+// 自适应阈值，避免和基于丢包的TCP流竞争时饿死
+void DelayBasedBwe::_update_threshold(double modified_trend, int64_t now_ms) {
+    if (_last_threshold_update_ms < 0) {
+        _last_threshold_update_ms = now_ms;
+    }
+
+    double abs_trend = fabs(modified_trend);
+    if (abs_trend > _threshold + k_max_adapt_offset) {
+        _last_threshold_update_ms = now_ms;
+        return;
+    }
+
+    double k = abs_trend < _threshold ? k_threshold_down : k_threshold_up;
+    int64_t dt_ms = std::min<int64_t>(now_ms - _last_threshold_update_ms, 100);
+    _threshold += k * (abs_trend - _threshold) * dt_ms;
+    _threshold = std::max(k_min_threshold, std::min(_threshold, k_max_threshold));
+    _last_threshold_update_ms = now_ms;
+}
+
+int64_t DelayBasedBwe::update(int64_t now_ms, int64_t acked_bitrate_bps) {
+    if (_last_update_ms < 0) {
+        _last_update_ms = now_ms;
+    }
+
+    int64_t dt_ms = std::min<int64_t>(now_ms - _last_update_ms, 1000);
+    _last_update_ms = now_ms;
+
+    switch (_state) {
+        case BandwidthUsage::k_overusing:
+            if (_last_decrease_ms < 0 ||
+                    now_ms - _last_decrease_ms >= k_min_decrease_interval_ms)
+            {
+                _bitrate = acked_bitrate_bps > 0
+                    ? k_decrease_factor * acked_bitrate_bps
+                    : k_decrease_factor * _bitrate;
+                _last_decrease_ms = now_ms;
+            }
+            break;
+        case BandwidthUsage::k_underusing:
+            // 队列在排空，保持码率
+            break;
+        default:
+            _bitrate *= pow(k_increase_per_second, dt_ms / 1000.0);
+            // 不超过实际发送码率太多，否则过载时降不下来
+            if (acked_bitrate_bps > 0) {
+                _bitrate = std::min(_bitrate, 1.5 * acked_bitrate_bps + 10000);
+            }
+            break;
+    }
+
+    _bitrate = std::max<double>(_min_bitrate_bps,
+            std::min<double>(_bitrate, _max_bitrate_bps));
+    return (int64_t)_bitrate;
+}
+
+} // namespace xrtc
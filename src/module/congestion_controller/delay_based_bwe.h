@@ -0,0 +1,75 @@
+#ifndef __MODULE_DELAY_BASED_BWE_H_
+#define __MODULE_DELAY_BASED_BWE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <utility>
+
+namespace xrtc {
+
+enum class BandwidthUsage {
+    k_normal,
+    k_underusing,
+    k_overusing,
+};
+
+// 基于时延的带宽估计，参考GCC(draft-ietf-rmcat-gcc):
+// 按发送时间把包分组，组间的时延变化经过trendline滤波后做过载检测，
+// 检测结果驱动AIMD码率控制
+class DelayBasedBwe {
+public:
+    DelayBasedBwe(int64_t start_bitrate_bps, int64_t min_bitrate_bps,
+            int64_t max_bitrate_bps);
+    ~DelayBasedBwe() = default;
+
+    // 一个反馈中收到的包(发送端和接收端各自的时钟)，按序号输入
+    void on_packet(int64_t send_time_us, int64_t recv_time_us);
+    // 一个反馈处理完后更新码率，acked_bitrate_bps小于0表示还没有测量值
+    int64_t update(int64_t now_ms, int64_t acked_bitrate_bps);
+
+    BandwidthUsage state() { return _state; }
+    int64_t bitrate() { return (int64_t)_bitrate; }
+
+private:
+    struct PacketGroup {
+        int64_t first_send_us = -1;
+        int64_t last_send_us = 0;
+        int64_t last_recv_us = 0;
+    };
+
+    void _on_group_delta(double send_delta_ms, double recv_delta_ms, int64_t recv_time_ms);
+    double _linear_fit_slope();
+    void _detect(double trend, double send_delta_ms, int64_t now_ms);
+    void _update_threshold(double modified_trend, int64_t now_ms);
+
+private:
+    PacketGroup _current;
+    PacketGroup _prev;
+
+    // trendline
+    std::deque<std::pair<double, double>> _samples; // 到达时间, 平滑后的累计时延
+    double _accumulated_delay = 0;
+    double _smoothed_delay = 0;
+    int64_t _first_recv_ms = -1;
+    int _num_deltas = 0;
+    double _prev_trend = 0;
+
+    // 过载检测
+    double _threshold = 12.5;
+    int64_t _last_threshold_update_ms = -1;
+    double _overuse_time_ms = -1;
+    int _overuse_count = 0;
+    BandwidthUsage _state = BandwidthUsage::k_normal;
+
+    // AIMD
+    double _bitrate;
+    int64_t _min_bitrate_bps;
+    int64_t _max_bitrate_bps;
+    int64_t _last_update_ms = -1;
+    int64_t _last_decrease_ms = -1;
+};
+
+} // namespace xrtc
+
+#endif // __MODULE_DELAY_BASED_BWE_H_
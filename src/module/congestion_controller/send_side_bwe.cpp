@@ -0,0 +1,108 @@
+#include "module/congestion_controller/send_side_bwe.h"
+
+#include <algorithm>
+
+namespace xrtc {
+
+// 能够匹配反馈的已发送包个数(2的幂)
+const size_t k_send_history_size = 8192;
+// 收到反馈的包的码率窗口
+const int64_t k_acked_window_us = 500000;
+// 基于丢包的估计: 每次至少统计这么多包，丢包率低于2%增加，高于10%降低
+const uint32_t k_min_loss_packets = 20;
+const double k_low_loss = 0.02;
+const double k_high_loss = 0.1;
+const int64_t k_loss_increase_interval_ms = 1000;
+const int64_t k_loss_decrease_interval_ms = 300;
+
+SendSideBwe::SendSideBwe(const BweConfig& config) :
+    _config(config),
+    _history(k_send_history_size),
+    _delay_bwe(config.start_bitrate_bps, config.min_bitrate_bps, config.max_bitrate_bps),
+    _loss_bitrate_bps(config.start_bitrate_bps),
+    _target_bitrate_bps(config.start_bitrate_bps)
+{
+}
+
+void SendSideBwe::on_packet_sent(uint16_t seq, size_t size, int64_t send_time_us) {
+    SentPacket& packet = _history[seq & (k_send_history_size - 1)];
+    packet.seq = seq;
+    packet.valid = true;
+    packet.acked = false;
+    packet.size = size;
+    packet.send_time_us = send_time_us;
+}
+
+void SendSideBwe::on_transport_feedback(const TransportFeedback& feedback, int64_t now_ms) {
+    for (auto& result : feedback.packets) {
+        SentPacket& packet = _history[result.seq & (k_send_history_size - 1)];
+        if (!packet.valid || packet.seq != result.seq || packet.acked) {
+            continue;
+        }
+
+        ++_expected_since_update;
+        if (!result.received) {
+            // 后面的反馈中还可能收到
+            ++_lost_since_update;
+            ++_packets_lost;
+            continue;
+        }
+
+        packet.acked = true;
+        ++_packets_acked;
+        _delay_bwe.on_packet(packet.send_time_us, result.recv_time_us);
+        _update_acked_bitrate(result.recv_time_us, packet.size);
+    }
+
+    int64_t delay_bitrate_bps = _delay_bwe.update(now_ms, _acked_bitrate_bps);
+    _update_loss_based(now_ms);
+    _target_bitrate_bps = std::min(delay_bitrate_bps, _loss_bitrate_bps);
+}
+
+void SendSideBwe::_update_acked_bitrate(int64_t recv_time_us, size_t size) {
+    _acked_window.emplace_back(recv_time_us, size);
+    _acked_window_bytes += size;
+    while (_acked_window.size() > 1 &&
+            recv_time_us - _acked_window.front().first > k_acked_window_us)
+    {
+        _acked_window_bytes -= _acked_window.front().second;
+        _acked_window.pop_front();
+    }
+
+    // 窗口填满之后才有意义
+    int64_t span_us = recv_time_us - _acked_window.front().first;
+    if (span_us >= k_acked_window_us / 2) {
+        _acked_bitrate_bps = (int64_t)_acked_window_bytes * 8 * 1000000 / span_us;
+    }
+}
+
+void SendSideBwe::_update_loss_based(int64_t now_ms) {
+    if (_expected_since_update < k_min_loss_packets) {
+        return;
+    }
+
+    double loss = (double)_lost_since_update / _expected_since_update;
+    _expected_since_update = 0;
+    _lost_since_update = 0;
+
+    if (loss < k_low_loss) {
+        if (_last_loss_increase_ms < 0 ||
+                now_ms - _last_loss_increase_ms >= k_loss_increase_interval_ms)
+        {
+            _loss_bitrate_bps = (int64_t)(_loss_bitrate_bps * 1.08) + 1000;
+            _last_loss_increase_ms = now_ms;
+        }
+    } else if (loss > k_high_loss) {
+        if (_last_loss_decrease_ms < 0 ||
+                now_ms - _last_loss_decrease_ms >= k_loss_decrease_interval_ms)
+        {
+            _loss_bitrate_bps = (int64_t)(_loss_bitrate_bps * (1 - 0.5 * loss));
+            _last_loss_decrease_ms = now_ms;
+        }
+    }
+
+    _loss_bitrate_bps = std::max(_config.min_bitrate_bps,
+            std::min(_loss_bitrate_bps, _config.max_bitrate_bps));
+}
+
+} // namespace xrtc
@@ -0,0 +1,77 @@
+#ifndef __MODULE_SEND_SIDE_BWE_H_
+#define __MODULE_SEND_SIDE_BWE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include "module/congestion_controller/delay_based_bwe.h"
+#include "module/rtp_rtcp/transport_feedback.h"
+
+namespace xrtc {
+
+struct BweConfig {
+    int64_t min_bitrate_bps = 100000;
+    int64_t start_bitrate_bps = 1000000;
+    int64_t max_bitrate_bps = 10000000;
+};
+
+// 一个发送通道(服务器到一个订阅者)的发送端带宽估计:
+// 发送时分配transport-wide序号并记录发送时间和大小，收到TWCC反馈后
+// 分别做基于时延和基于丢包的估计，取较小值作为目标码率
+class SendSideBwe {
+public:
+    explicit SendSideBwe(const BweConfig& config);
+    ~SendSideBwe() = default;
+
+    uint16_t next_sequence_number() { return _next_seq++; }
+    void on_packet_sent(uint16_t seq, size_t size, int64_t send_time_us);
+    void on_transport_feedback(const TransportFeedback& feedback, int64_t now_ms);
+
+    // 给层选择和平滑发送使用
+    int64_t target_bitrate_bps() { return _target_bitrate_bps; }
+    // 收到反馈的包的码率，还没有时返回-1
+    int64_t acked_bitrate_bps() { return _acked_bitrate_bps; }
+    BandwidthUsage delay_state() { return _delay_bwe.state(); }
+    uint64_t packets_lost() { return _packets_lost; }
+    uint64_t packets_acked() { return _packets_acked; }
+
+private:
+    struct SentPacket {
+        uint16_t seq = 0;
+        bool valid = false;
+        bool acked = false;
+        size_t size = 0;
+        int64_t send_time_us = 0;
+    };
+
+    void _update_acked_bitrate(int64_t recv_time_us, size_t size);
+    void _update_loss_based(int64_t now_ms);
+
+private:
+    BweConfig _config;
+    uint16_t _next_seq = 1;
+    std::vector<SentPacket> _history; // 按序号索引的环形缓冲区
+    DelayBasedBwe _delay_bwe;
+
+    // 收到反馈的包的码率，按接收端时间的滑动窗口计算
+    std::deque<std::pair<int64_t, size_t>> _acked_window;
+    size_t _acked_window_bytes = 0;
+    int64_t _acked_bitrate_bps = -1;
+
+    // 基于丢包
+    int64_t _loss_bitrate_bps;
+    uint32_t _expected_since_update = 0;
+    uint32_t _lost_since_update = 0;
+    int64_t _last_loss_increase_ms = -1;
+    int64_t _last_loss_decrease_ms = -1;
+
+    int64_t _target_bitrate_bps;
+    uint64_t _packets_lost = 0;
+    uint64_t _packets_acked = 0;
+};
+
+} // namespace xrtc
+
+#endif // __MODULE_SEND_SIDE_BWE_H_
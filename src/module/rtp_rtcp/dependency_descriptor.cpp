@@ -0,0 +1,109 @@
+#include "module/rtp_rtcp/dependency_descriptor.h"
+
+namespace xrtc {
+
+// 模板id是6位
+const int k_max_templates = 64;
+
+// 按位读取，高位在前。越界后都返回0并设置error
+struct BitReader {
+    const uint8_t* data;
+    size_t len;
+    size_t offset = 0;
+    bool error = false;
+};
+
+static uint32_t read_bits(BitReader* reader, int bits) {
+    uint32_t value = 0;
+    for (int i = 0; i < bits; ++i) {
+        if (reader->offset >= reader->len * 8) {
+            reader->error = true;
+            return 0;
+        }
+
+        value = (value << 1) |
+            ((reader->data[reader->offset / 8] >> (7 - reader->offset % 8)) & 0x01);
+        ++reader->offset;
+    }
+
+    return value;
+}
+
+// template_layers(): next_layer_idc为1时时间层加一，为2时空间层加一，为3时结束
+static bool parse_template_structure(BitReader* reader,
+        FrameDependencyStructure* structure)
+{
+    FrameDependencyStructure result;
+    result.template_id_offset = read_bits(reader, 6);
+    result.decode_target_count = read_bits(reader, 5) + 1;
+
+    FrameDependencyStructure::Layer layer;
+    uint32_t next_layer_idc = 0;
+    do {
+        if ((int)result.templates.size() >= k_max_templates) {
+            return false;
+        }
+
+        result.templates.push_back(layer);
+        next_layer_idc = read_bits(reader, 2);
+        if (1 == next_layer_idc) {
+            ++layer.temporal_id;
+        } else if (2 == next_layer_idc) {
+            layer.temporal_id = 0;
+            ++layer.spatial_id;
+        }
+    } while (3 != next_layer_idc && !reader->error);
+
+    if (reader->error) {
+        return false;
+    }
+
+    // 之后的dtis、fdiffs、chains和分辨率用不到，不解析
+    result.valid = true;
+    *structure = result;
+    return true;
+}
+
+bool parse_dependency_descriptor(const uint8_t* data, size_t len,
+        FrameDependencyStructure* structure, DependencyDescriptor* descriptor)
+{
+    if (len < 3) {
+        return false;
+    }
+
+    BitReader reader;
+    reader.data = data;
+    reader.len = len;
+    *descriptor = DependencyDescriptor();
+    descriptor->start_of_frame = read_bits(&reader, 1);
+    descriptor->end_of_frame = read_bits(&reader, 1);
+    descriptor->template_id = read_bits(&reader, 6);
+    descriptor->frame_number = read_bits(&reader, 16);
+
+    if (len > 3) {
+        bool structure_present = read_bits(&reader, 1);
+        read_bits(&reader, 4); // active_decode_targets、custom_dtis/fdiffs/chains
+        if (structure_present) {
+            if (!parse_template_structure(&reader, structure)) {
+                return false;
+            }
+            descriptor->has_structure = true;
+        }
+    }
+
+    if (!structure->valid) {
+        return false;
+    }
+
+    int index = (descriptor->template_id + k_max_templates -
+            structure->template_id_offset) % k_max_templates;
+    if (index >= (int)structure->templates.size()) {
+        return false;
+    }
+
+    descriptor->spatial_id = structure->templates[index].spatial_id;
+    descriptor->temporal_id = structure->templates[index].temporal_id;
+    return true;
+}
+
+} // namespace xrtc
@@ -0,0 +1,41 @@
+#ifndef __MODULE_DEPENDENCY_DESCRIPTOR_H_
+#define __MODULE_DEPENDENCY_DESCRIPTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace xrtc {
+
+// AV1 RTP规范附录A的模板依赖结构，只保留每个模板的空间层和时间层。
+// 关键帧的描述符中携带，之后的帧按模板id引用
+struct FrameDependencyStructure {
+    struct Layer {
+        int spatial_id = 0;
+        int temporal_id = 0;
+    };
+
+    bool valid = false;
+    int template_id_offset = 0;
+    int decode_target_count = 0;
+    std::vector<Layer> templates;
+};
+
+struct DependencyDescriptor {
+    bool start_of_frame = false;
+    bool end_of_frame = false;
+    int template_id = 0;
+    uint16_t frame_number = 0;
+    bool has_structure = false; // 携带了新的模板依赖结构
+    int spatial_id = 0;
+    int temporal_id = 0;
+};
+
+// data是头扩展元素的数据。携带模板依赖结构时更新structure，
+// 按structure查出这一帧的层；格式错误或者还没有收到结构时返回false
+bool parse_dependency_descriptor(const uint8_t* data, size_t len,
+        FrameDependencyStructure* structure, DependencyDescriptor* descriptor);
+
+} // namespace xrtc
+
+#endif // __MODULE_DEPENDENCY_DESCRIPTOR_H_
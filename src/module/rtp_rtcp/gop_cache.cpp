@@ -0,0 +1,94 @@
+#include "module/rtp_rtcp/gop_cache.h"
+
+#include <string.h>
+
+#include <rtc_base/logging.h>
+
+#include "module/rtp_rtcp/rtp_utils.h"
+
+namespace xrtc {
+
+// 时间戳回绕的比较，a比b新时返回true
+static bool is_newer_timestamp(uint32_t a, uint32_t b) {
+    return a != b && (uint32_t)(a - b) < 0x80000000;
+}
+
+void GopCache::_clear(Gop& gop) {
+    _bytes -= gop.bytes;
+    gop.bytes = 0;
+    gop.packets.clear();
+    gop.valid = false;
+}
+
+void GopCache::put(const char* data, size_t len,
+        std::shared_ptr<const HistoryPacket> packet)
+{
+    if (len > k_packet_buffer_capacity) {
+        return;
+    }
+
+    rtc::ArrayView<const uint8_t> view((const uint8_t*)data, len);
+    size_t header_len = 0;
+    size_t payload_len = 0;
+    if (!parse_rtp_layout(view, &header_len, &payload_len)) {
+        return;
+    }
+
+    auto iter = _gops.find(parse_rtp_ssrc(view));
+    if (iter == _gops.end()) {
+        return;
+    }
+
+    Gop& gop = iter->second;
+    uint32_t ts = parse_rtp_timestamp(view);
+    auto codec_iter = _codecs.find(parse_rtp_payload_type(view));
+    RtpVideoHeader header;
+    if (codec_iter != _codecs.end() && payload_len > 0 &&
+            parse_rtp_video_header(codec_iter->second, view.data() + header_len,
+                payload_len, &header) &&
+            header.frame_start && header.keyframe &&
+            (!gop.valid || is_newer_timestamp(ts, gop.keyframe_ts)))
+    {
+        // 同一个关键帧的多个slice时间戳相同，只在第一个包重新开始
+        _clear(gop);
+        gop.valid = true;
+        gop.keyframe_ts = ts;
+        ++gop.generation;
+    }
+
+    if (!gop.valid) {
+        return;
+    }
+
+    if (_bytes + sizeof(HistoryPacket) > _max_bytes) {
+        // 不完整的GOP无法解码，等下一个关键帧
+        _clear(gop);
+        if (_overflows++ % 100 == 0) {
+            RTC_LOG(LS_WARNING) << "gop cache overflow, max_bytes: " << _max_bytes
+                << ", count: " << _overflows;
+        }
+        return;
+    }
+
+    if (!packet) {
+        std::shared_ptr<HistoryPacket> copy = std::make_shared<HistoryPacket>();
+        memcpy(copy->data, data, len);
+        copy->size = len;
+        packet = copy;
+    }
+
+    gop.packets.push_back(packet);
+    gop.bytes += sizeof(HistoryPacket);
+    _bytes += sizeof(HistoryPacket);
+}
+
+const Gop* GopCache::find(uint32_t ssrc) {
+    auto iter = _gops.find(ssrc);
+    if (iter == _gops.end() || !iter->second.valid || iter->second.packets.empty()) {
+        return nullptr;
+    }
+
+    return &iter->second;
+}
+
+} // namespace xrtc
@@ -0,0 +1,61 @@
+#ifndef __MODULE_GOP_CACHE_H_
+#define __MODULE_GOP_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "module/rtp_rtcp/rtp_packet_history.h"
+#include "module/rtp_rtcp/rtp_video_header.h"
+
+namespace xrtc {
+
+// 一个视频ssrc从最近一个关键帧开始的所有包，按到达顺序
+struct Gop {
+    std::vector<std::shared_ptr<const HistoryPacket>> packets;
+    size_t bytes = 0;
+    uint32_t keyframe_ts = 0;
+    uint64_t generation = 0; // 每个新的关键帧加1
+    bool valid = false;      // 超过上限后无效，直到下一个关键帧
+};
+
+// 每个推流一个，新的订阅者不用等关键帧，直接从缓存的关键帧开始播放。
+// 包和NACK历史共用同一份内存，内存按每个包的缓冲区大小计算
+class GopCache {
+public:
+    explicit GopCache(size_t max_bytes) : _max_bytes(max_bytes) {}
+    ~GopCache() = default;
+
+    // 只缓存加入过的ssrc(视频的媒体ssrc，不包括RTX)
+    void add_ssrc(uint32_t ssrc) { _gops[ssrc]; }
+    bool has_ssrc(uint32_t ssrc) { return _gops.find(ssrc) != _gops.end(); }
+    // 根据payload type确定解析关键帧的编码格式
+    void set_codec(uint8_t payload_type, VideoCodecType codec) {
+        _codecs[payload_type] = codec;
+    }
+
+    // packet为nullptr时拷贝data
+    void put(const char* data, size_t len, std::shared_ptr<const HistoryPacket> packet);
+    // 没有可用的GOP时返回nullptr
+    const Gop* find(uint32_t ssrc);
+
+    size_t bytes() { return _bytes; }
+    size_t max_bytes() { return _max_bytes; }
+    uint64_t overflows() { return _overflows; }
+
+private:
+    void _clear(Gop& gop);
+
+private:
+    size_t _max_bytes;
+    size_t _bytes = 0;
+    uint64_t _overflows = 0;
+    std::unordered_map<uint8_t, VideoCodecType> _codecs;
+    std::unordered_map<uint32_t, Gop> _gops;
+};
+
+} // namespace xrtc
+
+#endif // __MODULE_GOP_CACHE_H_
@@ -0,0 +1,147 @@
+#include "module/rtp_rtcp/receive_statistics.h"
+
+#include <stdlib.h>
+
+#include "module/rtp_rtcp/rtp_utils.h"
+
+namespace xrtc {
+
+// 超过5秒(90kHz)的传输时间变化认为是时间戳跳变，不计入抖动
+const int32_t k_max_transit_delta = 450000;
+
+void StreamStatistician::on_rtp(uint16_t seq, uint32_t rtp_ts, int64_t now_ms) {
+    ++_received;
+    uint32_t transit = (uint32_t)(now_ms * _clockrate / 1000) - rtp_ts;
+    if (!_has_packet) {
+        _has_packet = true;
+        _base_seq = seq;
+        _max_seq = seq;
+        _last_transit = transit;
+        return;
+    }
+
+    // 重复或者乱序的旧包只计入收到的个数
+    uint16_t delta = seq - _max_seq;
+    if (0 == delta || delta >= 0x8000) {
+        return;
+    }
+
+    if (seq < _max_seq) {
+        _cycles += 1 << 16;
+    }
+    _max_seq = seq;
+
+    int32_t d = (int32_t)(transit - _last_transit);
+    _last_transit = transit;
+    d = abs(d);
+    if (d < k_max_transit_delta) {
+        _jitter_q4 += d - ((_jitter_q4 + 8) >> 4);
+    }
+}
+
+void StreamStatistician::on_sender_report(uint64_t ntp, int64_t now_ms) {
+    _last_sr = compact_ntp(ntp);
+    _last_sr_ms = now_ms;
+}
+
+int64_t StreamStatistician::cumulative_lost() const {
+    if (!_has_packet) {
+        return 0;
+    }
+
+    int64_t expected = (int64_t)extended_highest_seq() - _base_seq + 1;
+    return expected - (int64_t)_received;
+}
+
+RtcpReportBlock StreamStatistician::build_report_block(int64_t now_ms) {
+    RtcpReportBlock block;
+    block.ssrc = _ssrc;
+
+    uint32_t expected = extended_highest_seq() - _base_seq + 1;
+    int64_t expected_interval = expected - _expected_prior;
+    int64_t received_interval = _received - _received_prior;
+    _expected_prior = expected;
+    _received_prior = _received;
+
+    int64_t lost_interval = expected_interval - received_interval;
+    if (expected_interval > 0 && lost_interval > 0) {
+        block.fraction_lost = (uint8_t)((lost_interval << 8) / expected_interval);
+    }
+
+    // 24位有符号
+    int64_t lost = cumulative_lost();
+    if (lost > 0x7FFFFF) {
+        lost = 0x7FFFFF;
+    } else if (lost < -0x800000) {
+        lost = -0x800000;
+    }
+    block.cumulative_lost = (int32_t)lost;
+    block.extended_highest_seq = extended_highest_seq();
+    block.jitter = jitter();
+
+    if (_last_sr_ms >= 0) {
+        block.last_sr = _last_sr;
+        block.delay_since_last_sr = (uint32_t)((now_ms - _last_sr_ms) * 65536 / 1000);
+    }
+
+    return block;
+}
+
+void ReceiveStatistics::add_ssrc(uint32_t ssrc, int clockrate) {
+    if (_streams.find(ssrc) == _streams.end()) {
+        _streams.emplace(ssrc, StreamStatistician(ssrc, clockrate));
+    }
+}
+
+void ReceiveStatistics::add_rtx_ssrc(uint32_t rtx_ssrc, uint32_t media_ssrc) {
+    _rtx_to_media[rtx_ssrc] = media_ssrc;
+}
+
+void ReceiveStatistics::on_rtp(const char* data, size_t len, int64_t now_ms) {
+    rtc::ArrayView<const uint8_t> view((const uint8_t*)data, len);
+    if (len < 12) {
+        return;
+    }
+
+    uint32_t ssrc = parse_rtp_ssrc(view);
+    auto iter = _streams.find(ssrc);
+    if (iter != _streams.end()) {
+        iter->second.on_rtp(parse_rtp_sequence_number(view), parse_rtp_timestamp(view),
+                now_ms);
+        return;
+    }
+
+    // 只有padding的RTX包是带宽探测，不是重传
+    auto rtx_iter = _rtx_to_media.find(ssrc);
+    size_t header_len = 0;
+    size_t payload_len = 0;
+    if (rtx_iter == _rtx_to_media.end() ||
+            !parse_rtp_layout(view, &header_len, &payload_len) || payload_len <= 2)
+    {
+        return;
+    }
+
+    iter = _streams.find(rtx_iter->second);
+    if (iter != _streams.end()) {
+        iter->second.on_retransmit();
+    }
+}
+
+void ReceiveStatistics::on_sender_report(uint32_t ssrc, uint64_t ntp, int64_t now_ms) {
+    auto iter = _streams.find(ssrc);
+    if (iter != _streams.end()) {
+        iter->second.on_sender_report(ntp, now_ms);
+    }
+}
+
+void ReceiveStatistics::build_report_blocks(int64_t now_ms,
+        std::vector<RtcpReportBlock>* blocks)
+{
+    for (auto& item : _streams) {
+        if (item.second.received() > 0) {
+            blocks->push_back(item.second.build_report_block(now_ms));
+        }
+    }
+}
+
+} // namespace xrtc
@@ -0,0 +1,72 @@
+#ifndef __MODULE_RECEIVE_STATISTICS_H_
+#define __MODULE_RECEIVE_STATISTICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "module/rtp_rtcp/rtcp_report.h"
+
+namespace xrtc {
+
+// 一个ssrc的接收统计，rfc3550 A.1(序号)、A.3(丢包)、A.8(抖动)
+class StreamStatistician {
+public:
+    StreamStatistician(uint32_t ssrc, int clockrate) :
+        _ssrc(ssrc), _clockrate(clockrate) {}
+
+    void on_rtp(uint16_t seq, uint32_t rtp_ts, int64_t now_ms);
+    // RTX恢复的包只计入收到的个数
+    void on_retransmit() { ++_received; }
+    void on_sender_report(uint64_t ntp, int64_t now_ms);
+    // 生成报告块，并开始新的丢包率统计区间
+    RtcpReportBlock build_report_block(int64_t now_ms);
+
+    uint64_t received() const { return _received; }
+    int64_t cumulative_lost() const;
+    uint32_t extended_highest_seq() const { return _cycles + _max_seq; }
+    uint32_t jitter() const { return _jitter_q4 >> 4; }
+    int clockrate() const { return _clockrate; }
+
+private:
+    uint32_t _ssrc;
+    int _clockrate;
+    bool _has_packet = false;
+    uint16_t _base_seq = 0;
+    uint16_t _max_seq = 0;
+    uint32_t _cycles = 0;         // 序号回绕次数 << 16
+    uint64_t _received = 0;
+    uint32_t _expected_prior = 0;
+    uint64_t _received_prior = 0;
+    uint32_t _last_transit = 0;
+    uint32_t _jitter_q4 = 0;      // 抖动 * 16
+    uint32_t _last_sr = 0;
+    int64_t _last_sr_ms = -1;
+};
+
+// 推流端每个媒体ssrc的接收统计，用于生成服务器自己的RR
+class ReceiveStatistics {
+public:
+    ReceiveStatistics() = default;
+    ~ReceiveStatistics() = default;
+
+    void clear() { _streams.clear(); _rtx_to_media.clear(); }
+    void add_ssrc(uint32_t ssrc, int clockrate);
+    void add_rtx_ssrc(uint32_t rtx_ssrc, uint32_t media_ssrc);
+
+    void on_rtp(const char* data, size_t len, int64_t now_ms);
+    void on_sender_report(uint32_t ssrc, uint64_t ntp, int64_t now_ms);
+    // 每个收到过包的ssrc一个报告块
+    void build_report_blocks(int64_t now_ms, std::vector<RtcpReportBlock>* blocks);
+
+    const std::unordered_map<uint32_t, StreamStatistician>& streams() { return _streams; }
+
+private:
+    std::unordered_map<uint32_t, StreamStatistician> _streams;
+    std::unordered_map<uint32_t, uint32_t> _rtx_to_media;
+};
+
+} // namespace xrtc
+
+#endif // __MODULE_RECEIVE_STATISTICS_H_
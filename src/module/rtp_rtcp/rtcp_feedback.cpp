@@ -0,0 +1,224 @@
+#include "module/rtp_rtcp/rtcp_feedback.h"
+
+#include <rtc_base/byte_io.h>
+
+namespace xrtc {
+
+const size_t k_rtcp_header_len = 4;
+const size_t k_rtcp_feedback_header_len = 12;
+
+bool next_rtcp_block(const uint8_t* data, size_t len, size_t* offset, RtcpBlock* block) {
+    if (*offset + k_rtcp_header_len > len) {
+        return false;
+    }
+
+    const uint8_t* p = data + *offset;
+    if ((p[0] >> 6) != 2) {
+        return false;
+    }
+
+    size_t block_len = (rtc::ByteReader<uint16_t>::ReadBigEndian(p + 2) + 1) * 4;
+    if (*offset + block_len > len) {
+        return false;
+    }
+
+    block->data = p;
+    block->len = block_len;
+    block->type = p[1];
+    block->fmt = p[0] & 0x1f;
+    *offset += block_len;
+    return true;
+}
+
+bool parse_rtcp_nack(const RtcpBlock& block, uint32_t* sender_ssrc,
+        uint32_t* media_ssrc, std::vector<uint16_t>* seqs)
+{
+    if (block.type != k_rtcp_type_rtpfb || block.fmt != k_rtcp_fmt_nack ||
+            block.len < k_rtcp_feedback_header_len)
+    {
+        return false;
+    }
+
+    *sender_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 4);
+    *media_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 8);
+
+    // 每个FCI: PID(16) + BLP(16)，BLP的第i位表示PID+i+1也丢失
+    for (size_t pos = k_rtcp_feedback_header_len; pos + 4 <= block.len; pos += 4) {
+        uint16_t pid = rtc::ByteReader<uint16_t>::ReadBigEndian(block.data + pos);
+        uint16_t blp = rtc::ByteReader<uint16_t>::ReadBigEndian(block.data + pos + 2);
+        seqs->push_back(pid);
+        for (int i = 0; i < 16; ++i) {
+            if (blp & (1 << i)) {
+                seqs->push_back(pid + i + 1);
+            }
+        }
+    }
+
+    return true;
+}
+
+static void write_feedback_header(uint8_t fmt, uint8_t type, size_t len,
+        uint32_t sender_ssrc, uint32_t media_ssrc, uint8_t* buf)
+{
+    buf[0] = 0x80 | fmt;
+    buf[1] = type;
+    rtc::ByteWriter<uint16_t>::WriteBigEndian(buf + 2, len / 4 - 1);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 4, sender_ssrc);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 8, media_ssrc);
+}
+
+size_t build_rtcp_nack(uint32_t sender_ssrc, uint32_t media_ssrc,
+        const std::vector<uint16_t>& seqs, uint8_t* buf, size_t max_len)
+{
+    if (seqs.empty() || max_len < k_rtcp_feedback_header_len) {
+        return 0;
+    }
+
+    size_t pos = k_rtcp_feedback_header_len;
+    size_t i = 0;
+    while (i < seqs.size()) {
+        if (pos + 4 > max_len) {
+            return 0;
+        }
+
+        uint16_t pid = seqs[i++];
+        uint16_t blp = 0;
+        while (i < seqs.size()) {
+            uint16_t diff = seqs[i] - pid;
+            if (diff == 0 || diff > 16) {
+                break;
+            }
+            blp |= 1 << (diff - 1);
+            ++i;
+        }
+
+        rtc::ByteWriter<uint16_t>::WriteBigEndian(buf + pos, pid);
+        rtc::ByteWriter<uint16_t>::WriteBigEndian(buf + pos + 2, blp);
+        pos += 4;
+    }
+
+    write_feedback_header(k_rtcp_fmt_nack, k_rtcp_type_rtpfb, pos,
+            sender_ssrc, media_ssrc, buf);
+    return pos;
+}
+
+bool parse_rtcp_keyframe_request(const RtcpBlock& block, uint32_t* sender_ssrc,
+        uint32_t* media_ssrc, bool* fir)
+{
+    if (block.type != k_rtcp_type_psfb || block.len < k_rtcp_feedback_header_len) {
+        return false;
+    }
+
+    *sender_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 4);
+    if (k_rtcp_fmt_pli == block.fmt) {
+        *media_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 8);
+        *fir = false;
+        return true;
+    }
+
+    // FIR的媒体ssrc字段为0，目标在FCI中: SSRC(32) + Seq nr.(8) + Reserved(24)
+    if (k_rtcp_fmt_fir == block.fmt && block.len >= k_rtcp_feedback_header_len + 8) {
+        *media_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(
+                block.data + k_rtcp_feedback_header_len);
+        *fir = true;
+        return true;
+    }
+
+    return false;
+}
+
+size_t build_rtcp_pli(uint32_t sender_ssrc, uint32_t media_ssrc,
+        uint8_t* buf, size_t max_len)
+{
+    if (max_len < k_rtcp_feedback_header_len) {
+        return 0;
+    }
+
+    write_feedback_header(k_rtcp_fmt_pli, k_rtcp_type_psfb, k_rtcp_feedback_header_len,
+            sender_ssrc, media_ssrc, buf);
+    return k_rtcp_feedback_header_len;
+}
+
+size_t build_rtcp_fir(uint32_t sender_ssrc, uint32_t media_ssrc, uint8_t seq_nr,
+        uint8_t* buf, size_t max_len)
+{
+    size_t len = k_rtcp_feedback_header_len + 8;
+    if (max_len < len) {
+        return 0;
+    }
+
+    write_feedback_header(k_rtcp_fmt_fir, k_rtcp_type_psfb, len, sender_ssrc, 0, buf);
+    uint8_t* fci = buf + k_rtcp_feedback_header_len;
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(fci, media_ssrc);
+    fci[4] = seq_nr;
+    fci[5] = fci[6] = fci[7] = 0;
+    return len;
+}
+
+bool parse_rtcp_remb(const RtcpBlock& block, uint32_t* sender_ssrc,
+        uint64_t* bitrate_bps, std::vector<uint32_t>* ssrcs)
+{
+    // 公共头 + 'R''E''M''B' + Num SSRC(8) + BR Exp(6) + BR Mantissa(18) + SSRC列表
+    if (block.type != k_rtcp_type_psfb || block.fmt != k_rtcp_fmt_afb ||
+            block.len < k_rtcp_feedback_header_len + 8)
+    {
+        return false;
+    }
+
+    const uint8_t* fci = block.data + k_rtcp_feedback_header_len;
+    if (fci[0] != 'R' || fci[1] != 'E' || fci[2] != 'M' || fci[3] != 'B') {
+        return false;
+    }
+
+    size_t count = fci[4];
+    if (k_rtcp_feedback_header_len + 8 + count * 4 > block.len) {
+        return false;
+    }
+
+    uint8_t exp = fci[5] >> 2;
+    uint64_t mantissa = ((uint64_t)(fci[5] & 0x03) << 16) |
+        rtc::ByteReader<uint16_t>::ReadBigEndian(fci + 6);
+    if (exp > 46) { // 超过64位
+        return false;
+    }
+
+    *sender_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 4);
+    *bitrate_bps = mantissa << exp;
+    for (size_t i = 0; i < count; ++i) {
+        ssrcs->push_back(rtc::ByteReader<uint32_t>::ReadBigEndian(fci + 8 + i * 4));
+    }
+
+    return true;
+}
+
+size_t build_rtcp_remb(uint32_t sender_ssrc, uint64_t bitrate_bps,
+        const std::vector<uint32_t>& ssrcs, uint8_t* buf, size_t max_len)
+{
+    size_t len = k_rtcp_feedback_header_len + 8 + ssrcs.size() * 4;
+    if (ssrcs.empty() || ssrcs.size() > 0xFF || max_len < len) {
+        return 0;
+    }
+
+    uint8_t exp = 0;
+    while (bitrate_bps >= (1 << 18)) {
+        bitrate_bps >>= 1;
+        ++exp;
+    }
+
+    write_feedback_header(k_rtcp_fmt_afb, k_rtcp_type_psfb, len, sender_ssrc, 0, buf);
+    uint8_t* fci = buf + k_rtcp_feedback_header_len;
+    fci[0] = 'R';
+    fci[1] = 'E';
+    fci[2] = 'M';
+    fci[3] = 'B';
+    fci[4] = (uint8_t)ssrcs.size();
+    fci[5] = (exp << 2) | ((bitrate_bps >> 16) & 0x03);
+    rtc::ByteWriter<uint16_t>::WriteBigEndian(fci + 6, bitrate_bps & 0xFFFF);
+    for (size_t i = 0; i < ssrcs.size(); ++i) {
+        rtc::ByteWriter<uint32_t>::WriteBigEndian(fci + 8 + i * 4, ssrcs[i]);
+    }
+
+    return len;
+}
+
+} // namespace xrtc
@@ -0,0 +1,56 @@
+#ifndef __MODULE_RTCP_FEEDBACK_H_
+#define __MODULE_RTCP_FEEDBACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace xrtc {
+
+const uint8_t k_rtcp_type_sr = 200;
+const uint8_t k_rtcp_type_rr = 201;
+const uint8_t k_rtcp_type_sdes = 202;
+const uint8_t k_rtcp_type_bye = 203;
+const uint8_t k_rtcp_type_rtpfb = 205;
+const uint8_t k_rtcp_type_psfb = 206;
+
+const uint8_t k_rtcp_fmt_nack = 1;
+const uint8_t k_rtcp_fmt_pli = 1;
+const uint8_t k_rtcp_fmt_fir = 4;
+const uint8_t k_rtcp_fmt_afb = 15; // REMB
+
+// 复合RTCP包中的一个报文
+struct RtcpBlock {
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    uint8_t type = 0;
+    uint8_t fmt = 0; // 反馈报文的FMT，其他报文是RC
+};
+
+// 从*offset开始取出下一个报文，没有或者格式错误时返回false
+bool next_rtcp_block(const uint8_t* data, size_t len, size_t* offset, RtcpBlock* block);
+
+// rfc4585 Generic NACK
+bool parse_rtcp_nack(const RtcpBlock& block, uint32_t* sender_ssrc,
+        uint32_t* media_ssrc, std::vector<uint16_t>* seqs);
+// 返回报文长度，缓冲区不够时返回0
+size_t build_rtcp_nack(uint32_t sender_ssrc, uint32_t media_ssrc,
+        const std::vector<uint16_t>& seqs, uint8_t* buf, size_t max_len);
+
+// PLI(rfc4585)或FIR(rfc5104)，FIR的媒体ssrc取第一个FCI
+bool parse_rtcp_keyframe_request(const RtcpBlock& block, uint32_t* sender_ssrc,
+        uint32_t* media_ssrc, bool* fir);
+size_t build_rtcp_pli(uint32_t sender_ssrc, uint32_t media_ssrc,
+        uint8_t* buf, size_t max_len);
+size_t build_rtcp_fir(uint32_t sender_ssrc, uint32_t media_ssrc, uint8_t seq_nr,
+        uint8_t* buf, size_t max_len);
+
+// draft-alvestrand-rmcat-remb，ssrcs为估计带宽对应的媒体ssrc
+bool parse_rtcp_remb(const RtcpBlock& block, uint32_t* sender_ssrc,
+        uint64_t* bitrate_bps, std::vector<uint32_t>* ssrcs);
+size_t build_rtcp_remb(uint32_t sender_ssrc, uint64_t bitrate_bps,
+        const std::vector<uint32_t>& ssrcs, uint8_t* buf, size_t max_len);
+
+} // namespace xrtc
+
+#endif // __MODULE_RTCP_FEEDBACK_H_
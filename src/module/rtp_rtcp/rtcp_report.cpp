@@ -0,0 +1,167 @@
+#include "module/rtp_rtcp/rtcp_report.h"
+
+#include <string.h>
+#include <sys/time.h>
+
+#include <rtc_base/byte_io.h>
+
+namespace xrtc {
+
+// 1900-01-01到1970-01-01的秒数
+const uint64_t k_ntp_jan_1970 = 2208988800ULL;
+const size_t k_rtcp_header_len = 4;
+const size_t k_report_block_len = 24;
+const size_t k_sender_info_len = 20;
+const size_t k_max_report_blocks = 31;
+const uint8_t k_sdes_cname = 1;
+
+uint64_t ntp_time_now() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    uint64_t seconds = (uint64_t)tv.tv_sec + k_ntp_jan_1970;
+    uint64_t fractions = ((uint64_t)tv.tv_usec << 32) / 1000000;
+    return (seconds << 32) | fractions;
+}
+
+int64_t rtt_from_report_block(const RtcpReportBlock& block, uint64_t ntp_now) {
+    if (0 == block.last_sr) {
+        return -1;
+    }
+
+    uint32_t rtt = compact_ntp(ntp_now) - block.last_sr - block.delay_since_last_sr;
+    if (rtt & 0x80000000) {
+        return -1;
+    }
+
+    return (int64_t)rtt * 1000 / 65536;
+}
+
+static void parse_report_blocks(const uint8_t* p, size_t count, size_t available,
+        std::vector<RtcpReportBlock>* report_blocks)
+{
+    for (size_t i = 0; i < count && (i + 1) * k_report_block_len <= available; ++i) {
+        const uint8_t* q = p + i * k_report_block_len;
+        RtcpReportBlock block;
+        block.ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(q);
+        block.fraction_lost = q[4];
+        block.cumulative_lost = rtc::ByteReader<int32_t, 3>::ReadBigEndian(q + 5);
+        block.extended_highest_seq = rtc::ByteReader<uint32_t>::ReadBigEndian(q + 8);
+        block.jitter = rtc::ByteReader<uint32_t>::ReadBigEndian(q + 12);
+        block.last_sr = rtc::ByteReader<uint32_t>::ReadBigEndian(q + 16);
+        block.delay_since_last_sr = rtc::ByteReader<uint32_t>::ReadBigEndian(q + 20);
+        report_blocks->push_back(block);
+    }
+}
+
+static void write_report_blocks(const std::vector<RtcpReportBlock>& report_blocks,
+        uint8_t* buf)
+{
+    for (size_t i = 0; i < report_blocks.size(); ++i) {
+        const RtcpReportBlock& block = report_blocks[i];
+        uint8_t* q = buf + i * k_report_block_len;
+        rtc::ByteWriter<uint32_t>::WriteBigEndian(q, block.ssrc);
+        q[4] = block.fraction_lost;
+        rtc::ByteWriter<int32_t, 3>::WriteBigEndian(q + 5, block.cumulative_lost);
+        rtc::ByteWriter<uint32_t>::WriteBigEndian(q + 8, block.extended_highest_seq);
+        rtc::ByteWriter<uint32_t>::WriteBigEndian(q + 12, block.jitter);
+        rtc::ByteWriter<uint32_t>::WriteBigEndian(q + 16, block.last_sr);
+        rtc::ByteWriter<uint32_t>::WriteBigEndian(q + 20, block.delay_since_last_sr);
+    }
+}
+
+static void write_header(uint8_t count, uint8_t type, size_t len, uint8_t* buf) {
+    buf[0] = 0x80 | count;
+    buf[1] = type;
+    rtc::ByteWriter<uint16_t>::WriteBigEndian(buf + 2, len / 4 - 1);
+}
+
+bool parse_rtcp_sr(const RtcpBlock& block, RtcpSenderInfo* info,
+        std::vector<RtcpReportBlock>* report_blocks)
+{
+    size_t header_len = k_rtcp_header_len + 4 + k_sender_info_len;
+    if (block.type != k_rtcp_type_sr || block.len < header_len) {
+        return false;
+    }
+
+    info->ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 4);
+    info->ntp = rtc::ByteReader<uint64_t>::ReadBigEndian(block.data + 8);
+    info->rtp_ts = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 16);
+    info->packets = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 20);
+    info->octets = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 24);
+    if (report_blocks) {
+        parse_report_blocks(block.data + header_len, block.fmt,
+                block.len - header_len, report_blocks);
+    }
+
+    return true;
+}
+
+bool parse_rtcp_rr(const RtcpBlock& block, uint32_t* sender_ssrc,
+        std::vector<RtcpReportBlock>* report_blocks)
+{
+    size_t header_len = k_rtcp_header_len + 4;
+    if (block.type != k_rtcp_type_rr || block.len < header_len) {
+        return false;
+    }
+
+    *sender_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(block.data + 4);
+    parse_report_blocks(block.data + header_len, block.fmt, block.len - header_len,
+            report_blocks);
+    return true;
+}
+
+size_t build_rtcp_sr(const RtcpSenderInfo& info,
+        const std::vector<RtcpReportBlock>& report_blocks, uint8_t* buf, size_t max_len)
+{
+    size_t len = k_rtcp_header_len + 4 + k_sender_info_len +
+        report_blocks.size() * k_report_block_len;
+    if (report_blocks.size() > k_max_report_blocks || max_len < len) {
+        return 0;
+    }
+
+    write_header((uint8_t)report_blocks.size(), k_rtcp_type_sr, len, buf);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 4, info.ssrc);
+    rtc::ByteWriter<uint64_t>::WriteBigEndian(buf + 8, info.ntp);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 16, info.rtp_ts);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 20, info.packets);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 24, info.octets);
+    write_report_blocks(report_blocks, buf + 28);
+    return len;
+}
+
+size_t build_rtcp_rr(uint32_t sender_ssrc,
+        const std::vector<RtcpReportBlock>& report_blocks, uint8_t* buf, size_t max_len)
+{
+    size_t len = k_rtcp_header_len + 4 + report_blocks.size() * k_report_block_len;
+    if (report_blocks.size() > k_max_report_blocks || max_len < len) {
+        return 0;
+    }
+
+    write_header((uint8_t)report_blocks.size(), k_rtcp_type_rr, len, buf);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 4, sender_ssrc);
+    write_report_blocks(report_blocks, buf + 8);
+    return len;
+}
+
+size_t build_rtcp_sdes(uint32_t ssrc, const std::string& cname,
+        uint8_t* buf, size_t max_len)
+{
+    // chunk: SSRC + CNAME(type, length, text) + 至少一个0，按4字节对齐
+    size_t cname_len = cname.size() > 255 ? 255 : cname.size();
+    size_t chunk_len = (4 + 2 + cname_len + 1 + 3) & ~(size_t)3;
+    size_t len = k_rtcp_header_len + chunk_len;
+    if (max_len < len) {
+        return 0;
+    }
+
+    write_header(1, k_rtcp_type_sdes, len, buf);
+    uint8_t* chunk = buf + k_rtcp_header_len;
+    memset(chunk, 0, chunk_len);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(chunk, ssrc);
+    chunk[4] = k_sdes_cname;
+    chunk[5] = (uint8_t)cname_len;
+    memcpy(chunk + 6, cname.data(), cname_len);
+    return len;
+}
+
+} // namespace xrtc
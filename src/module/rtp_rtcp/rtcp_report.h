@@ -0,0 +1,55 @@
+#ifndef __MODULE_RTCP_REPORT_H_
+#define __MODULE_RTCP_REPORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "module/rtp_rtcp/rtcp_feedback.h"
+
+namespace xrtc {
+
+// rfc3550 6.4.1
+struct RtcpReportBlock {
+    uint32_t ssrc = 0;
+    uint8_t fraction_lost = 0;     // 上一个报告之后的丢包率，单位1/256
+    int32_t cumulative_lost = 0;   // 24位有符号
+    uint32_t extended_highest_seq = 0;
+    uint32_t jitter = 0;           // 时钟单位
+    uint32_t last_sr = 0;          // 收到的最后一个SR的NTP中间32位
+    uint32_t delay_since_last_sr = 0; // 单位1/65536秒
+};
+
+struct RtcpSenderInfo {
+    uint32_t ssrc = 0;
+    uint64_t ntp = 0;
+    uint32_t rtp_ts = 0;
+    uint32_t packets = 0;
+    uint32_t octets = 0;
+};
+
+// 当前时间的NTP时间戳(高32位秒，低32位小数)
+uint64_t ntp_time_now();
+// NTP的中间32位，用于LSR/DLSR
+inline uint32_t compact_ntp(uint64_t ntp) { return (uint32_t)(ntp >> 16); }
+// LSR/DLSR计算往返时间，没有SR或者结果异常时返回-1
+int64_t rtt_from_report_block(const RtcpReportBlock& block, uint64_t ntp_now);
+
+bool parse_rtcp_sr(const RtcpBlock& block, RtcpSenderInfo* info,
+        std::vector<RtcpReportBlock>* report_blocks);
+bool parse_rtcp_rr(const RtcpBlock& block, uint32_t* sender_ssrc,
+        std::vector<RtcpReportBlock>* report_blocks);
+
+// 最多31个报告块，返回报文长度，缓冲区不够时返回0
+size_t build_rtcp_sr(const RtcpSenderInfo& info,
+        const std::vector<RtcpReportBlock>& report_blocks, uint8_t* buf, size_t max_len);
+size_t build_rtcp_rr(uint32_t sender_ssrc,
+        const std::vector<RtcpReportBlock>& report_blocks, uint8_t* buf, size_t max_len);
+// 只有CNAME一项的SDES，复合包必须携带
+size_t build_rtcp_sdes(uint32_t ssrc, const std::string& cname,
+        uint8_t* buf, size_t max_len);
+
+} // namespace xrtc
+
+#endif // __MODULE_RTCP_REPORT_H_
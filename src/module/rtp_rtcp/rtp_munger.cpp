@@ -0,0 +1,180 @@
+#include "module/rtp_rtcp/rtp_munger.h"
+
+#include <rtc_base/byte_io.h>
+
+#include "module/rtp_rtcp/rtp_utils.h"
+
+namespace xrtc {
+
+// 保存的序号区间个数，丢弃一个连续的帧只产生一个区间
+const size_t k_max_seq_ranges = 512;
+
+// 序号回绕的比较，a比b旧时返回true
+static bool is_older_sequence_number(uint16_t a, uint16_t b) {
+    return a != b && (uint16_t)(b - a) < 0x8000;
+}
+
+bool RtpMunger::rewrite(uint8_t* packet, size_t len, const RtpVideoHeader* header,
+        int64_t now_ms)
+{
+    rtc::ArrayView<const uint8_t> view(packet, len);
+    if (len < 12) {
+        return false;
+    }
+
+    uint16_t seq = parse_rtp_sequence_number(view);
+    uint32_t ts = parse_rtp_timestamp(view);
+    int picture_id = header ? header->picture_id : -1;
+    int tl0_pic_idx = header ? header->tl0_pic_idx : -1;
+
+    if (!_started || _switching) {
+        if (_started) {
+            // 时间戳按经过的时间前进，至少一个时钟单位
+            int64_t elapsed = (now_ms - _last_ms) * _clockrate / 1000;
+            uint32_t ts_step = elapsed > 0 ? (uint32_t)elapsed : 1;
+            _seq_offset = _last_seq + 1 - seq;
+            _ts_offset = _last_ts + ts_step - ts;
+            if (picture_id >= 0 && _last_picture_id >= 0) {
+                _picture_id_offset = _last_picture_id + 1 - picture_id;
+            }
+            if (tl0_pic_idx >= 0 && _last_tl0_pic_idx >= 0) {
+                _tl0_pic_idx_offset = _last_tl0_pic_idx + 1 - tl0_pic_idx;
+            }
+        }
+
+        _started = true;
+        _switching = false;
+        _switch_seq = seq;
+        _highest_seq = seq;
+        _seq_ranges.clear();
+        _seq_ranges.push_back({seq, _seq_offset});
+    } else if (is_older_sequence_number(seq, _switch_seq)) {
+        return false;
+    }
+
+    uint16_t seq_offset = 0;
+    size_t payload_len = 0;
+    if (!_sequence_offset(seq, &seq_offset) ||
+            !_write(packet, len, header, seq_offset, &payload_len))
+    {
+        return false;
+    }
+
+    if (!is_older_sequence_number(seq, _highest_seq)) {
+        _highest_seq = seq;
+        _last_seq = seq + seq_offset;
+        _last_ts = ts + _ts_offset;
+        _last_ms = now_ms;
+        if (picture_id >= 0) {
+            _last_picture_id = (uint16_t)(picture_id + _picture_id_offset) &
+                (header->picture_id_15bit ? 0x7FFF : 0x7F);
+        }
+        if (tl0_pic_idx >= 0) {
+            _last_tl0_pic_idx = (uint8_t)(tl0_pic_idx + _tl0_pic_idx_offset);
+        }
+    }
+
+    ++_packets;
+    _octets += payload_len;
+    return true;
+}
+
+void RtpMunger::drop(uint16_t seq) {
+    if (!_started || _switching || !is_older_sequence_number(_highest_seq, seq)) {
+        return;
+    }
+
+    // 连续丢弃时只移动最后一个区间的起点
+    _highest_seq = seq;
+    --_seq_offset;
+    if (_seq_ranges.back().source_start == seq) {
+        _seq_ranges.back() = {(uint16_t)(seq + 1), _seq_offset};
+        return;
+    }
+
+    _seq_ranges.push_back({(uint16_t)(seq + 1), _seq_offset});
+    if (_seq_ranges.size() > k_max_seq_ranges) {
+        _seq_ranges.pop_front();
+    }
+}
+
+bool RtpMunger::rewrite_retransmit(uint8_t* packet, size_t len,
+        const RtpVideoHeader* header) const
+{
+    uint16_t seq_offset = 0;
+    size_t payload_len = 0;
+    return _started && len >= 12 && _sequence_offset(
+            parse_rtp_sequence_number(rtc::ArrayView<const uint8_t>(packet, len)),
+            &seq_offset) && _write(packet, len, header, seq_offset, &payload_len);
+}
+
+bool RtpMunger::source_sequence_number(uint16_t seq, uint16_t* source_seq) const {
+    if (!_started) {
+        return false;
+    }
+
+    // 区间在订阅者的序号上也是连续的
+    for (auto iter = _seq_ranges.rbegin(); iter != _seq_ranges.rend(); ++iter) {
+        uint16_t start = iter->source_start + iter->offset;
+        if (!is_older_sequence_number(seq, start)) {
+            *source_seq = seq - iter->offset;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool RtpMunger::_sequence_offset(uint16_t seq, uint16_t* offset) const {
+    for (auto iter = _seq_ranges.rbegin(); iter != _seq_ranges.rend(); ++iter) {
+        if (!is_older_sequence_number(seq, iter->source_start)) {
+            *offset = iter->offset;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool RtpMunger::_write(uint8_t* packet, size_t len, const RtpVideoHeader* header,
+        uint16_t seq_offset, size_t* payload_len) const
+{
+    rtc::ArrayView<const uint8_t> view(packet, len);
+    size_t header_len = 0;
+    if (!parse_rtp_layout(view, &header_len, payload_len)) {
+        return false;
+    }
+
+    uint16_t seq = parse_rtp_sequence_number(view);
+    uint32_t ts = parse_rtp_timestamp(view);
+    rtc::ByteWriter<uint16_t>::WriteBigEndian(packet + 2, seq + seq_offset);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(packet + 4, ts + _ts_offset);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(packet + 8, _ssrc);
+
+    if (!header) {
+        return true;
+    }
+
+    uint8_t* payload = packet + header_len;
+    if (header->picture_id >= 0 && header->picture_id_offset < *payload_len) {
+        uint16_t picture_id = header->picture_id + _picture_id_offset;
+        if (header->picture_id_15bit) {
+            if (header->picture_id_offset + 2 > *payload_len) {
+                return false;
+            }
+            payload[header->picture_id_offset] = 0x80 | ((picture_id >> 8) & 0x7F);
+            payload[header->picture_id_offset + 1] = picture_id & 0xFF;
+        } else {
+            payload[header->picture_id_offset] = picture_id & 0x7F;
+        }
+    }
+
+    if (header->tl0_pic_idx >= 0 && header->tl0_pic_idx_offset < *payload_len) {
+        payload[header->tl0_pic_idx_offset] =
+            (uint8_t)(header->tl0_pic_idx + _tl0_pic_idx_offset);
+    }
+
+    return true;
+}
+
+} // namespace xrtc
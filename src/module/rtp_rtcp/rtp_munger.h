@@ -0,0 +1,80 @@
+#ifndef __MODULE_RTP_MUNGER_H_
+#define __MODULE_RTP_MUNGER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+
+#include "module/rtp_rtcp/rtp_video_header.h"
+
+namespace xrtc {
+
+// 把多个源(simulcast的层)的包改写成一个连续的流: ssrc固定，切换源时
+// 序号、时间戳、PictureID和TL0PICIDX接在之前发出的最后一个包之后。
+// 每个订阅者一个，在订阅者自己的拷贝上改写。
+// 丢弃的包(SVC的增强层)之后的序号减小，订阅者看到的序号仍然是连续的
+class RtpMunger {
+public:
+    RtpMunger(uint32_t ssrc, int clockrate) : _ssrc(ssrc), _clockrate(clockrate) {}
+    ~RtpMunger() = default;
+
+    uint32_t ssrc() const { return _ssrc; }
+    bool started() const { return _started; }
+
+    // 下一个改写的包来自新的源，应该是新源的关键帧
+    void switch_source() { _switching = true; }
+    // header为nullptr时不改写PictureID。源中早于切换点的包返回false，不应该发送
+    bool rewrite(uint8_t* packet, size_t len, const RtpVideoHeader* header,
+            int64_t now_ms);
+    // 源中不发送给这个订阅者的包，只有按顺序到达的新包才影响之后的序号
+    void drop(uint16_t seq);
+    // 重传的包只改写，不更新状态
+    bool rewrite_retransmit(uint8_t* packet, size_t len,
+            const RtpVideoHeader* header) const;
+    // 订阅者看到的序号 -> 当前源的序号，切换之前的包返回false
+    bool source_sequence_number(uint16_t seq, uint16_t* source_seq) const;
+
+    // 用于SR: 源的时间戳加上偏移是订阅者看到的时间戳
+    uint32_t timestamp_offset() const { return _ts_offset; }
+    uint32_t packets() const { return _packets; }
+    uint32_t octets() const { return _octets; }
+
+private:
+    // 源的序号所在区间的序号偏移，早于切换点时返回false
+    bool _sequence_offset(uint16_t seq, uint16_t* offset) const;
+    bool _write(uint8_t* packet, size_t len, const RtpVideoHeader* header,
+            uint16_t seq_offset, size_t* payload_len) const;
+
+private:
+    uint32_t _ssrc;
+    int _clockrate;
+    bool _started = false;
+    bool _switching = false;
+
+    uint16_t _switch_seq = 0;   // 当前源的第一个包(源的序号)
+    uint16_t _highest_seq = 0;  // 当前源最新的包(源的序号)
+    uint16_t _seq_offset = 0;   // 新包的序号偏移
+    // 每次丢包之后序号偏移变化，保存最近的区间用于重传和NACK的序号换算
+    struct SeqRange {
+        uint16_t source_start;
+        uint16_t offset;
+    };
+    std::deque<SeqRange> _seq_ranges;
+    uint32_t _ts_offset = 0;
+    uint16_t _picture_id_offset = 0;
+    uint8_t _tl0_pic_idx_offset = 0;
+
+    // 最后发出的包(改写之后的值)
+    uint16_t _last_seq = 0;
+    uint32_t _last_ts = 0;
+    int _last_picture_id = -1;
+    int _last_tl0_pic_idx = -1;
+    int64_t _last_ms = 0;
+
+    uint32_t _packets = 0;
+    uint32_t _octets = 0;
+};
+
+} // namespace xrtc
+
+#endif // __MODULE_RTP_MUNGER_H_
@@ -0,0 +1,135 @@
+#include "module/rtp_rtcp/rtp_packet_history.h"
+
+#include <string.h>
+
+#include "module/rtp_rtcp/rtp_utils.h"
+
+namespace xrtc {
+
+static size_t round_up_pow2(size_t n) {
+    size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+// 序号回绕的比较，a比b新时返回true
+static bool is_newer_seq(uint16_t a, uint16_t b) {
+    return a != b && (uint16_t)(a - b) < 0x8000;
+}
+
+RtpPacketHistory::RtpPacketHistory(size_t capacity) :
+    _mask(round_up_pow2(capacity < 16 ? 16 : capacity) - 1)
+{
+}
+
+void RtpPacketHistory::add_ssrc(uint32_t ssrc) {
+    Stream& stream = _streams[ssrc];
+    stream.slots.resize(_mask + 1);
+}
+
+RtpPacketHistory::Stream* RtpPacketHistory::_find_stream(uint32_t ssrc) {
+    auto iter = _streams.find(ssrc);
+    return iter != _streams.end() ? &iter->second : nullptr;
+}
+
+bool RtpPacketHistory::put(const char* data, size_t len) {
+    if (len < 12 || len > k_packet_buffer_capacity) {
+        return true;
+    }
+
+    rtc::ArrayView<const uint8_t> view((const uint8_t*)data, len);
+    Stream* stream = _find_stream(parse_rtp_ssrc(view));
+    if (!stream) {
+        return true;
+    }
+
+    uint16_t seq = parse_rtp_sequence_number(view);
+    if (stream->has_packet && !is_newer_seq(seq, stream->highest_seq) &&
+            !in_window(parse_rtp_ssrc(view), seq))
+    {
+        return true;
+    }
+
+    Slot& slot = stream->slots[seq & _mask];
+    if (slot.valid && slot.seq == seq) {
+        return false;
+    }
+
+    // 没有人持有旧包时直接复用，稳定状态下不再分配内存
+    if (!slot.packet || slot.packet.use_count() > 1) {
+        slot.packet = std::make_shared<HistoryPacket>();
+    }
+
+    memcpy(slot.packet->data, data, len);
+    slot.packet->size = len;
+    slot.seq = seq;
+    slot.valid = true;
+    slot.request_ms = -1;
+
+    if (!stream->has_packet || is_newer_seq(seq, stream->highest_seq)) {
+        // 跳过的序号所在的slot已经过期
+        if (stream->has_packet) {
+            for (uint16_t s = stream->highest_seq + 1; s != seq; ++s) {
+                Slot& skipped = stream->slots[s & _mask];
+                skipped.valid = false;
+                skipped.seq = s;
+                skipped.request_ms = -1;
+                if ((uint16_t)(s - stream->highest_seq) > _mask) {
+                    break;
+                }
+            }
+        }
+
+        stream->highest_seq = seq;
+        stream->has_packet = true;
+    }
+
+    return true;
+}
+
+std::shared_ptr<const HistoryPacket> RtpPacketHistory::get(uint32_t ssrc, uint16_t seq) {
+    Stream* stream = _find_stream(ssrc);
+    if (!stream) {
+        return nullptr;
+    }
+
+    Slot& slot = stream->slots[seq & _mask];
+    if (!slot.valid || slot.seq != seq) {
+        return nullptr;
+    }
+
+    return slot.packet;
+}
+
+bool RtpPacketHistory::in_window(uint32_t ssrc, uint16_t seq) {
+    Stream* stream = _find_stream(ssrc);
+    if (!stream || !stream->has_packet || is_newer_seq(seq, stream->highest_seq)) {
+        return false;
+    }
+
+    return (uint16_t)(stream->highest_seq - seq) <= _mask;
+}
+
+bool RtpPacketHistory::should_request(uint32_t ssrc, uint16_t seq, int64_t now_ms,
+        int64_t interval_ms)
+{
+    if (!in_window(ssrc, seq)) {
+        return false;
+    }
+
+    Slot& slot = _find_stream(ssrc)->slots[seq & _mask];
+    if (slot.valid || slot.seq != seq) {
+        return false;
+    }
+
+    if (slot.request_ms >= 0 && now_ms - slot.request_ms < interval_ms) {
+        return false;
+    }
+
+    slot.request_ms = now_ms;
+    return true;
+}
+
+} // namespace xrtc
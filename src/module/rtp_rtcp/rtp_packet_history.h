@@ -0,0 +1,66 @@
+#ifndef __MODULE_RTP_PACKET_HISTORY_H_
+#define __MODULE_RTP_PACKET_HISTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "base/packet_buffer.h"
+
+namespace xrtc {
+
+// 历史中保存的解密后的RTP包，引用计数，重传时多个订阅者共用
+struct HistoryPacket {
+    size_t size = 0;
+    char data[k_packet_buffer_capacity];
+};
+
+// 每个ssrc一个按序号索引的环形缓冲区，保存最近转发过的包，
+// 用于直接响应订阅者的NACK
+class RtpPacketHistory {
+public:
+    // capacity向上取整到2的幂
+    explicit RtpPacketHistory(size_t capacity);
+    ~RtpPacketHistory() = default;
+
+    // 只有加入过的ssrc才保存历史
+    void add_ssrc(uint32_t ssrc);
+    bool has_ssrc(uint32_t ssrc) { return _streams.find(ssrc) != _streams.end(); }
+    void clear() { _streams.clear(); }
+
+    // 保存一个包，已经收到过的包返回false(重复包)
+    bool put(const char* data, size_t len);
+    std::shared_ptr<const HistoryPacket> get(uint32_t ssrc, uint16_t seq);
+    // 序号是否还在历史窗口内(比最新的包旧不超过capacity)
+    bool in_window(uint32_t ssrc, uint16_t seq);
+
+    // 服务器自己也没有收到的包，向推流端请求；
+    // 同一个序号在interval_ms内只请求一次，返回是否需要请求
+    bool should_request(uint32_t ssrc, uint16_t seq, int64_t now_ms, int64_t interval_ms);
+
+private:
+    struct Slot {
+        uint16_t seq = 0;
+        bool valid = false;
+        int64_t request_ms = -1; // 向推流端请求的时间，对应seq
+        std::shared_ptr<HistoryPacket> packet;
+    };
+
+    struct Stream {
+        std::vector<Slot> slots;
+        uint16_t highest_seq = 0;
+        bool has_packet = false;
+    };
+
+    Stream* _find_stream(uint32_t ssrc);
+
+private:
+    size_t _mask;
+    std::unordered_map<uint32_t, Stream> _streams;
+};
+
+} // namespace xrtc
+
+#endif // __MODULE_RTP_PACKET_HISTORY_H_
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include <rtc_base/byte_io.h>
 #include "module/rtp_rtcp/rtp_utils.h"
 #include "api/array_view.h"
@@ -45,10 +47,236 @@ uint16_t parse_rtp_sequence_number(rtc::ArrayView<const uint8_t> packet) {
     return rtc::ByteReader<uint16_t>::ReadBigEndian(packet.data() + 2); // rtp包的第二和第三个字节是sequence_num
 }
 
+uint32_t parse_rtp_timestamp(rtc::ArrayView<const uint8_t> packet) {
+    return rtc::ByteReader<uint32_t>::ReadBigEndian(packet.data() + 4);
+}
+
 uint32_t parse_rtp_ssrc(rtc::ArrayView<const uint8_t> packet) {
     return rtc::ByteReader<uint32_t>::ReadBigEndian(packet.data() + 8);
 }
 
+uint8_t parse_rtp_payload_type(rtc::ArrayView<const uint8_t> packet) {
+    return packet[1] & 0x7F;
+}
+
+bool parse_rtp_layout(rtc::ArrayView<const uint8_t> packet, size_t* header_len,
+        size_t* payload_len)
+{
+    if (packet.size() < k_min_rtp_packet_len) {
+        return false;
+    }
+
+    size_t len = k_min_rtp_packet_len + (packet[0] & 0x0F) * 4;
+    if (packet[0] & 0x10) { // 扩展头
+        if (len + 4 > packet.size()) {
+            return false;
+        }
+        len += 4 + rtc::ByteReader<uint16_t>::ReadBigEndian(packet.data() + len + 2) * 4;
+    }
+
+    size_t padding = 0;
+    if (packet[0] & 0x20) {
+        padding = packet[packet.size() - 1];
+    }
+
+    if (len + padding > packet.size()) {
+        return false;
+    }
+
+    *header_len = len;
+    *payload_len = packet.size() - len - padding;
+    return true;
+}
+
+size_t build_rtx_packet(rtc::ArrayView<const uint8_t> packet, uint8_t rtx_pt,
+        uint32_t rtx_ssrc, uint16_t rtx_seq, uint8_t* buf, size_t max_len)
+{
+    size_t header_len = 0;
+    size_t payload_len = 0;
+    if (!parse_rtp_layout(packet, &header_len, &payload_len) ||
+            header_len + 2 + payload_len > max_len)
+    {
+        return 0;
+    }
+
+    memcpy(buf, packet.data(), header_len);
+    buf[0] &= ~0x20;
+    buf[1] = (buf[1] & 0x80) | (rtx_pt & 0x7F);
+    rtc::ByteWriter<uint16_t>::WriteBigEndian(buf + 2, rtx_seq);
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 8, rtx_ssrc);
+    memcpy(buf + header_len, packet.data() + 2, 2); // OSN
+    memcpy(buf + header_len + 2, packet.data() + header_len, payload_len);
+    return header_len + 2 + payload_len;
+}
+
+size_t restore_rtx_packet(rtc::ArrayView<const uint8_t> packet, uint8_t media_pt,
+        uint32_t media_ssrc, uint8_t* buf, size_t max_len)
+{
+    size_t header_len = 0;
+    size_t payload_len = 0;
+    if (!parse_rtp_layout(packet, &header_len, &payload_len) ||
+            payload_len <= 2 || header_len + payload_len - 2 > max_len)
+    {
+        return 0;
+    }
+
+    memcpy(buf, packet.data(), header_len);
+    buf[0] &= ~0x20;
+    buf[1] = (buf[1] & 0x80) | (media_pt & 0x7F);
+    memcpy(buf + 2, packet.data() + header_len, 2); // OSN
+    rtc::ByteWriter<uint32_t>::WriteBigEndian(buf + 8, media_ssrc);
+    memcpy(buf + header_len, packet.data() + header_len + 2, payload_len - 2);
+    return header_len + payload_len - 2;
+}
+
+size_t set_rtp_transport_sequence_number(uint8_t* packet, size_t len, size_t capacity,
+        int ext_id, uint16_t seq)
+{
+    if (len < k_min_rtp_packet_len) {
+        return 0;
+    }
+
+    // 扩展元素: ID(4) + L(4, 长度减1) + 序号(16)，加一个字节padding凑齐4字节
+    uint8_t element[4] = {(uint8_t)((ext_id << 4) | 0x01), (uint8_t)(seq >> 8),
+        (uint8_t)(seq & 0xFF), 0};
+
+    size_t ext_offset = k_min_rtp_packet_len + (packet[0] & 0x0F) * 4;
+    if (!(packet[0] & 0x10)) {
+        if (ext_offset > len || len + 8 > capacity) {
+            return 0;
+        }
+
+        memmove(packet + ext_offset + 8, packet + ext_offset, len - ext_offset);
+        packet[0] |= 0x10;
+        rtc::ByteWriter<uint16_t>::WriteBigEndian(packet + ext_offset, 0xBEDE);
+        rtc::ByteWriter<uint16_t>::WriteBigEndian(packet + ext_offset + 2, 1);
+        memcpy(packet + ext_offset + 4, element, sizeof(element));
+        return len + 8;
+    }
+
+    if (ext_offset + 4 > len ||
+            rtc::ByteReader<uint16_t>::ReadBigEndian(packet + ext_offset) != 0xBEDE)
+    {
+        return 0;
+    }
+
+    size_t words = rtc::ByteReader<uint16_t>::ReadBigEndian(packet + ext_offset + 2);
+    size_t begin = ext_offset + 4;
+    size_t end = begin + words * 4;
+    if (end > len) {
+        return 0;
+    }
+
+    size_t pos = begin;
+    while (pos < end) {
+        uint8_t id = packet[pos] >> 4;
+        if (0 == id) { // padding
+            ++pos;
+            continue;
+        }
+
+        if (15 == id) {
+            break;
+        }
+
+        size_t element_len = (packet[pos] & 0x0F) + 1;
+        if (id == ext_id && 2 == element_len && pos + 3 <= end) {
+            packet[pos + 1] = element[1];
+            packet[pos + 2] = element[2];
+            return len;
+        }
+        pos += 1 + element_len;
+    }
+
+    // 追加到扩展的末尾
+    if (len + 4 > capacity) {
+        return 0;
+    }
+
+    memmove(packet + end + 4, packet + end, len - end);
+    memcpy(packet + end, element, sizeof(element));
+    rtc::ByteWriter<uint16_t>::WriteBigEndian(packet + ext_offset + 2, words + 1);
+    return len + 4;
+}
+
+bool find_rtp_header_extension(rtc::ArrayView<const uint8_t> packet, int ext_id,
+        const uint8_t** data, size_t* len)
+{
+    if (packet.size() < k_min_rtp_packet_len || !(packet[0] & 0x10) || ext_id <= 0) {
+        return false;
+    }
+
+    size_t ext_offset = k_min_rtp_packet_len + (packet[0] & 0x0F) * 4;
+    if (ext_offset + 4 > packet.size()) {
+        return false;
+    }
+
+    uint16_t profile = rtc::ByteReader<uint16_t>::ReadBigEndian(packet.data() + ext_offset);
+    size_t words = rtc::ByteReader<uint16_t>::ReadBigEndian(packet.data() + ext_offset + 2);
+    size_t pos = ext_offset + 4;
+    size_t end = pos + words * 4;
+    if (end > packet.size()) {
+        return false;
+    }
+
+    // one-byte: 0xBEDE，ID(4) + L(4)；two-byte: 0x100X，ID(8) + L(8)
+    bool one_byte = 0xBEDE == profile;
+    if (!one_byte && (profile & 0xFFF0) != 0x1000) {
+        return false;
+    }
+
+    while (pos < end) {
+        if (0 == packet[pos]) { // padding
+            ++pos;
+            continue;
+        }
+
+        int id = 0;
+        size_t element_len = 0;
+        if (one_byte) {
+            id = packet[pos] >> 4;
+            if (15 == id) {
+                return false;
+            }
+            element_len = (packet[pos] & 0x0F) + 1;
+            ++pos;
+        } else {
+            if (pos + 2 > end) {
+                return false;
+            }
+            id = packet[pos];
+            element_len = packet[pos + 1];
+            pos += 2;
+        }
+
+        if (pos + element_len > end) {
+            return false;
+        }
+
+        if (id == ext_id) {
+            *data = packet.data() + pos;
+            *len = element_len;
+            return true;
+        }
+        pos += element_len;
+    }
+
+    return false;
+}
+
+uint32_t parse_rtcp_ssrc(rtc::ArrayView<const uint8_t> packet) {
+    if (packet.size() < 8) {
+        return 0;
+    }
+
+    uint8_t type = packet[1];
+    if ((205 == type || 206 == type) && packet.size() >= 12) {
+        return rtc::ByteReader<uint32_t>::ReadBigEndian(packet.data() + 8);
+    }
+
+    return rtc::ByteReader<uint32_t>::ReadBigEndian(packet.data() + 4);
+}
+
 bool get_rtcp_type(const void* data, size_t len, int* type) {
     if (len < k_min_rtcp_packet_len) {
         return false;
@@ -5,6 +5,10 @@
 
 namespace xrtc {
 
+// 服务器协商的编码(opus, H264/VP8/VP9/AV1)的时钟频率
+const int k_audio_clockrate = 48000;
+const int k_video_clockrate = 90000;
+
 enum class RtpPacketType {
     k_rtp,
     k_rtcp,
@@ -15,8 +19,36 @@ RtpPacketType infer_rtp_packet_type(rtc::ArrayView<const char> packet);
 
 uint16_t parse_rtp_sequence_number(rtc::ArrayView<const uint8_t> packet);
 
+uint32_t parse_rtp_timestamp(rtc::ArrayView<const uint8_t> packet);
+
 uint32_t parse_rtp_ssrc(rtc::ArrayView<const uint8_t> packet);
 
+uint8_t parse_rtp_payload_type(rtc::ArrayView<const uint8_t> packet);
+
+// 解析RTP头(含CSRC和扩展)的长度以及去掉padding后的payload长度，格式错误返回false
+bool parse_rtp_layout(rtc::ArrayView<const uint8_t> packet, size_t* header_len,
+        size_t* payload_len);
+
+// rfc4588: RTX包的payload = 原始序号(OSN) + 原始payload，padding被去掉。
+// 返回新包的长度，失败返回0
+size_t build_rtx_packet(rtc::ArrayView<const uint8_t> packet, uint8_t rtx_pt,
+        uint32_t rtx_ssrc, uint16_t rtx_seq, uint8_t* buf, size_t max_len);
+// 从RTX包恢复原始包，只有padding的RTX包(带宽探测)返回0
+size_t restore_rtx_packet(rtc::ArrayView<const uint8_t> packet, uint8_t media_pt,
+        uint32_t media_ssrc, uint8_t* buf, size_t max_len);
+
+// rfc8285 one-byte头扩展中写入transport-wide序号(draft-holmer-rmcat-transport-wide-cc)，
+// 已有该扩展时覆盖，没有时插入。返回新包的长度，空间不够或者是two-byte扩展时返回0
+size_t set_rtp_transport_sequence_number(uint8_t* packet, size_t len, size_t capacity,
+        int ext_id, uint16_t seq);
+
+// rfc8285 查找one-byte或two-byte头扩展中id对应的元素，返回元素数据的位置和长度
+bool find_rtp_header_extension(rtc::ArrayView<const uint8_t> packet, int ext_id,
+        const uint8_t** data, size_t* len);
+
+// 反馈报文(RTPFB/PSFB)返回媒体源的ssrc，其他报文返回发送者的ssrc，长度不够返回0
+uint32_t parse_rtcp_ssrc(rtc::ArrayView<const uint8_t> packet);
+
 bool get_rtcp_type(const void* data, size_t len, int* type);
 
 } // namespace xrtc
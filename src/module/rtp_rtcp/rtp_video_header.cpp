@@ -0,0 +1,201 @@
+#include "module/rtp_rtcp/rtp_video_header.h"
+
+#include <strings.h>
+
+namespace xrtc {
+
+// H264 NAL类型
+const uint8_t k_h264_idr = 5;
+const uint8_t k_h264_sps = 7;
+const uint8_t k_h264_pps = 8;
+const uint8_t k_h264_stap_a = 24;
+const uint8_t k_h264_fu_a = 28;
+
+VideoCodecType video_codec_type(const std::string& name) {
+    if (0 == strcasecmp(name.c_str(), "VP8")) {
+        return VideoCodecType::k_vp8;
+    } else if (0 == strcasecmp(name.c_str(), "VP9")) {
+        return VideoCodecType::k_vp9;
+    } else if (0 == strcasecmp(name.c_str(), "H264")) {
+        return VideoCodecType::k_h264;
+    } else if (0 == strcasecmp(name.c_str(), "AV1")) {
+        return VideoCodecType::k_av1;
+    }
+
+    return VideoCodecType::k_unknown;
+}
+
+static bool is_h264_key_nal(uint8_t nal_type) {
+    return k_h264_idr == nal_type || k_h264_sps == nal_type || k_h264_pps == nal_type;
+}
+
+// rfc6184，关键帧前面通常是SPS/PPS(单独或者STAP-A)，之后是IDR
+static bool parse_h264(const uint8_t* payload, size_t len, RtpVideoHeader* header) {
+    uint8_t nal_type = payload[0] & 0x1F;
+    if (k_h264_stap_a == nal_type) {
+        size_t offset = 1;
+        while (offset + 2 < len) {
+            size_t nal_len = ((size_t)payload[offset] << 8) | payload[offset + 1];
+            if (0 == nal_len || offset + 2 + nal_len > len) {
+                return false;
+            }
+
+            if (is_h264_key_nal(payload[offset + 2] & 0x1F)) {
+                header->keyframe = true;
+            }
+            offset += 2 + nal_len;
+        }
+
+        header->frame_start = true;
+    } else if (k_h264_fu_a == nal_type) {
+        if (len < 2) {
+            return false;
+        }
+
+        header->frame_start = (payload[1] & 0x80) != 0;
+        header->keyframe = header->frame_start && is_h264_key_nal(payload[1] & 0x1F);
+    } else if (nal_type > 0 && nal_type < k_h264_stap_a) {
+        header->frame_start = true;
+        header->keyframe = is_h264_key_nal(nal_type);
+    }
+
+    return true;
+}
+
+// M位为1时是15位的PictureID
+static bool parse_picture_id(const uint8_t* payload, size_t len, size_t* offset,
+        RtpVideoHeader* header)
+{
+    if (*offset >= len) {
+        return false;
+    }
+
+    header->picture_id_offset = *offset;
+    if (payload[*offset] & 0x80) {
+        if (*offset + 2 > len) {
+            return false;
+        }
+        header->picture_id = ((payload[*offset] & 0x7F) << 8) | payload[*offset + 1];
+        header->picture_id_15bit = true;
+        *offset += 2;
+    } else {
+        header->picture_id = payload[*offset];
+        *offset += 1;
+    }
+
+    return true;
+}
+
+// rfc7741
+//  |X|R|N|S|R| PID | (扩展)|I|L|T|K| RSV | ...
+static bool parse_vp8(const uint8_t* payload, size_t len, RtpVideoHeader* header) {
+    size_t offset = 1;
+    if (payload[0] & 0x80) {
+        if (len < 2) {
+            return false;
+        }
+
+        uint8_t ext = payload[1];
+        offset = 2;
+        if (ext & 0x80) { // PictureID
+            if (!parse_picture_id(payload, len, &offset, header)) {
+                return false;
+            }
+        }
+        if (ext & 0x40) { // TL0PICIDX
+            if (offset >= len) {
+                return false;
+            }
+            header->tl0_pic_idx = payload[offset];
+            header->tl0_pic_idx_offset = offset;
+            ++offset;
+        }
+        if (ext & 0x30) { // TID/KEYIDX
+            ++offset;
+        }
+    }
+
+    if (offset >= len) {
+        return false;
+    }
+
+    // 第一个分区的开始，VP8 payload header的P位为0表示关键帧
+    header->frame_start = (payload[0] & 0x10) && 0 == (payload[0] & 0x07);
+    header->keyframe = header->frame_start && 0 == (payload[offset] & 0x01);
+    return true;
+}
+
+// draft-ietf-payload-vp9
+//  |I|P|L|F|B|E|V|Z| ... 层信息 |TID|U| SID |D|
+static bool parse_vp9(const uint8_t* payload, size_t len, RtpVideoHeader* header) {
+    uint8_t flags = payload[0];
+    size_t offset = 1;
+    if (flags & 0x80) { // PictureID
+        if (!parse_picture_id(payload, len, &offset, header)) {
+            return false;
+        }
+    }
+
+    int spatial_id = 0;
+    if (flags & 0x20) {
+        if (offset >= len) {
+            return false;
+        }
+        header->has_layers = true;
+        header->temporal_id = payload[offset] >> 5;
+        spatial_id = (payload[offset] >> 1) & 0x07;
+        header->spatial_id = spatial_id;
+
+        // 非flexible模式下层信息之后是TL0PICIDX
+        if (0 == (flags & 0x10)) {
+            if (offset + 1 >= len) {
+                return false;
+            }
+            header->tl0_pic_idx = payload[offset + 1];
+            header->tl0_pic_idx_offset = offset + 1;
+        }
+    }
+
+    // 超帧从空间层0开始，P位为0表示不参考之前的帧
+    header->frame_start = (flags & 0x08) && 0 == spatial_id;
+    header->keyframe = header->frame_start && 0 == (flags & 0x40);
+    header->frame_end = (flags & 0x04) != 0;
+    return true;
+}
+
+// AV1 RTP规范 4.4 聚合头
+//  |Z|Y| W |N|-|-|-|
+// Z为1表示第一个OBU接着上一个包，N为1表示新的编码序列(关键帧)的第一个包
+static bool parse_av1(const uint8_t* payload, size_t len, RtpVideoHeader* header) {
+    if (len < 2) {
+        return false;
+    }
+
+    header->frame_start = 0 == (payload[0] & 0x80);
+    header->keyframe = header->frame_start && (payload[0] & 0x08);
+    return true;
+}
+
+bool parse_rtp_video_header(VideoCodecType codec, const uint8_t* payload, size_t len,
+        RtpVideoHeader* header)
+{
+    *header = RtpVideoHeader();
+    if (0 == len) {
+        return false;
+    }
+
+    switch (codec) {
+        case VideoCodecType::k_h264:
+            return parse_h264(payload, len, header);
+        case VideoCodecType::k_vp8:
+            return parse_vp8(payload, len, header);
+        case VideoCodecType::k_vp9:
+            return parse_vp9(payload, len, header);
+        case VideoCodecType::k_av1:
+            return parse_av1(payload, len, header);
+        default:
+            return false;
+    }
+}
+
+} // namespace xrtc
@@ -0,0 +1,47 @@
+#ifndef __MODULE_RTP_VIDEO_HEADER_H_
+#define __MODULE_RTP_VIDEO_HEADER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace xrtc {
+
+enum class VideoCodecType {
+    k_unknown,
+    k_vp8,
+    k_vp9,
+    k_h264,
+    k_av1,
+};
+
+// SDP中的编码名(不区分大小写)
+VideoCodecType video_codec_type(const std::string& name);
+
+// 从RTP payload的描述符(VP8/VP9)、NAL头(H264)或聚合头(AV1)中解析出的帧信息
+struct RtpVideoHeader {
+    bool frame_start = false; // 帧(H264是NAL，AV1是OBU)的第一个包
+    bool keyframe = false;    // frame_start时有效
+
+    // VP9的层信息，AV1的层在依赖描述符(头扩展)中
+    bool has_layers = false;
+    int spatial_id = 0;
+    int temporal_id = 0;
+    bool frame_end = false;   // 空间层帧的最后一个包(E位)
+
+    // VP8/VP9的PictureID和TL0PICIDX，没有时为-1。offset是在payload中的位置，
+    // 切换simulcast层时按订阅者改写
+    int picture_id = -1;
+    bool picture_id_15bit = false;
+    size_t picture_id_offset = 0;
+    int tl0_pic_idx = -1;
+    size_t tl0_pic_idx_offset = 0;
+};
+
+// payload不含RTP头和padding，格式错误返回false
+bool parse_rtp_video_header(VideoCodecType codec, const uint8_t* payload, size_t len,
+        RtpVideoHeader* header);
+
+} // namespace xrtc
+
+#endif // __MODULE_RTP_VIDEO_HEADER_H_
@@ -0,0 +1,90 @@
+#include "module/rtp_rtcp/transport_feedback.h"
+
+#include <rtc_base/byte_io.h>
+
+namespace xrtc {
+
+const size_t k_transport_feedback_header_len = 20;
+// 包的状态，0表示没有收到
+const uint8_t k_status_small_delta = 1;
+const uint8_t k_status_large_delta = 2;
+// 时间单位
+const int64_t k_reference_time_us = 64000;
+const int64_t k_delta_us = 250;
+
+bool parse_rtcp_transport_feedback(const RtcpBlock& block, TransportFeedback* feedback) {
+    if (block.type != k_rtcp_type_rtpfb || block.fmt != k_rtcp_fmt_transport_cc ||
+            block.len < k_transport_feedback_header_len)
+    {
+        return false;
+    }
+
+    const uint8_t* p = block.data;
+    feedback->sender_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(p + 4);
+    feedback->media_ssrc = rtc::ByteReader<uint32_t>::ReadBigEndian(p + 8);
+    feedback->base_seq = rtc::ByteReader<uint16_t>::ReadBigEndian(p + 12);
+    size_t status_count = rtc::ByteReader<uint16_t>::ReadBigEndian(p + 14);
+    int64_t reference_time = rtc::ByteReader<int32_t, 3>::ReadBigEndian(p + 16);
+    feedback->feedback_count = p[19];
+    feedback->packets.clear();
+
+    // packet chunk: 游程编码(0 + S(2) + 长度(13))或者状态向量(1 + 符号大小(1) + 符号)
+    std::vector<uint8_t> statuses;
+    statuses.reserve(status_count);
+    size_t pos = k_transport_feedback_header_len;
+    while (statuses.size() < status_count) {
+        if (pos + 2 > block.len) {
+            return false;
+        }
+
+        uint16_t chunk = rtc::ByteReader<uint16_t>::ReadBigEndian(p + pos);
+        pos += 2;
+        if (0 == (chunk & 0x8000)) {
+            uint8_t status = (chunk >> 13) & 0x03;
+            size_t run = chunk & 0x1FFF;
+            for (size_t i = 0; i < run && statuses.size() < status_count; ++i) {
+                statuses.push_back(status);
+            }
+        } else if (0 == (chunk & 0x4000)) {
+            for (int i = 13; i >= 0 && statuses.size() < status_count; --i) {
+                statuses.push_back((chunk >> i) & 0x01);
+            }
+        } else {
+            for (int i = 12; i >= 0 && statuses.size() < status_count; i -= 2) {
+                statuses.push_back((chunk >> i) & 0x03);
+            }
+        }
+    }
+
+    // 接收时间差: 小的1字节无符号，大的2字节有符号，单位250us
+    int64_t recv_time_us = reference_time * k_reference_time_us;
+    uint16_t seq = feedback->base_seq;
+    for (uint8_t status : statuses) {
+        TransportFeedback::Packet packet;
+        packet.seq = seq++;
+        if (k_status_small_delta == status) {
+            if (pos + 1 > block.len) {
+                return false;
+            }
+            recv_time_us += p[pos] * k_delta_us;
+            pos += 1;
+        } else if (k_status_large_delta == status) {
+            if (pos + 2 > block.len) {
+                return false;
+            }
+            recv_time_us += rtc::ByteReader<int16_t>::ReadBigEndian(p + pos) * k_delta_us;
+            pos += 2;
+        }
+
+        // 3是保留值，按丢失处理
+        if (k_status_small_delta == status || k_status_large_delta == status) {
+            packet.received = true;
+            packet.recv_time_us = recv_time_us;
+        }
+        feedback->packets.push_back(packet);
+    }
+
+    return true;
+}
+
+} // namespace xrtc
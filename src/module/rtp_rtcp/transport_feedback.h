@@ -0,0 +1,33 @@
+#ifndef __MODULE_TRANSPORT_FEEDBACK_H_
+#define __MODULE_TRANSPORT_FEEDBACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "module/rtp_rtcp/rtcp_feedback.h"
+
+namespace xrtc {
+
+const uint8_t k_rtcp_fmt_transport_cc = 15;
+
+// draft-holmer-rmcat-transport-wide-cc-extensions-01
+struct TransportFeedback {
+    struct Packet {
+        uint16_t seq = 0;
+        bool received = false;
+        int64_t recv_time_us = 0; // 接收端时钟，只有received时有效
+    };
+
+    uint32_t sender_ssrc = 0;
+    uint32_t media_ssrc = 0;
+    uint16_t base_seq = 0;
+    uint8_t feedback_count = 0;
+    std::vector<Packet> packets; // 按序号排列，包括丢失的包
+};
+
+bool parse_rtcp_transport_feedback(const RtcpBlock& block, TransportFeedback* feedback);
+
+} // namespace xrtc
+
+#endif // __MODULE_TRANSPORT_FEEDBACK_H_
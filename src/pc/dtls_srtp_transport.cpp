@@ -1,16 +1,20 @@
 #include <rtc_base/logging.h>
 #include <rtc_base/buffer.h>
+#include <rtc_base/time_utils.h>
 
 #include "module/rtp_rtcp/rtp_utils.h"
 #include "api/array_view.h"
 #include "pc/dtls_transport.h"
-#include "rtc_base/copy_on_write_buffer.h"
 #include "pc/dtls_srtp_transport.h"
 
 namespace xrtc {
 
-// rfc5764
-static char k_dtls_srtp_exporter_label[] = "EXTRACTOR-dtls_srtp";
+// 写入头扩展时给SRTP认证tag保留的空间
+const size_t k_srtp_trailer_reserve = 32;
+
+static rtc::ArrayView<const uint8_t> rtp_view(const char* data, size_t len) {
+    return rtc::MakeArrayView((const uint8_t*)data, len);
+}
 
 DtlsSrtpTransport::DtlsSrtpTransport(const std::string& transport_name,
         bool rtcp_mux_enabled) :
@@ -46,7 +50,7 @@ void DtlsSrtpTransport::_on_dtls_state(DtlsTransport* /*dtls*/,
     _maybe_setup_dtls_srtp();
 }
 
-void DtlsSrtpTransport::_on_read_packet(DtlsTransport* /*dtls*/,
+void DtlsSrtpTransport::_on_read_packet(DtlsTransport* dtls,
         const char*data, size_t len, int64_t ts)
 {
     auto array_view = rtc::MakeArrayView(data, len);
@@ -56,24 +60,30 @@ void DtlsSrtpTransport::_on_read_packet(DtlsTransport* /*dtls*/,
         return;
     }
 
-    rtc::CopyOnWriteBuffer packet(data, len);
+    // 拷贝到缓冲池的slot中原地解密，避免每个包分配内存
+    PacketBuffer packet;
+    if (!packet.set_data(data, len)) {
+        RTC_LOG(LS_WARNING) << "Received packet too large, size=" << len;
+        return;
+    }
+
     if (packet_type == RtpPacketType::k_rtcp) {
-        _on_rtcp_packet_received(std::move(packet), ts);
+        _on_rtcp_packet_received(dtls, &packet, ts);
     } else {
-        _on_rtp_packet_received(std::move(packet), ts);
+        _on_rtp_packet_received(dtls, &packet, ts);
     }
 }
 
-void DtlsSrtpTransport::_on_rtcp_packet_received(rtc::CopyOnWriteBuffer packet,
-        int64_t ts)
+void DtlsSrtpTransport::_on_rtcp_packet_received(DtlsTransport* dtls,
+        PacketBuffer* packet, int64_t ts)
 {
     if (!is_srtp_active()) {
         RTC_LOG(LS_WARNING) << "Inactive SRTP transport received a rtcp packet, drop it.";
         return;
     }
 
-    char* data = packet.data<char>();
-    int len = packet.size();
+    char* data = packet->data();
+    int len = packet->size();
 
     if (!unprotect_rtcp(data, len, &len)) {
         int type = 0;
@@ -84,36 +94,43 @@ void DtlsSrtpTransport::_on_rtcp_packet_received(rtc::CopyOnWriteBuffer packet,
         return;
     }
 
-    packet.SetSize(len);
-    signal_rtcp_packet_received(this, &packet, ts);
+    dtls->ice_channel()->on_media_received();
+    packet->set_size(len);
+    signal_rtcp_packet_received(this, packet, ts);
 }
 
-void DtlsSrtpTransport::_on_rtp_packet_received(rtc::CopyOnWriteBuffer packet,
-        int64_t ts)
+void DtlsSrtpTransport::_on_rtp_packet_received(DtlsTransport* dtls,
+        PacketBuffer* packet, int64_t ts)
 {
     if (!is_srtp_active()) {
         RTC_LOG(LS_WARNING) << "Inactive SRTP transport received a rtp packet, drop it.";
         return;
     }
 
-    char* data = packet.data<char>();
-    int len = packet.size();
+    char* data = packet->data();
+    int len = packet->size();
 
     if (!unprotect_rtp(data, len, &len)) {
         const int k_fail_log = 100;
         if (_unprotect_fail_count % k_fail_log == 0) {
+            SrtpUnprotectStats stats = unprotect_stats();
             RTC_LOG(LS_WARNING) << "Failed to unprotect rtp packet: "
                 << ", size=" << len
-                << ", seqnum=" << parse_rtp_sequence_number(packet)
-                << ", ssrc=" << parse_rtp_ssrc(packet)
-                << ", _unprotect_fail_count=" << _unprotect_fail_count;
+                << ", seqnum=" << parse_rtp_sequence_number(rtp_view(data, len))
+                << ", ssrc=" << parse_rtp_ssrc(rtp_view(data, len))
+                << ", _unprotect_fail_count=" << _unprotect_fail_count
+                << ", replay=" << stats.replay
+                << ", auth=" << stats.auth
+                << ", roc=" << stats.roc
+                << ", other=" << stats.other;
         }
         _unprotect_fail_count++;
         return;
     }
 
-    packet.SetSize(len);
-    signal_rtp_packet_received(this, &packet, ts);
+    dtls->ice_channel()->on_media_received();
+    packet->set_size(len);
+    signal_rtp_packet_received(this, packet, ts);
 }
 
 int DtlsSrtpTransport::send_rtp(const char* buf, size_t size) {
@@ -122,26 +139,135 @@ int DtlsSrtpTransport::send_rtp(const char* buf, size_t size) {
         return -1;
     }
 
-    int rtp_auth_tag_len = 0;
-    get_send_auth_tag_len(&rtp_auth_tag_len, nullptr);
-    rtc::CopyOnWriteBuffer packet(buf, size, size + rtp_auth_tag_len);
-    
-    char* data = (char*)packet.data();
+    // 在缓冲池的slot中原地加密，slot预留了认证tag的空间
+    PacketBuffer packet;
+    if (!packet.set_data(buf, size)) {
+        RTC_LOG(LS_WARNING) << "Failed to send rtp packet: too large, size=" << size;
+        return -1;
+    }
+
+    if (_bwe) {
+        _stamp_transport_cc(packet, rtc::TimeMicros());
+    }
+
+    char* data = packet.data();
     int len = packet.size();
-    uint16_t seq_num = parse_rtp_sequence_number(packet);
+    uint16_t seq_num = parse_rtp_sequence_number(rtp_view(data, len));
     if (!protect_rtp(data, len, packet.capacity(), &len)) {
         RTC_LOG(LS_WARNING) << "Failed to protect rtp packet, size=" << len
             << ", seqnum=" << seq_num
-            << ", ssrc=" << parse_rtp_ssrc(packet)
+            << ", ssrc=" << parse_rtp_ssrc(rtp_view(data, len))
             << ", last_send_seq_num=" << _last_send_seq_num;
         return -1;
     }
 
     _last_send_seq_num = seq_num;
 
-    packet.SetSize(len);
+    return _rtp_dtls_transport->send_packet(data, len);
+}
 
-    return _rtp_dtls_transport->send_packet((const char*)packet.cdata(), packet.size());
+int DtlsSrtpTransport::send_rtp_batch(const std::vector<DtlsSrtpTransport*>& transports,
+        const char* data, size_t len)
+{
+    // 线程内复用，避免每个包分配内存
+    static thread_local std::vector<PacketBuffer> buffers;
+    static thread_local std::vector<DtlsSrtpTransport*> targets;
+
+    buffers.clear();
+    targets.clear();
+
+    for (auto transport : transports) {
+        if (!transport->is_srtp_active()) {
+            continue;
+        }
+
+        buffers.emplace_back();
+        if (!buffers.back().set_data(data, len)) {
+            RTC_LOG(LS_WARNING) << "Failed to send rtp packet: too large, size=" << len;
+            buffers.clear();
+            targets.clear();
+            return 0;
+        }
+        targets.push_back(transport);
+    }
+
+    // 发送后立即把slot还给缓冲池。thread_local的vector在线程退出时才析构，
+    // 不清空的话slot会一直被占用，而且可能在缓冲池析构之后才归还
+    int sent = send_rtp_batch(targets, buffers);
+    buffers.clear();
+    targets.clear();
+    return sent;
+}
+
+int DtlsSrtpTransport::send_rtp_batch(const std::vector<DtlsSrtpTransport*>& transports,
+        std::vector<PacketBuffer>& packets)
+{
+    static thread_local std::vector<SrtpProtectItem> items;
+    static thread_local std::vector<DtlsSrtpTransport*> targets;
+
+    items.clear();
+    targets.clear();
+
+    int64_t now_us = rtc::TimeMicros();
+    for (size_t i = 0; i < transports.size() && i < packets.size(); ++i) {
+        DtlsSrtpTransport* transport = transports[i];
+        if (!transport->is_srtp_active()) {
+            continue;
+        }
+
+        // transport-wide序号每个transport各自分配，在各自的拷贝上写入
+        PacketBuffer& packet = packets[i];
+        if (transport->_bwe) {
+            transport->_stamp_transport_cc(packet, now_us);
+        }
+
+        // vector扩容只移动PacketBuffer对象，slot的地址不变
+        SrtpProtectItem item;
+        item.session = transport->send_session();
+        item.data = packet.data();
+        item.len = packet.size();
+        item.max_len = packet.capacity();
+        items.push_back(item);
+        targets.push_back(transport);
+    }
+
+    SrtpSession::protect_rtp_batch(items.data(), items.size());
+
+    int sent = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (!items[i].ok) {
+            RTC_LOG(LS_WARNING) << "Failed to protect rtp packet in batch, size="
+                << items[i].len << ", transport=" << targets[i]->transport_name();
+            continue;
+        }
+
+        if (targets[i]->_rtp_dtls_transport->send_packet(items[i].data, items[i].len) >= 0) {
+            ++sent;
+        }
+    }
+
+    return sent;
+}
+
+void DtlsSrtpTransport::enable_transport_cc(int ext_id, const BweConfig& config) {
+    _transport_cc_ext_id = ext_id;
+    _bwe.reset(new SendSideBwe(config));
+    RTC_LOG(LS_INFO) << "transport-cc enabled, transport_name: " << _transport_name
+        << ", ext_id: " << ext_id;
+}
+
+void DtlsSrtpTransport::_stamp_transport_cc(PacketBuffer& packet, int64_t now_us) {
+    uint16_t seq = _bwe->next_sequence_number();
+    size_t new_len = set_rtp_transport_sequence_number((uint8_t*)packet.data(),
+            packet.size(), packet.capacity() - k_srtp_trailer_reserve,
+            _transport_cc_ext_id, seq);
+    if (0 == new_len) {
+        // 不带序号照常发送，带宽估计把这个序号当作没有发出
+        return;
+    }
+
+    packet.set_size(new_len);
+    _bwe->on_packet_sent(seq, new_len, now_us);
 }
 
 int DtlsSrtpTransport::send_rtcp(const char* buf, size_t size) {
@@ -150,11 +276,13 @@ int DtlsSrtpTransport::send_rtcp(const char* buf, size_t size) {
         return -1;
     }
 
-    int rtcp_auth_tag_len = 0;
-    get_send_auth_tag_len(nullptr, &rtcp_auth_tag_len);
-    rtc::CopyOnWriteBuffer packet(buf, size, size + rtcp_auth_tag_len + sizeof(uint32_t));
-    
-    char* data = (char*)packet.data();
+    PacketBuffer packet;
+    if (!packet.set_data(buf, size)) {
+        RTC_LOG(LS_WARNING) << "Failed to send rtcp packet: too large, size=" << size;
+        return -1;
+    }
+
+    char* data = packet.data();
     int len = packet.size();
     if (!protect_rtcp(data, len, packet.capacity(), &len)) {
         int type = 0;
@@ -164,9 +292,7 @@ int DtlsSrtpTransport::send_rtcp(const char* buf, size_t size) {
         return -1;
     }
 
-    packet.SetSize(len);
-
-    return _rtp_dtls_transport->send_packet((const char*)packet.cdata(), packet.size());
+    return _rtp_dtls_transport->send_packet(data, len);
 }
 bool DtlsSrtpTransport::is_dtls_writable() {
     auto rtcp_transport = _rtcp_mux_enabled ? nullptr : _rtcp_dtls_transport;
@@ -1,10 +1,13 @@
 #ifndef __DTLS_SRTP_TRANSPORT_H_
 #define __DTLS_SRTP_TRANSPORT_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <rtc_base/buffer.h>
-#include <rtc_base/copy_on_write_buffer.h>
+#include "base/packet_buffer.h"
+#include "module/congestion_controller/send_side_bwe.h"
 #include "pc/srtp_transport.h"
 #include "pc/dtls_transport.h"
 #include "rtc_base/third_party/sigslot/sigslot.h"
@@ -25,10 +28,24 @@ public:
     int send_rtp(const char* data, size_t len);
     int send_rtcp(const char* data, size_t len);
 
+    // 协商了transport-wide-cc扩展时调用，之后每个发出的RTP包都写入
+    // transport-wide序号，并由带宽估计记录发送时间和大小
+    void enable_transport_cc(int ext_id, const BweConfig& config);
+    // 没有协商transport-wide-cc时返回nullptr
+    SendSideBwe* bwe() { return _bwe.get(); }
+
+    // 同一个RTP包发送给多个transport：统一拷贝、批量加密后再逐个发送
+    // 返回成功发送的个数
+    static int send_rtp_batch(const std::vector<DtlsSrtpTransport*>& transports,
+            const char* data, size_t len);
+    // 每个transport发送各自的包(例如已经按订阅者改写了包头)，packets和transports一一对应
+    static int send_rtp_batch(const std::vector<DtlsSrtpTransport*>& transports,
+            std::vector<PacketBuffer>& packets);
+
 public:
-    sigslot::signal3<DtlsSrtpTransport*, rtc::CopyOnWriteBuffer*, int64_t>
+    sigslot::signal3<DtlsSrtpTransport*, PacketBuffer*, int64_t>
         signal_rtp_packet_received;
-    sigslot::signal3<DtlsSrtpTransport*, rtc::CopyOnWriteBuffer*, int64_t>
+    sigslot::signal3<DtlsSrtpTransport*, PacketBuffer*, int64_t>
         signal_rtcp_packet_received;
 
 private:
@@ -40,8 +57,9 @@ private:
     void _setup_dtls_srtp();
     void _on_dtls_state(DtlsTransport* dtls, DtlsTransportState state);
     void _on_read_packet(DtlsTransport* dtls, const char*data, size_t len, int64_t ts);
-    void _on_rtp_packet_received(rtc::CopyOnWriteBuffer packet, int64_t ts);
-    void _on_rtcp_packet_received(rtc::CopyOnWriteBuffer packet, int64_t ts);
+    void _on_rtp_packet_received(DtlsTransport* dtls, PacketBuffer* packet, int64_t ts);
+    void _on_rtcp_packet_received(DtlsTransport* dtls, PacketBuffer* packet, int64_t ts);
+    void _stamp_transport_cc(PacketBuffer& packet, int64_t now_us);
 
 private:
     std::string _transport_name;
@@ -49,6 +67,8 @@ private:
     DtlsTransport* _rtcp_dtls_transport = nullptr;
     int _unprotect_fail_count = 0;
     uint16_t _last_send_seq_num = 0;
+    int _transport_cc_ext_id = 0;
+    std::unique_ptr<SendSideBwe> _bwe;
 };
 
 } // namespace xrtvc
@@ -1,17 +1,71 @@
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <mutex>
+
 #include <rtc_base/logging.h>
+#include <rtc_base/time_utils.h>
 #include <api/crypto/crypto_options.h>
 
+#include "base/conf.h"
+#include "base/event_loop.h"
+#include "base/task_pool.h"
 #include "pc/dtls_transport.h"
+#include "pc/srtp_session.h"
 #include "ice/ice_controller.h"
 #include "rtc_base/stream.h"
 
+extern xrtc::GeneralConf* g_conf;
+extern xrtc::TaskPool* g_dtls_handshake_pool;
+
 namespace xrtc {
 
+const char k_dtls_srtp_exporter_label[] = "EXTRACTOR-dtls_srtp";
+
 const size_t k_dtls_record_header_len = 13;
 const size_t k_max_dtls_packet_len = 2048;
-const size_t k_max_pending_packets = 2;
+// 一次握手flight可能包含多个数据包(证书分片等)，需要能够缓存一整个flight
+const size_t k_max_pending_packets = 16;
 const size_t k_min_rtp_packet_len = 12;
 
+// 每完成多少次握手打印一次汇总
+const uint64_t k_handshake_stats_log_interval = 100;
+
+static int64_t thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 所有worker共用的握手CPU统计
+class DtlsHandshakeStats {
+public:
+    static DtlsHandshakeStats* instance() {
+        static DtlsHandshakeStats stats;
+        return &stats;
+    }
+
+    void add(int64_t cpu_ns) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        ++_handshakes;
+        _total_cpu_ns += cpu_ns;
+        _max_cpu_ns = std::max(_max_cpu_ns, cpu_ns);
+
+        if (_handshakes % k_handshake_stats_log_interval == 0) {
+            RTC_LOG(LS_INFO) << "DTLS handshake stats: handshakes=" << _handshakes
+                << ", avg_cpu_us=" << _total_cpu_ns / _handshakes / 1000
+                << ", max_cpu_us=" << _max_cpu_ns / 1000;
+        }
+    }
+
+private:
+    std::mutex _mtx;
+    uint64_t _handshakes = 0;
+    int64_t _total_cpu_ns = 0;
+    int64_t _max_cpu_ns = 0;
+};
+
 bool is_dtls_packet(const char* buf, size_t len) {
     const uint8_t* u = reinterpret_cast<const uint8_t*>(buf);
     return len >= k_dtls_record_header_len && (u[0] > 19 && u[0] < 64);
@@ -38,16 +92,26 @@ StreamInterfaceChannel::StreamInterfaceChannel(IceTransportChannel* ice_transpor
 }
 
 bool StreamInterfaceChannel::on_received_packet(const char* data, size_t size) {
+    // 队列中还有数据时先入队，保证record的顺序
     if (_packets.size() > 0) {
-        RTC_LOG(LS_INFO) << ": Packet already in buffer queue";
-    }
-
-    if (!_packets.WriteBack(data, size, NULL)) {
-        RTC_LOG(LS_WARNING) << ": Failed to write packet to queue";
+        if (!_packets.WriteBack(data, size, NULL)) {
+            RTC_LOG(LS_WARNING) << ": Failed to write packet to queue";
+        }
+        SignalEvent(this, rtc::SE_READ, 0);
+        return true;
     }
 
+    _current_data = data;
+    _current_size = size;
     SignalEvent(this, rtc::SE_READ, 0);
 
+    if (_current_data) {
+        _current_data = nullptr;
+        if (!_packets.WriteBack(data, size, NULL)) {
+            RTC_LOG(LS_WARNING) << ": Failed to write packet to queue";
+        }
+    }
+
     return true;
 }
 
@@ -68,11 +132,22 @@ rtc::StreamResult StreamInterfaceChannel::Read(void* buffer,
         return rtc::SR_BLOCK;
     }
 
-    if (!_packets.ReadFront(buffer, buffer_len, read)) {
-        return rtc::SR_BLOCK;
+    if (_packets.ReadFront(buffer, buffer_len, read)) {
+        return rtc::SR_SUCCESS;
     }
 
-    return rtc::SR_SUCCESS;
+    if (_current_data) {
+        size_t len = std::min(buffer_len, _current_size);
+        memcpy(buffer, _current_data, len);
+        if (read) {
+            *read = len;
+        }
+        _current_data = nullptr;
+        _current_size = 0;
+        return rtc::SR_SUCCESS;
+    }
+
+    return rtc::SR_BLOCK;
 }
 
 rtc::StreamResult StreamInterfaceChannel::Write(const void* data,
@@ -80,7 +155,12 @@ rtc::StreamResult StreamInterfaceChannel::Write(const void* data,
                            size_t* written,
                            int* /*error*/)
 {
-    _ice_channel->send_packet(static_cast<const char*>(data), data_len);
+    if (_write_cb) {
+        _write_cb(static_cast<const char*>(data), data_len);
+    } else {
+        _ice_channel->send_packet(static_cast<const char*>(data), data_len);
+    }
+
     if (written) {
         *written = data_len;
     }
@@ -90,10 +170,124 @@ rtc::StreamResult StreamInterfaceChannel::Write(const void* data,
 
 void StreamInterfaceChannel::Close() {
     _state = rtc::SS_CLOSED;
+    _current_data = nullptr;
+    _current_size = 0;
     _packets.Clear();
 }
 
 
+// 配置的SRTP套件过滤掉libsrtp不支持的之后只计算一次，所有worker共用
+static const std::vector<int>& get_srtp_crypto_suites() {
+    static const std::vector<int> suites = []() {
+        if (g_conf->srtp_crypto_suites.empty()) {
+            webrtc::CryptoOptions crypto_options;
+            return crypto_options.GetSupportedDtlsSrtpCryptoSuites();
+        }
+        return SrtpSession::get_supported_crypto_suites(g_conf->srtp_crypto_suites);
+    }();
+    return suites;
+}
+
+// 卸载到握手线程池的DTLS握手。创建之后dtls只在握手线程上访问，
+// transport只在worker线程上访问，两者之间只传递DTLS record和导出的SRTP密钥
+class DtlsOffloadContext : public sigslot::has_slots<>,
+    public std::enable_shared_from_this<DtlsOffloadContext>
+{
+public:
+    DtlsOffloadContext(DtlsTransport* transport) :
+        transport(transport),
+        el(transport->ice_channel()->event_loop()),
+        key(reinterpret_cast<uintptr_t>(transport) >> 6)
+    {
+    }
+
+    // 在握手线程上执行
+    void post_to_handshake(std::function<void(DtlsOffloadContext*)> task) {
+        auto self = shared_from_this();
+        g_dtls_handshake_pool->post(key, [self, task]() {
+            task(self.get());
+        });
+    }
+
+    // 回到worker线程上执行，transport已经销毁时丢弃
+    void post_to_worker(std::function<void(DtlsTransport*)> task) {
+        auto self = shared_from_this();
+        el->post_task([self, task]() {
+            if (self->transport) {
+                task(self->transport);
+            }
+        });
+    }
+
+    void on_dtls_event(rtc::StreamInterface* /*dtls*/, int sig, int error) {
+        if (sig & rtc::SE_OPEN) {
+            _on_handshake_complete();
+        }
+
+        if (sig & rtc::SE_READ) {
+            char buf[k_max_dtls_packet_len];
+            size_t read;
+            int read_error;
+            rtc::StreamResult ret;
+            do {
+                ret = dtls->Read(buf, sizeof(buf), &read, &read_error);
+                if (ret == rtc::SR_EOS || ret == rtc::SR_ERROR) {
+                    bool is_error = (ret == rtc::SR_ERROR);
+                    post_to_worker([=](DtlsTransport* t) {
+                        t->_on_dtls_read_closed(is_error, read_error);
+                    });
+                }
+            } while (ret == rtc::SR_SUCCESS);
+        }
+
+        if (sig & rtc::SE_CLOSE) {
+            post_to_worker([=](DtlsTransport* t) {
+                t->_on_dtls_stream_closed(error);
+            });
+        }
+    }
+
+    void on_dtls_handshake_error(rtc::SSLHandshakeError err) {
+        RTC_LOG(LS_WARNING) << ": DTLS handshake error=" << (int)err;
+    }
+
+private:
+    // SRTP密钥在握手线程上导出，worker线程上只做拷贝
+    void _on_handshake_complete() {
+        int crypto_suite = rtc::kSrtpInvalidCryptoSuite;
+        std::shared_ptr<rtc::ZeroOnFreeBuffer<uint8_t>> keying_material;
+        int key_len;
+        int salt_len;
+        if (dtls->GetDtlsSrtpCryptoSuite(&crypto_suite) &&
+                rtc::GetSrtpKeyAndSaltLengths(crypto_suite, &key_len, &salt_len))
+        {
+            keying_material = std::make_shared<rtc::ZeroOnFreeBuffer<uint8_t>>(
+                    key_len * 2 + salt_len * 2);
+            if (!dtls->ExportKeyingMaterial(k_dtls_srtp_exporter_label, NULL, 0, false,
+                        keying_material->data(), keying_material->size()))
+            {
+                keying_material.reset();
+            }
+        }
+
+        int64_t cpu_ns = handshake_cpu_ns +
+            (call_start_cpu_ns ? thread_cpu_ns() - call_start_cpu_ns : 0);
+        post_to_worker([=](DtlsTransport* t) {
+            t->_on_offload_handshake_complete(crypto_suite, keying_material, cpu_ns);
+        });
+    }
+
+public:
+    DtlsTransport* transport;
+    EventLoop* el;
+    size_t key;
+    std::unique_ptr<rtc::SSLStreamAdapter> dtls;
+    StreamInterfaceChannel* downward = nullptr;
+    // 只在握手线程上访问
+    int64_t handshake_cpu_ns = 0;
+    int64_t call_start_cpu_ns = 0;
+};
+
 DtlsTransport::DtlsTransport(IceTransportChannel* ice_channel) :
         _ice_channel(ice_channel)
 {
@@ -101,12 +295,24 @@ DtlsTransport::DtlsTransport(IceTransportChannel* ice_channel) :
     _ice_channel->signal_writable_state.connect(this, &DtlsTransport::_on_writable_state);
     _ice_channel->signal_receiving_state.connect(this, &DtlsTransport::_on_receiving_state);
 
-    webrtc::CryptoOptions crypto_options;
-    _srtp_ciphers = crypto_options.GetSupportedDtlsSrtpCryptoSuites();
+    _srtp_ciphers = get_srtp_crypto_suites();
 }
 
 DtlsTransport::~DtlsTransport() {
+    _reset_dtls();
+}
+
+void DtlsTransport::_reset_dtls() {
+    _dtls.reset(nullptr);
+
+    // 握手线程上可能还有未执行的任务，由最后一个任务释放
+    if (_offload) {
+        _offload->transport = nullptr;
+        _offload.reset();
+    }
 
+    _downward = nullptr;
+    _offload_keying_material.reset();
 }
 
 void DtlsTransport::_on_read_packet(IceTransportChannel* /*channel*/,
@@ -114,7 +320,7 @@ void DtlsTransport::_on_read_packet(IceTransportChannel* /*channel*/,
 {
     switch (_dtls_state) {
         case DtlsTransportState::k_new:
-            if (_dtls) {
+            if (_dtls_created()) {
                 RTC_LOG(LS_INFO) << to_string() << ": Received packet before DTLS started.";
             } else {
                 RTC_LOG(LS_WARNING) << to_string() << ": Received packet before we know if "
@@ -126,7 +332,7 @@ void DtlsTransport::_on_read_packet(IceTransportChannel* /*channel*/,
                     << "DTLS started";
                 _catched_client_hello.SetData(buf, len);
 
-                if (!_dtls && _local_certificate) {
+                if (!_dtls_created() && _local_certificate) {
                     _setup_dtls();
                 }
 
@@ -246,18 +452,24 @@ bool DtlsTransport::set_remote_fingerprint(const std::string& digest_alg,
     _remote_fingerprint_alg = digest_alg;
 
     // ClientHello packet先到，answer_sdp后到 
-    if (_dtls && !fingerprint_change) {
+    if (_dtls_created() && !fingerprint_change) {
+        // 卸载模式下收到fingerprint之前不会开始握手，此时握手线程还没有访问过dtls
+        rtc::SSLStreamAdapter* dtls = _offload ? _offload->dtls.get() : _dtls.get();
         rtc::SSLPeerCertificateDigestError err;
-        if (_dtls && !_dtls->SetPeerCertificateDigest(digest_alg, digest, digest_len, &err)) {
+        if (!dtls->SetPeerCertificateDigest(digest_alg, digest, digest_len, &err)) {
             RTC_LOG(LS_WARNING) << to_string() << ": Failed to set peer certificate digest";
             _set_dtls_state(DtlsTransportState::k_failed);
             return err == rtc::SSLPeerCertificateDigestError::VERIFICATION_FAILED;
         }
+
+        if (_offload) {
+            _maybe_start_dtls();
+        }
         return true;
     }
 
-    if (_dtls && fingerprint_change) {
-        _dtls.reset(nullptr);
+    if (_dtls_created() && fingerprint_change) {
+        _reset_dtls();
         _set_dtls_state(DtlsTransportState::k_new);
         _set_writable_state(false);
     }
@@ -307,10 +519,7 @@ bool DtlsTransport::_setup_dtls() {
     _dtls->SetIdentity(_local_certificate->identity()->Clone());
     _dtls->SetMode(rtc::SSL_MODE_DTLS);
     _dtls->SetMaxProtocolVersion(rtc::SSL_PROTOCOL_DTLS_12);
-    _dtls->SetServerRole(rtc::SSL_SERVER);
-    _dtls->SignalEvent.connect(this, &DtlsTransport::_on_dtls_event);
-    _dtls->SignalSSLHandshakeError.connect(this,
-         &DtlsTransport::_on_dtls_handshake_error);
+    _dtls->SetServerRole(_dtls_role);
 
     if (_remote_fingerprint_value.size() && !_dtls->SetPeerCertificateDigest(
                 _remote_fingerprint_alg,
@@ -330,7 +539,30 @@ bool DtlsTransport::_setup_dtls() {
         RTC_LOG(LS_INFO) << to_string() << ": Not using DTLS-SRTP.";
     }
 
-    RTC_LOG(LS_INFO) << to_string() << ": Setup DTLS complete";
+    if (g_dtls_handshake_pool) {
+        // 后续的握手计算都在握手线程上进行，worker线程只负责收发
+        _offload = std::make_shared<DtlsOffloadContext>(this);
+        DtlsOffloadContext* ctx = _offload.get();
+        downward_ptr->set_write_callback([ctx](const char* data, size_t len) {
+            auto buf = std::make_shared<rtc::Buffer>(data, len);
+            ctx->post_to_worker([buf](DtlsTransport* t) {
+                t->send_packet(buf->data<char>(), buf->size());
+            });
+        });
+        _dtls->SignalEvent.connect(ctx, &DtlsOffloadContext::on_dtls_event);
+        _dtls->SignalSSLHandshakeError.connect(ctx,
+                &DtlsOffloadContext::on_dtls_handshake_error);
+        ctx->dtls = std::move(_dtls);
+        ctx->downward = downward_ptr;
+        _downward = nullptr;
+    } else {
+        _dtls->SignalEvent.connect(this, &DtlsTransport::_on_dtls_event);
+        _dtls->SignalSSLHandshakeError.connect(this,
+                &DtlsTransport::_on_dtls_handshake_error);
+    }
+
+    RTC_LOG(LS_INFO) << to_string() << ": Setup DTLS complete"
+        << (_offload ? " (offloaded)" : "");
 
     _maybe_start_dtls();
 
@@ -339,9 +571,7 @@ bool DtlsTransport::_setup_dtls() {
 
 void DtlsTransport::_on_dtls_event(rtc::StreamInterface* /*dtls*/, int sig, int error) {
     if (sig & rtc::SE_OPEN) {
-        RTC_LOG(LS_INFO) << to_string() << ": DTLS handshake complete.";
-        _set_writable_state(true);
-        _set_dtls_state(DtlsTransportState::k_connected);
+        _on_dtls_open();
     }
 
     if (sig & rtc::SE_READ) {
@@ -352,36 +582,67 @@ void DtlsTransport::_on_dtls_event(rtc::StreamInterface* /*dtls*/, int sig, int
         // 因为一个数据包可能会包含多个DTLS record，需要循环读取
         do {
             ret = _dtls->Read(buf, sizeof(buf), &read, &read_error);
-            if (ret == rtc::SR_SUCCESS) {
-
-            } else if (ret == rtc::SR_EOS){
-                RTC_LOG(LS_INFO) << to_string() << ": DTLS transport closed by remote.";
-                _set_writable_state(false);
-                _set_dtls_state(DtlsTransportState::k_closed);
-                signal_closed(this);
+            if (ret == rtc::SR_EOS) {
+                _on_dtls_read_closed(false, 0);
             } else if (ret == rtc::SR_ERROR) {
-                RTC_LOG(LS_WARNING) << to_string() << ": Closed DTLS transport by remote "
-                    << "with error, code=" << read_error;
-                _set_writable_state(false);
-                _set_dtls_state(DtlsTransportState::k_closed);
-                signal_closed(this);
+                _on_dtls_read_closed(true, read_error);
             }
         } while (ret == rtc::SR_SUCCESS);
     }
 
     if (sig & rtc::SE_CLOSE) {
-        if (!error) {
-            RTC_LOG(LS_INFO) << to_string() << ": DTLS transport closed";
-            _set_writable_state(false);
-            _set_dtls_state(DtlsTransportState::k_closed);
-        } else {
-            RTC_LOG(LS_INFO) << to_string() << ": DTLS transport closed with error, "
-                << "code=" << error;
-            _set_writable_state(false);
-            _set_dtls_state(DtlsTransportState::k_failed);
-        }
+        _on_dtls_stream_closed(error);
+    }
+}
+
+void DtlsTransport::_on_dtls_open() {
+    if (_dtls_state != DtlsTransportState::k_connected) {
+        int64_t cpu_ns = _handshake_cpu_ns +
+            (_ssl_call_start_cpu_ns ? thread_cpu_ns() - _ssl_call_start_cpu_ns : 0);
+        DtlsHandshakeStats::instance()->add(cpu_ns);
+        RTC_LOG(LS_INFO) << to_string() << ": DTLS handshake complete, cpu_us="
+            << cpu_ns / 1000 << (_offload ? ", offloaded" : "");
     }
 
+    _set_writable_state(true);
+    _set_dtls_state(DtlsTransportState::k_connected);
+}
+
+void DtlsTransport::_on_dtls_read_closed(bool error, int code) {
+    if (!error) {
+        RTC_LOG(LS_INFO) << to_string() << ": DTLS transport closed by remote.";
+    } else {
+        RTC_LOG(LS_WARNING) << to_string() << ": Closed DTLS transport by remote "
+            << "with error, code=" << code;
+    }
+
+    _set_writable_state(false);
+    _set_dtls_state(DtlsTransportState::k_closed);
+    signal_closed(this);
+}
+
+void DtlsTransport::_on_dtls_stream_closed(int error) {
+    if (!error) {
+        RTC_LOG(LS_INFO) << to_string() << ": DTLS transport closed";
+        _set_writable_state(false);
+        _set_dtls_state(DtlsTransportState::k_closed);
+    } else {
+        RTC_LOG(LS_INFO) << to_string() << ": DTLS transport closed with error, "
+            << "code=" << error;
+        _set_writable_state(false);
+        _set_dtls_state(DtlsTransportState::k_failed);
+    }
+}
+
+void DtlsTransport::_on_offload_handshake_complete(int crypto_suite,
+        std::shared_ptr<rtc::ZeroOnFreeBuffer<uint8_t>> keying_material,
+        int64_t handshake_cpu_ns)
+{
+    _offload_crypto_suite = crypto_suite;
+    _offload_keying_material = keying_material;
+    _handshake_cpu_ns = handshake_cpu_ns;
+    _ssl_call_start_cpu_ns = 0;
+    _on_dtls_open();
 }
 
 void DtlsTransport::_on_dtls_handshake_error(rtc::SSLHandshakeError err) {
@@ -390,8 +651,48 @@ void DtlsTransport::_on_dtls_handshake_error(rtc::SSLHandshakeError err) {
 
 
 void DtlsTransport::_maybe_start_dtls() {
+    if (_offload && _ice_channel->writable()) {
+        // 证书校验需要对端的fingerprint，收到之后才交给握手线程
+        if (_dtls_state != DtlsTransportState::k_new ||
+                _remote_fingerprint_value.size() == 0)
+        {
+            return;
+        }
+
+        _offload->post_to_handshake([](DtlsOffloadContext* ctx) {
+            ctx->call_start_cpu_ns = thread_cpu_ns();
+            int err = ctx->dtls->StartSSL();
+            ctx->handshake_cpu_ns += thread_cpu_ns() - ctx->call_start_cpu_ns;
+            ctx->call_start_cpu_ns = 0;
+            if (err) {
+                ctx->post_to_worker([](DtlsTransport* t) {
+                    RTC_LOG(LS_WARNING) << t->to_string() << ": Failed to StartSSL.";
+                    t->_set_dtls_state(DtlsTransportState::k_failed);
+                });
+            }
+        });
+
+        RTC_LOG(LS_INFO) << to_string() << ": Started DTLS on handshake thread.";
+        _set_dtls_state(DtlsTransportState::k_connecting);
+
+        if (_catched_client_hello.size()) {
+            if (!_handle_dtls_packet(_catched_client_hello.data<char>(),
+                        _catched_client_hello.size()))
+            {
+                RTC_LOG(LS_WARNING) << to_string() << ": Handing dtls client packet failed.";
+                _set_dtls_state(DtlsTransportState::k_failed);
+            }
+            _catched_client_hello.Clear();
+        }
+        return;
+    }
+
     if (_dtls && _ice_channel->writable()) {
-        if (_dtls->StartSSL()) {
+        _ssl_call_start_cpu_ns = thread_cpu_ns();
+        int err = _dtls->StartSSL();
+        _handshake_cpu_ns += thread_cpu_ns() - _ssl_call_start_cpu_ns;
+        _ssl_call_start_cpu_ns = 0;
+        if (err) {
             RTC_LOG(LS_WARNING) << to_string() << ": Failed to StartSSL.";
             _set_dtls_state(DtlsTransportState::k_failed);
             return;
@@ -430,7 +731,22 @@ bool DtlsTransport::_handle_dtls_packet(const char* data, size_t size) {
         tmp_size -= k_dtls_record_header_len + recode_len;
     }
 
-    return _downward->on_received_packet(data, size);
+    if (_offload) {
+        auto buf = std::make_shared<rtc::Buffer>(data, size);
+        _offload->post_to_handshake([buf](DtlsOffloadContext* ctx) {
+            ctx->call_start_cpu_ns = thread_cpu_ns();
+            ctx->downward->on_received_packet(buf->data<char>(), buf->size());
+            ctx->handshake_cpu_ns += thread_cpu_ns() - ctx->call_start_cpu_ns;
+            ctx->call_start_cpu_ns = 0;
+        });
+        return true;
+    }
+
+    _ssl_call_start_cpu_ns = thread_cpu_ns();
+    bool ret = _downward->on_received_packet(data, size);
+    _handshake_cpu_ns += thread_cpu_ns() - _ssl_call_start_cpu_ns;
+    _ssl_call_start_cpu_ns = 0;
+    return ret;
 }
 
 std::string DtlsTransport::to_string() {
@@ -450,6 +766,14 @@ bool DtlsTransport::get_srtp_crypto_suite(int* selected_crypto_suite) {
         return false;
     }
 
+    if (_offload) {
+        if (!_offload_keying_material) {
+            return false;
+        }
+        *selected_crypto_suite = _offload_crypto_suite;
+        return true;
+    }
+
     return _dtls->GetDtlsSrtpCryptoSuite(selected_crypto_suite);
 }
 
@@ -460,6 +784,19 @@ bool DtlsTransport::export_keying_material(const std::string& label,
         uint8_t* result,
         size_t result_len)
 {
+    // 卸载模式下只有握手线程导出的DTLS-SRTP密钥
+    if (_offload) {
+        if (!_offload_keying_material || use_context ||
+                label != k_dtls_srtp_exporter_label ||
+                result_len > _offload_keying_material->size())
+        {
+            return false;
+        }
+
+        memcpy(result, _offload_keying_material->data(), result_len);
+        return true;
+    }
+
     return _dtls.get() ? _dtls->ExportKeyingMaterial(label, context,
             context_len, use_context, result, result_len) : false;
 }
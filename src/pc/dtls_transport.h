@@ -2,6 +2,7 @@
 #define __DTLS_TRANSPORT_H_
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 
 #include <rtc_base/ssl_stream_adapter.h>
@@ -15,6 +16,9 @@
 
 namespace xrtc {
 
+// rfc5764
+extern const char k_dtls_srtp_exporter_label[];
+
 enum class DtlsTransportState {
     k_new,
     k_connecting,
@@ -42,12 +46,24 @@ public:
                                int* error) override;
     void Close() override;
 
+    // 握手线程不能直接访问IceTransportChannel，设置后发送的record交给回调
+    void set_write_callback(std::function<void(const char*, size_t)> cb) {
+        _write_cb = std::move(cb);
+    }
+
 private:
     IceTransportChannel* _ice_channel;
+    std::function<void(const char*, size_t)> _write_cb;
+    // 正在投递的数据包，SSLStreamAdapter在SE_READ回调中直接从这里读取，
+    // 没有被同步读走(例如握手还未开始)时才拷贝到_packets
+    const char* _current_data = nullptr;
+    size_t _current_size = 0;
     rtc::BufferQueue _packets;
     rtc::StreamState _state = rtc::SS_OPEN;
 };
 
+class DtlsOffloadContext;
+
 class DtlsTransport : public sigslot::has_slots<> {
 public:
     DtlsTransport(IceTransportChannel* ice_channel);
@@ -57,6 +73,8 @@ public:
     IceCandidateComponent component() { return _ice_channel->component(); }
     IceTransportChannel* ice_channel() { return _ice_channel; }
     bool is_dtls_active() { return _dtls_active; }
+    // 默认作为DTLS server，需要在设置fingerprint之前调用
+    void set_dtls_role(rtc::SSLRole role) { _dtls_role = role; }
     bool writable() { return _writable; }
 
     int send_packet(const char* data, size_t len);
@@ -94,6 +112,16 @@ private:
     void _set_writable_state(bool writable);
     void _set_receiving_state(bool receiving);
     bool _handle_dtls_packet(const char* data, size_t size);
+    bool _dtls_created() { return _dtls || _offload; }
+    void _reset_dtls();
+    void _on_dtls_open();
+    void _on_dtls_read_closed(bool error, int code);
+    void _on_dtls_stream_closed(int error);
+    void _on_offload_handshake_complete(int crypto_suite,
+            std::shared_ptr<rtc::ZeroOnFreeBuffer<uint8_t>> keying_material,
+            int64_t handshake_cpu_ns);
+
+    friend class DtlsOffloadContext;
 
 private:
     IceTransportChannel* _ice_channel;
@@ -107,7 +135,15 @@ private:
     rtc::Buffer _remote_fingerprint_value;
     std::string _remote_fingerprint_alg;
     bool _dtls_active = false;
+    rtc::SSLRole _dtls_role = rtc::SSL_SERVER;
     std::vector<int> _srtp_ciphers;
+    // 握手卸载到握手线程池时使用，此时_dtls为空
+    std::shared_ptr<DtlsOffloadContext> _offload;
+    int _offload_crypto_suite = 0;
+    std::shared_ptr<rtc::ZeroOnFreeBuffer<uint8_t>> _offload_keying_material;
+    // 握手消耗的线程CPU时间，_ssl_call_start_cpu_ns非0表示正在SSL调用中
+    int64_t _handshake_cpu_ns = 0;
+    int64_t _ssl_call_start_cpu_ns = 0;
 };
 
 } // namespace xrtc
@@ -3,17 +3,28 @@
 #include <rtc_base/logging.h>
 
 #include "pc/peer_connection.h"
+#include "base/conf.h"
 #include "base/event_loop.h"
 #include "ice/ice_credentials.h"
+#include "pc/dtls_srtp_transport.h"
 #include "pc/peer_connection_def.h"
 #include "pc/session_description.h"
 #include "pc/stream_params.h"
 #include "pc/transport_controller.h"
+#include "module/rtp_rtcp/rtp_utils.h"
 #include "rtc_base/string_encode.h"
 
+extern xrtc::GeneralConf* g_conf;
 
 namespace xrtc {
 
+// 本端offer中头扩展的id
+const int k_transport_cc_ext_id = 3;
+const int k_mid_ext_id = 4;
+const int k_rid_ext_id = 5;
+const int k_repaired_rid_ext_id = 6;
+const int k_dependency_descriptor_ext_id = 7;
+
 struct SsrcInfo {
     uint32_t ssrc_id;
     std::string cname;
@@ -33,9 +44,10 @@ static RtpDirection get_direction(bool send, bool recv) {
     }
 }
 
-PeerConnection::PeerConnection(EventLoop* el, PortAllocator* allocator) :
+PeerConnection::PeerConnection(EventLoop* el, PortAllocator* allocator,
+        IceScheduler* scheduler) :
         _el(el),
-        _transport_controller(new TransportController(el, allocator))      
+        _transport_controller(new TransportController(el, allocator, scheduler))      
 {
     _transport_controller->signal_candidate_allocate_done.connect(this,
         &PeerConnection::_on_candidate_allocate_done);
@@ -81,13 +93,13 @@ void PeerConnection::_on_connection_state(TransportController*, PeerConnectionSt
 }
 
 void PeerConnection::_on_rtp_packet_received(TransportController*,
-        rtc::CopyOnWriteBuffer* packet, int64_t ts)
+        PacketBuffer* packet, int64_t ts)
 {
     signal_rtp_packet_received(this, packet, ts);
 }
 
 void PeerConnection::_on_rtcp_packet_received(TransportController*,
-        rtc::CopyOnWriteBuffer* packet, int64_t ts)
+        PacketBuffer* packet, int64_t ts)
 {
     signal_rtcp_packet_received(this, packet, ts);
 }
@@ -120,21 +132,33 @@ std::string PeerConnection::create_offer(const RTCOfferAnswerOptions& options) {
         return "";
     }
 
+    // ice restart: 保留之前收集到的candidate，只更换ufrag/pwd
+    std::unique_ptr<SessionDescription> prev_desc;
+    if (options.ice_restart) {
+        prev_desc = std::move(_local_desc);
+    }
+
     _local_desc = std::make_unique<SessionDescription>(SdpType::k_offer);
 
     IceParamters ice_param = IceCredentials::create_random_ice_credentials();
+    bool transport_cc = options.transport_cc && g_conf->bwe_transport_cc;
 
     if (options.recv_audio || options.send_audio) {
         auto audio = std::make_shared<AudioContentDescription>();
         audio->set_direction(get_direction(options.send_audio, options.recv_audio));
         audio->set_rtcp_mux(options.use_rtcp_mux);
         _local_desc->add_content(audio);
-        _local_desc->add_transport_info(audio->mid(), ice_param, _certificate);
+        _local_desc->add_transport_info(audio->mid(), ice_param, _certificate.get());
     
         if (options.send_audio) {
             for (auto stream : _audio_source) {
                 audio->add_stream(stream);
             }
+
+            if (transport_cc) {
+                audio->add_rtp_header_extension(RtpExtension(k_rtp_transport_cc_uri,
+                            k_transport_cc_ext_id));
+            }
         }
     }
 
@@ -143,12 +167,34 @@ std::string PeerConnection::create_offer(const RTCOfferAnswerOptions& options) {
         video->set_direction(get_direction(options.send_audio, options.recv_audio));
         video->set_rtcp_mux(options.use_rtcp_mux);
         _local_desc->add_content(video);
-        _local_desc->add_transport_info(video->mid(), ice_param, _certificate);
+        _local_desc->add_transport_info(video->mid(), ice_param, _certificate.get());
+
+        // 推流和拉流的offer相同，转发的包不用改写payload type和扩展id
+        _svc_codecs = g_conf->svc_enable;
+        if (_svc_codecs) {
+            video->add_svc_codecs();
+            video->add_rtp_header_extension(RtpExtension(k_rtp_dependency_descriptor_uri,
+                        k_dependency_descriptor_ext_id));
+        }
 
         if (options.send_video) {
             for (auto stream : _video_source) {
                 video->add_stream(stream);
             }
+
+            if (transport_cc) {
+                video->add_rtp_header_extension(RtpExtension(k_rtp_transport_cc_uri,
+                            k_transport_cc_ext_id));
+            }
+        }
+
+        // simulcast的层没有在SDP中声明ssrc，按RID头扩展识别
+        if (options.recv_video && !options.recv_simulcast_rids.empty()) {
+            video->add_rtp_header_extension(RtpExtension(k_rtp_mid_uri, k_mid_ext_id));
+            video->add_rtp_header_extension(RtpExtension(k_rtp_rid_uri, k_rid_ext_id));
+            video->add_rtp_header_extension(RtpExtension(k_rtp_repaired_rid_uri,
+                        k_repaired_rid_ext_id));
+            video->set_receive_rids(options.recv_simulcast_rids);
         }
     }
 
@@ -163,7 +209,17 @@ std::string PeerConnection::create_offer(const RTCOfferAnswerOptions& options) {
         }
     }
 
+    if (prev_desc) {
+        for (auto content : _local_desc->contents()) {
+            auto prev_content = prev_desc->get_content(content->mid());
+            if (prev_content) {
+                content->add_candidates(prev_content->candidates());
+            }
+        }
+    }
+
     _transport_controller->set_local_description(_local_desc.get());
+    _update_ssrc_transports();
 
     return _local_desc->to_string();
 }
@@ -314,6 +370,82 @@ static int parse_ssrc_group_info(std::vector<SsrcGroup>& ssrc_groups,
     return 0;
 }
 
+static int parse_rtp_extension(std::shared_ptr<MediaContentDescription> content,
+        const std::string& line)
+{
+    if (line.find("a=extmap:") == std::string::npos) {
+        return 0;
+    }
+
+    // rfc8285
+    // a=extmap:<value>["/"<direction>] <URI> <extensionattributes>
+    std::vector<std::string> fields;
+    rtc::split(line.substr(9), ' ', &fields);
+    if (fields.size() < 2) {
+        RTC_LOG(LS_WARNING) << "parse a=extmap failed, line: " << line;
+        return -1;
+    }
+
+    std::string value = fields[0].substr(0, fields[0].find('/'));
+    int id = 0;
+    if (!rtc::FromString(value, &id) || id < 1 || id > 255) {
+        RTC_LOG(LS_WARNING) << "invalid extmap id, line: " << line;
+        return -1;
+    }
+
+    content->add_rtp_header_extension(RtpExtension(fields[1], id));
+    return 0;
+}
+
+// rfc8853
+// a=simulcast:send <rid>;<rid>,<替代rid>;~<暂停的rid>
+static int parse_simulcast(std::vector<std::string>& rids, const std::string& line) {
+    if (line.find("a=simulcast:") == std::string::npos) {
+        return 0;
+    }
+
+    std::vector<std::string> fields;
+    rtc::split(line.substr(12), ' ', &fields);
+    for (size_t i = 0; i + 1 < fields.size(); i += 2) {
+        if (fields[i] != "send") {
+            continue;
+        }
+
+        std::vector<std::string> streams;
+        rtc::split(fields[i + 1], ';', &streams);
+        for (auto& stream : streams) {
+            std::string rid = stream.substr(0, stream.find(','));
+            if (!rid.empty() && '~' == rid[0]) {
+                rid = rid.substr(1);
+            }
+
+            if (rid.empty()) {
+                RTC_LOG(LS_WARNING) << "invalid simulcast rid, line: " << line;
+                return -1;
+            }
+            rids.push_back(rid);
+        }
+    }
+
+    return 0;
+}
+
+// a=msid:<stream id> <track id>
+static void parse_msid(StreamParams& track, const std::string& line) {
+    if (line.find("a=msid:") == std::string::npos) {
+        return;
+    }
+
+    std::vector<std::string> fields;
+    rtc::split(line.substr(7), ' ', &fields);
+    if (!fields.empty()) {
+        track.stream_id = fields[0];
+    }
+    if (fields.size() > 1) {
+        track.id = fields[1];
+    }
+}
+
 static void create_track_from_ssrc_info(const std::vector<SsrcInfo>& ssrc_infos,
         std::vector<StreamParams>& tracks)
 {
@@ -359,6 +491,9 @@ int PeerConnection::set_remote_sdp(const std::string& sdp) {
 
     auto audio_content = std::make_shared<AudioContentDescription>();
     auto video_content = std::make_shared<VideoContentDescription>();
+    if (_svc_codecs) {
+        video_content->add_svc_codecs();
+    }
 
     auto audio_td = std::make_shared<TransportDescription>();
     auto video_td = std::make_shared<TransportDescription>();
@@ -368,6 +503,8 @@ int PeerConnection::set_remote_sdp(const std::string& sdp) {
     std::vector<SsrcGroup> video_ssrc_groups;
     std::vector<StreamParams> audio_tracks; // 对应webrtc::AudioTrack
     std::vector<StreamParams> video_tracks; // 对应webrtc::VideoTrack
+    std::vector<std::string> video_rids;
+    StreamParams video_msid;
 
     for (auto field : fields) {
         if (is_rn) {
@@ -413,6 +550,10 @@ int PeerConnection::set_remote_sdp(const std::string& sdp) {
                 return -1;
             }
 
+            if (parse_rtp_extension(audio_content, field) != 0) {
+                return -1;
+            }
+
         } else if ("video" == media_type) {
             if (parse_transport_info(video_td.get(), field) != 0) {
                 return -1;
@@ -426,6 +567,16 @@ int PeerConnection::set_remote_sdp(const std::string& sdp) {
                 return -1;
             }
 
+            if (parse_rtp_extension(video_content, field) != 0) {
+                return -1;
+            }
+
+            if (parse_simulcast(video_rids, field) != 0) {
+                return -1;
+            }
+
+            parse_msid(video_msid, field);
+
         }
     }
 
@@ -457,27 +608,151 @@ int PeerConnection::set_remote_sdp(const std::string& sdp) {
         }
     }
 
+    // RID方式的simulcast没有ssrc，只有一个track
+    if (video_ssrc_info.empty() && video_rids.size() > 1) {
+        StreamParams track = video_msid;
+        track.rids = video_rids;
+        video_content->add_stream(track);
+    }
+
     _remote_desc->add_transport_info(audio_td);
     _remote_desc->add_transport_info(video_td);
 
     _transport_controller->set_remote_description(_remote_desc.get());
+    _update_ssrc_transports();
+    _maybe_enable_transport_cc();
 
     return 0;
 }
 
+// offer中提供并且answer中接受了transport-wide-cc扩展的传输通道，开启带宽估计
+void PeerConnection::_maybe_enable_transport_cc() {
+    if (!_local_desc || !_remote_desc) {
+        return;
+    }
+
+    for (auto content : _local_desc->contents()) {
+        if (!content->find_rtp_header_extension(k_rtp_transport_cc_uri)) {
+            continue;
+        }
+
+        auto remote_content = _remote_desc->get_content(content->mid());
+        if (!remote_content) {
+            continue;
+        }
+
+        int ext_id = remote_content->find_rtp_header_extension(k_rtp_transport_cc_uri);
+        if (ext_id <= 0 || ext_id > 14) { // 只支持one-byte头扩展
+            continue;
+        }
+
+        DtlsSrtpTransport* transport = _get_transport_by_mid(content->mid());
+        if (!transport || transport->bwe()) {
+            continue;
+        }
+
+        BweConfig config;
+        config.min_bitrate_bps = (int64_t)g_conf->bwe_min_bitrate_kbps * 1000;
+        config.start_bitrate_bps = (int64_t)g_conf->bwe_start_bitrate_kbps * 1000;
+        config.max_bitrate_bps = (int64_t)g_conf->bwe_max_bitrate_kbps * 1000;
+        transport->enable_transport_cc(ext_id, config);
+    }
+}
+
+// bundle时所有mid共用第一个mid的传输通道
+DtlsSrtpTransport* PeerConnection::_get_transport_by_mid(const std::string& mid) {
+    if (!_local_desc || !_local_desc->get_content(mid)) {
+        return nullptr;
+    }
+
+    std::string transport_name = mid;
+    if (_local_desc->is_bundle(mid)) {
+        transport_name = _local_desc->get_first_bundle_mid();
+    }
+
+    return _transport_controller->get_dtls_srtp_transport(transport_name);
+}
+
+void PeerConnection::_add_ssrc_transports(SessionDescription* desc) {
+    for (auto content : desc->contents()) {
+        DtlsSrtpTransport* transport = _get_transport_by_mid(content->mid());
+        if (!transport) {
+            continue;
+        }
+
+        for (auto& stream : content->streams()) {
+            for (uint32_t ssrc : stream.ssrcs) {
+                _ssrc_transports[ssrc] = transport;
+            }
+
+            for (auto& group : stream.ssrc_groups) {
+                for (uint32_t ssrc : group.ssrcs) {
+                    _ssrc_transports[ssrc] = transport;
+                }
+            }
+        }
+    }
+}
+
+void PeerConnection::_update_ssrc_transports() {
+    _ssrc_transports.clear();
+    if (_local_desc) {
+        _add_ssrc_transports(_local_desc.get());
+    }
+
+    if (_remote_desc) {
+        _add_ssrc_transports(_remote_desc.get());
+    }
+}
+
+DtlsSrtpTransport* PeerConnection::get_transport_by_ssrc(uint32_t ssrc) {
+    auto iter = _ssrc_transports.find(ssrc);
+    if (iter != _ssrc_transports.end()) {
+        return iter->second;
+    }
+
+    if (!_local_desc || _local_desc->contents().empty()) {
+        return nullptr;
+    }
+
+    return _get_transport_by_mid(_local_desc->contents().front()->mid());
+}
+
+DtlsSrtpTransport* PeerConnection::get_rtp_transport(MediaType type) {
+    if (!_local_desc) {
+        return nullptr;
+    }
+
+    for (auto content : _local_desc->contents()) {
+        if (content->type() == type) {
+            return _get_transport_by_mid(content->mid());
+        }
+    }
+
+    return nullptr;
+}
+
 int PeerConnection::send_rtp(const char* data, size_t len) {
-    if (_transport_controller) {
-        // todo: 需要根据实际情况完善（是否bundle、是否音视频都发送）
-        return _transport_controller->send_rtp("audio", data, len);
+    if (len < 12) {
+        return -1;
+    }
+
+    uint32_t ssrc = parse_rtp_ssrc(rtc::ArrayView<const uint8_t>(
+                (const uint8_t*)data, len));
+    DtlsSrtpTransport* transport = get_transport_by_ssrc(ssrc);
+    if (transport) {
+        return transport->send_rtp(data, len);
     }
 
     return -1;
 }
 
 int PeerConnection::send_rtcp(const char* data, size_t len) {
-    if (_transport_controller) {
-        // todo: 需要根据实际情况完善（是否bundle、是否音视频都发送）
-        return _transport_controller->send_rtcp("audio", data, len);
+    uint32_t ssrc = parse_rtcp_ssrc(rtc::ArrayView<const uint8_t>(
+                (const uint8_t*)data, len));
+    DtlsSrtpTransport* transport = get_transport_by_ssrc(ssrc);
+    if (transport) {
+        return transport->send_rtcp(data, len);
     }
 
     return -1;
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include <rtc_base/rtc_certificate.h>
 
@@ -10,6 +11,7 @@
 #include "ice/candidate.h"
 #include "ice/ice_def.h"
 #include "ice/port_allocator.h"
+#include "ice/ice_scheduler.h"
 #include "pc/peer_connection_def.h"
 #include "pc/session_description.h"
 #include "pc/transport_controller.h"
@@ -28,11 +30,14 @@ struct RTCOfferAnswerOptions {
     bool use_rtp_mux = true; // bundle
     bool use_rtcp_mux = true; // rtp和rtcp是否复用同一传输通道的选项
     bool dtls_on = true;
+    bool ice_restart = false; // 生成新的ufrag/pwd，复用已有的传输通道
+    bool transport_cc = false; // 发送的媒体提供transport-wide-cc扩展，用于带宽估计
+    std::vector<std::string> recv_simulcast_rids; // 接收的视频请求按RID的simulcast层
 };
 
 class PeerConnection : public sigslot::has_slots<> {
 public:
-    PeerConnection(EventLoop* el, PortAllocator* allocator);
+    PeerConnection(EventLoop* el, PortAllocator* allocator, IceScheduler* scheduler);
 
     int init(rtc::RTCCertificate* certificate);
     void destroy();
@@ -50,14 +55,19 @@ public:
         _video_source = source;
     }
 
+    // 按ssrc选择音频或视频的传输通道
     int send_rtp(const char* data, size_t len);
     int send_rtcp(const char* data, size_t len);
+    // 某种媒体使用的transport，供批量转发使用；bundle时音视频相同
+    DtlsSrtpTransport* get_rtp_transport(MediaType type);
+    // ssrc所在的传输通道，未知的ssrc使用第一个传输通道
+    DtlsSrtpTransport* get_transport_by_ssrc(uint32_t ssrc);
 
 public:
     sigslot::signal2<PeerConnection*, PeerConnectionState> signal_connection_state;
-    sigslot::signal3<PeerConnection*, rtc::CopyOnWriteBuffer*, int64_t>
+    sigslot::signal3<PeerConnection*, PacketBuffer*, int64_t>
         signal_rtp_packet_received;
-    sigslot::signal3<PeerConnection*, rtc::CopyOnWriteBuffer*, int64_t>
+    sigslot::signal3<PeerConnection*, PacketBuffer*, int64_t>
         signal_rtcp_packet_received;
 
 private:
@@ -68,20 +78,28 @@ private:
             const std::vector<Candidate>& candidates);
     void _on_connection_state(TransportController*, PeerConnectionState state);
     void _on_rtp_packet_received(TransportController*,
-        rtc::CopyOnWriteBuffer* packet, int64_t ts);
+        PacketBuffer* packet, int64_t ts);
     void _on_rtcp_packet_received(TransportController*,
-        rtc::CopyOnWriteBuffer* packet, int64_t ts);
+        PacketBuffer* packet, int64_t ts);
     friend void destroy_timer_cb(EventLoop* el, TimerWatcher* w, void* data);
+    DtlsSrtpTransport* _get_transport_by_mid(const std::string& mid);
+    void _update_ssrc_transports();
+    void _add_ssrc_transports(SessionDescription* desc);
+    void _maybe_enable_transport_cc();
 
 private:
     EventLoop* _el;
     std::unique_ptr<SessionDescription> _local_desc;
     std::unique_ptr<SessionDescription> _remote_desc;
-    rtc::RTCCertificate* _certificate = nullptr;
+    // 持有引用，证书轮换后旧证书在连接结束前仍然有效
+    rtc::scoped_refptr<rtc::RTCCertificate> _certificate;
     std::unique_ptr<TransportController> _transport_controller;
     TimerWatcher* _destroy_timer = nullptr;
     std::vector<StreamParams> _audio_source;
     std::vector<StreamParams> _video_source;
+    bool _svc_codecs = false; // offer中有VP9/AV1，answer的编码按offer的payload type
+    // 本端发送和对端发送的ssrc所在的传输通道，RTCP反馈按媒体ssrc查找
+    std::unordered_map<uint32_t, DtlsSrtpTransport*> _ssrc_transports;
 };
 
 } // namespace xrtc
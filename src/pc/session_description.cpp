@@ -14,6 +14,14 @@ namespace xrtc {
 
 const char k_media_protocol_dtls_savpf[] = "UDP/TLS/RTP/SAVPF"; // 支持dtls
 const char k_meida_protocol_savpf[] = "RTP/SAVPF";
+const char k_rtp_transport_cc_uri[] =
+    "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
+const char k_rtp_mid_uri[] = "urn:ietf:params:rtp-hdrext:sdes:mid";
+const char k_rtp_rid_uri[] = "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id";
+const char k_rtp_repaired_rid_uri[] =
+    "urn:ietf:params:rtp-hdrext:sdes:repaired-rtp-stream-id";
+const char k_rtp_dependency_descriptor_uri[] =
+    "https://aomediacodec.github.io/av1-rtp-spec/#dependency-descriptor-rtp-header-extension";
 
 
 AudioContentDescription::AudioContentDescription() {
@@ -65,6 +73,46 @@ VideoContentDescription::VideoContentDescription() {
     _codecs.push_back(rtx_codec);
 }
 
+void VideoContentDescription::add_svc_codecs() {
+    std::vector<std::shared_ptr<CodecInfo>> codecs;
+    const int ids[][2] = {{98, 100}, {45, 46}}; // VP9、AV1和各自的RTX
+    const char* names[] = {"VP9", "AV1"};
+    for (size_t i = 0; i < 2; ++i) {
+        auto codec = std::make_shared<VideoCodecInfo>();
+        codec->id = ids[i][0];
+        codec->name = names[i];
+        codec->clockrate = 90000;
+        codec->feedback_param.push_back(FeedBackParam("goog-remb"));
+        codec->feedback_param.push_back(FeedBackParam("transport-cc"));
+        codec->feedback_param.push_back(FeedBackParam("ccm", "fir"));
+        codec->feedback_param.push_back(FeedBackParam("nack"));
+        codec->feedback_param.push_back(FeedBackParam("nack", "pli"));
+        if ("VP9" == codec->name) {
+            codec->codec_param["profile-id"] = "0";
+        }
+        codecs.push_back(codec);
+
+        auto rtx_codec = std::make_shared<VideoCodecInfo>();
+        rtx_codec->id = ids[i][1];
+        rtx_codec->name = "rtx";
+        rtx_codec->clockrate = 90000;
+        rtx_codec->codec_param["apt"] = std::to_string(codec->id);
+        codecs.push_back(rtx_codec);
+    }
+
+    _codecs.insert(_codecs.begin(), codecs.begin(), codecs.end());
+}
+
+int MediaContentDescription::find_rtp_header_extension(const std::string& uri) {
+    for (auto& extension : _rtp_header_extensions) {
+        if (extension.uri == uri) {
+            return extension.id;
+        }
+    }
+
+    return 0;
+}
+
 bool ContentGroup::has_content_name(const std::string& content_name) {
     for (auto name : _content_names) {
         if (name == content_name) {
@@ -256,6 +304,31 @@ static void build_rtp_map(std::shared_ptr<MediaContentDescription> content,
 
 }
 
+static void build_rtp_extensions(std::shared_ptr<MediaContentDescription> content,
+        std::stringstream& ss)
+{
+    for (auto& extension : content->rtp_header_extensions()) {
+        ss << "a=extmap:" << extension.id << " " << extension.uri << "\r\n";
+    }
+}
+
+// rfc8853
+static void build_simulcast(std::shared_ptr<MediaContentDescription> content,
+        std::stringstream& ss)
+{
+    if (content->receive_rids().empty()) {
+        return;
+    }
+
+    std::string rids;
+    for (auto& rid : content->receive_rids()) {
+        ss << "a=rid:" << rid << " recv\r\n";
+        rids += (rids.empty() ? "" : ";") + rid;
+    }
+
+    ss << "a=simulcast:recv " << rids << "\r\n";
+}
+
 static void build_rtp_direction(std::shared_ptr<MediaContentDescription> content,
        std::stringstream& ss)
 {
@@ -394,6 +467,7 @@ std::string SessionDescription::to_string() {
 
         // 媒体方向
         ss << "a=mid:" << content->mid() << "\r\n";
+        build_rtp_extensions(content, ss);
         build_rtp_direction(content, ss);
         
         if (content->rtcp_mux()) {
@@ -401,6 +475,7 @@ std::string SessionDescription::to_string() {
         }
 
         build_rtp_map(content, ss);
+        build_simulcast(content, ss);
         build_ssrc(content, ss);
     }
 
@@ -31,6 +31,19 @@ enum class RtpDirection {
     k_inactive
 };
 
+// rfc8285 RTP头扩展，a=extmap:<id> <uri>
+struct RtpExtension {
+    RtpExtension(const std::string& uri, int id) : uri(uri), id(id) {}
+
+    std::string uri;
+    int id;
+};
+
+extern const char k_rtp_transport_cc_uri[];
+extern const char k_rtp_mid_uri[];
+extern const char k_rtp_rid_uri[];
+extern const char k_rtp_repaired_rid_uri[];
+extern const char k_rtp_dependency_descriptor_uri[];
 
 class MediaContentDescription {
 public:
@@ -58,12 +71,27 @@ public:
         _send_streams.push_back(stream);
     }
 
+    const std::vector<RtpExtension>& rtp_header_extensions() {
+        return _rtp_header_extensions;
+    }
+    void add_rtp_header_extension(const RtpExtension& extension) {
+        _rtp_header_extensions.push_back(extension);
+    }
+    // 没有协商该扩展时返回0
+    int find_rtp_header_extension(const std::string& uri);
+
+    // 希望对端发送的simulcast层(a=rid:<rid> recv，a=simulcast:recv)，从低到高
+    const std::vector<std::string>& receive_rids() { return _receive_rids; }
+    void set_receive_rids(const std::vector<std::string>& rids) { _receive_rids = rids; }
+
 protected:
     std::vector<std::shared_ptr<CodecInfo>> _codecs;
     RtpDirection _direction;
     bool _rtcp_mux = true;
     std::vector<Candidate> _candidates;
     std::vector<StreamParams> _send_streams;
+    std::vector<RtpExtension> _rtp_header_extensions;
+    std::vector<std::string> _receive_rids;
 };
 
 class AudioContentDescription : public MediaContentDescription {
@@ -77,6 +105,8 @@ class VideoContentDescription : public MediaContentDescription {
 public:
     VideoContentDescription();
     MediaType type() override { return MediaType::MEDIA_TYPE_VIDEO; }
+    // 可伸缩编码(VP9、AV1)放在H264之前，优先协商
+    void add_svc_codecs();
     std::string mid() override { return "video"; }
 };
 
@@ -1,24 +1,205 @@
+#include <arpa/inet.h>
+
+#include <algorithm>
+
 #include <rtc_base/logging.h>
-#include <rtc_base/synchronization/mutex.h>
-#include <absl/base/attributes.h>
+#include <rtc_base/ssl_stream_adapter.h>
 #include "pc/srtp_session.h"
 #include "srtp2/srtp.h"
 
 namespace xrtc {
 
+// 每个方向最多缓存的空闲上下文个数，超出的直接释放
+const size_t k_srtp_context_pool_max_free = 1024;
+
+static inline uint16_t read_be16(const uint8_t* p) {
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t read_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+        | ((uint32_t)p[2] << 8) | p[3];
+}
+
+SrtpContextPool::~SrtpContextPool() {
+    for (srtp_t ctx : _free_inbound) {
+        srtp_dealloc(ctx);
+    }
+
+    for (srtp_t ctx : _free_outbound) {
+        srtp_dealloc(ctx);
+    }
+}
+
+SrtpContextPool* SrtpContextPool::current() {
+    static thread_local SrtpContextPool pool;
+    return &pool;
+}
+
+std::vector<srtp_t>* SrtpContextPool::_free_list(srtp_ssrc_type_t type) {
+    return ssrc_any_inbound == type ? &_free_inbound : &_free_outbound;
+}
+
+size_t SrtpContextPool::free_count(srtp_ssrc_type_t type) {
+    return _free_list(type)->size();
+}
+
+void SrtpContextPool::reserve(size_t count) {
+    srtp_policy_t policy;
+    memset(&policy, 0, sizeof(policy));
+    srtp_crypto_policy_set_rtp_default(&policy.rtp);
+    srtp_crypto_policy_set_rtcp_default(&policy.rtcp);
+    uint8_t key[SRTP_MAX_KEY_LEN] = {0};
+    policy.key = key;
+    policy.window_size = 1024;
+
+    for (srtp_ssrc_type_t type : { ssrc_any_inbound, ssrc_any_outbound }) {
+        std::vector<srtp_t>* free_list = _free_list(type);
+        policy.ssrc.type = type;
+        while (free_list->size() < count) {
+            srtp_t ctx = nullptr;
+            int err = srtp_create(&ctx, &policy);
+            if (err != srtp_err_status_ok) {
+                RTC_LOG(LS_WARNING) << "Failed to preallocate srtp, err: " << err;
+                return;
+            }
+            free_list->push_back(ctx);
+        }
+    }
+}
+
+srtp_t SrtpContextPool::acquire(const srtp_policy_t* policy) {
+    std::vector<srtp_t>* free_list = _free_list(policy->ssrc.type);
+    while (!free_list->empty()) {
+        srtp_t ctx = free_list->back();
+        free_list->pop_back();
+
+        // 会释放旧的stream模板并按新的policy重新分配
+        int err = srtp_update(ctx, policy);
+        if (err == srtp_err_status_ok) {
+            return ctx;
+        }
+
+        RTC_LOG(LS_WARNING) << "Failed to reuse srtp context, err: " << err;
+        srtp_dealloc(ctx);
+    }
+
+    srtp_t ctx = nullptr;
+    int err = srtp_create(&ctx, policy);
+    if (err != srtp_err_status_ok) {
+        RTC_LOG(LS_WARNING) << "Failed to create srtp, err: " << err;
+        return nullptr;
+    }
+
+    return ctx;
+}
+
+void SrtpContextPool::release(srtp_t ctx, srtp_ssrc_type_t type,
+        const std::vector<SrtpStreamInfo>& streams)
+{
+    srtp_set_user_data(ctx, nullptr);
+
+    std::vector<srtp_t>* free_list = _free_list(type);
+    if (free_list->size() >= k_srtp_context_pool_max_free) {
+        srtp_dealloc(ctx);
+        return;
+    }
+
+    // 删除克隆出来的stream，否则srtp_update会保留旧的重放窗口和ROC
+    for (auto& stream : streams) {
+        srtp_remove_stream(ctx, htonl(stream.ssrc));
+    }
+
+    free_list->push_back(ctx);
+}
+
 SrtpSession::SrtpSession() {
 
 }
 
 SrtpSession::~SrtpSession() {
     if (_session) {
-        srtp_set_user_data(_session, nullptr);
-        srtp_dealloc(_session);
+        SrtpContextPool::current()->release(_session, _type, _streams);
+        _session = nullptr;
+    }
+}
+
+bool SrtpSession::init_libsrtp() {
+    int err = srtp_init();
+    if (err != srtp_err_status_ok) {
+        RTC_LOG(LS_WARNING) << "Failed to init srtp, err: " << err;
+        return false;
+    }
+
+    err = srtp_install_event_handler(&SrtpSession::_event_handle_thunk);
+    if (err != srtp_err_status_ok) {
+        RTC_LOG(LS_WARNING) << "Failed to install srtp event, err: " << err;
+        return false;
+    }
+
+    return true;
+}
+
+void SrtpSession::shutdown_libsrtp() {
+    int err = srtp_shutdown();
+    if (err != srtp_err_status_ok) {
+        RTC_LOG(LS_WARNING) << "Failed to shutdown srtp, err: " << err;
+    }
+}
+
+void SrtpSession::set_replay_window(int window_size) {
+    _replay_window = std::min(std::max(window_size, k_srtp_min_replay_window),
+            k_srtp_max_replay_window);
+}
+
+void SrtpSession::_on_unprotect_rtp_failed(const uint8_t* data, int len, int err) {
+    if (srtp_err_status_replay_fail == err || srtp_err_status_replay_old == err) {
+        ++_unprotect_stats.replay;
+        return;
+    }
+
+    if (err != srtp_err_status_auth_fail || len < 12) {
+        ++_unprotect_stats.other;
+        return;
     }
 
-    if (_inited) {
-        _decrement_libsrtp_usage_count_and_maybe_deinit();
+    // 认证失败时，如果序号和上一次成功的序号分别在回绕点两侧，
+    // 说明接收端估计的ROC很可能和发送端不一致
+    uint16_t seq = read_be16(data + 2);
+    uint32_t ssrc = read_be32(data + 8);
+    for (auto& stream : _streams) {
+        if (stream.ssrc == ssrc && stream.has_seq) {
+            uint16_t last = stream.last_seq;
+            if ((last > 0xc000 && seq < 0x4000) || (last < 0x4000 && seq > 0xc000)) {
+                ++_unprotect_stats.roc;
+                return;
+            }
+            break;
+        }
+    }
+
+    ++_unprotect_stats.auth;
+}
+
+SrtpStreamInfo* SrtpSession::_add_ssrc(uint32_t ssrc) {
+    // 连续的包大多来自同一个SSRC，先比较上一次的
+    if (_last_stream < _streams.size() && _streams[_last_stream].ssrc == ssrc) {
+        return &_streams[_last_stream];
+    }
+
+    // 一个session的SSRC很少，线性查找即可
+    for (size_t i = 0; i < _streams.size(); ++i) {
+        if (_streams[i].ssrc == ssrc) {
+            _last_stream = i;
+            return &_streams[i];
+        }
     }
+
+    // libsrtp第一次见到这个SSRC，克隆出了一个stream
+    _last_stream = _streams.size();
+    _streams.emplace_back();
+    _streams.back().ssrc = ssrc;
+    return &_streams.back();
 }
 
 bool SrtpSession::set_send(int cs, const uint8_t* key, size_t key_len,
@@ -70,8 +251,16 @@ bool SrtpSession::unprotect_rtp(void* p, int in_len, int* out_len) {
     *out_len = in_len;
 
     int err = srtp_unprotect(_session, p, out_len);
+    if (err != srtp_err_status_ok) {
+        _on_unprotect_rtp_failed((const uint8_t*)p, in_len, err);
+        return false;
+    }
 
-    return err == srtp_err_status_ok;
+    // 查找stream时一并记录序号，每个包只查找一次
+    SrtpStreamInfo* stream = _add_ssrc(read_be32((const uint8_t*)p + 8));
+    stream->has_seq = true;
+    stream->last_seq = read_be16((const uint8_t*)p + 2);
+    return true;
 }
 
 bool SrtpSession::unprotect_rtcp(void* p, int in_len, int* out_len) {
@@ -84,10 +273,18 @@ bool SrtpSession::unprotect_rtcp(void* p, int in_len, int* out_len) {
 
     int err = srtp_unprotect_rtcp(_session, p, out_len);
     if (err != srtp_err_status_ok) {
+        if (srtp_err_status_replay_fail == err || srtp_err_status_replay_old == err) {
+            ++_unprotect_stats.replay;
+        } else if (srtp_err_status_auth_fail == err) {
+            ++_unprotect_stats.auth;
+        } else {
+            ++_unprotect_stats.other;
+        }
         RTC_LOG(LS_WARNING) << "Failed to protect rtp packet, err=" << err;
         return false;
     }
 
+    _add_ssrc(read_be32((const uint8_t*)p + 4));
     return true;
 
 }
@@ -108,7 +305,28 @@ bool SrtpSession::protect_rtp(void*p, int in_len, int max_len, int* out_len) {
 
     *out_len = in_len;
     int err = srtp_protect(_session, p, out_len);
-    return err == srtp_err_status_ok;
+    if (err != srtp_err_status_ok) {
+        return false;
+    }
+
+    _add_ssrc(read_be32((const uint8_t*)p + 8));
+    return true;
+}
+
+void SrtpSession::protect_rtp_batch(SrtpProtectItem* items, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (i + 1 < count) {
+            SrtpProtectItem& next = items[i + 1];
+            if (next.session) {
+                __builtin_prefetch(next.session->_session);
+            }
+            __builtin_prefetch(next.data, 1);
+        }
+
+        SrtpProtectItem& item = items[i];
+        item.ok = item.session &&
+            item.session->protect_rtp(item.data, item.len, item.max_len, &item.len);
+    }
 }
 
 bool SrtpSession::protect_rtcp(void*p, int in_len, int max_len, int* out_len) {
@@ -117,7 +335,7 @@ bool SrtpSession::protect_rtcp(void*p, int in_len, int max_len, int* out_len) {
         return false;
     }
 
-    int need_len = in_len + _rtp_auth_tag_len + sizeof(uint32_t);
+    int need_len = in_len + _rtcp_auth_tag_len + sizeof(uint32_t);
     if (max_len < need_len) {
         RTC_LOG(LS_WARNING) << "Failed to protect rtcp packet: The buffer length "
             << max_len << " is less than needed " << need_len;
@@ -131,10 +349,73 @@ bool SrtpSession::protect_rtcp(void*p, int in_len, int max_len, int* out_len) {
         return false;
     }
 
+    _add_ssrc(read_be32((const uint8_t*)p + 4));
     return true;
 }
 
 
+static const int k_known_crypto_suites[] = {
+    rtc::kSrtpAeadAes128Gcm,
+    rtc::kSrtpAeadAes256Gcm,
+    rtc::kSrtpAes128CmSha1_80,
+    rtc::kSrtpAes128CmSha1_32,
+};
+
+std::vector<int> SrtpSession::get_supported_crypto_suites(
+        const std::vector<std::string>& names)
+{
+    std::vector<int> suites;
+    for (auto& name : names) {
+        int cs = rtc::kSrtpInvalidCryptoSuite;
+        for (int known : k_known_crypto_suites) {
+            if (rtc::SrtpCryptoSuiteToName(known) == name) {
+                cs = known;
+                break;
+            }
+        }
+
+        if (rtc::kSrtpInvalidCryptoSuite == cs) {
+            RTC_LOG(LS_WARNING) << "Unknown SRTP crypto suite: " << name;
+            continue;
+        }
+
+        if (!is_crypto_suite_supported(cs)) {
+            RTC_LOG(LS_WARNING) << "SRTP crypto suite not supported by libsrtp: " << name;
+            continue;
+        }
+
+        RTC_LOG(LS_INFO) << "SRTP crypto suite enabled: " << name;
+        suites.push_back(cs);
+    }
+
+    return suites;
+}
+
+bool SrtpSession::is_crypto_suite_supported(int cs) {
+    // 使用全零的key创建一个临时的session，cipher不可用时srtp_create会失败
+    srtp_policy_t policy;
+    memset(&policy, 0, sizeof(policy));
+    bool supported = false;
+    if (srtp_crypto_policy_set_from_profile_for_rtp(&policy.rtp,
+                (srtp_profile_t)cs) == srtp_err_status_ok &&
+            srtp_crypto_policy_set_from_profile_for_rtcp(&policy.rtcp,
+                (srtp_profile_t)cs) == srtp_err_status_ok)
+    {
+        uint8_t key[SRTP_MAX_KEY_LEN] = {0};
+        policy.ssrc.type = ssrc_any_outbound;
+        policy.key = key;
+        policy.window_size = 1024;
+
+        srtp_t session = nullptr;
+        if (srtp_create(&session, &policy) == srtp_err_status_ok) {
+            supported = true;
+            srtp_dealloc(session);
+        }
+    }
+
+    return supported;
+}
+
 bool SrtpSession::_update_key(int type, int cs, const uint8_t* key, size_t key_len,
         const std::vector<int>& extension_ids)
 {
@@ -145,9 +426,6 @@ bool SrtpSession::_update_key(int type, int cs, const uint8_t* key, size_t key_l
     return _do_set_key(type, cs, key, key_len, extension_ids);
 }
 
-ABSL_CONST_INIT int g_libsrtp_usage_count = 0;
-ABSL_CONST_INIT webrtc::GlobalMutex g_libsrtp_lock(absl::kConstInit);
-
 void SrtpSession::_event_handle_thunk(srtp_event_data_t* ev) {
     SrtpSession* session = (SrtpSession*)(srtp_get_user_data(ev->session));
     if (session) {
@@ -175,39 +453,6 @@ void SrtpSession::_handle_event(srtp_event_data_t* ev) {
     }
 }
 
-bool SrtpSession::_increment_libsrtp_usage_count_and_maybe_init() {
-    webrtc::GlobalMutexLock ls(&g_libsrtp_lock);
-
-    if (0 == g_libsrtp_usage_count) {
-        int err = srtp_init();
-        if (err != srtp_err_status_ok) {
-            RTC_LOG(LS_WARNING) << "Failed to init srtp, err: " << err;
-            return false;
-        }
-
-        err = srtp_install_event_handler(&SrtpSession::_event_handle_thunk);
-        if (err != srtp_err_status_ok) {
-            RTC_LOG(LS_WARNING) << "Failed to install srtp event, err: " << err;
-            return false;
-        }
-    }
-
-    g_libsrtp_usage_count++;
-    return true;
-}
-
-void SrtpSession::_decrement_libsrtp_usage_count_and_maybe_deinit() {
-    webrtc::GlobalMutexLock ls(&g_libsrtp_lock);
-
-    if (--g_libsrtp_usage_count == 0) {
-        int err = srtp_shutdown();
-        if (err) {
-            RTC_LOG(LS_WARNING) << "Failed to shutdown srtp, err: " << err;
-            return;
-        }
-    }
-}
-
 bool SrtpSession::_set_key(int type, int cs, const uint8_t* key, size_t key_len,
         const std::vector<int>& extension_ids)
 {
@@ -217,12 +462,6 @@ bool SrtpSession::_set_key(int type, int cs, const uint8_t* key, size_t key_len,
         return false;
     }
 
-    if (_increment_libsrtp_usage_count_and_maybe_init()) {
-        _inited = true;
-    } else {
-        return false;
-    }
-
     return _do_set_key(type, cs, key, key_len, extension_ids);
 }
 
@@ -251,17 +490,17 @@ bool SrtpSession::_do_set_key(int type, int cs, const uint8_t* key, size_t key_l
     policy.ssrc.type = (srtp_ssrc_type_t)type;
     policy.ssrc.value = 0;
     policy.key = (uint8_t*)key;
-    policy.window_size = 1024;
+    // 发送方向不做重放检查，窗口只对接收方向生效
+    policy.window_size = ssrc_any_inbound == type ? _replay_window : 1024;
     policy.allow_repeat_tx = 1;
     policy.next = nullptr;
 
     if (!_session) {
-        int err = srtp_create(&_session, &policy);
-        if (err != srtp_err_status_ok) {
-            RTC_LOG(LS_WARNING) << "Failed to create srtp, err: " << err;
-            _session = nullptr;
+        _session = SrtpContextPool::current()->acquire(&policy);
+        if (!_session) {
             return false;
         }
+        _type = policy.ssrc.type;
         srtp_set_user_data(_session, this);
     } else {
         int err = srtp_update(_session, &policy);
@@ -7,6 +7,66 @@
 
 namespace xrtc {
 
+class SrtpSession;
+
+// libsrtp为session中的每个SSRC克隆出的一个stream
+struct SrtpStreamInfo {
+    uint32_t ssrc = 0;
+    // 接收方向最近一次解密成功的RTP序号，用于区分ROC不一致
+    bool has_seq = false;
+    uint16_t last_seq = 0;
+};
+
+// 每个worker线程一个srtp_t上下文池，session释放时清理掉SSRC stream后放回，
+// 复用时用srtp_update重新设置key，整个过程不需要全局锁。
+// 复用省掉的是session本身的srtp_create/srtp_dealloc，并不是零分配:
+// srtp_update会重新分配stream模板(cipher和auth上下文)，
+// 释放时srtp_remove_stream也会释放克隆出来的每个SSRC的stream
+class SrtpContextPool {
+public:
+    SrtpContextPool() = default;
+    ~SrtpContextPool();
+
+    static SrtpContextPool* current();
+
+    // 预先创建count个发送和接收方向的上下文，需要在worker线程中调用
+    void reserve(size_t count);
+
+    srtp_t acquire(const srtp_policy_t* policy);
+    void release(srtp_t ctx, srtp_ssrc_type_t type,
+            const std::vector<SrtpStreamInfo>& streams);
+
+    size_t free_count(srtp_ssrc_type_t type);
+
+private:
+    std::vector<srtp_t>* _free_list(srtp_ssrc_type_t type);
+
+private:
+    std::vector<srtp_t> _free_inbound;
+    std::vector<srtp_t> _free_outbound;
+};
+
+// 批量加密的一项：同一个包发给多个订阅者时，每个订阅者各自的session和缓冲区
+struct SrtpProtectItem {
+    SrtpSession* session = nullptr;
+    char* data = nullptr;
+    int len = 0;
+    int max_len = 0;
+    bool ok = false;
+};
+
+// 解密失败按原因分类统计
+struct SrtpUnprotectStats {
+    uint64_t replay = 0;    // 重复包或者超出重放窗口的旧包
+    uint64_t auth = 0;      // 认证失败
+    uint64_t roc = 0;       // 认证失败且序号跨越了回绕点，很可能是ROC不一致
+    uint64_t other = 0;
+};
+
+// libsrtp的重放窗口取值范围
+const int k_srtp_min_replay_window = 64;
+const int k_srtp_max_replay_window = 0x7fff;
+
 class SrtpSession {
 public:
     SrtpSession();
@@ -25,6 +85,22 @@ public:
     bool protect_rtp(void*p, int in_len, int max_len, int* out_len);
     bool protect_rtcp(void*p, int in_len, int max_len, int* out_len);
     void get_auth_tag_len(int* rtp_auth_tag_len, int* _rtcp_auth_tag_len);
+    // 接收方向的重放窗口(包数)，需要在set_recv之前设置
+    void set_replay_window(int window_size);
+    const SrtpUnprotectStats& unprotect_stats() { return _unprotect_stats; }
+
+    // 进程启动时初始化一次libsrtp，退出时释放
+    static bool init_libsrtp();
+    static void shutdown_libsrtp();
+
+    // 按配置的顺序返回当前libsrtp可用的加密套件
+    // (例如libsrtp编译时没有开启openssl，则不支持AEAD_AES_GCM)
+    static std::vector<int> get_supported_crypto_suites(
+            const std::vector<std::string>& names);
+    static bool is_crypto_suite_supported(int cs);
+
+    // 在一个紧凑的循环里依次加密，处理当前项时预取下一项的session和包头
+    static void protect_rtp_batch(SrtpProtectItem* items, size_t count);
 
 private:
     bool _set_key(int type, int cs, const uint8_t* key, size_t key_len,
@@ -33,13 +109,19 @@ private:
         const std::vector<int>& extension_ids);
     bool _update_key(int type, int cs, const uint8_t* key, size_t key_len,
         const std::vector<int>& extension_ids);
-    static bool _increment_libsrtp_usage_count_and_maybe_init();
-    static void _decrement_libsrtp_usage_count_and_maybe_deinit();
+    // 记录libsrtp克隆出的stream，已经记录过的直接返回
+    SrtpStreamInfo* _add_ssrc(uint32_t ssrc);
+    void _on_unprotect_rtp_failed(const uint8_t* data, int len, int err);
     static void _event_handle_thunk(srtp_event_data_t* ev); 
     void _handle_event(srtp_event_data_t* ev);
 private:
     srtp_ctx_t* _session = nullptr;
-    bool _inited = false;
+    srtp_ssrc_type_t _type = ssrc_undefined;
+    // libsrtp为每个SSRC克隆了一个stream，归还上下文前需要删除
+    std::vector<SrtpStreamInfo> _streams;
+    size_t _last_stream = 0; // 上一个包所属的stream在_streams中的下标
+    int _replay_window = 1024;
+    SrtpUnprotectStats _unprotect_stats;
     int _rtp_auth_tag_len = 0;
     int _rtcp_auth_tag_len = 0;
 };
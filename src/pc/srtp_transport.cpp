@@ -55,9 +55,14 @@ void SrtpTransport::reset_params() {
     RTC_LOG(LS_INFO) << "The params in SRTP reset";
 }
 
+SrtpUnprotectStats SrtpTransport::unprotect_stats() {
+    return _recv_session ? _recv_session->unprotect_stats() : SrtpUnprotectStats();
+}
+
 void SrtpTransport::_create_srtp_session() {
     _send_session.reset(new SrtpSession());
     _recv_session.reset(new SrtpSession());
+    _recv_session->set_replay_window(_replay_window);
 }
 
 void SrtpTransport::get_send_auth_tag_len(int* rtp_auth_tag_len, int* rtcp_auth_tag_len) {
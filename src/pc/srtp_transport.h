@@ -29,6 +29,10 @@ public:
     bool protect_rtp(void*p, int in_len, int max_len, int* out_len);
     bool protect_rtcp(void*p, int in_len, int max_len, int* out_len);
     void get_send_auth_tag_len(int* rtp_auth_tag_len, int* rtcp_auth_tag_len);
+    SrtpSession* send_session() { return _send_session.get(); }
+    // 接收方向的重放窗口，在密钥设置之前调用
+    void set_replay_window(int window_size) { _replay_window = window_size; }
+    SrtpUnprotectStats unprotect_stats();
 
 private:
     void _create_srtp_session();
@@ -37,6 +41,7 @@ protected:
     bool _rtcp_mux_enabled;
     std::unique_ptr<SrtpSession> _send_session;
     std::unique_ptr<SrtpSession> _recv_session;
+    int _replay_window = 1024;
 };
 
 }
@@ -21,6 +21,8 @@ struct StreamParams {
     std::vector<SsrcGroup> ssrc_groups;
     std::string cname;
     std::string stream_id;
+    // 按RID区分的simulcast层(rfc8853)，从低到高，这时没有ssrc
+    std::vector<std::string> rids;
 };
 
 } // namespace xrtc
@@ -1,16 +1,20 @@
 #include <rtc_base/logging.h>
 
+#include "base/conf.h"
+
 #include "pc/transport_controller.h"
 #include "pc/dtls_transport.h"
 #include "pc/dtls_srtp_transport.h"
 #include "pc/peer_connection_def.h"
-#include "rtc_base/copy_on_write_buffer.h"
+
+extern xrtc::GeneralConf* g_conf;
 
 namespace xrtc {
 
-TransportController::TransportController(EventLoop* el, PortAllocator* allocator) :
+TransportController::TransportController(EventLoop* el, PortAllocator* allocator,
+        IceScheduler* scheduler) :
         _el(el),
-        _ice_agent(new IceAgent(el, allocator))
+        _ice_agent(new IceAgent(el, allocator, scheduler))
 {
     _ice_agent->signal_candidate_allocate_done.connect(this, 
             &TransportController::on_candidate_allocate_done);
@@ -59,6 +63,23 @@ DtlsTransport* TransportController::_get_dtls_transport(const std::string& trans
     return nullptr;
 }
 
+// 传输通道上是否有视频，bundle时看同一组里的所有content
+bool TransportController::_has_video(SessionDescription* desc, const std::string& mid) {
+    for (auto content : desc->contents()) {
+        if (content->type() != MediaType::MEDIA_TYPE_VIDEO) {
+            continue;
+        }
+
+        if (content->mid() == mid ||
+                (desc->is_bundle(mid) && desc->is_bundle(content->mid())))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void TransportController::_add_dtls_srtp_transport(DtlsSrtpTransport* dtls_srtp) {
     auto iter = _dtls_srtp_transport_by_name.find(dtls_srtp->transport_name());
     if (iter != _dtls_srtp_transport_by_name.end()) {
@@ -85,6 +106,7 @@ int TransportController::set_local_description(SessionDescription* desc) {
         return -1;
     }
 
+    bool new_channel = false;
     for (auto content : desc->contents()) {
         std::string mid = content->mid();
 
@@ -92,12 +114,21 @@ int TransportController::set_local_description(SessionDescription* desc) {
             continue;
         }
 
+        // ice restart: 通道已经存在，只更新ICE参数，DTLS/SRTP保持不变
+        bool exist = _ice_agent->get_channel(mid, IceCandidateComponent::RTP) != nullptr;
+
         _ice_agent->create_channel(_el, mid, IceCandidateComponent::RTP);
         auto td = desc->get_transport_info(mid);
         if (td) {
             _ice_agent->set_ice_params(mid, IceCandidateComponent::RTP, IceParamters(td->ice_ufrag, td->ice_pwd));
         }
 
+        if (exist) {
+            continue;
+        }
+
+        new_channel = true;
+
         DtlsTransport* dtls = new DtlsTransport(
             _ice_agent->get_channel(mid, IceCandidateComponent::RTP));
         dtls->set_local_certificate(_local_certificate);
@@ -112,6 +143,8 @@ int TransportController::set_local_description(SessionDescription* desc) {
 
         DtlsSrtpTransport* dtls_srtp = new DtlsSrtpTransport(dtls->transport_name(),
                 true); // 读写能力依赖于dtls
+        dtls_srtp->set_replay_window(_has_video(desc, mid)
+                ? g_conf->srtp_video_replay_window : g_conf->srtp_audio_replay_window);
         dtls_srtp->set_dtls_transport(dtls, nullptr);
         dtls_srtp->signal_rtp_packet_received.connect(this, 
             &TransportController::_on_rtp_packet_received);
@@ -120,19 +153,21 @@ int TransportController::set_local_description(SessionDescription* desc) {
         _add_dtls_srtp_transport(dtls_srtp);
     }
 
-    _ice_agent->gathering_candidate();
+    if (new_channel) {
+        _ice_agent->gathering_candidate();
+    }
 
     return 0;
 }
 
 void TransportController::_on_rtp_packet_received(DtlsSrtpTransport*,
-        rtc::CopyOnWriteBuffer* packet, int64_t ts)
+        PacketBuffer* packet, int64_t ts)
 {
     signal_rtp_packet_received(this, packet, ts);
 }
 
 void TransportController::_on_rtcp_packet_received(DtlsSrtpTransport*,
-        rtc::CopyOnWriteBuffer* packet, int64_t ts)
+        PacketBuffer* packet, int64_t ts)
 {
     signal_rtcp_packet_received(this, packet, ts);
 }
@@ -6,7 +6,7 @@
 #include "ice/ice_agent.h"
 #include "pc/session_description.h"
 #include "pc/peer_connection_def.h"
-#include "rtc_base/copy_on_write_buffer.h"
+#include "base/packet_buffer.h"
 #include "rtc_base/third_party/sigslot/sigslot.h"
 
 namespace xrtc {
@@ -17,7 +17,8 @@ enum class DtlsTransportState;
 
 class TransportController : public sigslot::has_slots<> {
 public:
-    TransportController(EventLoop* el, PortAllocator* allocator);
+    TransportController(EventLoop* el, PortAllocator* allocator,
+            IceScheduler* scheduler);
     ~TransportController();
 
     int set_local_description(SessionDescription* desc);
@@ -25,14 +26,17 @@ public:
     void set_local_certificate(rtc::RTCCertificate* cert);
     int send_rtp(const std::string& transport_name, const char* data, size_t len);
     int send_rtcp(const std::string& transport_name, const char* data, size_t len);
+    DtlsSrtpTransport* get_dtls_srtp_transport(const std::string& transport_name) {
+        return _get_dtls_srtp_transport(transport_name);
+    }
 
 public:
     sigslot::signal4<TransportController*, const std::string&, IceCandidateComponent,
         const std::vector<Candidate>&> signal_candidate_allocate_done;
     sigslot::signal2<TransportController*, PeerConnectionState> signal_connection_state;
-    sigslot::signal3<TransportController*, rtc::CopyOnWriteBuffer*, int64_t>
+    sigslot::signal3<TransportController*, PacketBuffer*, int64_t>
         signal_rtp_packet_received;
-    sigslot::signal3<TransportController*, rtc::CopyOnWriteBuffer*, int64_t>
+    sigslot::signal3<TransportController*, PacketBuffer*, int64_t>
         signal_rtcp_packet_received;
 private:
     void on_candidate_allocate_done(IceAgent* agent, 
@@ -43,14 +47,15 @@ private:
     void _on_dtls_writable_state(DtlsTransport*);
     void _on_dtls_state(DtlsTransport*, DtlsTransportState);
     void _on_rtp_packet_received(DtlsSrtpTransport*,
-            rtc::CopyOnWriteBuffer* packet, int64_t ts);
+            PacketBuffer* packet, int64_t ts);
     void _on_rtcp_packet_received(DtlsSrtpTransport*,
-            rtc::CopyOnWriteBuffer* packet, int64_t ts);
+            PacketBuffer* packet, int64_t ts);
     void _on_ice_state(IceAgent*, IceTransportState);
     void _update_state();
     void _add_dtls_transport(DtlsTransport* dtls);
     DtlsTransport* _get_dtls_transport(const std::string& transport_name);
     void _add_dtls_srtp_transport(DtlsSrtpTransport* dtls);
+    bool _has_video(SessionDescription* desc, const std::string& mid);
     DtlsSrtpTransport* _get_dtls_srtp_transport(const std::string& transport_name);
 
 private:
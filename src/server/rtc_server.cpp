@@ -1,18 +1,35 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
 
 #include <rtc_base/crc32.h>
 #include <rtc_base/rtc_certificate_generator.h>
 #include <rtc_base/logging.h>
 #include <yaml-cpp/yaml.h>
 
+#include "base/conf.h"
 #include "server/rtc_server.h"
 #include "rtc_base/rtc_certificate.h"
 #include "server/rtc_worker.h"
 
+extern xrtc::GeneralConf* g_conf;
+
 namespace xrtc {
 
 const uint64_t k_year_in_ms =  365 * 24 * 3600 * 1000UL;
+// 检查证书是否需要轮换的间隔
+const unsigned int k_cert_check_interval_us = 3600 * 1000000U;
+
+void rtc_server_cert_timer_cb(EventLoop* /*el*/, TimerWatcher* /*w*/, void* data) {
+    RtcServer* server = (RtcServer*)data;
+    server->_maybe_rotate_certificate();
+}
 
 void rtc_server_recv_notify(EventLoop* /*el*/, IOWatcher* /*w*/,
     int fd, int /*events*/, void* data)
@@ -35,6 +52,15 @@ RtcServer::RtcServer() :
 }
 
 RtcServer::~RtcServer() {
+    // 后台生成证书的线程完成后会向_el投递任务，需要先等待它结束
+    if (_cert_thread) {
+        if (_cert_thread->joinable()) {
+            _cert_thread->join();
+        }
+        delete _cert_thread;
+        _cert_thread = nullptr;
+    }
+
     if (_el) {
         delete _el;
         _el = nullptr;
@@ -54,26 +80,204 @@ RtcServer::~RtcServer() {
     _workers.clear();
 }
 
-int RtcServer::_generate_and_check_certificate() {
-    if (!_certificate || _certificate->HasExpired(time(NULL) * 1000)) {
-        rtc::KeyParams key_perams;
-        RTC_LOG(LS_INFO) << "dtls enabled, key type: " << key_perams.type();
-        _certificate = rtc::RTCCertificateGenerator::GenerateCertificate(key_perams,
-             k_year_in_ms);
-        if (_certificate) {
-            rtc::RTCCertificatePEM pem = _certificate->ToPEM();
-            RTC_LOG(INFO) << "rtc certificate: \n" << pem.certificate();
+static rtc::KeyParams get_key_params() {
+    if (g_conf->dtls_key_type == "rsa") {
+        return rtc::KeyParams::RSA(g_conf->dtls_rsa_modulus);
+    }
+
+    if (g_conf->dtls_key_type != "ecdsa") {
+        RTC_LOG(LS_WARNING) << "unknown dtls key type: " << g_conf->dtls_key_type
+            << ", use ecdsa";
+    }
+
+    return rtc::KeyParams::ECDSA(rtc::EC_NIST_P256);
+}
+
+static rtc::scoped_refptr<rtc::RTCCertificate> generate_certificate() {
+    rtc::KeyParams key_perams = get_key_params();
+    RTC_LOG(LS_INFO) << "generate dtls certificate, key type: " << key_perams.type();
+    rtc::scoped_refptr<rtc::RTCCertificate> certificate =
+        rtc::RTCCertificateGenerator::GenerateCertificate(key_perams, k_year_in_ms);
+    if (!certificate) {
+        RTC_LOG(LS_WARNING) << "generate dtls certificate failed";
+    }
+    return certificate;
+}
+
+static bool read_file(const std::string& filename, std::string* content) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << in.rdbuf();
+    *content = ss.str();
+    return !content->empty();
+}
+
+// 先写临时文件再rename，避免进程中途退出留下不完整的证书。
+// 临时文件创建时就使用mode，私钥在任何时刻都不会被其他用户读到
+static bool write_file(const std::string& filename, const std::string& content,
+        mode_t mode)
+{
+    std::string tmp_filename = filename + ".tmp";
+    int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fd < 0) {
+        RTC_LOG(LS_WARNING) << "open " << tmp_filename << " failed: " << strerror(errno);
+        return false;
+    }
+
+    // 临时文件之前已经存在时，open不会修改它的权限
+    bool ok = fchmod(fd, mode) == 0;
+    if (!ok) {
+        RTC_LOG(LS_WARNING) << "chmod " << tmp_filename << " failed: " << strerror(errno);
+    }
+
+    size_t written = 0;
+    while (ok && written < content.size()) {
+        ssize_t ret = write(fd, content.data() + written, content.size() - written);
+        if (ret < 0 && EINTR == errno) {
+            continue;
         }
+
+        if (ret < 0) {
+            RTC_LOG(LS_WARNING) << "write " << tmp_filename << " failed: "
+                << strerror(errno);
+            ok = false;
+            break;
+        }
+
+        written += ret;
+    }
+
+    if (close(fd) != 0) {
+        ok = false;
+    }
+
+    if (!ok || rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        unlink(tmp_filename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+rtc::scoped_refptr<rtc::RTCCertificate> RtcServer::_load_certificate() {
+    if (_options.cert_file.empty() || _options.key_file.empty()) {
+        return nullptr;
+    }
+
+    std::string cert_pem;
+    std::string key_pem;
+    if (!read_file(_options.cert_file, &cert_pem) ||
+            !read_file(_options.key_file, &key_pem))
+    {
+        RTC_LOG(LS_INFO) << "no persisted dtls certificate: " << _options.cert_file;
+        return nullptr;
+    }
+
+    rtc::scoped_refptr<rtc::RTCCertificate> certificate =
+        rtc::RTCCertificate::FromPEM(rtc::RTCCertificatePEM(key_pem, cert_pem));
+    if (!certificate) {
+        RTC_LOG(LS_WARNING) << "load dtls certificate failed: " << _options.cert_file;
+        return nullptr;
+    }
+
+    if (certificate->HasExpired(time(NULL) * 1000)) {
+        RTC_LOG(LS_INFO) << "persisted dtls certificate expired: " << _options.cert_file;
+        return nullptr;
+    }
+
+    RTC_LOG(LS_INFO) << "load dtls certificate: " << _options.cert_file
+        << ", expires: " << certificate->Expires();
+    return certificate;
+}
+
+void RtcServer::_save_certificate(rtc::RTCCertificate* certificate) {
+    if (_options.cert_file.empty() || _options.key_file.empty()) {
+        return;
     }
 
+    rtc::RTCCertificatePEM pem = certificate->ToPEM();
+    if (!write_file(_options.key_file, pem.private_key(), 0600) ||
+            !write_file(_options.cert_file, pem.certificate(), 0644))
+    {
+        RTC_LOG(LS_WARNING) << "save dtls certificate failed: " << _options.cert_file
+            << ", errno: " << errno;
+        return;
+    }
+
+    RTC_LOG(LS_INFO) << "save dtls certificate: " << _options.cert_file;
+}
+
+bool RtcServer::_need_rotate_certificate(rtc::RTCCertificate* certificate) {
+    uint64_t now_ms = time(NULL) * 1000;
+    return certificate->Expires() <=
+        now_ms + (uint64_t)_options.cert_rotate_before_sec * 1000;
+}
+
+int RtcServer::_init_certificate() {
+    // 优先使用持久化的证书，只有第一次启动或者证书过期时才同步生成
+    _certificate = _load_certificate();
     if (!_certificate) {
-        RTC_LOG(LS_WARNING) << "get certificate error";
-        return -1;
+        _certificate = generate_certificate();
+        if (!_certificate) {
+            return -1;
+        }
+        _save_certificate(_certificate.get());
     }
 
+    rtc::RTCCertificatePEM pem = _certificate->ToPEM();
+    RTC_LOG(INFO) << "rtc certificate: \n" << pem.certificate();
+
+    _cert_timer = _el->create_timer(rtc_server_cert_timer_cb, this, true);
+    _el->start_timer(_cert_timer, k_cert_check_interval_us);
+    _maybe_rotate_certificate();
+
     return 0;
 }
 
+void RtcServer::_maybe_rotate_certificate() {
+    if (_cert_generating || !_need_rotate_certificate(_certificate.get())) {
+        return;
+    }
+
+    if (_cert_thread) {
+        if (_cert_thread->joinable()) {
+            _cert_thread->join();
+        }
+        delete _cert_thread;
+        _cert_thread = nullptr;
+    }
+
+    // 密钥生成在后台线程进行，完成后回到RtcServer线程替换
+    RTC_LOG(LS_INFO) << "dtls certificate expires at " << _certificate->Expires()
+        << ", pre-generate the next one";
+    _cert_generating = true;
+    _cert_thread = new std::thread([=]() {
+        rtc::scoped_refptr<rtc::RTCCertificate> certificate = generate_certificate();
+        _el->post_task([=]() {
+            _on_certificate_generated(certificate);
+        });
+    });
+}
+
+void RtcServer::_on_certificate_generated(
+        rtc::scoped_refptr<rtc::RTCCertificate> certificate)
+{
+    _cert_generating = false;
+    if (!certificate) {
+        // 下一次定时检查时重试
+        return;
+    }
+
+    _save_certificate(certificate.get());
+    _prev_certificate = _certificate;
+    _certificate = certificate;
+    RTC_LOG(LS_INFO) << "dtls certificate rotated, expires: " << _certificate->Expires();
+}
+
 int RtcServer::init(const char* conf_file) {
     if (!conf_file) {
         RTC_LOG(LS_WARNING) << "conf_file is null";
@@ -83,15 +287,30 @@ int RtcServer::init(const char* conf_file) {
     try {
         YAML::Node config = YAML::LoadFile(conf_file);
         _options.worker_num = config["worker_num"].as<int>();
+        if (config["worker_ifaces"]) {
+            _options.worker_ifaces = config["worker_ifaces"].as<std::vector<std::string>>();
+        }
+        if (config["certificate"]) {
+            YAML::Node cert = config["certificate"];
+            if (cert["cert_file"]) {
+                _options.cert_file = cert["cert_file"].as<std::string>();
+            }
+            if (cert["key_file"]) {
+                _options.key_file = cert["key_file"].as<std::string>();
+            }
+            if (cert["rotate_before_sec"]) {
+                _options.cert_rotate_before_sec = cert["rotate_before_sec"].as<int>();
+            }
+        }
     } catch (YAML::Exception& e) {
         RTC_LOG(LS_WARNING) << "rtc server load conf file error: " << e.msg;
         return -1;
     }
 
-    // 生成证书
-    if (_generate_and_check_certificate() != 0) {
+    // 加载或生成证书
+    if (_init_certificate() != 0) {
         return -1;
-    } 
+    }
 
     int fds[2];
     if (-1 == pipe(fds)) {
@@ -186,6 +405,10 @@ int RtcServer::send_rtc_msg(std::shared_ptr<RtcMsg> msg) {
 void RtcServer::_stop() {
     RTC_LOG(INFO) << "[DEBUG] RtcServer::_stop";
     _el->delete_io_event(_pipe_watcher);
+    if (_cert_timer) {
+        _el->delete_timer(_cert_timer);
+        _cert_timer = nullptr;
+    }
     _el->stop();
     close(_notify_recv_fd);
     close(_notify_send_fd);
@@ -200,29 +423,55 @@ void RtcServer::_stop() {
     }
 }
 
-RtcWorker* RtcServer::_get_worker(const std::string& stream_name) {
+RtcWorker* RtcServer::_get_worker(const std::string& key) {
     if (_workers.size() == 0 || _workers.size() != (size_t)_options.worker_num) {
         return nullptr;
     }
     
-    uint32_t num = rtc::ComputeCrc32(stream_name);
+    uint32_t num = rtc::ComputeCrc32(key);
     size_t index = num % _options.worker_num;
     return _workers[index];
 }
 
+// 推流按stream_name分配worker；开启跨worker转发时，拉流按stream_name+uid分散，
+// 同一个拉流的所有请求仍然落在同一个worker上
+std::string RtcServer::_get_worker_key(std::shared_ptr<RtcMsg> msg) {
+    if (!g_conf->fanout_cross_worker) {
+        return msg->stream_name;
+    }
+
+    bool pull = false;
+    switch (msg->cmdno) {
+        case CMDNO_PULL:
+        case CMDNO_STOPPULL:
+            pull = true;
+            break;
+        case CMDNO_ANSWER:
+        case CMDNO_ICE_RESTART:
+            pull = ("pull" == msg->stream_type);
+            break;
+        default:
+            break;
+    }
+
+    return pull ? msg->stream_name + "_" + std::to_string(msg->uid) : msg->stream_name;
+}
+
 void RtcServer::_process_rtc_msg() {
     std::shared_ptr<RtcMsg> msg = pop_msg();
     if (!msg) {
         return;
     }
 
-    if (_generate_and_check_certificate() != 0) {
+    // 证书轮换在后台完成，请求处理不会触发密钥生成
+    if (!_certificate) {
+        RTC_LOG(LS_WARNING) << "get certificate error";
         return;
     }
 
     msg->certificate = _certificate.get();
 
-    RtcWorker* worker = _get_worker(msg->stream_name);
+    RtcWorker* worker = _get_worker(_get_worker_key(msg));
     if (worker) {
         worker->send_rtc_msg(msg);
     }
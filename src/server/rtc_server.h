@@ -5,6 +5,8 @@
 #include <mutex>
 #include <memory>
 #include <thread>
+#include <string>
+#include <vector>
 
 #include <rtc_base/rtc_certificate.h>
 
@@ -16,6 +18,12 @@ namespace xrtc {
 
 struct RtcServerOptions {
     int worker_num;
+    std::vector<std::string> worker_ifaces; // worker_id % size选择优先使用的网卡
+    // DTLS证书持久化的文件，为空表示不持久化
+    std::string cert_file;
+    std::string key_file;
+    // 证书过期前多久在后台生成下一个证书
+    int cert_rotate_before_sec = 7 * 24 * 3600;
 };
 
 class RtcWorker;
@@ -40,14 +48,21 @@ public:
     std::shared_ptr<RtcMsg> pop_msg();
 
     friend void rtc_server_recv_notify(EventLoop*, IOWatcher*, int, int, void*);
+    friend void rtc_server_cert_timer_cb(EventLoop*, TimerWatcher*, void*);
 
 private:
     void _process_notify(int msg);
     void _stop();
     void _process_rtc_msg();
     int _create_worker(int worker_id);
-    RtcWorker* _get_worker(const std::string& stream_name);
-    int _generate_and_check_certificate();
+    RtcWorker* _get_worker(const std::string& key);
+    std::string _get_worker_key(std::shared_ptr<RtcMsg> msg);
+    int _init_certificate();
+    rtc::scoped_refptr<rtc::RTCCertificate> _load_certificate();
+    void _save_certificate(rtc::RTCCertificate* certificate);
+    bool _need_rotate_certificate(rtc::RTCCertificate* certificate);
+    void _maybe_rotate_certificate();
+    void _on_certificate_generated(rtc::scoped_refptr<rtc::RTCCertificate> certificate);
 
 private:
     EventLoop* _el;    
@@ -62,7 +77,13 @@ private:
     std::mutex _q_msg_mutex;
 
     std::vector<RtcWorker*> _workers;
+    // 证书只在RtcServer线程上读写；旧证书保留到下一次轮换，
+    // 保证已经投递给worker但还没有处理的请求引用的证书有效
     rtc::scoped_refptr<rtc::RTCCertificate> _certificate;
+    rtc::scoped_refptr<rtc::RTCCertificate> _prev_certificate;
+    TimerWatcher* _cert_timer = nullptr;
+    std::thread* _cert_thread = nullptr;
+    bool _cert_generating = false;
 };
 
 } // namespace xrtc
@@ -3,8 +3,11 @@
 #include "server/rtc_worker.h"
 #include "rtc_base/rtc_certificate.h"
 #include "server/signaling_worker.h"
+#include "base/conf.h"
+#include "pc/srtp_session.h"
 #include "xrtc_server_def.h"
 
+extern xrtc::GeneralConf* g_conf;
 
 namespace xrtc {
 
@@ -23,11 +26,19 @@ void rtc_worker_recv_notify(EventLoop* /*el*/, IOWatcher* /*w*/, int fd,
 
 }
 
+static std::string get_preferred_iface(int worker_id, const RtcServerOptions& options) {
+    if (options.worker_ifaces.empty()) {
+        return "";
+    }
+
+    return options.worker_ifaces[worker_id % options.worker_ifaces.size()];
+}
+
 RtcWorker::RtcWorker(int worker_id, const RtcServerOptions& options) :
     _options(options),
     _worker_id(worker_id),
     _el(new EventLoop(this)),
-    _rtc_stream_mgr(new RtcStreamManager(_el))
+    _rtc_stream_mgr(new RtcStreamManager(_el, get_preferred_iface(worker_id, options)))
 {
 
 }
@@ -69,6 +80,7 @@ bool RtcWorker::start() {
 
     _thread = new std::thread([=]() {
         RTC_LOG(INFO) << "rtc worker event loop start, worker_id: " << _worker_id;
+        SrtpContextPool::current()->reserve(g_conf->srtp_context_pool_size);
         _el->start();
         RTC_LOG(INFO) << "rtc worker event loop stop, worker_id: " << _worker_id;
     }); 
@@ -189,6 +201,29 @@ void RtcWorker::_process_answer(std::shared_ptr<RtcMsg> msg) {
         << ", ret: " << ret;
 }
 
+void RtcWorker::_process_ice_restart(std::shared_ptr<RtcMsg> msg) {
+    std::string offer;
+    int ret = _rtc_stream_mgr->restart_ice(msg->uid, msg->stream_name,
+        msg->stream_type, msg->log_id, offer);
+
+    RTC_LOG(LS_INFO) << "rtc worker process ice restart, uid: " << msg->uid
+        << ", stream_name: " << msg->stream_name
+        << ", worker_id: " << _worker_id
+        << ", log_id: " << msg->log_id
+        << ", ret: " << ret
+        << ", offer: " << offer;
+
+    msg->sdp = offer;
+    if (ret != 0) {
+        msg->err_no = -1;
+    }
+
+    SignalingWorker* worker = (SignalingWorker*)(msg->worker);
+    if (worker) {
+        worker->send_rtc_msg(msg);
+    }
+}
+
 void RtcWorker::_process_rtc_msg() {
     std::shared_ptr<RtcMsg> msg;
     if (!pop_msg(&msg)) {
@@ -216,6 +251,9 @@ void RtcWorker::_process_rtc_msg() {
         case CMDNO_ANSWER:
             _process_answer(msg);
             break;
+        case CMDNO_ICE_RESTART:
+            _process_ice_restart(msg);
+            break;
 
         default:
             RTC_LOG(LS_WARNING) << "unknown cmdno: " << msg->cmdno
@@ -42,6 +42,7 @@ private:
     void _process_stop_push(std::shared_ptr<RtcMsg> msg);
     void _process_stop_pull(std::shared_ptr<RtcMsg> msg);
     void _process_answer(std::shared_ptr<RtcMsg> msg);
+    void _process_ice_restart(std::shared_ptr<RtcMsg> msg);
 
 private:
     RtcServerOptions _options;
@@ -318,6 +318,9 @@ int SignalingWorker::_process_request(TcpConnection* c,
         case CMDNO_PULL:
             return _process_pull(cmdno, c, root, xh->log_id);
 
+        case CMDNO_ICE_RESTART:
+            return _process_ice_restart(cmdno, c, root, xh->log_id);
+
         case CMDNO_STOPPUSH:
             ret = _process_stop_push(cmdno, c, root, xh->log_id);
             break;
@@ -546,6 +549,43 @@ int SignalingWorker::_process_answer(int cmdno, TcpConnection* c,
     return g_rtc_server->send_rtc_msg(msg);
 }
 
+int SignalingWorker::_process_ice_restart(int cmdno, TcpConnection* c, 
+    const json& root, uint32_t log_id) 
+{
+    uint64_t uid;
+    std::string stream_name;
+    std::string stream_type;
+
+    try {
+        uid = root.at("uid");
+        stream_name = root.at("stream_name");
+        stream_type = root.at("type");
+
+    } catch (const json::out_of_range& e) {
+        RTC_LOG(LS_WARNING) << "parse error: " << e.what()
+            << ", fd: " << c->fd
+            << ", log_id: " << log_id;
+        return -1;
+    }
+
+    RTC_LOG(LS_INFO) << "cmdno[" << cmdno
+        << "] uid[" << uid
+        << "] stream_name[" << stream_name
+        << "] stream_type[" << stream_type
+        << "] signaling server ice restart request";
+
+    std::shared_ptr<RtcMsg> msg = std::make_shared<RtcMsg>();
+    msg->cmdno = cmdno;
+    msg->uid = uid;
+    msg->stream_name = stream_name;
+    msg->stream_type = stream_type;
+    msg->log_id = log_id;
+    msg->worker = this;
+    msg->conn = c;
+    msg->fd = c->fd;
+
+    return g_rtc_server->send_rtc_msg(msg);
+}
 
 void SignalingWorker::_response_server_offer(std::shared_ptr<RtcMsg> msg) {
     TcpConnection* c = (TcpConnection*)msg->conn;
@@ -617,6 +657,7 @@ void SignalingWorker::_process_rtc_msg() {
     {
     case CMDNO_PUSH:
     case CMDNO_PULL:
+    case CMDNO_ICE_RESTART:
         _response_server_offer(msg);
         break;
     
@@ -62,6 +62,7 @@ private:
     int _process_answer(int cmdno, TcpConnection* c, const json& root, uint32_t log_id);
     int _process_stop_push(int cmdno, TcpConnection* c, const json& root, uint32_t log_id);
     int _process_stop_pull(int cmdno, TcpConnection* c, const json& root, uint32_t log_id);
+    int _process_ice_restart(int cmdno, TcpConnection* c, const json& root, uint32_t log_id);
     
     void _process_rtc_msg();
     void _response_server_offer(std::shared_ptr<RtcMsg>);
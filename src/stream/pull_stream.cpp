@@ -1,27 +1,49 @@
+#include <stdlib.h>
+
+#include <algorithm>
+
 #include "stream/pull_stream.h"
 #include "ice/port_allocator.h"
+#include "pc/dtls_srtp_transport.h"
 #include <rtc_base/logging.h>
 
 namespace xrtc {
 
-PullStream::PullStream(EventLoop* el, PortAllocator* allocator, uint64_t uid, const std::string& stream_name,
+PullStream::PullStream(EventLoop* el, PortAllocator* allocator, IceScheduler* scheduler,
+        uint64_t uid, const std::string& stream_name,
         bool audio, bool video, uint32_t log_id) :
-    RtcStream(el, allocator, uid, stream_name, audio, video, log_id)
+    RtcStream(el, allocator, scheduler, uid, stream_name, audio, video, log_id)
 {
 
 }
 
 PullStream::~PullStream() {
     RTC_LOG(LS_INFO) << to_string() << ": Pull stream destroy";
+
+    for (auto& item : _reports) {
+        const RtcpReportBlock& block = item.second.block;
+        RTC_LOG(LS_INFO) << to_string() << ": ssrc: " << item.first
+            << ", fraction_lost: " << (int)block.fraction_lost
+            << ", lost: " << block.cumulative_lost
+            << ", jitter: " << block.jitter
+            << ", rtt: " << item.second.rtt_ms << "ms";
+    }
+
+    if (_feedback_count > 0) {
+        RTC_LOG(LS_INFO) << to_string() << ": transport feedback: " << _feedback_count
+            << ", target_bitrate: " << target_bitrate_bps() << "bps";
+    }
 }
 
 // 对于xrtcserver来说，是向PullStream发送音视频
-std::string PullStream::create_offer() {
+std::string PullStream::create_offer(bool ice_restart) {
     RTCOfferAnswerOptions options;
+    options.ice_restart = ice_restart;
     options.send_audio = _audio;
     options.send_video = _video;
     options.recv_audio = false;
     options.recv_video = false;
+    options.transport_cc = true;
     //options.use_rtcp_mux = false;  // rtp和rtcp是否复用的选项
 
     return _pc->create_offer(options);
@@ -39,4 +61,53 @@ void PullStream::add_video_source(const std::vector<StreamParams>& source) {
     }
 }
 
-}
\ No newline at end of file
+uint16_t PullStream::next_rtx_seq(uint32_t rtx_ssrc) {
+    auto iter = _rtx_seqs.find(rtx_ssrc);
+    if (iter == _rtx_seqs.end()) {
+        iter = _rtx_seqs.emplace(rtx_ssrc, (uint16_t)(rand() & 0x7fff)).first;
+    }
+
+    return iter->second++;
+}
+
+void PullStream::on_report_block(const RtcpReportBlock& block, int64_t rtt_ms) {
+    ReceiverReport& report = _reports[block.ssrc];
+    report.block = block;
+    if (rtt_ms >= 0) {
+        report.rtt_ms = rtt_ms;
+    }
+}
+
+void PullStream::on_transport_feedback(const TransportFeedback& feedback,
+        int64_t now_ms)
+{
+    if (!_pc) {
+        return;
+    }
+
+    DtlsSrtpTransport* transport = _pc->get_transport_by_ssrc(feedback.media_ssrc);
+    if (!transport || !transport->bwe()) {
+        return;
+    }
+
+    ++_feedback_count;
+    transport->bwe()->on_transport_feedback(feedback, now_ms);
+}
+
+int64_t PullStream::target_bitrate_bps() {
+    // 没有bundle时音频和视频各自有一个带宽估计
+    DtlsSrtpTransport* audio = rtp_transport(MediaType::MEDIA_TYPE_AUDIO);
+    DtlsSrtpTransport* video = rtp_transport(MediaType::MEDIA_TYPE_VIDEO);
+    int64_t target = -1;
+    if (audio && audio->bwe()) {
+        target = audio->bwe()->target_bitrate_bps();
+    }
+
+    if (video && video != audio && video->bwe()) {
+        target = std::max(target, (int64_t)0) + video->bwe()->target_bitrate_bps();
+    }
+
+    return target;
+}
+
+}
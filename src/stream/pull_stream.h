@@ -1,7 +1,11 @@
 #ifndef __PULL_STREAM_H_
 #define __PULL_STREAM_H_
 
+#include <unordered_map>
+
 #include "ice/port_allocator.h"
+#include "module/rtp_rtcp/rtcp_report.h"
+#include "module/rtp_rtcp/transport_feedback.h"
 #include "pc/stream_params.h"
 #include "stream/rtc_stream.h"
 
@@ -9,16 +13,36 @@ namespace xrtc {
 
 class PullStream : public RtcStream {
 public:
-    PullStream(EventLoop* el, PortAllocator* alloctor, uint64_t uid, 
+    PullStream(EventLoop* el, PortAllocator* alloctor, IceScheduler* scheduler,
+        uint64_t uid,
         const std::string& stream_name,
         bool audio, bool video, uint32_t log_id);
 
     ~PullStream() override;
-    std::string create_offer() override;
+    std::string create_offer(bool ice_restart = false) override;
     RtcStreamType stream_type() override { return RtcStreamType::k_pull; }
 
     void add_audio_source(const std::vector<StreamParams>& source);
     void add_video_source(const std::vector<StreamParams>& source);
+
+    // 服务器重传使用的RTX序号，每个订阅者独立
+    uint16_t next_rtx_seq(uint32_t rtx_ssrc);
+
+    // 订阅者RR中服务器到订阅者这一段的统计，rtt_ms没有时为-1
+    void on_report_block(const RtcpReportBlock& block, int64_t rtt_ms);
+    // 订阅者的TWCC反馈，交给对应传输通道的带宽估计
+    void on_transport_feedback(const TransportFeedback& feedback, int64_t now_ms);
+    // 服务器到这个订阅者的目标码率，没有协商transport-wide-cc时返回-1
+    int64_t target_bitrate_bps();
+
+private:
+    std::unordered_map<uint32_t, uint16_t> _rtx_seqs;
+    struct ReceiverReport {
+        RtcpReportBlock block;
+        int64_t rtt_ms = -1;
+    };
+    std::unordered_map<uint32_t, ReceiverReport> _reports;
+    uint64_t _feedback_count = 0;
 };
 
 }
@@ -5,23 +5,37 @@
 
 namespace xrtc {
 
-PushStream::PushStream(EventLoop* el, PortAllocator* allocator, uint64_t uid, const std::string& stream_name,
+PushStream::PushStream(EventLoop* el, PortAllocator* allocator, IceScheduler* scheduler,
+        uint64_t uid, const std::string& stream_name,
         bool audio, bool video, uint32_t log_id) :
-    RtcStream(el, allocator, uid, stream_name, audio, video, log_id)
+    RtcStream(el, allocator, scheduler, uid, stream_name, audio, video, log_id)
 {
 
 }
 
 PushStream::~PushStream() {
-    RTC_LOG(LS_INFO) << to_string() << ": Push stream destroy";
+    const KeyframeRequestStats& stats = _subscribers.keyframe_request_stats();
+    RTC_LOG(LS_INFO) << to_string() << ": Push stream destroy"
+        << ", keyframe requests received: " << stats.received
+        << ", sent: " << stats.sent << ", suppressed: " << stats.suppressed;
+
+    for (auto& item : _receive_statistics.streams()) {
+        const StreamStatistician& stream = item.second;
+        RTC_LOG(LS_INFO) << to_string() << ": ssrc: " << item.first
+            << ", received: " << stream.received()
+            << ", lost: " << stream.cumulative_lost()
+            << ", jitter: " << stream.jitter() * 1000 / stream.clockrate() << "ms";
+    }
 }
 
-std::string PushStream::create_offer() {
+std::string PushStream::create_offer(bool ice_restart) {
     RTCOfferAnswerOptions options;
+    options.ice_restart = ice_restart;
     options.send_audio = false;
     options.send_video = false;
     options.recv_audio = _audio;
     options.recv_video = _video;
+    options.recv_simulcast_rids = _simulcast_rids;
     //options.use_rtcp_mux = false;  // rtp和rtcp是否复用的选项
 
     return _pc->create_offer(options);
@@ -35,6 +49,51 @@ bool PushStream::get_video_source(std::vector<StreamParams>& source) {
     return _get_source("video", source);
 }
 
+bool PushStream::get_video_codecs(std::unordered_map<uint8_t, VideoCodecType>& codecs) {
+    if (!_pc || !_pc->remote_desc()) {
+        return false;
+    }
+
+    auto content = _pc->remote_desc()->get_content("video");
+    if (!content) {
+        return false;
+    }
+
+    for (auto codec : content->get_codecs()) {
+        VideoCodecType type = video_codec_type(codec->name);
+        if (VideoCodecType::k_unknown != type) {
+            codecs[codec->id] = type;
+        }
+    }
+
+    return true;
+}
+
+void PushStream::get_rid_extensions(int* rid_ext_id, int* repaired_rid_ext_id) {
+    *rid_ext_id = 0;
+    *repaired_rid_ext_id = 0;
+    if (!_pc || !_pc->remote_desc()) {
+        return;
+    }
+
+    auto content = _pc->remote_desc()->get_content("video");
+    if (!content) {
+        return;
+    }
+
+    *rid_ext_id = content->find_rtp_header_extension(k_rtp_rid_uri);
+    *repaired_rid_ext_id = content->find_rtp_header_extension(k_rtp_repaired_rid_uri);
+}
+
+int PushStream::get_dependency_descriptor_extension() {
+    if (!_pc || !_pc->remote_desc()) {
+        return 0;
+    }
+
+    auto content = _pc->remote_desc()->get_content("video");
+    return content ? content->find_rtp_header_extension(k_rtp_dependency_descriptor_uri) : 0;
+}
+
 bool PushStream::_get_source(const std::string& mid, std::vector<StreamParams>& source) {
     if (!_pc) {
         return false;
@@ -1,27 +1,64 @@
 #ifndef __PUSH_STREAM_H_
 #define __PUSH_STREAM_H_
 
+#include <unordered_map>
+
 #include "ice/port_allocator.h"
+#include "module/rtp_rtcp/receive_statistics.h"
+#include "module/rtp_rtcp/rtp_video_header.h"
 #include "pc/stream_params.h"
 #include "stream/rtc_stream.h"
+#include "stream/stream_hub.h"
+#include "stream/subscriber_set.h"
 
 namespace xrtc {
 
 class PushStream : public RtcStream {
 public:
-    PushStream(EventLoop* el, PortAllocator* alloctor, uint64_t uid, 
+    PushStream(EventLoop* el, PortAllocator* alloctor, IceScheduler* scheduler,
+        uint64_t uid,
         const std::string& stream_name,
         bool audio, bool video, uint32_t log_id);
 
     ~PushStream() override;
-    std::string create_offer() override;
+    std::string create_offer(bool ice_restart = false) override;
     RtcStreamType stream_type() override { return RtcStreamType::k_push; }
 
     bool get_audio_source(std::vector<StreamParams>& source);
     bool get_video_source(std::vector<StreamParams>& source);
+    // 协商的视频payload type和编码格式
+    bool get_video_codecs(std::unordered_map<uint8_t, VideoCodecType>& codecs);
+    // 协商的RID和repaired RID头扩展的id，没有协商时为0
+    void get_rid_extensions(int* rid_ext_id, int* repaired_rid_ext_id);
+    // 协商的AV1依赖描述符头扩展的id，没有协商时为0
+    int get_dependency_descriptor_extension();
+    // create_offer之前设置，请求推流端按这些RID发送simulcast(从低到高)
+    void set_simulcast_rids(const std::vector<std::string>& rids) { _simulcast_rids = rids; }
+
+    // 订阅者的生命周期由RtcStreamManager管理，这里只保存引用
+    SubscriberSet* subscribers() { return &_subscribers; }
+    // 开启跨worker转发时，其他worker通过hub订阅
+    HubStream* hub() { return _hub.get(); }
+    // 第一个answer之后已经按推流的ssrc建立了转发，ICE重启的answer不再重建
+    bool has_sources() { return _has_sources; }
+    void set_has_sources(bool has_sources) { _has_sources = has_sources; }
+    void set_hub(std::shared_ptr<HubStream> hub) { _hub = hub; }
+
+    // 推流端每个ssrc的接收统计，服务器按周期发送自己的RR
+    ReceiveStatistics* receive_statistics() { return &_receive_statistics; }
+    int64_t next_report_ms() { return _next_report_ms; }
+    void set_next_report_ms(int64_t next_report_ms) { _next_report_ms = next_report_ms; }
 
 private:
     bool _get_source(const std::string& mid, std::vector<StreamParams>& source);
+
+private:
+    SubscriberSet _subscribers;
+    std::shared_ptr<HubStream> _hub;
+    ReceiveStatistics _receive_statistics;
+    int64_t _next_report_ms = 0;
+    std::vector<std::string> _simulcast_rids;
+    bool _has_sources = false;
 };
 
 }
@@ -0,0 +1,95 @@
+#include "stream/relay_stream.h"
+
+#include <rtc_base/logging.h>
+#include <rtc_base/time_utils.h>
+
+#include "module/rtp_rtcp/rtcp_report.h"
+#include "stream/pull_stream.h"
+
+namespace xrtc {
+
+RelayStream::RelayStream(EventLoop* el, std::shared_ptr<HubStream> hub) :
+    _el(el),
+    _hub(hub),
+    _next_seq(hub->ring()->head())
+{
+}
+
+RelayStream::~RelayStream() {
+    if (_reader) {
+        _reader->active = false;
+        _hub->remove_reader(_reader);
+    }
+
+    const KeyframeRequestStats& stats = _subscribers.keyframe_request_stats();
+    RTC_LOG(LS_INFO) << "relay stream destroy, stream_name: " << _hub->stream_name()
+        << ", lost: " << _lost
+        << ", keyframe requests received: " << stats.received
+        << ", sent: " << stats.sent << ", suppressed: " << stats.suppressed;
+}
+
+void RelayStream::start(std::function<void()> on_readable) {
+    _reader = std::make_shared<HubReader>();
+    _reader->el = _el;
+    _reader->on_readable = std::move(on_readable);
+    _hub->add_reader(_reader);
+}
+
+bool RelayStream::drain() {
+    BroadcastRing* ring = _hub->ring();
+    BroadcastPacket* packet = nullptr;
+    while (true) {
+        uint64_t seq = _next_seq;
+        int ret = ring->read(&_next_seq, &packet);
+        if (BroadcastRing::k_read_empty == ret) {
+            break;
+        }
+
+        if (BroadcastRing::k_read_overrun == ret) {
+            // 本worker处理不过来，被覆盖的包直接丢弃，由NACK/PLI恢复
+            if (_lost == 0 || (_lost / 1000) != ((_lost + _next_seq - seq) / 1000)) {
+                RTC_LOG(LS_WARNING) << "relay stream overrun, stream_name: "
+                    << _hub->stream_name() << ", lost: " << _lost + _next_seq - seq;
+            }
+            _lost += _next_seq - seq;
+            continue;
+        }
+
+        if (HubStream::k_rtp == packet->type()) {
+            if (!_subscribers.empty() || _subscribers.gop_cache()) {
+                _subscribers.forward_rtp(packet->data(), packet->size());
+            }
+        } else {
+            _on_publisher_rtcp(packet->data(), packet->size());
+        }
+
+        BroadcastRing::release(packet);
+    }
+
+    // 本worker内合并的关键帧请求，推流所在worker会再合并一次
+    if (_subscribers.has_pending_keyframe_request()) {
+        uint8_t buf[k_packet_buffer_capacity];
+        size_t len = _subscribers.flush_keyframe_requests(rtc::TimeMillis(),
+                buf, sizeof(buf));
+        if (len > 0) {
+            _hub->send_rtcp_to_owner((const char*)buf, len);
+        }
+    }
+
+    return !_hub->closed();
+}
+
+// 推流端的RTCP不转发给订阅者，只取SR生成本worker发给订阅者的SR
+void RelayStream::_on_publisher_rtcp(const char* data, size_t len) {
+    int64_t now_ms = rtc::TimeMillis();
+    size_t offset = 0;
+    RtcpBlock block;
+    RtcpSenderInfo info;
+    while (next_rtcp_block((const uint8_t*)data, len, &offset, &block)) {
+        if (parse_rtcp_sr(block, &info, nullptr)) {
+            _subscribers.on_sender_report(info, now_ms);
+        }
+    }
+}
+
+} // namespace xrtc
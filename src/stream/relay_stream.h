@@ -0,0 +1,42 @@
+#ifndef __RELAY_STREAM_H_
+#define __RELAY_STREAM_H_
+
+#include <functional>
+#include <memory>
+
+#include "base/event_loop.h"
+#include "stream/stream_hub.h"
+#include "stream/subscriber_set.h"
+
+namespace xrtc {
+
+// 其他worker上的推流在本worker的转发点: 从HubStream的环形队列读取包，
+// 为本worker上的订阅者加密发送
+class RelayStream {
+public:
+    RelayStream(EventLoop* el, std::shared_ptr<HubStream> hub);
+    ~RelayStream();
+
+    // 有新包时在本worker上回调on_readable
+    void start(std::function<void()> on_readable);
+    // 转发所有可读的包，推流已经结束时返回false
+    bool drain();
+
+    HubStream* hub() { return _hub.get(); }
+    SubscriberSet* subscribers() { return &_subscribers; }
+
+private:
+    void _on_publisher_rtcp(const char* data, size_t len);
+
+private:
+    EventLoop* _el;
+    std::shared_ptr<HubStream> _hub;
+    std::shared_ptr<HubReader> _reader;
+    uint64_t _next_seq;
+    uint64_t _lost = 0;
+    SubscriberSet _subscribers;
+};
+
+} // namespace xrtc
+
+#endif // __RELAY_STREAM_H_
@@ -3,7 +3,6 @@
 #include "ice/port_allocator.h"
 #include "pc/peer_connection.h"
 #include "pc/peer_connection_def.h"
-#include "rtc_base/copy_on_write_buffer.h"
 
 #include <rtc_base/rtc_certificate.h>
 #include <rtc_base/logging.h>
@@ -14,11 +13,11 @@ namespace xrtc {
 const size_t k_ice_timeout = 30000; // 30s
 
 RtcStream::RtcStream(EventLoop* el, PortAllocator* allocator, 
-        uint64_t uid, const std::string& stream_name,
+        IceScheduler* scheduler, uint64_t uid, const std::string& stream_name,
         bool audio, bool video, uint32_t log_id) :
     _el(el), _uid(uid), _stream_name(stream_name), _audio(audio),
     _video(video), _log_id(log_id),
-    _pc(new PeerConnection(el, allocator))
+    _pc(new PeerConnection(el, allocator, scheduler))
 {
     _pc->signal_connection_state.connect(this, &RtcStream::_on_connection_state);
     _pc->signal_rtp_packet_received.connect(this, &RtcStream::_on_rtp_packet_received);
@@ -55,18 +54,18 @@ void RtcStream::_on_connection_state(PeerConnection*, PeerConnectionState state)
 }
 
 void RtcStream::_on_rtp_packet_received(PeerConnection*,
-        rtc::CopyOnWriteBuffer* packet, int64_t /*ts*/)
+        PacketBuffer* packet, int64_t /*ts*/)
 {
     if (_listener) {
-        _listener->on_rtp_packet_received(this, (const char*)packet->data(), packet->size());
+        _listener->on_rtp_packet_received(this, packet->cdata(), packet->size());
     }
 }
 
 void RtcStream::_on_rtcp_packet_received(PeerConnection*,
-        rtc::CopyOnWriteBuffer* packet, int64_t /*ts*/)
+        PacketBuffer* packet, int64_t /*ts*/)
 {
     if (_listener) {
-        _listener->on_rtcp_packet_received(this, (const char*)packet->data(), packet->size());
+        _listener->on_rtcp_packet_received(this, packet->cdata(), packet->size());
     }
 }
 
@@ -9,6 +9,7 @@
 
 #include "base/event_loop.h"
 #include "ice/port_allocator.h"
+#include "ice/ice_scheduler.h"
 #include "pc/peer_connection.h"
 #include "pc/peer_connection_def.h"
 #include "rtc_base/third_party/sigslot/sigslot.h"
@@ -32,7 +33,8 @@ public:
 
 class RtcStream : public sigslot::has_slots<> {
 public:
-    RtcStream(EventLoop* el, PortAllocator* allocator, uint64_t uid, const std::string& stream_name,
+    RtcStream(EventLoop* el, PortAllocator* allocator, IceScheduler* scheduler,
+        uint64_t uid, const std::string& stream_name,
         bool audio, bool video, uint32_t log_id);
 
     virtual ~RtcStream();
@@ -41,23 +43,27 @@ public:
     int set_remote_sdp(const std::string& sdp);
     void register_listener(RtcStreamListener* listener) { _listener = listener; }
 
-    virtual std::string create_offer() = 0;
+    virtual std::string create_offer(bool ice_restart = false) = 0;
     virtual RtcStreamType stream_type() = 0;
 
     uint64_t get_uid() { return _uid; }
+    bool is_connected() { return PeerConnectionState::k_connected == _state; }
     const std::string& get_stream_name() { return _stream_name; }
 
     int send_rtp(const char* data, size_t len);
     int send_rtcp(const char* data, size_t len);
+    DtlsSrtpTransport* rtp_transport(MediaType type) {
+        return _pc ? _pc->get_rtp_transport(type) : nullptr;
+    }
 
     std::string to_string();
 
 private:
     void _on_connection_state(PeerConnection*, PeerConnectionState state);
     void _on_rtp_packet_received(PeerConnection*,
-        rtc::CopyOnWriteBuffer* packet, int64_t /*ts*/);
+        PacketBuffer* packet, int64_t /*ts*/);
     void _on_rtcp_packet_received(PeerConnection*,
-        rtc::CopyOnWriteBuffer* packet, int64_t /*ts*/);
+        PacketBuffer* packet, int64_t /*ts*/);
 
 protected:
     EventLoop* _el;
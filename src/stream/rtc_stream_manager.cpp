@@ -1,30 +1,129 @@
 #include "base/conf.h"
 #include "ice/port_allocator.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <rtc_base/helpers.h>
 #include <rtc_base/logging.h>
 #include <rtc_base/rtc_certificate.h>
+#include <rtc_base/time_utils.h>
+
+#include "module/rtp_rtcp/rtcp_feedback.h"
+#include "module/rtp_rtcp/rtcp_report.h"
+#include "module/rtp_rtcp/rtp_utils.h"
+#include "module/rtp_rtcp/transport_feedback.h"
 
 #include "pc/peer_connection_def.h"
 #include "pc/stream_params.h"
 #include "stream/push_stream.h"
 #include "stream/pull_stream.h"
+#include "stream/relay_stream.h"
 #include "stream/rtc_stream.h"
 #include "stream/rtc_stream_manager.h"
+#include "stream/stream_hub.h"
 
 
 extern xrtc::GeneralConf* g_conf;
+extern xrtc::StreamHub* g_stream_hub;
 
 namespace xrtc {
 
-RtcStreamManager::RtcStreamManager(EventLoop* el) :
+static NetworkOptions make_network_options(const std::string& preferred_iface) {
+    NetworkOptions options;
+    options.include_ifaces = g_conf->ice_include_ifaces;
+    options.exclude_ifaces = g_conf->ice_exclude_ifaces;
+    options.enable_ipv6 = g_conf->ice_enable_ipv6;
+    options.announced_ips = g_conf->ice_announced_ips;
+    options.preferred_iface = preferred_iface;
+    return options;
+}
+
+// 服务器RTCP的CNAME
+const char* const k_rtcp_cname = "xrtcserver";
+// GOP回放的节拍
+const int k_gop_replay_interval_ms = 10;
+// GOP缓存内存的统计周期
+const int k_gop_stats_interval_ms = 10000;
+// 检查RTCP报告是否到期的周期
+const int k_rtcp_check_interval_ms = 100;
+
+void gop_replay_cb(EventLoop* el, TimerWatcher* w, void* data) {
+    RtcStreamManager* manager = (RtcStreamManager*)data;
+    manager->_on_gop_replay();
+}
+
+void gop_stats_cb(EventLoop* el, TimerWatcher* w, void* data) {
+    RtcStreamManager* manager = (RtcStreamManager*)data;
+    manager->_on_gop_stats();
+}
+
+void rtcp_report_cb(EventLoop* el, TimerWatcher* w, void* data) {
+    RtcStreamManager* manager = (RtcStreamManager*)data;
+    manager->_on_rtcp_report();
+}
+
+// 推流的媒体ssrc按时钟频率统计，RTX的包计入对应的媒体ssrc
+static void add_receive_ssrcs(ReceiveStatistics* receive_statistics,
+        const std::vector<StreamParams>& source, int clockrate)
+{
+    for (auto& stream : source) {
+        std::vector<uint32_t> rtx_ssrcs;
+        for (auto& group : stream.ssrc_groups) {
+            if ("FID" == group.semantics && group.ssrcs.size() == 2) {
+                receive_statistics->add_rtx_ssrc(group.ssrcs[1], group.ssrcs[0]);
+                rtx_ssrcs.push_back(group.ssrcs[1]);
+            }
+        }
+
+        for (uint32_t ssrc : stream.ssrcs) {
+            if (std::find(rtx_ssrcs.begin(), rtx_ssrcs.end(), ssrc) == rtx_ssrcs.end()) {
+                receive_statistics->add_ssrc(ssrc, clockrate);
+            }
+        }
+    }
+}
+
+RtcStreamManager::RtcStreamManager(EventLoop* el, const std::string& preferred_iface) :
     _el(el),
-    _allocator(new PortAllocator())
+    _allocator(new PortAllocator(make_network_options(preferred_iface))),
+    _ice_scheduler(new IceScheduler(el))
 {
     _allocator->set_port_range(g_conf->ice_min_port, g_conf->ice_max_port);
+
+    _rtcp_timer = _el->create_timer(rtcp_report_cb, this, true);
+    _el->start_timer(_rtcp_timer, k_rtcp_check_interval_ms * 1000);
+
+    if (g_conf->gop_cache_enable) {
+        _gop_replay_timer = _el->create_timer(gop_replay_cb, this, true);
+        _gop_stats_timer = _el->create_timer(gop_stats_cb, this, true);
+        _el->start_timer(_gop_stats_timer, k_gop_stats_interval_ms * 1000);
+    }
 }
 
 RtcStreamManager::~RtcStreamManager() {
+    for (auto& item : _push_streams) {
+        _delete_push_stream(item.second);
+    }
+    _push_streams.clear();
+
+    while (!_relay_streams.empty()) {
+        _delete_relay_stream(_relay_streams.begin()->first);
+    }
+
+    if (_rtcp_timer) {
+        _el->delete_timer(_rtcp_timer);
+        _rtcp_timer = nullptr;
+    }
+
+    if (_gop_replay_timer) {
+        _el->delete_timer(_gop_replay_timer);
+        _gop_replay_timer = nullptr;
+    }
+
+    if (_gop_stats_timer) {
+        _el->delete_timer(_gop_stats_timer);
+        _gop_stats_timer = nullptr;
+    }
 }
 
 
@@ -37,15 +136,134 @@ PushStream* RtcStreamManager::_find_push_stream(const std::string& stream_name)
     return nullptr;
 }
 
-PullStream* RtcStreamManager::_find_pull_stream(const std::string& stream_name) {
-    auto iter = _pull_streams.find(stream_name);
-    if (iter != _pull_streams.end()) {
+SubscriberSet* RtcStreamManager::_find_subscribers(const std::string& stream_name) {
+    PushStream* push_stream = _find_push_stream(stream_name);
+    if (push_stream) {
+        return push_stream->subscribers();
+    }
+
+    RelayStream* relay_stream = _find_relay_stream(stream_name);
+    if (relay_stream) {
+        return relay_stream->subscribers();
+    }
+
+    return nullptr;
+}
+
+PullStream* RtcStreamManager::_find_pull_stream(uint64_t uid,
+        const std::string& stream_name)
+{
+    SubscriberSet* subscribers = _find_subscribers(stream_name);
+    if (!subscribers) {
+        return nullptr;
+    }
+
+    return subscribers->find(uid);
+}
+
+// 推流结束时它的订阅者也随之释放，其他worker上的订阅者在读到hub关闭后释放
+void RtcStreamManager::_delete_push_stream(PushStream* push_stream) {
+    HubStream* hub = push_stream->hub();
+    if (hub) {
+        g_stream_hub->remove(hub);
+        hub->close();
+    }
+
+    for (auto pull_stream : push_stream->subscribers()->streams()) {
+        delete pull_stream;
+    }
+
+    delete push_stream;
+}
+
+void RtcStreamManager::_publish_to_hub(PushStream* push_stream) {
+    // ICE重启后的answer不需要重新发布
+    if (push_stream->hub()) {
+        return;
+    }
+
+    std::vector<StreamParams> audio_source;
+    std::vector<StreamParams> video_source;
+    push_stream->get_audio_source(audio_source);
+    push_stream->get_video_source(video_source);
+
+    std::string stream_name = push_stream->get_stream_name();
+    std::shared_ptr<HubStream> hub = std::make_shared<HubStream>(stream_name, _el,
+            g_conf->fanout_ring_size, audio_source, video_source);
+    std::unordered_map<uint8_t, VideoCodecType> video_codecs;
+    push_stream->get_video_codecs(video_codecs);
+    hub->set_video_codecs(video_codecs);
+    int rid_ext_id = 0;
+    int repaired_rid_ext_id = 0;
+    push_stream->get_rid_extensions(&rid_ext_id, &repaired_rid_ext_id);
+    hub->set_rid_extensions(rid_ext_id, repaired_rid_ext_id);
+    hub->set_dependency_descriptor_extension(push_stream->get_dependency_descriptor_extension());
+    hub->set_rtcp_sink([this, stream_name](const char* data, size_t len) {
+        _on_relay_rtcp(stream_name, data, len);
+    });
+
+    push_stream->set_hub(hub);
+    g_stream_hub->add(hub);
+}
+
+RelayStream* RtcStreamManager::_find_relay_stream(const std::string& stream_name) {
+    auto iter = _relay_streams.find(stream_name);
+    if (iter != _relay_streams.end()) {
         return iter->second;
     }
 
     return nullptr;
 }
 
+RelayStream* RtcStreamManager::_create_relay_stream(const std::string& stream_name) {
+    std::shared_ptr<HubStream> hub = g_stream_hub->find(stream_name);
+    if (!hub) {
+        return nullptr;
+    }
+
+    RelayStream* relay_stream = new RelayStream(_el, hub);
+    relay_stream->subscribers()->set_video_codecs(hub->video_codecs());
+    relay_stream->subscribers()->set_rid_extensions(hub->rid_ext_id(),
+            hub->repaired_rid_ext_id());
+    if (g_conf->svc_enable) {
+        relay_stream->subscribers()->enable_svc(hub->dependency_descriptor_extension());
+    }
+    relay_stream->subscribers()->set_sources(hub->audio_source(), hub->video_source(),
+            g_conf->rtp_history_size);
+    relay_stream->subscribers()->set_keyframe_request_interval(
+            g_conf->keyframe_request_interval_ms);
+    if (g_conf->gop_cache_enable) {
+        relay_stream->subscribers()->enable_gop_cache(g_conf->gop_cache_max_bytes,
+                hub->video_codecs());
+    }
+    relay_stream->start([this, stream_name]() {
+        _on_relay_readable(stream_name);
+    });
+    _relay_streams[stream_name] = relay_stream;
+    return relay_stream;
+}
+
+void RtcStreamManager::_delete_relay_stream(const std::string& stream_name) {
+    RelayStream* relay_stream = _find_relay_stream(stream_name);
+    if (!relay_stream) {
+        return;
+    }
+
+    _relay_streams.erase(stream_name);
+    for (auto pull_stream : relay_stream->subscribers()->streams()) {
+        delete pull_stream;
+    }
+
+    delete relay_stream;
+}
+
+void RtcStreamManager::_on_relay_readable(const std::string& stream_name) {
+    RelayStream* relay_stream = _find_relay_stream(stream_name);
+    if (relay_stream && !relay_stream->drain()) {
+        _delete_relay_stream(stream_name);
+    }
+}
+
 void RtcStreamManager::_remove_push_stream(RtcStream* stream) {
     if (!stream) {
         return;
@@ -58,7 +276,7 @@ void RtcStreamManager::_remove_push_stream(uint64_t uid, const std::string& stre
     PushStream* push_stream = _find_push_stream(stream_name);
     if (push_stream && uid == push_stream->get_uid()) {
         _push_streams.erase(stream_name);
-        delete push_stream;
+        _delete_push_stream(push_stream);
     }
 }
 
@@ -71,11 +289,20 @@ void RtcStreamManager::_remove_pull_stream(RtcStream* stream) {
 }
 
 void RtcStreamManager::_remove_pull_stream(uint64_t uid, const std::string& stream_name) {
-    PullStream* pull_stream = _find_pull_stream(stream_name);
-    if (pull_stream && uid == pull_stream->get_uid()) {
-        _pull_streams.erase(stream_name);
+    SubscriberSet* subscribers = _find_subscribers(stream_name);
+    if (!subscribers) {
+        return;
+    }
+
+    PullStream* pull_stream = subscribers->remove(uid);
+    if (pull_stream) {
         delete pull_stream;
     }
+
+    // 本worker上最后一个订阅者离开，停止读取hub
+    if (subscribers->empty() && !_find_push_stream(stream_name)) {
+        _delete_relay_stream(stream_name);
+    }
 }
 
 int RtcStreamManager::create_push_stream(uint64_t uid, const std::string& stream_name, 
@@ -86,12 +313,13 @@ int RtcStreamManager::create_push_stream(uint64_t uid, const std::string& stream
     PushStream* stream = _find_push_stream(stream_name);
     if (stream) {
         _push_streams.erase(stream_name);
-        delete stream;
+        _delete_push_stream(stream);
     }
 
-    stream = new PushStream(_el, _allocator.get(), uid, stream_name,
+    stream = new PushStream(_el, _allocator.get(), _ice_scheduler.get(), uid, stream_name,
         audio, video, log_id);
     stream->register_listener(this);
+    stream->set_simulcast_rids(g_conf->simulcast_rids);
     stream->start(certificate);
     offer = stream->create_offer();
 
@@ -105,21 +333,41 @@ int RtcStreamManager::create_pull_stream(uint64_t uid, const std::string& stream
         rtc::RTCCertificate* certificate,
         std::string& offer)
 {
+    _remove_pull_stream(uid, stream_name);
+
+    std::vector<StreamParams> audio_source;
+    std::vector<StreamParams> video_source;
+    SubscriberSet* subscribers = nullptr;
+
     PushStream* push_stream = _find_push_stream(stream_name);
-    if (!push_stream) {
+    if (push_stream) {
+        push_stream->get_audio_source(audio_source);
+        push_stream->get_video_source(video_source);
+        subscribers = push_stream->subscribers();
+    } else if (g_conf->fanout_cross_worker) {
+        // 推流在其他worker上
+        RelayStream* relay_stream = _find_relay_stream(stream_name);
+        if (!relay_stream) {
+            relay_stream = _create_relay_stream(stream_name);
+        }
+
+        if (relay_stream) {
+            audio_source = relay_stream->hub()->audio_source();
+            video_source = relay_stream->hub()->video_source();
+            subscribers = relay_stream->subscribers();
+        }
+    }
+
+    if (!subscribers) {
         RTC_LOG(LS_WARNING) << "stream not found, uid: " << uid << ", stream_name: "
             << stream_name << ", log_id: " << log_id;
         return -1;
     }
 
-    _remove_pull_stream(uid, stream_name);
-
-    std::vector<StreamParams> audio_source;
-    std::vector<StreamParams> video_source;
-    push_stream->get_audio_source(audio_source);
-    push_stream->get_video_source(video_source);
+    // simulcast的推流，订阅者只看到一个视频ssrc
+    subscribers->get_subscriber_video_source(&video_source);
 
-    PullStream* stream = new PullStream(_el, _allocator.get(), uid, stream_name,
+    PullStream* stream = new PullStream(_el, _allocator.get(), _ice_scheduler.get(), uid, stream_name,
         audio, video, log_id);
     stream->register_listener(this);
     stream->add_audio_source(audio_source);
@@ -127,7 +375,23 @@ int RtcStreamManager::create_pull_stream(uint64_t uid, const std::string& stream
     stream->start(certificate);
     offer = stream->create_offer();
 
-    _pull_streams[stream_name] = stream;
+    // create_offer之后传输通道已经创建，整个生命周期内不变
+    DtlsSrtpTransport* audio_transport = stream->rtp_transport(MediaType::MEDIA_TYPE_AUDIO);
+    DtlsSrtpTransport* video_transport = stream->rtp_transport(MediaType::MEDIA_TYPE_VIDEO);
+    if (!audio_transport && !video_transport) {
+        RTC_LOG(LS_WARNING) << "create pull stream transport failed, uid: " << uid
+            << ", stream_name: " << stream_name << ", log_id: " << log_id;
+        delete stream;
+        if (subscribers->empty() && !push_stream) {
+            _delete_relay_stream(stream_name);
+        }
+        return -1;
+    }
+
+    subscribers->add(uid, stream, audio_transport, video_transport);
+    if (subscribers->has_replays()) {
+        _start_gop_replay();
+    }
 
     return 0;
 }
@@ -154,8 +418,50 @@ int RtcStreamManager::set_answer(uint64_t uid, const std::string& stream_name,
 
         push_stream->set_remote_sdp(answer);
 
+        // ICE重启的answer只更新ICE参数，ssrc不变。重建会丢掉simulcast给订阅者的ssrc、
+        // 改写的偏移、NACK历史、GOP缓存和接收统计
+        if (push_stream->has_sources() || push_stream->hub()) {
+            return 0;
+        }
+
+        // 按推流的ssrc建立转发路由
+        std::vector<StreamParams> audio_source;
+        std::vector<StreamParams> video_source;
+        push_stream->get_audio_source(audio_source);
+        push_stream->get_video_source(video_source);
+        std::unordered_map<uint8_t, VideoCodecType> video_codecs;
+        push_stream->get_video_codecs(video_codecs);
+        int rid_ext_id = 0;
+        int repaired_rid_ext_id = 0;
+        push_stream->get_rid_extensions(&rid_ext_id, &repaired_rid_ext_id);
+        push_stream->subscribers()->set_video_codecs(video_codecs);
+        push_stream->subscribers()->set_rid_extensions(rid_ext_id, repaired_rid_ext_id);
+        if (g_conf->svc_enable) {
+            push_stream->subscribers()->enable_svc(
+                    push_stream->get_dependency_descriptor_extension());
+        }
+        push_stream->subscribers()->set_sources(audio_source, video_source,
+                g_conf->rtp_history_size);
+        ReceiveStatistics* receive_statistics = push_stream->receive_statistics();
+        receive_statistics->clear();
+        add_receive_ssrcs(receive_statistics, audio_source, k_audio_clockrate);
+        add_receive_ssrcs(receive_statistics, video_source, k_video_clockrate);
+        push_stream->subscribers()->set_keyframe_request_interval(
+                g_conf->keyframe_request_interval_ms);
+        if (g_conf->gop_cache_enable) {
+            push_stream->subscribers()->enable_gop_cache(g_conf->gop_cache_max_bytes,
+                    video_codecs);
+        }
+
+        push_stream->set_has_sources(true);
+
+        // answer之后才知道推流的ssrc等参数，其他worker的订阅者需要
+        if (g_conf->fanout_cross_worker) {
+            _publish_to_hub(push_stream);
+        }
+
     } else if ("pull" == stream_type) {
-        PullStream* pull_stream = _find_pull_stream(stream_name);
+        PullStream* pull_stream = _find_pull_stream(uid, stream_name);
         if (!pull_stream) {
             RTC_LOG(LS_WARNING) << "pull stream not found, uid: " << uid
                 << ", stream_name: " << stream_name
@@ -163,19 +469,45 @@ int RtcStreamManager::set_answer(uint64_t uid, const std::string& stream_name,
             return -1;
         }
 
-        if (uid != pull_stream->get_uid()) {
-            RTC_LOG(LS_WARNING) << "uid invalid, uid: " << uid
-                << ", stream_name: " << stream_name
-                << ", log_id: " << log_id;
-            return -1;
-        }
-
         pull_stream->set_remote_sdp(answer);
     }
 
     return 0;
 }
 
+int RtcStreamManager::restart_ice(uint64_t uid, const std::string& stream_name,
+        const std::string& stream_type, uint32_t log_id,
+        std::string& offer)
+{
+    RtcStream* stream = nullptr;
+    if ("push" == stream_type) {
+        stream = _find_push_stream(stream_name);
+    } else if ("pull" == stream_type) {
+        stream = _find_pull_stream(uid, stream_name);
+    }
+
+    if (!stream) {
+        RTC_LOG(LS_WARNING) << stream_type << " stream not found, uid: " << uid
+            << ", stream_name: " << stream_name
+            << ", log_id: " << log_id;
+        return -1;
+    }
+
+    if (uid != stream->get_uid()) {
+        RTC_LOG(LS_WARNING) << "uid invalid, uid: " << uid
+            << ", stream_name: " << stream_name
+            << ", log_id: " << log_id;
+        return -1;
+    }
+
+    offer = stream->create_offer(true);
+    if (offer.empty()) {
+        return -1;
+    }
+
+    return 0;
+}
+
 int RtcStreamManager::stop_push(uint64_t uid, const std::string& stream_name) {
     _remove_push_stream(uid, stream_name);
     return 0;
@@ -202,9 +534,29 @@ void RtcStreamManager::on_rtp_packet_received(RtcStream* stream,
         const char* data, size_t len)
 {
     if (RtcStreamType::k_push == stream->stream_type()) {
-        PullStream* pull_stream = _find_pull_stream(stream->get_stream_name());
-        if (pull_stream) {
-            pull_stream->send_rtp(data, len);
+        PushStream* push_stream = (PushStream*)stream;
+        push_stream->receive_statistics()->on_rtp(data, len, rtc::TimeMillis());
+
+        SubscriberSet* subscribers = push_stream->subscribers();
+        // 没有订阅者时也要更新GOP缓存
+        if (!subscribers->empty() || subscribers->gop_cache()) {
+            subscribers->forward_rtp(data, len);
+        }
+
+        // 窗口内被合并的关键帧请求
+        if (subscribers->has_pending_keyframe_request()) {
+            uint8_t buf[k_packet_buffer_capacity];
+            size_t buf_len = subscribers->flush_keyframe_requests(rtc::TimeMillis(),
+                    buf, sizeof(buf));
+            if (buf_len > 0) {
+                push_stream->send_rtcp((const char*)buf, buf_len);
+            }
+        }
+
+        // 其他worker的订阅者共享同一份解密后的包
+        HubStream* hub = push_stream->hub();
+        if (hub && hub->has_readers()) {
+            hub->publish(data, len, HubStream::k_rtp);
         }
     }
 
@@ -214,14 +566,375 @@ void RtcStreamManager::on_rtcp_packet_received(RtcStream* stream,
         const char* data, size_t len)
 {
     if (RtcStreamType::k_push == stream->stream_type()) {
-        PullStream* pull_stream = _find_pull_stream(stream->get_stream_name());
-        if (pull_stream) {
-            pull_stream->send_rtcp(data, len);
+        // 推流端的RTCP在服务器终结，不再转发给订阅者，
+        // SR用于服务器自己的RR(LSR/DLSR)和发给订阅者的SR
+        PushStream* push_stream = (PushStream*)stream;
+        int64_t now_ms = rtc::TimeMillis();
+        const uint8_t* p = (const uint8_t*)data;
+        size_t offset = 0;
+        RtcpBlock block;
+        RtcpSenderInfo info;
+        while (next_rtcp_block(p, len, &offset, &block)) {
+            if (parse_rtcp_sr(block, &info, nullptr)) {
+                push_stream->receive_statistics()->on_sender_report(info.ssrc, info.ntp,
+                        now_ms);
+                push_stream->subscribers()->on_sender_report(info, now_ms);
+            }
+        }
+
+        HubStream* hub = push_stream->hub();
+        if (hub && hub->has_readers()) {
+            hub->publish(data, len, HubStream::k_rtcp);
         }
     } else if (RtcStreamType::k_pull == stream->stream_type()) {
-        PushStream* push_stream = _find_push_stream(stream->get_stream_name());
-        if (push_stream) {
-            push_stream->send_rtcp(data, len);
+        _on_subscriber_rtcp((PullStream*)stream, data, len);
+    }
+}
+
+void RtcStreamManager::_start_gop_replay() {
+    if (_gop_replay_timer && !_gop_replay_running) {
+        _gop_replay_running = true;
+        _el->start_timer(_gop_replay_timer, k_gop_replay_interval_ms * 1000);
+    }
+}
+
+void RtcStreamManager::_on_gop_replay() {
+    size_t budget = (size_t)g_conf->gop_cache_replay_kbps * k_gop_replay_interval_ms / 8;
+    bool pending = false;
+    for (auto& item : _push_streams) {
+        SubscriberSet* subscribers = item.second->subscribers();
+        if (subscribers->has_replays()) {
+            subscribers->pace_replays(budget);
+            pending = pending || subscribers->has_replays();
+        }
+    }
+
+    for (auto& item : _relay_streams) {
+        SubscriberSet* subscribers = item.second->subscribers();
+        if (subscribers->has_replays()) {
+            subscribers->pace_replays(budget);
+            pending = pending || subscribers->has_replays();
+        }
+    }
+
+    if (!pending) {
+        _gop_replay_running = false;
+        _el->stop_timer(_gop_replay_timer);
+    }
+}
+
+void RtcStreamManager::_on_gop_stats() {
+    size_t bytes = 0;
+    int streams = 0;
+    for (auto& item : _push_streams) {
+        GopCache* cache = item.second->subscribers()->gop_cache();
+        if (cache && cache->bytes() > 0) {
+            bytes += cache->bytes();
+            ++streams;
+        }
+    }
+
+    for (auto& item : _relay_streams) {
+        GopCache* cache = item.second->subscribers()->gop_cache();
+        if (cache && cache->bytes() > 0) {
+            bytes += cache->bytes();
+            ++streams;
+        }
+    }
+
+    if (streams > 0) {
+        RTC_LOG(LS_INFO) << "gop cache memory: " << bytes << " bytes, streams: " << streams;
+    }
+}
+
+void RtcStreamManager::_on_rtcp_report() {
+    int64_t now_ms = rtc::TimeMillis();
+    uint64_t ntp_now = ntp_time_now();
+    for (auto& item : _push_streams) {
+        PushStream* push_stream = item.second;
+        if (push_stream->is_connected() && now_ms >= push_stream->next_report_ms()) {
+            push_stream->set_next_report_ms(_next_report_time(now_ms));
+            _send_receiver_report(push_stream, now_ms);
+        }
+
+        _select_layers(item.first, push_stream->subscribers(), now_ms);
+        _send_sender_reports(push_stream->subscribers(), now_ms, ntp_now);
+    }
+
+    for (auto& item : _relay_streams) {
+        RelayStream* relay_stream = item.second;
+        SubscriberSet* subscribers = relay_stream->subscribers();
+        if (now_ms >= subscribers->next_report_ms()) {
+            // 本worker订阅者的REMB先合并一次，推流所在worker再合并
+            uint64_t bitrate_bps = 0;
+            if (subscribers->get_remb(now_ms, &bitrate_bps)) {
+                uint8_t buf[k_packet_buffer_capacity];
+                size_t len = build_rtcp_remb(subscribers->rtcp_ssrc(), bitrate_bps,
+                        subscribers->video_ssrcs(), buf, sizeof(buf));
+                if (len > 0) {
+                    relay_stream->hub()->send_rtcp_to_owner((const char*)buf, len);
+                }
+            }
+        }
+
+        _select_layers(item.first, subscribers, now_ms);
+        _send_sender_reports(subscribers, now_ms, ntp_now);
+    }
+}
+
+// 按订阅者的带宽估计选择simulcast层或SVC的层，切换需要的关键帧请求发给推流端
+void RtcStreamManager::_select_layers(const std::string& stream_name,
+        SubscriberSet* subscribers, int64_t now_ms)
+{
+    if (!subscribers->has_simulcast() && !subscribers->has_svc()) {
+        return;
+    }
+
+    uint8_t buf[k_packet_buffer_capacity];
+    size_t len = subscribers->select_layers(now_ms, buf, sizeof(buf));
+    if (len > 0) {
+        _send_to_publisher(stream_name, (const char*)buf, len);
+    }
+}
+
+int64_t RtcStreamManager::_next_report_time(int64_t now_ms) {
+    // rfc3550 6.3.5，间隔在[0.5, 1.5]倍之间随机，避免所有连接同时发送
+    int64_t interval_ms = g_conf->rtcp_report_interval_ms;
+    return now_ms + interval_ms / 2 + rtc::CreateRandomId() % (interval_ms + 1);
+}
+
+// 服务器作为推流端的接收者: RR + SDES，以及合并后的REMB
+void RtcStreamManager::_send_receiver_report(PushStream* push_stream, int64_t now_ms) {
+    SubscriberSet* subscribers = push_stream->subscribers();
+    std::vector<RtcpReportBlock> report_blocks;
+    push_stream->receive_statistics()->build_report_blocks(now_ms, &report_blocks);
+    if (report_blocks.size() > 31) {
+        report_blocks.resize(31);
+    }
+
+    uint8_t buf[k_packet_buffer_capacity];
+    size_t len = build_rtcp_rr(subscribers->rtcp_ssrc(), report_blocks, buf, sizeof(buf));
+    if (0 == len) {
+        return;
+    }
+
+    len += build_rtcp_sdes(subscribers->rtcp_ssrc(), k_rtcp_cname, buf + len,
+            sizeof(buf) - len);
+
+    uint64_t bitrate_bps = 0;
+    if (subscribers->get_remb(now_ms, &bitrate_bps)) {
+        len += build_rtcp_remb(subscribers->rtcp_ssrc(), bitrate_bps,
+                subscribers->video_ssrcs(), buf + len, sizeof(buf) - len);
+    }
+
+    push_stream->send_rtcp((const char*)buf, len);
+}
+
+// 服务器作为订阅者的发送者: 每个推流ssrc一个SR + SDES，同一个推流的订阅者一起发送
+void RtcStreamManager::_send_sender_reports(SubscriberSet* subscribers, int64_t now_ms,
+        uint64_t ntp_now)
+{
+    if (subscribers->empty() || now_ms < subscribers->next_report_ms()) {
+        return;
+    }
+
+    subscribers->set_next_report_ms(_next_report_time(now_ms));
+
+    std::vector<std::string> reports;
+    subscribers->build_sender_reports(now_ms, ntp_now, &reports);
+
+    std::string simulcast_report;
+    for (auto pull_stream : subscribers->streams()) {
+        if (!pull_stream->is_connected()) {
+            continue;
+        }
+
+        for (auto& report : reports) {
+            pull_stream->send_rtcp(report.data(), report.size());
+        }
+
+        // simulcast的SR每个订阅者不同
+        if (subscribers->build_simulcast_sender_report(pull_stream->get_uid(), now_ms,
+                    ntp_now, &simulcast_report))
+        {
+            pull_stream->send_rtcp(simulcast_report.data(), simulcast_report.size());
+        }
+    }
+}
+
+void RtcStreamManager::_send_to_publisher(const std::string& stream_name,
+        const char* data, size_t len)
+{
+    PushStream* push_stream = _find_push_stream(stream_name);
+    if (push_stream) {
+        push_stream->send_rtcp(data, len);
+        return;
+    }
+
+    // 推流在其他worker上
+    RelayStream* relay_stream = _find_relay_stream(stream_name);
+    if (relay_stream) {
+        relay_stream->hub()->send_rtcp_to_owner(data, len);
+    }
+}
+
+// 订阅者的NACK由服务器直接响应，只有服务器也没有收到的包才向推流端请求，
+// 其他报文照常转发给推流端
+void RtcStreamManager::_on_subscriber_rtcp(PullStream* pull_stream,
+        const char* data, size_t len)
+{
+    const std::string& stream_name = pull_stream->get_stream_name();
+    SubscriberSet* subscribers = _find_subscribers(stream_name);
+    if (!subscribers) {
+        return;
+    }
+
+    std::string upstream;
+    _process_feedback(subscribers, pull_stream, nullptr, data, len, &upstream);
+    if (!upstream.empty()) {
+        _send_to_publisher(stream_name, upstream.data(), upstream.size());
+    }
+}
+
+// 其他worker转过来的RTCP，NACK命中的包重新写入hub，由各worker转发给自己的订阅者
+void RtcStreamManager::_on_relay_rtcp(const std::string& stream_name,
+        const char* data, size_t len)
+{
+    PushStream* push_stream = _find_push_stream(stream_name);
+    if (!push_stream) {
+        return;
+    }
+
+    std::string upstream;
+    _process_feedback(push_stream->subscribers(), nullptr, push_stream->hub(),
+            data, len, &upstream);
+    if (!upstream.empty()) {
+        push_stream->send_rtcp(upstream.data(), upstream.size());
+    }
+}
+
+void RtcStreamManager::_process_feedback(SubscriberSet* subscribers, PullStream* from,
+        HubStream* hub, const char* data, size_t len, std::string* upstream)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    size_t offset = 0;
+    RtcpBlock block;
+    std::vector<uint16_t> seqs;
+    std::vector<uint16_t> missing;
+    std::vector<uint32_t> ssrcs;
+    std::vector<RtcpReportBlock> report_blocks;
+    RtcpSenderInfo sender_info;
+    TransportFeedback feedback;
+    int64_t now_ms = rtc::TimeMillis();
+
+    while (next_rtcp_block(p, len, &offset, &block)) {
+        uint32_t sender_ssrc = 0;
+        uint32_t media_ssrc = 0;
+        bool fir = false;
+        if (parse_rtcp_keyframe_request(block, &sender_ssrc, &media_ssrc, &fir)) {
+            if (from) {
+                media_ssrc = subscribers->source_ssrc(from->get_uid(), media_ssrc);
+            }
+
+            uint8_t request[k_packet_buffer_capacity];
+            size_t request_len = subscribers->on_keyframe_request(sender_ssrc, media_ssrc,
+                    fir, now_ms, request, sizeof(request));
+            if (request_len > 0) {
+                upstream->append((const char*)request, request_len);
+            }
+            continue;
+        }
+
+        uint64_t bitrate_bps = 0;
+        ssrcs.clear();
+        if (parse_rtcp_remb(block, &sender_ssrc, &bitrate_bps, &ssrcs)) {
+            subscribers->on_remb(sender_ssrc, bitrate_bps, now_ms);
+            continue;
+        }
+
+        // RR中是服务器到这个订阅者这一段的统计，在这里终结
+        report_blocks.clear();
+        if (parse_rtcp_rr(block, &sender_ssrc, &report_blocks) ||
+                parse_rtcp_sr(block, &sender_info, &report_blocks))
+        {
+            if (from) {
+                uint64_t ntp_now = ntp_time_now();
+                for (auto& report_block : report_blocks) {
+                    from->on_report_block(report_block,
+                            rtt_from_report_block(report_block, ntp_now));
+                }
+            }
+            continue;
+        }
+
+        // TWCC用于服务器到这个订阅者这一段的带宽估计
+        if (parse_rtcp_transport_feedback(block, &feedback)) {
+            if (from) {
+                from->on_transport_feedback(feedback, now_ms);
+            }
+            continue;
+        }
+
+        seqs.clear();
+        if (!parse_rtcp_nack(block, &sender_ssrc, &media_ssrc, &seqs)) {
+            // SDES、BYE、XR等只和这一段连接有关
+            continue;
+        }
+
+        // simulcast的订阅者看到的ssrc和序号映射回推流端的层，SVC的序号映射回推流端的
+        bool mapped = false;
+        if (from) {
+            uint32_t source_ssrc = subscribers->source_ssrc(from->get_uid(), media_ssrc);
+            mapped = source_ssrc != media_ssrc;
+            missing.clear();
+            for (uint16_t seq : seqs) {
+                uint16_t source_seq = 0;
+                if (subscribers->source_sequence_number(from->get_uid(), media_ssrc, seq,
+                            &source_seq))
+                {
+                    missing.push_back(source_seq);
+                }
+                mapped = mapped || source_seq != seq;
+            }
+
+            media_ssrc = source_ssrc;
+            seqs.swap(missing);
+        }
+
+        if (!subscribers->has_history(media_ssrc) && !mapped) {
+            upstream->append((const char*)block.data, block.len);
+            continue;
+        }
+
+        if (!subscribers->has_history(media_ssrc)) {
+            uint8_t nack[k_packet_buffer_capacity];
+            size_t nack_len = build_rtcp_nack(sender_ssrc, media_ssrc, seqs,
+                    nack, sizeof(nack));
+            if (nack_len > 0) {
+                upstream->append((const char*)nack, nack_len);
+            }
+            continue;
+        }
+
+        missing.clear();
+        for (uint16_t seq : seqs) {
+            auto packet = subscribers->find_packet(media_ssrc, seq);
+            if (packet) {
+                if (from) {
+                    subscribers->retransmit(from, *packet);
+                } else if (hub) {
+                    hub->publish(packet->data, packet->size, HubStream::k_rtp);
+                }
+            } else if (subscribers->should_request(media_ssrc, seq, now_ms)) {
+                missing.push_back(seq);
+            }
+        }
+
+        uint8_t nack[k_packet_buffer_capacity];
+        size_t nack_len = build_rtcp_nack(sender_ssrc, media_ssrc, missing,
+                nack, sizeof(nack));
+        if (nack_len > 0) {
+            upstream->append((const char*)nack, nack_len);
         }
     }
 }
@@ -5,11 +5,14 @@
 #include <string>
 #include <stdint.h>
 #include <unordered_map>
+#include <vector>
 
 #include <rtc_base/rtc_certificate.h>
 
 #include "base/event_loop.h"
 #include "ice/port_allocator.h"
+#include "ice/ice_scheduler.h"
+#include "pc/dtls_srtp_transport.h"
 #include "pc/peer_connection_def.h"
 #include "stream/rtc_stream.h"
 
@@ -17,10 +20,13 @@ namespace xrtc {
 
 class PushStream;
 class PullStream;
+class RelayStream;
+class SubscriberSet;
+class HubStream;
 
 class RtcStreamManager : public RtcStreamListener {
 public:
-    RtcStreamManager(EventLoop* el);
+    RtcStreamManager(EventLoop* el, const std::string& preferred_iface);
     ~RtcStreamManager();
 
     int create_push_stream(uint64_t uid, const std::string& stream_name, 
@@ -40,6 +46,11 @@ public:
         const std::string& answer, const std::string& stream_type,
         uint32_t log_id);
 
+    // 在原有的PeerConnection上重新生成ufrag/pwd，DTLS/SRTP状态保持不变
+    int restart_ice(uint64_t uid, const std::string& stream_name,
+        const std::string& stream_type, uint32_t log_id,
+        std::string& offer);
+
     PushStream* find_push_stream(const std::string& stream_name);
     void remove_push_stream(RtcStream* stream);
     void remove_push_stream(uint64_t uid, const std::string& stream_name);
@@ -54,14 +65,54 @@ private:
     void _remove_push_stream(RtcStream* stream);
     void _remove_push_stream(uint64_t uid, const std::string& stream_name);
 
-    PullStream* _find_pull_stream(const std::string& stream_name);
+    PullStream* _find_pull_stream(uint64_t uid, const std::string& stream_name);
     void _remove_pull_stream(RtcStream* stream);
     void _remove_pull_stream(uint64_t uid, const std::string& stream_name);
+    void _delete_push_stream(PushStream* push_stream);
+
+    // 跨worker转发
+    void _publish_to_hub(PushStream* push_stream);
+    RelayStream* _find_relay_stream(const std::string& stream_name);
+    RelayStream* _create_relay_stream(const std::string& stream_name);
+    void _delete_relay_stream(const std::string& stream_name);
+    void _on_relay_readable(const std::string& stream_name);
+    SubscriberSet* _find_subscribers(const std::string& stream_name);
+
+    // 订阅者的RTCP反馈
+    void _on_subscriber_rtcp(PullStream* pull_stream, const char* data, size_t len);
+    void _on_relay_rtcp(const std::string& stream_name, const char* data, size_t len);
+    void _process_feedback(SubscriberSet* subscribers, PullStream* from, HubStream* hub,
+            const char* data, size_t len, std::string* upstream);
+    void _send_to_publisher(const std::string& stream_name, const char* data, size_t len);
+
+    // GOP缓存回放
+    void _start_gop_replay();
+    void _on_gop_replay();
+    void _on_gop_stats();
+
+    // 每一段连接上服务器自己的RTCP报告
+    void _on_rtcp_report();
+    int64_t _next_report_time(int64_t now_ms);
+    void _send_receiver_report(PushStream* push_stream, int64_t now_ms);
+    void _send_sender_reports(SubscriberSet* subscribers, int64_t now_ms, uint64_t ntp_now);
+    void _select_layers(const std::string& stream_name, SubscriberSet* subscribers,
+            int64_t now_ms);
+
+    friend void gop_replay_cb(EventLoop* el, TimerWatcher* w, void* data);
+    friend void gop_stats_cb(EventLoop* el, TimerWatcher* w, void* data);
+    friend void rtcp_report_cb(EventLoop* el, TimerWatcher* w, void* data);
 private:
     EventLoop* _el;
+    // 拉流作为订阅者挂在对应的推流上(PushStream::subscribers)，
+    // 推流在其他worker时挂在RelayStream上
     std::unordered_map<std::string, PushStream*> _push_streams;
-    std::unordered_map<std::string, PullStream*> _pull_streams;
+    std::unordered_map<std::string, RelayStream*> _relay_streams;
     std::unique_ptr<PortAllocator> _allocator;
+    std::unique_ptr<IceScheduler> _ice_scheduler; // worker内所有ICE检查共用
+    TimerWatcher* _rtcp_timer = nullptr;
+    TimerWatcher* _gop_replay_timer = nullptr; // 有订阅者在回放时才运行
+    bool _gop_replay_running = false;
+    TimerWatcher* _gop_stats_timer = nullptr;
 };
 
 
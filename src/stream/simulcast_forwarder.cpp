@@ -0,0 +1,296 @@
+#include "stream/simulcast_forwarder.h"
+
+#include <algorithm>
+
+#include "base/packet_buffer.h"
+#include "module/rtp_rtcp/rtp_utils.h"
+#include "pc/dtls_srtp_transport.h"
+#include "stream/pull_stream.h"
+
+namespace xrtc {
+
+// 每层码率的统计周期
+const int64_t k_layer_stats_interval_ms = 1000;
+// 超过这个时间没有收到包的层不再选择(推流端因为带宽不够停掉了高的层)
+const int64_t k_layer_timeout_ms = 2000;
+// 上次切换之后至少经过这么久才升层，避免来回切换
+const int64_t k_layer_upgrade_interval_ms = 3000;
+// 升层时层的码率不能超过目标码率的比例
+const double k_layer_upgrade_ratio = 0.9;
+
+SimulcastForwarder::Viewer::Viewer(uint64_t uid, PullStream* stream,
+        DtlsSrtpTransport* transport, uint32_t ssrc) :
+    uid(uid), stream(stream), transport(transport),
+    munger(ssrc, k_video_clockrate)
+{
+}
+
+SimulcastForwarder::SimulcastForwarder(const std::vector<SimulcastLayer>& layers,
+        uint32_t ssrc, uint32_t rtx_ssrc) :
+    _layers(layers), _ssrc(ssrc), _rtx_ssrc(rtx_ssrc)
+{
+}
+
+int SimulcastForwarder::find_layer(uint32_t ssrc) {
+    for (size_t i = 0; i < _layers.size(); ++i) {
+        if (_layers[i].ssrc == ssrc && ssrc != 0) {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+int SimulcastForwarder::find_layer(const std::string& rid) {
+    for (size_t i = 0; i < _layers.size(); ++i) {
+        if (_layers[i].rid == rid) {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+void SimulcastForwarder::add(uint64_t uid, PullStream* stream,
+        DtlsSrtpTransport* transport)
+{
+    if (_index.find(uid) != _index.end()) {
+        return;
+    }
+
+    // 第一次选层时开始接收，之前不发送视频
+    _index[uid] = _viewers.size();
+    _viewers.emplace_back(uid, stream, transport, _ssrc);
+}
+
+void SimulcastForwarder::remove(uint64_t uid) {
+    auto iter = _index.find(uid);
+    if (iter == _index.end()) {
+        return;
+    }
+
+    size_t pos = iter->second;
+    _index.erase(iter);
+
+    size_t last = _viewers.size() - 1;
+    if (pos != last) {
+        std::swap(_viewers[pos], _viewers[last]);
+        _index[_viewers[pos].uid] = pos;
+    }
+
+    _viewers.pop_back();
+}
+
+void SimulcastForwarder::get_subscribers(std::vector<uint64_t>* uids,
+        std::vector<PullStream*>* streams, std::vector<DtlsSrtpTransport*>* transports)
+{
+    for (auto& viewer : _viewers) {
+        uids->push_back(viewer.uid);
+        streams->push_back(viewer.stream);
+        transports->push_back(viewer.transport);
+    }
+}
+
+SimulcastForwarder::Viewer* SimulcastForwarder::_find_viewer(uint64_t uid) {
+    auto iter = _index.find(uid);
+    return iter != _index.end() ? &_viewers[iter->second] : nullptr;
+}
+
+bool SimulcastForwarder::_parse_video_header(const uint8_t* data, size_t len,
+        RtpVideoHeader* header)
+{
+    rtc::ArrayView<const uint8_t> view(data, len);
+    size_t header_len = 0;
+    size_t payload_len = 0;
+    if (!parse_rtp_layout(view, &header_len, &payload_len)) {
+        return false;
+    }
+
+    auto iter = _codecs.find(parse_rtp_payload_type(view));
+    if (iter == _codecs.end()) {
+        return false;
+    }
+
+    return parse_rtp_video_header(iter->second, data + header_len, payload_len, header);
+}
+
+int SimulcastForwarder::forward(int layer, const char* data, size_t len, int64_t now_ms) {
+    _layers[layer].bytes += len;
+    _layers[layer].last_packet_ms = now_ms;
+    if (_viewers.empty()) {
+        return 0;
+    }
+
+    RtpVideoHeader header;
+    bool has_header = _parse_video_header((const uint8_t*)data, len, &header);
+    bool keyframe = has_header && header.frame_start && header.keyframe;
+
+    // 线程内复用，避免每个包分配内存
+    static thread_local std::vector<PacketBuffer> buffers;
+    static thread_local std::vector<DtlsSrtpTransport*> targets;
+    buffers.clear();
+    targets.clear();
+
+    for (auto& viewer : _viewers) {
+        if (!viewer.transport->is_srtp_active()) {
+            continue;
+        }
+
+        if (viewer.target == layer && keyframe) {
+            viewer.current = layer;
+            viewer.target = -1;
+            viewer.last_switch_ms = now_ms;
+            viewer.munger.switch_source();
+        }
+
+        if (viewer.current != layer) {
+            continue;
+        }
+
+        buffers.emplace_back();
+        PacketBuffer& packet = buffers.back();
+        if (!packet.set_data(data, len) ||
+                !viewer.munger.rewrite((uint8_t*)packet.data(), len,
+                    has_header ? &header : nullptr, now_ms))
+        {
+            buffers.pop_back();
+            continue;
+        }
+
+        targets.push_back(viewer.transport);
+    }
+
+    if (targets.empty()) {
+        return 0;
+    }
+
+    // 发送后立即把slot还给缓冲池，不要留到下一个包
+    int sent = DtlsSrtpTransport::send_rtp_batch(targets, buffers);
+    buffers.clear();
+    targets.clear();
+    return sent;
+}
+
+bool SimulcastForwarder::_is_active(const SimulcastLayer& layer, int64_t now_ms) {
+    return layer.last_packet_ms >= 0 && now_ms - layer.last_packet_ms < k_layer_timeout_ms;
+}
+
+void SimulcastForwarder::_update_bitrates(int64_t now_ms) {
+    if (_last_update_ms < 0) {
+        _last_update_ms = now_ms;
+        return;
+    }
+
+    int64_t elapsed_ms = now_ms - _last_update_ms;
+    if (elapsed_ms < k_layer_stats_interval_ms) {
+        return;
+    }
+
+    for (auto& layer : _layers) {
+        layer.bitrate_bps = (int64_t)layer.bytes * 8 * 1000 / elapsed_ms;
+        layer.measured = true;
+        layer.bytes = 0;
+    }
+
+    _last_update_ms = now_ms;
+}
+
+// 最低的可用层总是可以选；没有带宽估计(没有协商transport-wide-cc)时选最高的层
+int SimulcastForwarder::_select_layer(Viewer& viewer, int64_t now_ms) {
+    int64_t target_bps = viewer.stream->target_bitrate_bps();
+    int current = viewer.target >= 0 ? viewer.target : viewer.current;
+    int best = -1;
+    for (size_t i = 0; i < _layers.size(); ++i) {
+        const SimulcastLayer& layer = _layers[i];
+        if (!_is_active(layer, now_ms)) {
+            continue;
+        }
+
+        if (best < 0) {
+            best = (int)i;
+            continue;
+        }
+
+        if (!layer.measured) {
+            break;
+        }
+
+        if (target_bps >= 0) {
+            bool upgrade = current < 0 || (int)i > current;
+            if (upgrade && (layer.bitrate_bps > target_bps * k_layer_upgrade_ratio ||
+                        now_ms - viewer.last_switch_ms < k_layer_upgrade_interval_ms))
+            {
+                break;
+            }
+
+            if (!upgrade && layer.bitrate_bps > target_bps) {
+                break;
+            }
+        }
+
+        best = (int)i;
+    }
+
+    return best;
+}
+
+void SimulcastForwarder::select_layers(int64_t now_ms,
+        std::vector<uint32_t>* keyframe_ssrcs)
+{
+    _update_bitrates(now_ms);
+
+    for (auto& viewer : _viewers) {
+        if (!viewer.transport->is_srtp_active()) {
+            continue;
+        }
+
+        int layer = _select_layer(viewer, now_ms);
+        if (layer < 0) {
+            continue;
+        }
+
+        if (layer == viewer.current) {
+            viewer.target = -1;
+            continue;
+        }
+
+        // 目标层的关键帧到达之前继续接收当前层，关键帧请求按推流ssrc合并
+        viewer.target = layer;
+        uint32_t ssrc = _layers[layer].ssrc;
+        if (std::find(keyframe_ssrcs->begin(), keyframe_ssrcs->end(), ssrc) ==
+                keyframe_ssrcs->end())
+        {
+            keyframe_ssrcs->push_back(ssrc);
+        }
+    }
+}
+
+uint32_t SimulcastForwarder::current_ssrc(uint64_t uid) {
+    Viewer* viewer = _find_viewer(uid);
+    if (!viewer || viewer->current < 0) {
+        return 0;
+    }
+
+    return _layers[viewer->current].ssrc;
+}
+
+const RtpMunger* SimulcastForwarder::munger(uint64_t uid) {
+    Viewer* viewer = _find_viewer(uid);
+    return viewer ? &viewer->munger : nullptr;
+}
+
+bool SimulcastForwarder::rewrite_retransmit(uint64_t uid, uint8_t* packet, size_t len) {
+    Viewer* viewer = _find_viewer(uid);
+    if (!viewer || viewer->current < 0 || len < 12 ||
+            parse_rtp_ssrc(rtc::ArrayView<const uint8_t>(packet, len)) !=
+            _layers[viewer->current].ssrc)
+    {
+        return false;
+    }
+
+    RtpVideoHeader header;
+    bool has_header = _parse_video_header(packet, len, &header);
+    return viewer->munger.rewrite_retransmit(packet, len, has_header ? &header : nullptr);
+}
+
+} // namespace xrtc
@@ -0,0 +1,101 @@
+#ifndef __SIMULCAST_FORWARDER_H_
+#define __SIMULCAST_FORWARDER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "module/rtp_rtcp/rtp_munger.h"
+#include "module/rtp_rtcp/rtp_video_header.h"
+
+namespace xrtc {
+
+class PullStream;
+class DtlsSrtpTransport;
+
+// 推流端的一个simulcast层
+struct SimulcastLayer {
+    uint32_t ssrc = 0;  // RID方式在收到第一个包之前为0
+    std::string rid;
+    int64_t bitrate_bps = 0;
+    bool measured = false;     // 至少统计过一个周期
+    int64_t last_packet_ms = -1;
+    size_t bytes = 0;          // 当前统计周期的字节数
+};
+
+// 一个推流的simulcast视频: 每个订阅者只接收一层，按它的目标码率选择，
+// 在目标层的关键帧处切换。订阅者看到的是一个固定的ssrc，序号、时间戳和
+// PictureID由每个订阅者的RtpMunger改写成连续的流
+class SimulcastForwarder {
+public:
+    // layers从低到高，ssrc和rtx_ssrc是订阅者看到的
+    SimulcastForwarder(const std::vector<SimulcastLayer>& layers, uint32_t ssrc,
+            uint32_t rtx_ssrc);
+    ~SimulcastForwarder() = default;
+
+    uint32_t ssrc() { return _ssrc; }
+    uint32_t rtx_ssrc() { return _rtx_ssrc; }
+    const std::vector<SimulcastLayer>& layers() { return _layers; }
+    void set_codecs(const std::unordered_map<uint8_t, VideoCodecType>& codecs) {
+        _codecs = codecs;
+    }
+
+    // 没有时返回-1
+    int find_layer(uint32_t ssrc);
+    int find_layer(const std::string& rid);
+    void set_layer_ssrc(int layer, uint32_t ssrc) { _layers[layer].ssrc = ssrc; }
+
+    void add(uint64_t uid, PullStream* stream, DtlsSrtpTransport* transport);
+    void remove(uint64_t uid);
+    // 返回所有订阅者，用于重新建立路由
+    void get_subscribers(std::vector<uint64_t>* uids, std::vector<PullStream*>* streams,
+            std::vector<DtlsSrtpTransport*>* transports);
+
+    // 转发一个层的包给当前在这一层的订阅者，返回发送的个数
+    int forward(int layer, const char* data, size_t len, int64_t now_ms);
+    // 定时调用: 统计每层的码率，为每个订阅者选择层。
+    // 需要关键帧才能切换的层的ssrc写入keyframe_ssrcs
+    void select_layers(int64_t now_ms, std::vector<uint32_t>* keyframe_ssrcs);
+
+    // 订阅者当前接收的层的ssrc，还没有开始接收时返回0
+    uint32_t current_ssrc(uint64_t uid);
+    // 没有这个订阅者时返回nullptr
+    const RtpMunger* munger(uint64_t uid);
+    // 推流端的包改写成这个订阅者看到的包，用于重传
+    bool rewrite_retransmit(uint64_t uid, uint8_t* packet, size_t len);
+
+private:
+    struct Viewer {
+        Viewer(uint64_t uid, PullStream* stream, DtlsSrtpTransport* transport,
+                uint32_t ssrc);
+
+        uint64_t uid;
+        PullStream* stream;
+        DtlsSrtpTransport* transport;
+        int current = -1; // 正在接收的层
+        int target = -1;  // 等待关键帧切换过去的层
+        int64_t last_switch_ms = 0;
+        RtpMunger munger;
+    };
+
+    Viewer* _find_viewer(uint64_t uid);
+    bool _is_active(const SimulcastLayer& layer, int64_t now_ms);
+    void _update_bitrates(int64_t now_ms);
+    int _select_layer(Viewer& viewer, int64_t now_ms);
+    bool _parse_video_header(const uint8_t* data, size_t len, RtpVideoHeader* header);
+
+private:
+    std::vector<SimulcastLayer> _layers;
+    uint32_t _ssrc;
+    uint32_t _rtx_ssrc;
+    std::unordered_map<uint8_t, VideoCodecType> _codecs;
+    std::vector<Viewer> _viewers;
+    std::unordered_map<uint64_t, size_t> _index;
+    int64_t _last_update_ms = -1;
+};
+
+} // namespace xrtc
+
+#endif // __SIMULCAST_FORWARDER_H_
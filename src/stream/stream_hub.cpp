@@ -0,0 +1,106 @@
+#include "stream/stream_hub.h"
+
+#include <algorithm>
+
+#include <rtc_base/logging.h>
+
+namespace xrtc {
+
+HubStream::HubStream(const std::string& stream_name, EventLoop* owner_el,
+        size_t ring_size,
+        const std::vector<StreamParams>& audio_source,
+        const std::vector<StreamParams>& video_source) :
+    _stream_name(stream_name),
+    _owner_el(owner_el),
+    _ring(ring_size),
+    _audio_source(audio_source),
+    _video_source(video_source)
+{
+}
+
+HubStream::~HubStream() {
+    RTC_LOG(LS_INFO) << "hub stream destroy, stream_name: " << _stream_name
+        << ", published: " << _ring.head() << ", dropped: " << _ring.dropped();
+}
+
+void HubStream::publish(const char* data, size_t len, int type) {
+    _ring.publish(data, len, type);
+    _notify_readers();
+}
+
+void HubStream::close() {
+    _closed = true;
+    _notify_readers();
+}
+
+void HubStream::set_rtcp_sink(std::function<void(const char*, size_t)> sink) {
+    _rtcp_sink = std::move(sink);
+}
+
+void HubStream::_notify_readers() {
+    std::lock_guard<std::mutex> lock(_readers_mtx);
+    for (auto& reader : _readers) {
+        if (reader->pending.exchange(true)) {
+            continue;
+        }
+
+        std::shared_ptr<HubReader> r = reader;
+        r->el->post_task([r]() {
+            r->pending = false;
+            if (r->active) {
+                r->on_readable();
+            }
+        });
+    }
+}
+
+void HubStream::add_reader(std::shared_ptr<HubReader> reader) {
+    std::lock_guard<std::mutex> lock(_readers_mtx);
+    _readers.push_back(reader);
+    ++_reader_count;
+}
+
+void HubStream::remove_reader(std::shared_ptr<HubReader> reader) {
+    std::lock_guard<std::mutex> lock(_readers_mtx);
+    auto iter = std::find(_readers.begin(), _readers.end(), reader);
+    if (iter != _readers.end()) {
+        _readers.erase(iter);
+        --_reader_count;
+    }
+}
+
+void HubStream::send_rtcp_to_owner(const char* data, size_t len) {
+    std::string packet(data, len);
+    std::shared_ptr<HubStream> self = shared_from_this();
+    // 推流结束后不再执行sink
+    _owner_el->post_task([self, packet]() {
+        if (!self->closed() && self->_rtcp_sink) {
+            self->_rtcp_sink(packet.data(), packet.size());
+        }
+    });
+}
+
+void StreamHub::add(std::shared_ptr<HubStream> stream) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _streams[stream->stream_name()] = stream;
+}
+
+void StreamHub::remove(HubStream* stream) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    auto iter = _streams.find(stream->stream_name());
+    if (iter != _streams.end() && iter->second.get() == stream) {
+        _streams.erase(iter);
+    }
+}
+
+std::shared_ptr<HubStream> StreamHub::find(const std::string& stream_name) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    auto iter = _streams.find(stream_name);
+    if (iter == _streams.end() || iter->second->closed()) {
+        return nullptr;
+    }
+
+    return iter->second;
+}
+
+} // namespace xrtc
@@ -0,0 +1,113 @@
+#ifndef __STREAM_HUB_H_
+#define __STREAM_HUB_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/broadcast_ring.h"
+#include "base/event_loop.h"
+#include "module/rtp_rtcp/rtp_video_header.h"
+#include "pc/stream_params.h"
+
+namespace xrtc {
+
+// 其他worker上读取HubStream的读者。
+// 生产者写入后通知读者所在的loop，通知在读者处理之前只投递一次
+struct HubReader {
+    EventLoop* el = nullptr;
+    std::atomic<bool> pending{false};
+    bool active = true; // 只在读者线程访问
+    std::function<void()> on_readable;
+};
+
+// 允许跨worker订阅的推流: 推流所在worker把解密后的RTP/RTCP写入环形队列，
+// 其他worker各自读取，为自己的订阅者加密发送
+class HubStream : public std::enable_shared_from_this<HubStream> {
+public:
+    enum {
+        k_rtp = 0,
+        k_rtcp = 1
+    };
+
+    HubStream(const std::string& stream_name, EventLoop* owner_el, size_t ring_size,
+            const std::vector<StreamParams>& audio_source,
+            const std::vector<StreamParams>& video_source);
+    ~HubStream();
+
+    const std::string& stream_name() { return _stream_name; }
+    BroadcastRing* ring() { return &_ring; }
+    const std::vector<StreamParams>& audio_source() { return _audio_source; }
+    const std::vector<StreamParams>& video_source() { return _video_source; }
+    // 加入StreamHub之前设置，之后只读
+    void set_video_codecs(const std::unordered_map<uint8_t, VideoCodecType>& codecs) {
+        _video_codecs = codecs;
+    }
+    const std::unordered_map<uint8_t, VideoCodecType>& video_codecs() {
+        return _video_codecs;
+    }
+    void set_rid_extensions(int rid_ext_id, int repaired_rid_ext_id) {
+        _rid_ext_id = rid_ext_id;
+        _repaired_rid_ext_id = repaired_rid_ext_id;
+    }
+    int rid_ext_id() { return _rid_ext_id; }
+    int repaired_rid_ext_id() { return _repaired_rid_ext_id; }
+    void set_dependency_descriptor_extension(int ext_id) { _dd_ext_id = ext_id; }
+    int dependency_descriptor_extension() { return _dd_ext_id; }
+
+    // 以下在推流所在worker调用
+    bool has_readers() { return _reader_count.load() > 0; }
+    void publish(const char* data, size_t len, int type);
+    void close();
+    // 订阅者的RTCP(NACK、PLI等)在推流所在worker上执行
+    void set_rtcp_sink(std::function<void(const char*, size_t)> sink);
+
+    // 以下在读者所在worker调用
+    bool closed() { return _closed.load(); }
+    void add_reader(std::shared_ptr<HubReader> reader);
+    void remove_reader(std::shared_ptr<HubReader> reader);
+    void send_rtcp_to_owner(const char* data, size_t len);
+
+private:
+    void _notify_readers();
+
+private:
+    std::string _stream_name;
+    EventLoop* _owner_el;
+    BroadcastRing _ring;
+    std::vector<StreamParams> _audio_source;
+    std::vector<StreamParams> _video_source;
+    std::unordered_map<uint8_t, VideoCodecType> _video_codecs;
+    int _rid_ext_id = 0;
+    int _repaired_rid_ext_id = 0;
+    int _dd_ext_id = 0;
+    std::function<void(const char*, size_t)> _rtcp_sink; // 只在推流所在worker访问
+    std::atomic<bool> _closed{false};
+    std::atomic<int> _reader_count{0};
+    std::mutex _readers_mtx;
+    std::vector<std::shared_ptr<HubReader>> _readers;
+};
+
+// stream_name到HubStream的全局映射，只在推拉流建立和结束时访问
+class StreamHub {
+public:
+    StreamHub() = default;
+    ~StreamHub() = default;
+
+    void add(std::shared_ptr<HubStream> stream);
+    // 只有stream仍是当前的映射时才删除，避免删掉同名的新推流
+    void remove(HubStream* stream);
+    std::shared_ptr<HubStream> find(const std::string& stream_name);
+
+private:
+    std::mutex _mtx;
+    std::unordered_map<std::string, std::shared_ptr<HubStream>> _streams;
+};
+
+} // namespace xrtc
+
+#endif // __STREAM_HUB_H_
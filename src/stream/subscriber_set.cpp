@@ -0,0 +1,918 @@
+#include "stream/subscriber_set.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include <rtc_base/byte_io.h>
+#include <rtc_base/helpers.h>
+#include <rtc_base/logging.h>
+#include <rtc_base/time_utils.h>
+
+#include "module/rtp_rtcp/rtcp_feedback.h"
+#include "module/rtp_rtcp/rtp_utils.h"
+#include "pc/dtls_srtp_transport.h"
+#include "stream/pull_stream.h"
+
+namespace xrtc {
+
+// 同一个序号向推流端重复请求的最小间隔
+const int64_t k_upstream_nack_interval_ms = 50;
+
+// 时间戳回绕的比较，a比b新时返回true
+static bool is_newer_timestamp(uint32_t a, uint32_t b) {
+    return a != b && (uint32_t)(a - b) < 0x80000000;
+}
+
+// 超过这个时间没有更新的REMB不再参与合并
+const int64_t k_remb_timeout_ms = 5000;
+
+SubscriberSet::SubscriberSet() :
+    _rtcp_ssrc(rtc::CreateRandomNonZeroId())
+{
+}
+
+void SubscriberSet::TransportList::add(uint64_t uid, DtlsSrtpTransport* transport) {
+    index[uid] = transports.size();
+    transports.push_back(transport);
+    uids.push_back(uid);
+}
+
+void SubscriberSet::TransportList::remove(uint64_t uid) {
+    auto iter = index.find(uid);
+    if (iter == index.end()) {
+        return;
+    }
+
+    size_t pos = iter->second;
+    index.erase(iter);
+
+    size_t last = transports.size() - 1;
+    if (pos != last) {
+        transports[pos] = transports[last];
+        uids[pos] = uids[last];
+        index[uids[pos]] = pos;
+    }
+
+    transports.pop_back();
+    uids.pop_back();
+}
+
+bool SubscriberSet::add(uint64_t uid, PullStream* stream,
+        DtlsSrtpTransport* audio_transport, DtlsSrtpTransport* video_transport)
+{
+    if (_index.find(uid) != _index.end()) {
+        return false;
+    }
+
+    _index[uid] = _streams.size();
+    _streams.push_back(stream);
+    _uids.push_back(uid);
+
+    if (audio_transport) {
+        _transports[(int)MediaType::MEDIA_TYPE_AUDIO].add(uid, audio_transport);
+    }
+
+    if (video_transport && _simulcast) {
+        _simulcast->add(uid, stream, video_transport);
+    } else if (video_transport) {
+        Replay replay;
+        const Gop* gop = _gop_cache ? _find_replay_gop(&replay.ssrc) : nullptr;
+        if (gop) {
+            replay.uid = uid;
+            replay.transport = video_transport;
+            replay.generation = gop->generation;
+            _replays.push_back(replay);
+        } else {
+            _add_video_transport(uid, video_transport);
+        }
+    }
+
+    return true;
+}
+
+PullStream* SubscriberSet::remove(uint64_t uid) {
+    auto iter = _index.find(uid);
+    if (iter == _index.end()) {
+        return nullptr;
+    }
+
+    size_t pos = iter->second;
+    PullStream* stream = _streams[pos];
+    _index.erase(iter);
+
+    size_t last = _streams.size() - 1;
+    if (pos != last) {
+        _streams[pos] = _streams[last];
+        _uids[pos] = _uids[last];
+        _index[_uids[pos]] = pos;
+    }
+
+    _streams.pop_back();
+    _uids.pop_back();
+
+    for (auto& list : _transports) {
+        list.remove(uid);
+    }
+
+    if (_simulcast) {
+        _simulcast->remove(uid);
+    }
+
+    if (_svc) {
+        _svc->remove(uid);
+    }
+
+    for (size_t i = 0; i < _replays.size(); ++i) {
+        if (_replays[i].uid == uid) {
+            _replays[i] = _replays.back();
+            _replays.pop_back();
+            break;
+        }
+    }
+
+    return stream;
+}
+
+PullStream* SubscriberSet::find(uint64_t uid) {
+    auto iter = _index.find(uid);
+    return iter != _index.end() ? _streams[iter->second] : nullptr;
+}
+
+void SubscriberSet::_add_video_transport(uint64_t uid, DtlsSrtpTransport* transport) {
+    _transports[(int)MediaType::MEDIA_TYPE_VIDEO].add(uid, transport);
+    if (_svc) {
+        _svc->add(uid, find(uid), transport);
+    }
+}
+
+bool SubscriberSet::_is_svc_packet(const char* data, size_t len) {
+    auto iter = _video_codecs.find(parse_rtp_payload_type(
+                rtc::ArrayView<const uint8_t>((const uint8_t*)data, len)));
+    return iter != _video_codecs.end() && (VideoCodecType::k_vp9 == iter->second ||
+            VideoCodecType::k_av1 == iter->second);
+}
+
+// 只处理第一个VP9/AV1的视频ssrc，已有的订阅者从下一个包开始过滤
+void SubscriberSet::_setup_svc(uint32_t ssrc) {
+    _svc.reset(new SvcForwarder(ssrc));
+    _svc->set_codecs(_video_codecs);
+    _svc->set_dependency_descriptor_extension(_dd_ext_id);
+
+    TransportList& video = _transports[(int)MediaType::MEDIA_TYPE_VIDEO];
+    for (size_t i = 0; i < video.uids.size(); ++i) {
+        _svc->add(video.uids[i], find(video.uids[i]), video.transports[i]);
+    }
+
+    RTC_LOG(LS_INFO) << "svc layer filter, ssrc: " << ssrc << ", subscribers: "
+        << video.uids.size();
+}
+
+int SubscriberSet::forward_rtp(const char* data, size_t len) {
+    if (len < 12) {
+        return -1;
+    }
+
+    uint32_t ssrc = parse_rtp_ssrc(rtc::ArrayView<const uint8_t>(
+                (const uint8_t*)data, len));
+
+    if (_simulcast && _routes.find(ssrc) == _routes.end() &&
+            _rtx_to_media.find(ssrc) == _rtx_to_media.end())
+    {
+        _learn_simulcast_ssrc(rtc::ArrayView<const uint8_t>((const uint8_t*)data, len),
+                ssrc);
+    }
+
+    // RTX的ssrc没有关键帧请求，重传的包不会被当成新的关键帧
+    if (_pending_keyframe_requests > 0) {
+        _on_keyframe_received(ssrc, data, len, rtc::TimeMillis());
+    }
+
+    // 推流端的RTX是对服务器NACK的响应，恢复后作为普通包转发
+    char restored[k_packet_buffer_capacity];
+    auto rtx_iter = _rtx_to_media.find(ssrc);
+    if (rtx_iter != _rtx_to_media.end()) {
+        MediaInfo& info = _media_infos[rtx_iter->second];
+        info.rtx_pt = parse_rtp_payload_type(rtc::ArrayView<const uint8_t>(
+                    (const uint8_t*)data, len));
+        if (info.media_pt < 0) {
+            return 0;
+        }
+
+        len = restore_rtx_packet(rtc::ArrayView<const uint8_t>((const uint8_t*)data, len),
+                info.media_pt, rtx_iter->second, (uint8_t*)restored, sizeof(restored));
+        if (0 == len) {
+            return 0;
+        }
+
+        data = restored;
+        ssrc = rtx_iter->second;
+    }
+
+    if (has_history(ssrc)) {
+        if (!_history->put(data, len)) {
+            return 0;
+        }
+
+        auto info_iter = _media_infos.find(ssrc);
+        if (info_iter != _media_infos.end()) {
+            info_iter->second.media_pt = parse_rtp_payload_type(
+                    rtc::ArrayView<const uint8_t>((const uint8_t*)data, len));
+        }
+    }
+
+    // 和NACK历史共用同一个包
+    if (_gop_cache && _gop_cache->has_ssrc(ssrc)) {
+        _gop_cache->put(data, len, has_history(ssrc)
+                ? _history->get(ssrc, parse_rtp_sequence_number(
+                        rtc::ArrayView<const uint8_t>((const uint8_t*)data, len)))
+                : nullptr);
+    }
+
+    const std::vector<DtlsSrtpTransport*>* transports = nullptr;
+    if (_routes.empty() && !_simulcast) {
+        transports = &_transports[(int)MediaType::MEDIA_TYPE_AUDIO].transports;
+    } else {
+        auto route_iter = _routes.find(ssrc);
+        if (route_iter != _routes.end() && route_iter->second.layer >= 0) {
+            // 每个订阅者的包头不同，由SimulcastForwarder改写后批量发送
+            return _simulcast->forward(route_iter->second.layer, data, len,
+                    rtc::TimeMillis());
+        }
+
+        if (route_iter != _routes.end()) {
+            transports = route_iter->second.transports;
+            Sender* sender = route_iter->second.sender;
+            size_t header_len = 0;
+            size_t payload_len = 0;
+            if (sender && parse_rtp_layout(rtc::ArrayView<const uint8_t>(
+                            (const uint8_t*)data, len), &header_len, &payload_len))
+            {
+                ++sender->packets;
+                sender->octets += payload_len;
+            }
+
+            if (_svc_enabled && !_svc && !_simulcast &&
+                    transports == &_transports[(int)MediaType::MEDIA_TYPE_VIDEO].transports &&
+                    _is_svc_packet(data, len))
+            {
+                _setup_svc(ssrc);
+            }
+
+            // 每个订阅者丢弃的层不同，由SvcForwarder改写后批量发送
+            if (_svc && _svc->ssrc() == ssrc) {
+                return _svc->forward(data, len, rtc::TimeMillis());
+            }
+        }
+    }
+
+    if (!transports) {
+        if (_unknown_ssrc_packets++ % 1000 == 0) {
+            RTC_LOG(LS_WARNING) << "drop rtp packet with unknown ssrc: " << ssrc
+                << ", count: " << _unknown_ssrc_packets;
+        }
+        return -1;
+    }
+
+    if (transports->empty()) {
+        return 0;
+    }
+
+    return DtlsSrtpTransport::send_rtp_batch(*transports, data, len);
+}
+
+void SubscriberSet::set_sources(const std::vector<StreamParams>& audio_source,
+        const std::vector<StreamParams>& video_source,
+        size_t history_size)
+{
+    // 已有的订阅者按新的方式接收视频(重新设置推流源时)
+    std::vector<uint64_t> uids;
+    std::vector<PullStream*> streams;
+    std::vector<DtlsSrtpTransport*> transports;
+    if (_simulcast) {
+        _simulcast->get_subscribers(&uids, &streams, &transports);
+        _simulcast.reset();
+    }
+
+    // 重新协商后编码可能变化，收到包时重新判断
+    _svc.reset();
+
+    _routes.clear();
+    _senders.clear();
+    _media_infos.clear();
+    _rtx_to_media.clear();
+    _video_ssrcs.clear();
+    _history.reset(history_size > 0 ? new RtpPacketHistory(history_size) : nullptr);
+
+    // ssrc变化后缓存失效，正在回放的订阅者直接转发直播
+    _gop_cache.reset();
+    for (auto& replay : _replays) {
+        _transports[(int)MediaType::MEDIA_TYPE_VIDEO].add(replay.uid, replay.transport);
+    }
+    _replays.clear();
+
+    _add_routes(audio_source, MediaType::MEDIA_TYPE_AUDIO);
+    _add_routes(video_source, MediaType::MEDIA_TYPE_VIDEO);
+    _setup_simulcast(video_source);
+
+    TransportList& video = _transports[(int)MediaType::MEDIA_TYPE_VIDEO];
+    if (_simulcast) {
+        for (size_t i = 0; i < video.uids.size(); ++i) {
+            uids.push_back(video.uids[i]);
+            streams.push_back(find(video.uids[i]));
+            transports.push_back(video.transports[i]);
+        }
+
+        video = TransportList();
+        for (size_t i = 0; i < uids.size(); ++i) {
+            _simulcast->add(uids[i], streams[i], transports[i]);
+        }
+    } else {
+        for (size_t i = 0; i < uids.size(); ++i) {
+            video.add(uids[i], transports[i]);
+        }
+    }
+}
+
+void SubscriberSet::set_video_codecs(
+        const std::unordered_map<uint8_t, VideoCodecType>& codecs)
+{
+    _video_codecs = codecs;
+    if (_simulcast) {
+        _simulcast->set_codecs(codecs);
+    }
+}
+
+// a=ssrc-group:SIM <低> <中> <高>，或者a=simulcast中的RID(从低到高)。
+// 订阅者看到的是最低层的ssrc(RID方式随机生成)，只支持一个simulcast的视频track
+void SubscriberSet::_setup_simulcast(const std::vector<StreamParams>& video_source) {
+    for (auto& stream : video_source) {
+        std::vector<SimulcastLayer> layers;
+        uint32_t ssrc = 0;
+        uint32_t rtx_ssrc = 0;
+        for (auto& group : stream.ssrc_groups) {
+            if ("SIM" != group.semantics || group.ssrcs.size() < 2) {
+                continue;
+            }
+
+            for (uint32_t layer_ssrc : group.ssrcs) {
+                SimulcastLayer layer;
+                layer.ssrc = layer_ssrc;
+                layers.push_back(layer);
+            }
+
+            ssrc = group.ssrcs[0];
+            auto iter = _media_infos.find(ssrc);
+            rtx_ssrc = iter != _media_infos.end() ? iter->second.rtx_ssrc : 0;
+            break;
+        }
+
+        if (layers.empty() && stream.rids.size() > 1) {
+            for (auto& rid : stream.rids) {
+                SimulcastLayer layer;
+                layer.rid = rid;
+                layers.push_back(layer);
+            }
+
+            ssrc = rtc::CreateRandomNonZeroId();
+            rtx_ssrc = rtc::CreateRandomNonZeroId();
+        }
+
+        if (layers.empty()) {
+            continue;
+        }
+
+        _simulcast.reset(new SimulcastForwarder(layers, ssrc, rtx_ssrc));
+        _simulcast->set_codecs(_video_codecs);
+        for (size_t i = 0; i < layers.size(); ++i) {
+            if (layers[i].ssrc != 0) {
+                _routes[layers[i].ssrc].layer = (int)i;
+            }
+        }
+
+        _simulcast_source = stream;
+        _simulcast_source.rids.clear();
+        _simulcast_source.ssrcs.assign(1, ssrc);
+        _simulcast_source.ssrc_groups.clear();
+        if (rtx_ssrc != 0) {
+            _simulcast_source.ssrcs.push_back(rtx_ssrc);
+            _simulcast_source.ssrc_groups.push_back(SsrcGroup("FID", {ssrc, rtx_ssrc}));
+        }
+
+        if (_simulcast_source.cname.empty()) {
+            _simulcast_source.cname = std::to_string(ssrc);
+        }
+        if (_simulcast_source.stream_id.empty()) {
+            _simulcast_source.stream_id = _simulcast_source.cname;
+        }
+        if (_simulcast_source.id.empty()) {
+            _simulcast_source.id = "video";
+        }
+
+        RTC_LOG(LS_INFO) << "simulcast layers: " << layers.size() << ", ssrc: " << ssrc
+            << ", rtx_ssrc: " << rtx_ssrc;
+        return;
+    }
+}
+
+void SubscriberSet::_learn_simulcast_ssrc(rtc::ArrayView<const uint8_t> packet,
+        uint32_t ssrc)
+{
+    const uint8_t* value = nullptr;
+    size_t value_len = 0;
+    if (find_rtp_header_extension(packet, _rid_ext_id, &value, &value_len)) {
+        std::string rid((const char*)value, value_len);
+        int layer = _simulcast->find_layer(rid);
+        if (layer < 0 || _simulcast->layers()[layer].ssrc != 0) {
+            return;
+        }
+
+        _simulcast->set_layer_ssrc(layer, ssrc);
+        Sender& sender = _senders[ssrc];
+        sender.clockrate = k_video_clockrate;
+        sender.cname = _simulcast_source.cname;
+        Route& route = _routes[ssrc];
+        route.sender = &sender;
+        route.layer = layer;
+        _video_ssrcs.push_back(ssrc);
+        if (_history) {
+            _history->add_ssrc(ssrc);
+        }
+
+        RTC_LOG(LS_INFO) << "simulcast layer: " << layer << ", rid: " << rid
+            << ", ssrc: " << ssrc;
+        return;
+    }
+
+    // RTX的repaired-rtp-stream-id是对应层的RID
+    if (find_rtp_header_extension(packet, _repaired_rid_ext_id, &value, &value_len)) {
+        int layer = _simulcast->find_layer(std::string((const char*)value, value_len));
+        uint32_t media_ssrc = layer >= 0 ? _simulcast->layers()[layer].ssrc : 0;
+        if (media_ssrc != 0) {
+            _media_infos[media_ssrc].rtx_ssrc = ssrc;
+            _rtx_to_media[ssrc] = media_ssrc;
+        }
+    }
+}
+
+void SubscriberSet::get_subscriber_video_source(std::vector<StreamParams>* source) {
+    if (_simulcast) {
+        source->assign(1, _simulcast_source);
+    }
+}
+
+size_t SubscriberSet::select_layers(int64_t now_ms, uint8_t* buf, size_t max_len) {
+    std::vector<uint32_t> ssrcs;
+    if (_simulcast) {
+        _simulcast->select_layers(now_ms, &ssrcs);
+    }
+
+    bool keyframe_needed = false;
+    if (_svc) {
+        _svc->select_layers(now_ms, &keyframe_needed);
+    }
+    if (keyframe_needed) {
+        ssrcs.push_back(_svc->ssrc());
+    }
+
+    // 和订阅者的PLI一起合并
+    size_t total = 0;
+    for (uint32_t ssrc : ssrcs) {
+        total += on_keyframe_request(_rtcp_ssrc, ssrc, false, now_ms,
+                buf + total, max_len - total);
+    }
+
+    return total;
+}
+
+uint32_t SubscriberSet::source_ssrc(uint64_t uid, uint32_t ssrc) {
+    if (!_simulcast || ssrc != _simulcast->ssrc()) {
+        return ssrc;
+    }
+
+    uint32_t current_ssrc = _simulcast->current_ssrc(uid);
+    return current_ssrc != 0 ? current_ssrc : ssrc;
+}
+
+bool SubscriberSet::source_sequence_number(uint64_t uid, uint32_t ssrc, uint16_t seq,
+        uint16_t* source_seq)
+{
+    if (_svc && ssrc == _svc->ssrc()) {
+        *source_seq = _svc->source_sequence_number(uid, seq);
+        return true;
+    }
+
+    if (!_simulcast || ssrc != _simulcast->ssrc()) {
+        *source_seq = seq;
+        return true;
+    }
+
+    const RtpMunger* munger = _simulcast->munger(uid);
+    return munger && munger->source_sequence_number(seq, source_seq);
+}
+
+// 一个track的所有ssrc(包括rtx、fec)走同一种媒体的通道
+void SubscriberSet::_add_routes(const std::vector<StreamParams>& source, MediaType type) {
+    const std::vector<DtlsSrtpTransport*>* transports = &_transports[(int)type].transports;
+    for (auto& stream : source) {
+        for (uint32_t ssrc : stream.ssrcs) {
+            _routes[ssrc].transports = transports;
+        }
+
+        std::vector<uint32_t> rtx_ssrcs;
+        for (auto& group : stream.ssrc_groups) {
+            for (uint32_t ssrc : group.ssrcs) {
+                _routes[ssrc].transports = transports;
+            }
+
+            // a=ssrc-group:FID <media ssrc> <rtx ssrc>
+            if ("FID" == group.semantics && group.ssrcs.size() == 2) {
+                _media_infos[group.ssrcs[0]].rtx_ssrc = group.ssrcs[1];
+                _rtx_to_media[group.ssrcs[1]] = group.ssrcs[0];
+                rtx_ssrcs.push_back(group.ssrcs[1]);
+            }
+        }
+
+        for (uint32_t ssrc : stream.ssrcs) {
+            if (std::find(rtx_ssrcs.begin(), rtx_ssrcs.end(), ssrc) != rtx_ssrcs.end()) {
+                continue;
+            }
+
+            Sender& sender = _senders[ssrc];
+            sender.clockrate = MediaType::MEDIA_TYPE_VIDEO == type
+                ? k_video_clockrate : k_audio_clockrate;
+            sender.cname = stream.cname;
+            _routes[ssrc].sender = &sender;
+
+            // 音频没有协商nack，只有视频保存历史
+            if (MediaType::MEDIA_TYPE_VIDEO != type) {
+                continue;
+            }
+
+            _video_ssrcs.push_back(ssrc);
+            if (_history) {
+                _history->add_ssrc(ssrc);
+            }
+        }
+    }
+}
+
+void SubscriberSet::enable_gop_cache(size_t max_bytes,
+        const std::unordered_map<uint8_t, VideoCodecType>& codecs)
+{
+    // simulcast的订阅者从所选层的关键帧开始接收，不回放GOP
+    if (_simulcast) {
+        return;
+    }
+
+    _gop_cache.reset(new GopCache(max_bytes));
+    for (uint32_t ssrc : _video_ssrcs) {
+        _gop_cache->add_ssrc(ssrc);
+    }
+
+    for (auto& item : codecs) {
+        _gop_cache->set_codec(item.first, item.second);
+    }
+}
+
+const Gop* SubscriberSet::_find_replay_gop(uint32_t* ssrc) {
+    for (uint32_t video_ssrc : _video_ssrcs) {
+        const Gop* gop = _gop_cache->find(video_ssrc);
+        if (gop) {
+            *ssrc = video_ssrc;
+            return gop;
+        }
+    }
+
+    return nullptr;
+}
+
+void SubscriberSet::pace_replays(size_t budget) {
+    for (size_t i = 0; i < _replays.size();) {
+        Replay& replay = _replays[i];
+        if (!_replay(replay, budget)) {
+            ++i;
+            continue;
+        }
+
+        _add_video_transport(replay.uid, replay.transport);
+        _replays[i] = _replays.back();
+        _replays.pop_back();
+    }
+}
+
+void SubscriberSet::_start_replay(Replay& replay, const Gop& gop) {
+    replay.started = true;
+    replay.next = 0;
+    replay.snapshot = gop.packets.size();
+    replay.frames = 0;
+    replay.frame_index = 0;
+
+    for (auto& packet : gop.packets) {
+        uint32_t ts = parse_rtp_timestamp(rtc::ArrayView<const uint8_t>(
+                    (const uint8_t*)packet->data, packet->size));
+        if (0 == replay.frames || is_newer_timestamp(ts, replay.last_ts)) {
+            replay.last_ts = ts;
+            ++replay.frames;
+        }
+    }
+
+    replay.frame_ts = gop.keyframe_ts;
+}
+
+bool SubscriberSet::_replay(Replay& replay, size_t budget) {
+    // 等待DTLS-SRTP建立
+    if (!replay.transport->is_srtp_active()) {
+        return false;
+    }
+
+    const Gop* gop = _gop_cache->find(replay.ssrc);
+    if (!gop) {
+        return true;
+    }
+
+    // 回放期间又来了新的关键帧，从新的GOP开始
+    if (!replay.started || gop->generation != replay.generation) {
+        replay.generation = gop->generation;
+        _start_replay(replay, *gop);
+    }
+
+    char buf[k_packet_buffer_capacity];
+    size_t sent = 0;
+    while (replay.next < gop->packets.size() && sent < budget) {
+        const HistoryPacket& packet = *gop->packets[replay.next];
+        const char* data = packet.data;
+        if (replay.next < replay.snapshot) {
+            uint32_t ts = parse_rtp_timestamp(rtc::ArrayView<const uint8_t>(
+                        (const uint8_t*)packet.data, packet.size));
+            if (is_newer_timestamp(ts, replay.frame_ts)) {
+                replay.frame_ts = ts;
+                ++replay.frame_index;
+            }
+
+            // 每帧间隔一个时钟单位，最后一帧保持原来的时间戳
+            uint32_t gap = replay.frame_index + 1 < replay.frames
+                ? replay.frames - 1 - replay.frame_index : 0;
+            memcpy(buf, packet.data, packet.size);
+            rtc::ByteWriter<uint32_t>::WriteBigEndian((uint8_t*)buf + 4,
+                    replay.last_ts - gap);
+            data = buf;
+        }
+
+        replay.transport->send_rtp(data, packet.size);
+        sent += packet.size;
+        ++replay.next;
+    }
+
+    return replay.next >= gop->packets.size();
+}
+
+bool SubscriberSet::should_request(uint32_t ssrc, uint16_t seq, int64_t now_ms) {
+    return _history && _history->should_request(ssrc, seq, now_ms,
+            k_upstream_nack_interval_ms);
+}
+
+int SubscriberSet::retransmit(PullStream* to, const HistoryPacket& packet) {
+    rtc::ArrayView<const uint8_t> view((const uint8_t*)packet.data, packet.size);
+    uint32_t ssrc = parse_rtp_ssrc(view);
+
+    // simulcast的包改写成这个订阅者看到的ssrc和序号，SVC的包改写序号
+    uint8_t munged[k_packet_buffer_capacity];
+    if (_simulcast && _simulcast->find_layer(ssrc) >= 0) {
+        memcpy(munged, packet.data, packet.size);
+        if (!_simulcast->rewrite_retransmit(to->get_uid(), munged, packet.size)) {
+            return -1;
+        }
+        view = rtc::ArrayView<const uint8_t>(munged, packet.size);
+    } else if (_svc && ssrc == _svc->ssrc()) {
+        memcpy(munged, packet.data, packet.size);
+        _svc->rewrite_retransmit(to->get_uid(), munged, packet.size);
+        view = rtc::ArrayView<const uint8_t>(munged, packet.size);
+    }
+
+    auto iter = _media_infos.find(ssrc);
+    uint32_t rtx_ssrc = iter != _media_infos.end() ? iter->second.rtx_ssrc : 0;
+    if (_simulcast && _simulcast->find_layer(ssrc) >= 0) {
+        rtx_ssrc = _simulcast->rtx_ssrc();
+    }
+
+    if (iter == _media_infos.end() || 0 == rtx_ssrc || iter->second.rtx_pt < 0) {
+        return to->send_rtp((const char*)view.data(), view.size());
+    }
+
+    uint8_t rtx[k_packet_buffer_capacity];
+    size_t len = build_rtx_packet(view, iter->second.rtx_pt, rtx_ssrc,
+            to->next_rtx_seq(rtx_ssrc), rtx, sizeof(rtx));
+    if (0 == len) {
+        return -1;
+    }
+
+    return to->send_rtp((const char*)rtx, len);
+}
+
+size_t SubscriberSet::_send_keyframe_request(uint32_t media_ssrc,
+        KeyframeRequest& request, int64_t now_ms, uint8_t* buf, size_t max_len)
+{
+    size_t len = request.fir
+        ? build_rtcp_fir(request.sender_ssrc, media_ssrc, ++request.fir_seq, buf, max_len)
+        : build_rtcp_pli(request.sender_ssrc, media_ssrc, buf, max_len);
+    if (0 == len) {
+        return 0;
+    }
+
+    if (request.pending) {
+        request.pending = false;
+        --_pending_keyframe_requests;
+    }
+
+    request.fir = false;
+    request.last_sent_ms = now_ms;
+    ++_keyframe_stats.sent;
+    return len;
+}
+
+size_t SubscriberSet::on_keyframe_request(uint32_t sender_ssrc, uint32_t media_ssrc,
+        bool fir, int64_t now_ms, uint8_t* buf, size_t max_len)
+{
+    ++_keyframe_stats.received;
+
+    KeyframeRequest& request = _keyframe_requests[media_ssrc];
+    request.sender_ssrc = sender_ssrc;
+    request.fir = request.fir || fir;
+
+    if (request.last_sent_ms < 0 ||
+            now_ms - request.last_sent_ms >= _keyframe_request_interval_ms)
+    {
+        return _send_keyframe_request(media_ssrc, request, now_ms, buf, max_len);
+    }
+
+    // 窗口内已经请求过，推流端的关键帧很可能还没有到达。
+    // 第一个被合并的请求等窗口结束后补发，之后的不会再发送
+    if (request.pending) {
+        ++_keyframe_stats.suppressed;
+    } else {
+        request.pending = true;
+        ++_pending_keyframe_requests;
+    }
+
+    return 0;
+}
+
+void SubscriberSet::_on_keyframe_received(uint32_t ssrc, const char* data, size_t len,
+        int64_t now_ms)
+{
+    auto iter = _keyframe_requests.find(ssrc);
+    if (iter == _keyframe_requests.end() || !iter->second.pending ||
+            now_ms <= iter->second.last_sent_ms)
+    {
+        return;
+    }
+
+    rtc::ArrayView<const uint8_t> view((const uint8_t*)data, len);
+    auto codec_iter = _video_codecs.find(parse_rtp_payload_type(view));
+    size_t header_len = 0;
+    size_t payload_len = 0;
+    RtpVideoHeader header;
+    if (codec_iter == _video_codecs.end() ||
+            !parse_rtp_layout(view, &header_len, &payload_len) ||
+            !parse_rtp_video_header(codec_iter->second, view.data() + header_len,
+                payload_len, &header) ||
+            !header.frame_start || !header.keyframe)
+    {
+        return;
+    }
+
+    // 上次请求之后推流端已经发来了关键帧，补发的请求不再需要
+    KeyframeRequest& request = iter->second;
+    request.pending = false;
+    request.fir = false;
+    --_pending_keyframe_requests;
+    ++_keyframe_stats.suppressed;
+}
+
+size_t SubscriberSet::flush_keyframe_requests(int64_t now_ms, uint8_t* buf,
+        size_t max_len)
+{
+    size_t total = 0;
+    for (auto& item : _keyframe_requests) {
+        KeyframeRequest& request = item.second;
+        if (!request.pending ||
+                now_ms - request.last_sent_ms < _keyframe_request_interval_ms)
+        {
+            continue;
+        }
+
+        total += _send_keyframe_request(item.first, request, now_ms,
+                buf + total, max_len - total);
+    }
+
+    return total;
+}
+
+void SubscriberSet::on_sender_report(const RtcpSenderInfo& info, int64_t now_ms) {
+    auto iter = _senders.find(info.ssrc);
+    if (iter == _senders.end()) {
+        return;
+    }
+
+    iter->second.has_sr = true;
+    iter->second.sr = info;
+    iter->second.sr_ms = now_ms;
+}
+
+void SubscriberSet::build_sender_reports(int64_t now_ms, uint64_t ntp_now,
+        std::vector<std::string>* packets)
+{
+    uint8_t buf[k_packet_buffer_capacity];
+    std::vector<RtcpReportBlock> no_blocks;
+    for (auto& item : _senders) {
+        Sender& sender = item.second;
+        if (!sender.has_sr) {
+            continue;
+        }
+
+        if (_simulcast && _simulcast->find_layer(item.first) >= 0) {
+            continue;
+        }
+
+        RtcpSenderInfo info;
+        info.ssrc = item.first;
+        info.ntp = ntp_now;
+        info.rtp_ts = _rtp_timestamp(sender, now_ms);
+        info.packets = sender.packets;
+        info.octets = sender.octets;
+
+        size_t len = build_rtcp_sr(info, no_blocks, buf, sizeof(buf));
+        if (0 == len) {
+            continue;
+        }
+
+        len += build_rtcp_sdes(item.first, sender.cname, buf + len, sizeof(buf) - len);
+        packets->emplace_back((const char*)buf, len);
+    }
+}
+
+// 按推流端SR之后经过的时间推算当前的RTP时间戳
+uint32_t SubscriberSet::_rtp_timestamp(const Sender& sender, int64_t now_ms) {
+    return sender.sr.rtp_ts + (uint32_t)((now_ms - sender.sr_ms) * sender.clockrate / 1000);
+}
+
+bool SubscriberSet::build_simulcast_sender_report(uint64_t uid, int64_t now_ms,
+        uint64_t ntp_now, std::string* packet)
+{
+    if (!_simulcast) {
+        return false;
+    }
+
+    const RtpMunger* munger = _simulcast->munger(uid);
+    auto iter = _senders.find(_simulcast->current_ssrc(uid));
+    if (!munger || iter == _senders.end() || !iter->second.has_sr) {
+        return false;
+    }
+
+    RtcpSenderInfo info;
+    info.ssrc = _simulcast->ssrc();
+    info.ntp = ntp_now;
+    info.rtp_ts = _rtp_timestamp(iter->second, now_ms) + munger->timestamp_offset();
+    info.packets = munger->packets();
+    info.octets = munger->octets();
+
+    uint8_t buf[k_packet_buffer_capacity];
+    std::vector<RtcpReportBlock> no_blocks;
+    size_t len = build_rtcp_sr(info, no_blocks, buf, sizeof(buf));
+    if (0 == len) {
+        return false;
+    }
+
+    len += build_rtcp_sdes(info.ssrc, _simulcast_source.cname, buf + len,
+            sizeof(buf) - len);
+    packet->assign((const char*)buf, len);
+    return true;
+}
+
+void SubscriberSet::on_remb(uint32_t sender_ssrc, uint64_t bitrate_bps, int64_t now_ms) {
+    Remb& remb = _rembs[sender_ssrc];
+    remb.bitrate_bps = bitrate_bps;
+    remb.update_ms = now_ms;
+}
+
+bool SubscriberSet::get_remb(int64_t now_ms, uint64_t* bitrate_bps) {
+    bool found = false;
+    for (auto iter = _rembs.begin(); iter != _rembs.end();) {
+        if (now_ms - iter->second.update_ms > k_remb_timeout_ms) {
+            iter = _rembs.erase(iter);
+            continue;
+        }
+
+        bool better = _simulcast ? iter->second.bitrate_bps > *bitrate_bps
+            : iter->second.bitrate_bps < *bitrate_bps;
+        if (!found || better) {
+            *bitrate_bps = iter->second.bitrate_bps;
+            found = true;
+        }
+        ++iter;
+    }
+
+    return found;
+}
+
+} // namespace xrtc
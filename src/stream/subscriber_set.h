@@ -0,0 +1,276 @@
+#ifndef __SUBSCRIBER_SET_H_
+#define __SUBSCRIBER_SET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <api/array_view.h>
+
+#include "module/rtp_rtcp/gop_cache.h"
+#include "module/rtp_rtcp/rtcp_report.h"
+#include "module/rtp_rtcp/rtp_packet_history.h"
+#include "pc/session_description.h"
+#include "pc/stream_params.h"
+#include "stream/simulcast_forwarder.h"
+#include "stream/svc_forwarder.h"
+
+namespace xrtc {
+
+class PullStream;
+class DtlsSrtpTransport;
+
+struct KeyframeRequestStats {
+    uint64_t received = 0;   // 订阅者(或其他worker)发来的PLI/FIR
+    uint64_t sent = 0;       // 发给推流端的
+    uint64_t suppressed = 0; // 被合并、最终没有发出的
+};
+
+// 一个推流的所有订阅者。订阅者和它们每种媒体的发送通道分别保存在连续的数组中，
+// 转发时直接遍历通道数组；按uid的索引保证加入和离开都是O(1)，
+// 删除时把最后一个元素移动到被删除的位置
+class SubscriberSet {
+public:
+    SubscriberSet();
+    ~SubscriberSet() = default;
+
+    SubscriberSet(const SubscriberSet&) = delete;
+    SubscriberSet& operator=(const SubscriberSet&) = delete;
+
+    // uid已经存在时返回false。没有订阅某种媒体时对应的transport为nullptr，
+    // bundle时音视频是同一个transport
+    bool add(uint64_t uid, PullStream* stream, DtlsSrtpTransport* audio_transport,
+            DtlsSrtpTransport* video_transport);
+    // 返回被删除的订阅者，不存在时返回nullptr
+    PullStream* remove(uint64_t uid);
+    PullStream* find(uint64_t uid);
+
+    size_t size() { return _streams.size(); }
+    bool empty() { return _streams.empty(); }
+    const std::vector<PullStream*>& streams() { return _streams; }
+    const std::vector<DtlsSrtpTransport*>& transports(MediaType type) {
+        return _transports[(int)type].transports;
+    }
+
+    // 根据推流SDP中的ssrc建立路由表: ssrc -> 媒体类型 -> 订阅者的发送通道。
+    // history_size大于0时为视频ssrc保存最近转发的包，用于响应NACK
+    void set_sources(const std::vector<StreamParams>& audio_source,
+            const std::vector<StreamParams>& video_source,
+            size_t history_size = 0);
+    // 只解析ssrc，查路由表后批量加密发送给对应媒体的订阅者。
+    // 推流端的RTX包恢复成原始包再转发，重复的包丢弃。
+    // 返回发送的个数，未知的ssrc返回-1
+    int forward_rtp(const char* data, size_t len);
+    // 视频的payload type到编码格式的映射，用于识别关键帧
+    void set_video_codecs(const std::unordered_map<uint8_t, VideoCodecType>& codecs);
+
+    // 推流的视频是simulcast(a=ssrc-group:SIM或者RID)时，每个订阅者只接收一层。
+    // RID方式的层按头扩展识别ssrc，id为0表示没有协商
+    void set_rid_extensions(int rid_ext_id, int repaired_rid_ext_id) {
+        _rid_ext_id = rid_ext_id;
+        _repaired_rid_ext_id = repaired_rid_ext_id;
+    }
+    bool has_simulcast() { return _simulcast != nullptr; }
+    // simulcast时替换成订阅者SDP中的视频track: 一个固定的ssrc(和RTX)
+    void get_subscriber_video_source(std::vector<StreamParams>* source);
+    // 可伸缩编码(VP9、AV1)的视频按订阅者丢弃增强层，不是simulcast时才生效。
+    // 收到第一个VP9/AV1的包时开始，dependency_descriptor_ext_id为0表示没有协商
+    void enable_svc(int dependency_descriptor_ext_id) {
+        _svc_enabled = true;
+        _dd_ext_id = dependency_descriptor_ext_id;
+    }
+    bool has_svc() { return _svc != nullptr; }
+    // 定时调用，按订阅者的目标码率选择层。需要关键帧的层的PLI写入buf，返回长度
+    size_t select_layers(int64_t now_ms, uint8_t* buf, size_t max_len);
+    // simulcast时订阅者反馈中的ssrc和序号换算成推流端当前层的，SVC时换算序号，
+    // 其他情况不变。切换之前的序号返回false
+    uint32_t source_ssrc(uint64_t uid, uint32_t ssrc);
+    bool source_sequence_number(uint64_t uid, uint32_t ssrc, uint16_t seq,
+            uint16_t* source_seq);
+
+    // NACK响应
+    bool has_history(uint32_t ssrc) { return _history && _history->has_ssrc(ssrc); }
+    std::shared_ptr<const HistoryPacket> find_packet(uint32_t ssrc, uint16_t seq) {
+        return _history ? _history->get(ssrc, seq) : nullptr;
+    }
+    // 服务器也没有收到的包是否需要向推流端请求
+    bool should_request(uint32_t ssrc, uint16_t seq, int64_t now_ms);
+    // 重传给一个订阅者，推流端协商了RTX时使用RTX
+    int retransmit(PullStream* to, const HistoryPacket& packet);
+
+    // 关键帧请求(PLI/FIR)在服务器终结，按推流ssrc合并，每个窗口最多向推流端请求一次。
+    // 需要立即请求时把PLI/FIR写入buf并返回长度；被合并的请求在窗口结束后补发一次，
+    // 在这之前收到了新的关键帧就不再补发
+    void set_keyframe_request_interval(int64_t interval_ms) {
+        _keyframe_request_interval_ms = interval_ms;
+    }
+    size_t on_keyframe_request(uint32_t sender_ssrc, uint32_t media_ssrc, bool fir,
+            int64_t now_ms, uint8_t* buf, size_t max_len);
+    bool has_pending_keyframe_request() { return _pending_keyframe_requests > 0; }
+    // 窗口已经结束的合并请求，返回写入buf的长度
+    size_t flush_keyframe_requests(int64_t now_ms, uint8_t* buf, size_t max_len);
+    const KeyframeRequestStats& keyframe_request_stats() { return _keyframe_stats; }
+
+    // GOP缓存，在set_sources之后开启。codecs是视频的payload type到编码格式的映射。
+    // 开启后新加入的订阅者先回放缓存的GOP，追上直播之后才加入视频的转发通道
+    void enable_gop_cache(size_t max_bytes,
+            const std::unordered_map<uint8_t, VideoCodecType>& codecs);
+    GopCache* gop_cache() { return _gop_cache.get(); }
+    bool has_replays() { return !_replays.empty(); }
+    // 定时调用，每个DTLS-SRTP已经建立的订阅者最多回放budget字节
+    void pace_replays(size_t budget);
+
+    // RTCP在每一段连接上终结，服务器给订阅者发自己的SR:
+    // NTP和RTP时间戳的对应关系来自推流端的SR，包数和字节数是服务器转发的
+    void on_sender_report(const RtcpSenderInfo& info, int64_t now_ms);
+    // 每个收到过SR的推流ssrc生成一个复合包(SR + SDES)，simulcast的层除外
+    void build_sender_reports(int64_t now_ms, uint64_t ntp_now,
+            std::vector<std::string>* packets);
+    // simulcast时每个订阅者看到的视频ssrc的SR，时间戳按这个订阅者的改写换算。
+    // 不是simulcast或者当前层还没有SR时返回false
+    bool build_simulcast_sender_report(uint64_t uid, int64_t now_ms, uint64_t ntp_now,
+            std::string* packet);
+    int64_t next_report_ms() { return _next_report_ms; }
+    void set_next_report_ms(int64_t next_report_ms) { _next_report_ms = next_report_ms; }
+
+    // 订阅者(或其他worker)的REMB只保留最近的估计，向上游发送最小值；
+    // simulcast时发送最大值，带宽不够的订阅者接收低的层
+    void on_remb(uint32_t sender_ssrc, uint64_t bitrate_bps, int64_t now_ms);
+    bool get_remb(int64_t now_ms, uint64_t* bitrate_bps);
+    const std::vector<uint32_t>& video_ssrcs() { return _video_ssrcs; }
+    // 服务器在这个推流上发送RTCP使用的ssrc
+    uint32_t rtcp_ssrc() { return _rtcp_ssrc; }
+
+    // 未知的ssrc返回nullptr；推流SDP中没有ssrc时所有包按音频的通道转发
+    const std::vector<DtlsSrtpTransport*>* find_route(uint32_t ssrc) {
+        if (_routes.empty()) {
+            return &_transports[(int)MediaType::MEDIA_TYPE_AUDIO].transports;
+        }
+
+        auto iter = _routes.find(ssrc);
+        return iter != _routes.end() ? iter->second.transports : nullptr;
+    }
+
+private:
+    struct TransportList {
+        std::vector<DtlsSrtpTransport*> transports;
+        std::vector<uint64_t> uids;
+        std::unordered_map<uint64_t, size_t> index;
+
+        void add(uint64_t uid, DtlsSrtpTransport* transport);
+        void remove(uint64_t uid);
+    };
+
+    void _add_routes(const std::vector<StreamParams>& source, MediaType type);
+    // 视频的转发通道，SVC时同时加入SvcForwarder
+    void _add_video_transport(uint64_t uid, DtlsSrtpTransport* transport);
+    bool _is_svc_packet(const char* data, size_t len);
+    void _setup_svc(uint32_t ssrc);
+
+    // 推流的媒体ssrc在服务器到订阅者这一段的发送状态
+    struct Sender {
+        int clockrate = 0;
+        std::string cname;
+        bool has_sr = false;
+        RtcpSenderInfo sr; // 推流端最近的SR
+        int64_t sr_ms = 0;
+        uint32_t packets = 0;
+        uint32_t octets = 0;
+    };
+
+    struct Route {
+        const std::vector<DtlsSrtpTransport*>* transports = nullptr;
+        Sender* sender = nullptr; // RTX等没有SR的ssrc为nullptr
+        int layer = -1;           // simulcast的层，由SimulcastForwarder转发
+    };
+
+    uint32_t _rtp_timestamp(const Sender& sender, int64_t now_ms);
+    void _setup_simulcast(const std::vector<StreamParams>& video_source);
+    // RID方式的层在收到第一个包时才知道ssrc
+    void _learn_simulcast_ssrc(rtc::ArrayView<const uint8_t> packet, uint32_t ssrc);
+
+    struct Remb {
+        uint64_t bitrate_bps = 0;
+        int64_t update_ms = 0;
+    };
+
+    // 回放的GOP之前的帧时间戳被压缩到最后一帧之前，接收端快速解码后立即显示最新的帧；
+    // 序号不变，回放结束后直播的包和重传的包正好接上
+    struct Replay {
+        uint64_t uid = 0;
+        DtlsSrtpTransport* transport = nullptr;
+        uint32_t ssrc = 0;
+        uint64_t generation = 0;
+        bool started = false;
+        size_t next = 0;         // 下一个要发送的包
+        size_t snapshot = 0;     // 开始回放时GOP中的包数，只改写这些包的时间戳
+        uint32_t last_ts = 0;    // 开始回放时最后一帧的时间戳
+        uint32_t frames = 0;     // 开始回放时的帧数
+        uint32_t frame_index = 0;
+        uint32_t frame_ts = 0;   // 当前帧的原始时间戳
+    };
+
+    const Gop* _find_replay_gop(uint32_t* ssrc);
+    void _start_replay(Replay& replay, const Gop& gop);
+    // 返回是否结束(追上直播或者缓存已经失效)
+    bool _replay(Replay& replay, size_t budget);
+
+    struct KeyframeRequest {
+        int64_t last_sent_ms = -1;
+        bool pending = false;
+        bool fir = false;
+        uint32_t sender_ssrc = 0;
+        uint8_t fir_seq = 0;
+    };
+
+    size_t _send_keyframe_request(uint32_t media_ssrc, KeyframeRequest& request,
+            int64_t now_ms, uint8_t* buf, size_t max_len);
+    // 等待补发的请求在收到新的关键帧时取消
+    void _on_keyframe_received(uint32_t ssrc, const char* data, size_t len,
+            int64_t now_ms);
+
+    // 媒体ssrc的RTX信息，payload type从推流端的包中学习
+    struct MediaInfo {
+        uint32_t rtx_ssrc = 0;
+        int media_pt = -1;
+        int rtx_pt = -1;
+    };
+
+private:
+    std::vector<PullStream*> _streams;
+    std::vector<uint64_t> _uids;
+    std::unordered_map<uint64_t, size_t> _index;
+    TransportList _transports[2]; // 按MediaType索引
+    std::unordered_map<uint32_t, Route> _routes;
+    std::unordered_map<uint32_t, Sender> _senders;
+    int64_t _next_report_ms = 0;
+    std::unordered_map<uint32_t, Remb> _rembs;
+    uint32_t _rtcp_ssrc;
+    uint64_t _unknown_ssrc_packets = 0;
+    std::unique_ptr<RtpPacketHistory> _history;
+    std::unordered_map<uint32_t, MediaInfo> _media_infos;
+    std::unordered_map<uint32_t, uint32_t> _rtx_to_media;
+    std::vector<uint32_t> _video_ssrcs; // 视频的媒体ssrc，不包括RTX
+    std::unordered_map<uint8_t, VideoCodecType> _video_codecs;
+    std::unique_ptr<GopCache> _gop_cache;
+    std::unique_ptr<SimulcastForwarder> _simulcast;
+    StreamParams _simulcast_source; // 订阅者看到的视频track
+    int _rid_ext_id = 0;
+    int _repaired_rid_ext_id = 0;
+    // 订阅者同时在视频的TransportList中，其他视频ssrc照常转发
+    std::unique_ptr<SvcForwarder> _svc;
+    bool _svc_enabled = false;
+    int _dd_ext_id = 0;
+    std::vector<Replay> _replays;
+    int64_t _keyframe_request_interval_ms = 500;
+    std::unordered_map<uint32_t, KeyframeRequest> _keyframe_requests;
+    int _pending_keyframe_requests = 0;
+    KeyframeRequestStats _keyframe_stats;
+};
+
+} // namespace xrtc
+
+#endif // __SUBSCRIBER_SET_H_
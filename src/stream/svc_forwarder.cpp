@@ -0,0 +1,307 @@
+#include "stream/svc_forwarder.h"
+
+#include <algorithm>
+
+#include "base/packet_buffer.h"
+#include "module/rtp_rtcp/rtp_utils.h"
+#include "pc/dtls_srtp_transport.h"
+#include "stream/pull_stream.h"
+
+namespace xrtc {
+
+// 每层码率的统计周期
+const int64_t k_svc_stats_interval_ms = 1000;
+// 上次切换之后至少经过这么久才升层
+const int64_t k_svc_upgrade_interval_ms = 3000;
+// 升层时累计码率不能超过目标码率的比例
+const double k_svc_upgrade_ratio = 0.9;
+
+SvcForwarder::Viewer::Viewer(uint64_t uid, PullStream* stream,
+        DtlsSrtpTransport* transport, uint32_t ssrc) :
+    uid(uid), stream(stream), transport(transport),
+    munger(ssrc, k_video_clockrate)
+{
+}
+
+void SvcForwarder::add(uint64_t uid, PullStream* stream, DtlsSrtpTransport* transport) {
+    if (_index.find(uid) != _index.end()) {
+        return;
+    }
+
+    _index[uid] = _viewers.size();
+    _viewers.emplace_back(uid, stream, transport, _ssrc);
+}
+
+void SvcForwarder::remove(uint64_t uid) {
+    auto iter = _index.find(uid);
+    if (iter == _index.end()) {
+        return;
+    }
+
+    size_t pos = iter->second;
+    _index.erase(iter);
+
+    size_t last = _viewers.size() - 1;
+    if (pos != last) {
+        std::swap(_viewers[pos], _viewers[last]);
+        _index[_viewers[pos].uid] = pos;
+    }
+
+    _viewers.pop_back();
+}
+
+SvcForwarder::Viewer* SvcForwarder::_find_viewer(uint64_t uid) {
+    auto iter = _index.find(uid);
+    return iter != _index.end() ? &_viewers[iter->second] : nullptr;
+}
+
+// VP9的层在payload描述符中，AV1的层在依赖描述符中
+void SvcForwarder::_parse_layers(const uint8_t* data, size_t len, PacketLayers* layers) {
+    rtc::ArrayView<const uint8_t> view(data, len);
+    size_t header_len = 0;
+    size_t payload_len = 0;
+    if (!parse_rtp_layout(view, &header_len, &payload_len)) {
+        return;
+    }
+
+    auto iter = _codecs.find(parse_rtp_payload_type(view));
+    RtpVideoHeader header;
+    if (iter == _codecs.end() ||
+            !parse_rtp_video_header(iter->second, data + header_len, payload_len, &header))
+    {
+        return;
+    }
+
+    if (VideoCodecType::k_vp9 == iter->second) {
+        if (!header.has_layers || header.spatial_id >= k_max_layers ||
+                header.temporal_id >= k_max_layers)
+        {
+            return;
+        }
+
+        layers->spatial_id = header.spatial_id;
+        layers->temporal_id = header.temporal_id;
+        layers->picture_start = header.frame_start;
+        layers->keyframe = header.keyframe;
+        layers->frame_end = header.frame_end;
+    } else if (VideoCodecType::k_av1 == iter->second) {
+        const uint8_t* value = nullptr;
+        size_t value_len = 0;
+        DependencyDescriptor descriptor;
+        if (!find_rtp_header_extension(view, _dd_ext_id, &value, &value_len) ||
+                !parse_dependency_descriptor(value, value_len, &_structure, &descriptor) ||
+                descriptor.spatial_id >= k_max_layers ||
+                descriptor.temporal_id >= k_max_layers)
+        {
+            return;
+        }
+
+        // 关键帧携带模板依赖结构
+        layers->spatial_id = descriptor.spatial_id;
+        layers->temporal_id = descriptor.temporal_id;
+        layers->picture_start = descriptor.start_of_frame && 0 == descriptor.spatial_id;
+        layers->keyframe = layers->picture_start &&
+            (descriptor.has_structure || header.keyframe);
+        layers->frame_end = descriptor.end_of_frame;
+    } else {
+        return;
+    }
+
+    layers->has_layers = true;
+}
+
+void SvcForwarder::_switch_layers(Viewer& viewer, const PacketLayers& layers,
+        int64_t now_ms)
+{
+    bool switched = false;
+    if (viewer.target_spatial < viewer.spatial ||
+            (viewer.target_spatial > viewer.spatial && layers.keyframe))
+    {
+        viewer.spatial = viewer.target_spatial;
+        switched = true;
+    }
+
+    // 时间层高的帧只参考低的层，从TL0开始的帧都可以解码
+    if (viewer.target_temporal < viewer.temporal ||
+            (viewer.target_temporal > viewer.temporal && 0 == layers.temporal_id))
+    {
+        viewer.temporal = viewer.target_temporal;
+        switched = true;
+    }
+
+    if (switched) {
+        viewer.last_switch_ms = now_ms;
+    }
+}
+
+int SvcForwarder::forward(const char* data, size_t len, int64_t now_ms) {
+    PacketLayers layers;
+    _parse_layers((const uint8_t*)data, len, &layers);
+    _bytes[layers.spatial_id][layers.temporal_id] += len;
+    if (_viewers.empty()) {
+        return 0;
+    }
+
+    uint16_t seq = parse_rtp_sequence_number(
+            rtc::ArrayView<const uint8_t>((const uint8_t*)data, len));
+
+    // 线程内复用，避免每个包分配内存
+    static thread_local std::vector<PacketBuffer> buffers;
+    static thread_local std::vector<DtlsSrtpTransport*> targets;
+    buffers.clear();
+    targets.clear();
+
+    for (auto& viewer : _viewers) {
+        if (!viewer.transport->is_srtp_active()) {
+            continue;
+        }
+
+        if (layers.picture_start) {
+            _switch_layers(viewer, layers, now_ms);
+        }
+
+        if (layers.has_layers && (layers.spatial_id > viewer.spatial ||
+                    layers.temporal_id > viewer.temporal))
+        {
+            viewer.munger.drop(seq);
+            continue;
+        }
+
+        buffers.emplace_back();
+        PacketBuffer& packet = buffers.back();
+        if (!packet.set_data(data, len) ||
+                !viewer.munger.rewrite((uint8_t*)packet.data(), len, nullptr, now_ms))
+        {
+            buffers.pop_back();
+            continue;
+        }
+
+        // 更高的空间层被丢弃时，接收端按M位确定一个图像结束
+        if (layers.frame_end && layers.spatial_id == viewer.spatial) {
+            ((uint8_t*)packet.data())[1] |= 0x80;
+        }
+
+        targets.push_back(viewer.transport);
+    }
+
+    if (targets.empty()) {
+        return 0;
+    }
+
+    // 缓冲区发送完就归还
+    int sent = DtlsSrtpTransport::send_rtp_batch(targets, buffers);
+    buffers.clear();
+    targets.clear();
+    return sent;
+}
+
+void SvcForwarder::_update_bitrates(int64_t now_ms) {
+    if (_last_update_ms < 0) {
+        _last_update_ms = now_ms;
+        return;
+    }
+
+    int64_t elapsed_ms = now_ms - _last_update_ms;
+    if (elapsed_ms < k_svc_stats_interval_ms) {
+        return;
+    }
+
+    _max_spatial = -1;
+    _max_temporal = -1;
+    for (int s = 0; s < k_max_layers; ++s) {
+        for (int t = 0; t < k_max_layers; ++t) {
+            _bitrates[s][t] = (int64_t)_bytes[s][t] * 8 * 1000 / elapsed_ms;
+            if (_bytes[s][t] > 0) {
+                _max_spatial = std::max(_max_spatial, s);
+                _max_temporal = std::max(_max_temporal, t);
+            }
+            _bytes[s][t] = 0;
+        }
+    }
+
+    _last_update_ms = now_ms;
+}
+
+// 接收(spatial_id, temporal_id)需要的码率，包括所有更低的层
+int64_t SvcForwarder::_bitrate(int spatial_id, int temporal_id) {
+    int64_t bitrate_bps = 0;
+    for (int s = 0; s <= spatial_id; ++s) {
+        for (int t = 0; t <= temporal_id; ++t) {
+            bitrate_bps += _bitrates[s][t];
+        }
+    }
+
+    return bitrate_bps;
+}
+
+// 优先空间层，同一个空间层选最高的时间层；最低的层总是可以选。
+// 没有带宽估计(没有协商transport-wide-cc)时不丢弃
+void SvcForwarder::_select_layers(Viewer& viewer, int64_t now_ms, bool* keyframe_needed) {
+    int64_t target_bps = viewer.stream->target_bitrate_bps();
+    int spatial = k_max_layers - 1;
+    int temporal = k_max_layers - 1;
+    if (target_bps >= 0) {
+        int current_spatial = std::min(viewer.target_spatial, _max_spatial);
+        int current_temporal = std::min(viewer.target_temporal, _max_temporal);
+        spatial = 0;
+        temporal = 0;
+        for (int s = 0; s <= _max_spatial; ++s) {
+            for (int t = 0; t <= _max_temporal; ++t) {
+                bool upgrade = s > current_spatial ||
+                    (s == current_spatial && t > current_temporal);
+                int64_t bitrate_bps = _bitrate(s, t);
+                if (upgrade && (bitrate_bps > target_bps * k_svc_upgrade_ratio ||
+                            now_ms - viewer.last_switch_ms < k_svc_upgrade_interval_ms))
+                {
+                    continue;
+                }
+
+                if (!upgrade && bitrate_bps > target_bps) {
+                    continue;
+                }
+
+                spatial = s;
+                temporal = t;
+            }
+        }
+    }
+
+    if (std::min(spatial, _max_spatial) > std::min(viewer.spatial, _max_spatial)) {
+        *keyframe_needed = true;
+    }
+
+    viewer.target_spatial = spatial;
+    viewer.target_temporal = temporal;
+}
+
+void SvcForwarder::select_layers(int64_t now_ms, bool* keyframe_needed) {
+    _update_bitrates(now_ms);
+    if (_max_spatial < 0) {
+        return;
+    }
+
+    for (auto& viewer : _viewers) {
+        if (viewer.transport->is_srtp_active()) {
+            _select_layers(viewer, now_ms, keyframe_needed);
+        }
+    }
+}
+
+uint16_t SvcForwarder::source_sequence_number(uint64_t uid, uint16_t seq) {
+    Viewer* viewer = _find_viewer(uid);
+    uint16_t source_seq = 0;
+    if (viewer && viewer->munger.source_sequence_number(seq, &source_seq)) {
+        return source_seq;
+    }
+
+    return seq;
+}
+
+void SvcForwarder::rewrite_retransmit(uint64_t uid, uint8_t* packet, size_t len) {
+    Viewer* viewer = _find_viewer(uid);
+    if (viewer) {
+        viewer->munger.rewrite_retransmit(packet, len, nullptr);
+    }
+}
+
+} // namespace xrtc
@@ -0,0 +1,101 @@
+#ifndef __SVC_FORWARDER_H_
+#define __SVC_FORWARDER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "module/rtp_rtcp/dependency_descriptor.h"
+#include "module/rtp_rtcp/rtp_munger.h"
+#include "module/rtp_rtcp/rtp_video_header.h"
+
+namespace xrtc {
+
+class PullStream;
+class DtlsSrtpTransport;
+
+// 一个推流的可伸缩编码(VP9、AV1)视频ssrc: 每个订阅者按目标码率选择空间层和时间层，
+// 更高的层不发送。序号由每个订阅者的RtpMunger改写，丢弃的包不会被当成丢包。
+// 空间层只在关键帧处升高，时间层在TL0的帧处升高，降低都在新的帧开始时
+class SvcForwarder {
+public:
+    static const int k_max_layers = 8;
+
+    explicit SvcForwarder(uint32_t ssrc) : _ssrc(ssrc) {}
+    ~SvcForwarder() = default;
+
+    uint32_t ssrc() { return _ssrc; }
+    void set_codecs(const std::unordered_map<uint8_t, VideoCodecType>& codecs) {
+        _codecs = codecs;
+    }
+    // AV1的层在依赖描述符中，0表示没有协商
+    void set_dependency_descriptor_extension(int ext_id) { _dd_ext_id = ext_id; }
+
+    void add(uint64_t uid, PullStream* stream, DtlsSrtpTransport* transport);
+    void remove(uint64_t uid);
+
+    // 每个订阅者过滤、改写后批量发送，返回发送的个数
+    int forward(const char* data, size_t len, int64_t now_ms);
+    // 定时调用: 统计每层的码率，为每个订阅者选择层。有订阅者需要升高空间层时
+    // keyframe_needed为true
+    void select_layers(int64_t now_ms, bool* keyframe_needed);
+
+    // 订阅者看到的序号 -> 推流端的序号，过滤之前发出的包序号没有改写
+    uint16_t source_sequence_number(uint64_t uid, uint16_t seq);
+    // 重传的包改写成这个订阅者看到的序号
+    void rewrite_retransmit(uint64_t uid, uint8_t* packet, size_t len);
+
+private:
+    // 包的层信息，没有层信息的包发送给所有订阅者
+    struct PacketLayers {
+        bool has_layers = false;
+        int spatial_id = 0;
+        int temporal_id = 0;
+        bool picture_start = false; // 空间层0的帧的第一个包
+        bool keyframe = false;
+        bool frame_end = false;     // 空间层帧的最后一个包
+    };
+
+    struct Viewer {
+        Viewer(uint64_t uid, PullStream* stream, DtlsSrtpTransport* transport,
+                uint32_t ssrc);
+
+        uint64_t uid;
+        PullStream* stream;
+        DtlsSrtpTransport* transport;
+        // 开始时不过滤，第一次选层之后生效
+        int spatial = k_max_layers - 1;
+        int temporal = k_max_layers - 1;
+        int target_spatial = k_max_layers - 1;
+        int target_temporal = k_max_layers - 1;
+        int64_t last_switch_ms = 0;
+        RtpMunger munger;
+    };
+
+    Viewer* _find_viewer(uint64_t uid);
+    void _parse_layers(const uint8_t* data, size_t len, PacketLayers* layers);
+    void _switch_layers(Viewer& viewer, const PacketLayers& layers, int64_t now_ms);
+    void _update_bitrates(int64_t now_ms);
+    int64_t _bitrate(int spatial_id, int temporal_id);
+    void _select_layers(Viewer& viewer, int64_t now_ms, bool* keyframe_needed);
+
+private:
+    uint32_t _ssrc;
+    std::unordered_map<uint8_t, VideoCodecType> _codecs;
+    int _dd_ext_id = 0;
+    FrameDependencyStructure _structure;
+    std::vector<Viewer> _viewers;
+    std::unordered_map<uint64_t, size_t> _index;
+
+    // 按[空间层][时间层]统计
+    size_t _bytes[k_max_layers][k_max_layers] = {};
+    int64_t _bitrates[k_max_layers][k_max_layers] = {};
+    int _max_spatial = -1; // 上个统计周期收到的最高层，没有统计时为-1
+    int _max_temporal = -1;
+    int64_t _last_update_ms = -1;
+};
+
+} // namespace xrtc
+
+#endif // __SVC_FORWARDER_H_
@@ -8,6 +8,7 @@
 #define CMDNO_ANSWER   3
 #define CMDNO_STOPPUSH 4
 #define CMDNO_STOPPULL 5
+#define CMDNO_ICE_RESTART 6
 
 #include <string>
 